@@ -0,0 +1,377 @@
+// Microbenchmarks for the kernels that dominate CFR, resolving and bucketing time.  Every kernel
+// does a fixed amount of work on inputs generated from a fixed seed, once to warm up and then
+// <reps> timed times, so results are comparable across builds on the same machine.  Results go
+// to stdout as a single JSON object (progress and library chatter go to stderr).
+//
+// The TCFR kernel is only run if the CFR params name the tcfr algorithm, and the bucket lookup
+// kernel only if the card abstraction has buckets on the final street.  Optional trailing
+// arguments restrict the run to the named kernels.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "betting_abstraction.h"
+#include "betting_abstraction_params.h"
+#include "betting_tree.h"
+#include "board_tree.h"
+#include "buckets.h"
+#include "canonical_cards.h"
+#include "card_abstraction.h"
+#include "card_abstraction_params.h"
+#include "cfr_config.h"
+#include "cfr_params.h"
+#include "cfr_utils.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "hand_value_tree.h"
+#include "params.h"
+#include "sampler.h"
+#include "tcfr.h"
+
+using std::string;
+using std::unique_ptr;
+using std::vector;
+
+// Keeps the compiler from discarding the work being timed
+static volatile double g_sink = 0;
+
+struct BenchResult {
+  string name;
+  long long int ops_per_rep;
+  vector<double> secs;
+};
+
+static double Now(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1000000000.0;
+}
+
+template <typename F>
+static void Bench(const char *name, long long int ops_per_rep, int reps, F f,
+		  vector<BenchResult> *results) {
+  fprintf(stderr, "Benchmarking %s\n", name);
+  BenchResult result;
+  result.name = name;
+  result.ops_per_rep = ops_per_rep;
+  f();
+  for (int r = 0; r < reps; ++r) {
+    double start = Now();
+    f();
+    result.secs.push_back(Now() - start);
+  }
+  results->push_back(result);
+}
+
+static void WriteJSON(const CardAbstraction &ca, const BettingAbstraction &ba,
+		      const CFRConfig &cc, int reps, const vector<BenchResult> &results) {
+  printf("{\n");
+  printf("  \"game\": \"%s\",\n", Game::GameName().c_str());
+  printf("  \"card_abstraction\": \"%s\",\n", ca.CardAbstractionName().c_str());
+  printf("  \"betting_abstraction\": \"%s\",\n", ba.BettingAbstractionName().c_str());
+  printf("  \"cfr_config\": \"%s\",\n", cc.CFRConfigName().c_str());
+  printf("  \"reps\": %i,\n", reps);
+  printf("  \"kernels\": [");
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult &result = results[i];
+    vector<double> secs = result.secs;
+    std::sort(secs.begin(), secs.end());
+    double median = secs[secs.size() / 2];
+    printf("%s\n    {\"name\": \"%s\", \"ops_per_rep\": %lli, \"min_secs\": %.6f, "
+	   "\"median_secs\": %.6f, \"max_secs\": %.6f, \"ops_per_sec\": %.1f}",
+	   i == 0 ? "" : ",", result.name.c_str(), result.ops_per_rep, secs[0], median,
+	   secs.back(), median > 0 ? result.ops_per_rep / median : 0);
+  }
+  printf("\n  ]\n}\n");
+  fflush(stdout);
+}
+
+// Finds the first showdown or fold terminal in the tree
+static Node *FindTerminal(Node *node, bool showdown) {
+  if (node->Terminal()) {
+    return node->Showdown() == showdown ? node : nullptr;
+  }
+  int num_succs = node->NumSuccs();
+  for (int s = 0; s < num_succs; ++s) {
+    Node *terminal = FindTerminal(node->IthSucc(s), showdown);
+    if (terminal) return terminal;
+  }
+  return nullptr;
+}
+
+// Fixed-seed inputs shared by the kernels
+class BenchInputs {
+public:
+  BenchInputs(int num_boards);
+  int NumBoards(void) const {return boards_.size();}
+  int Board(int i) const {return boards_[i];}
+  const CanonicalCards *Hands(int i) const {return hands_[i].get();}
+  double *OppProbs(void) const {return opp_probs_.get();}
+private:
+  vector<int> boards_;
+  vector< unique_ptr<CanonicalCards> > hands_;
+  unique_ptr<double []> opp_probs_;
+};
+
+// Samples num_boards final-street boards and builds their sorted hands
+BenchInputs::BenchInputs(int num_boards) {
+  int max_street = Game::MaxStreet();
+  int num_board_cards = Game::NumBoardCards(max_street);
+  int total_boards = BoardTree::NumBoards(max_street);
+  RNG rng(0);
+  for (int i = 0; i < num_boards; ++i) {
+    int bd = rng.RandBelow(total_boards);
+    boards_.push_back(bd);
+    const Card *board = BoardTree::Board(max_street, bd);
+    CanonicalCards *hands = new CanonicalCards(2, board, num_board_cards,
+					       BoardTree::SuitGroups(max_street, bd), false);
+    hands->SortByHandStrength(board);
+    hands_.emplace_back(hands);
+  }
+  int max_card1 = Game::MaxCard() + 1;
+  opp_probs_.reset(new double[max_card1 * max_card1]);
+  for (int enc = 0; enc < max_card1 * max_card1; ++enc) opp_probs_[enc] = rng.RandZeroToOne();
+}
+
+static void BenchHandValueTree(int reps, vector<BenchResult> *results) {
+  const int kNumHands = 1000000;
+  int max_street = Game::MaxStreet();
+  int num_cards = Game::NumBoardCards(max_street) + 2;
+  unique_ptr<Card []> cards(new Card[kNumHands * num_cards]);
+  RNG rng(1);
+  for (int i = 0; i < kNumHands; ++i) {
+    unsigned long long int deck = FullDeck();
+    for (int j = 0; j < num_cards; ++j) cards[i * num_cards + j] = DealCard(&rng, &deck);
+  }
+  Bench("hand_value_tree_val", kNumHands, reps, [&]() {
+      long long int sum = 0;
+      for (int i = 0; i < kNumHands; ++i) sum += HandValueTree::Val(&cards[i * num_cards]);
+      g_sink = sum;
+    }, results);
+}
+
+static void BenchCanonicalCards(const BenchInputs &inputs, int reps,
+				vector<BenchResult> *results) {
+  int max_street = Game::MaxStreet();
+  int num_board_cards = Game::NumBoardCards(max_street);
+  int num_boards = inputs.NumBoards();
+  Bench("canonical_cards", num_boards, reps, [&]() {
+      for (int i = 0; i < num_boards; ++i) {
+	int bd = inputs.Board(i);
+	const Card *board = BoardTree::Board(max_street, bd);
+	CanonicalCards hands(2, board, num_board_cards, BoardTree::SuitGroups(max_street, bd),
+			     false);
+	hands.SortByHandStrength(board);
+	g_sink = hands.HandValue(0);
+      }
+    }, results);
+}
+
+// Showdown()/Fold() are the per-node versions; terminal_probs is the shared pass that VCFR uses
+// for all the terminals facing the same opponent reach probabilities.
+static void BenchTerminals(Node *root, const BenchInputs &inputs, int reps,
+			   vector<BenchResult> *results) {
+  Node *showdown = FindTerminal(root, true);
+  Node *fold = FindTerminal(root, false);
+  int max_street = Game::MaxStreet();
+  int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
+  int num_boards = inputs.NumBoards();
+  double *opp_probs = inputs.OppProbs();
+  unique_ptr<double []> vals(new double[num_hole_card_pairs]);
+  unique_ptr<double []> fold_probs(new double[num_hole_card_pairs]);
+  unique_ptr<double []> showdown_probs(new double[num_hole_card_pairs]);
+  double total_card_probs[52];
+  // Small games have few hands per board; repeat so that each rep is long enough to time
+  const int kNumPasses = 64;
+  long long int ops_per_rep = (long long int)kNumPasses * num_boards * num_hole_card_pairs;
+  if (showdown) {
+    Bench("showdown", ops_per_rep, reps, [&]() {
+	for (int pass = 0; pass < kNumPasses; ++pass) {
+	  for (int i = 0; i < num_boards; ++i) {
+	    const CanonicalCards *hands = inputs.Hands(i);
+	    double sum_opp_probs;
+	    CommonBetResponseCalcs(max_street, hands, opp_probs, &sum_opp_probs,
+				   total_card_probs);
+	    Showdown(showdown, hands, opp_probs, sum_opp_probs, total_card_probs, vals.get());
+	    g_sink = vals[0];
+	  }
+	}
+      }, results);
+  }
+  if (fold) {
+    Bench("fold", ops_per_rep, reps, [&]() {
+	for (int pass = 0; pass < kNumPasses; ++pass) {
+	  for (int i = 0; i < num_boards; ++i) {
+	    const CanonicalCards *hands = inputs.Hands(i);
+	    double sum_opp_probs;
+	    CommonBetResponseCalcs(max_street, hands, opp_probs, &sum_opp_probs,
+				   total_card_probs);
+	    Fold(fold, 0, hands, opp_probs, sum_opp_probs, total_card_probs, vals.get());
+	    g_sink = vals[0];
+	  }
+	}
+      }, results);
+  }
+  Bench("terminal_probs", ops_per_rep, reps, [&]() {
+      for (int pass = 0; pass < kNumPasses; ++pass) {
+	for (int i = 0; i < num_boards; ++i) {
+	  TerminalProbs(inputs.Hands(i), opp_probs, fold_probs.get(), showdown_probs.get());
+	  g_sink = fold_probs[0] + showdown_probs[0];
+	}
+      }
+    }, results);
+}
+
+// Synthetic regrets for a three-succ node over kNumHands hands (or buckets)
+static void BenchRegretMatching(int reps, vector<BenchResult> *results) {
+  const int kNumHands = 1 << 16;
+  const int kNumSuccs = 3;
+  const int kNumCalls = 64;
+  RNG rng(2);
+  unique_ptr<int []> int_regrets(new int[kNumHands * kNumSuccs]);
+  unique_ptr<double []> double_regrets(new double[kNumHands * kNumSuccs]);
+  for (int i = 0; i < kNumHands * kNumSuccs; ++i) {
+    // Some zero regrets so that the positive-sum branch is exercised both ways
+    int r = (int)rng.RandBelow(2000000) - 500000;
+    int_regrets[i] = r < 0 ? 0 : r;
+    double_regrets[i] = int_regrets[i];
+  }
+  double probs[kNumSuccs];
+  Bench("rm_probs_int", (long long int)kNumCalls * kNumHands, reps, [&]() {
+      double sum = 0;
+      for (int c = 0; c < kNumCalls; ++c) {
+	for (int h = 0; h < kNumHands; ++h) {
+	  RMProbs(&int_regrets[h * kNumSuccs], kNumSuccs, 0, probs);
+	  sum += probs[0];
+	}
+      }
+      g_sink = sum;
+    }, results);
+  Bench("rm_probs_double", (long long int)kNumCalls * kNumHands, reps, [&]() {
+      double sum = 0;
+      for (int c = 0; c < kNumCalls; ++c) {
+	for (int h = 0; h < kNumHands; ++h) {
+	  RMProbs(&double_regrets[h * kNumSuccs], kNumSuccs, 0, probs);
+	  sum += probs[0];
+	}
+      }
+      g_sink = sum;
+    }, results);
+
+  // One final-street board's worth of hands mapped to random buckets
+  const int kNumBuckets = 1000;
+  int num_hole_card_pairs = Game::NumHoleCardPairs(Game::MaxStreet());
+  unique_ptr<int []> street_buckets(new int[num_hole_card_pairs]);
+  for (int i = 0; i < num_hole_card_pairs; ++i) street_buckets[i] = rng.RandBelow(kNumBuckets);
+  unique_ptr<double []> succ_vals_storage(new double[kNumSuccs * num_hole_card_pairs]);
+  double *succ_vals[kNumSuccs];
+  for (int s = 0; s < kNumSuccs; ++s) {
+    succ_vals[s] = &succ_vals_storage[s * num_hole_card_pairs];
+    for (int i = 0; i < num_hole_card_pairs; ++i) succ_vals[s][i] = rng.RandZeroToOne() - 0.5;
+  }
+  unique_ptr<double []> vals(new double[num_hole_card_pairs]);
+  const int kNumBucketedCalls = 4096;
+  Bench("compute_our_vals_bucketed", (long long int)kNumBucketedCalls * num_hole_card_pairs,
+	reps, [&]() {
+	  for (int c = 0; c < kNumBucketedCalls; ++c) {
+	    ComputeOurValsBucketed(int_regrets.get(), num_hole_card_pairs, kNumSuccs, 0, succ_vals,
+				   street_buckets.get(), vals.get());
+	    g_sink = vals[0];
+	  }
+	}, results);
+}
+
+static void BenchBuckets(const Buckets &buckets, int reps, vector<BenchResult> *results) {
+  const int kNumLookups = 1 << 22;
+  int max_street = Game::MaxStreet();
+  unsigned int num_hands =
+    ((unsigned int)BoardTree::NumBoards(max_street)) * Game::NumHoleCardPairs(max_street);
+  unique_ptr<unsigned int []> hands(new unsigned int[kNumLookups]);
+  RNG rng(3);
+  for (int i = 0; i < kNumLookups; ++i) hands[i] = rng.RandBelow(num_hands);
+  Bench("buckets_bucket", kNumLookups, reps, [&]() {
+      long long int sum = 0;
+      for (int i = 0; i < kNumLookups; ++i) sum += buckets.Bucket(max_street, hands[i]);
+      g_sink = sum;
+    }, results);
+}
+
+// Two single-threaded batches per rep, without checkpointing.  TCFR seeds each batch from the
+// batch index, so every build samples the same deals; the regrets carry over from rep to rep.
+static void BenchTCFR(const CardAbstraction &ca, const BettingAbstraction &ba,
+		      const CFRConfig &cc, const Buckets &buckets, int reps,
+		      vector<BenchResult> *results) {
+  const int kBatchSize = 100000;
+  TCFR tcfr(ca, ba, cc, buckets, 1, -1);
+  // Telemetry would write tcfr_stats.0 into the CFR directory of a real run
+  tcfr.SetTelemetryInterval(0);
+  Bench("tcfr_process", 2LL * kBatchSize, reps, [&]() {
+      tcfr.Run(0, 2, kBatchSize, 2);
+    }, results);
+}
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params> <card params> <betting params> <CFR params> "
+	  "<reps> (<kernel>...)\n", prog_name);
+  fprintf(stderr, "\nKernels: hand_value_tree canonical_cards terminals regret_matching "
+	  "buckets tcfr\n");
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 6) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  unique_ptr<Params> card_params = CreateCardAbstractionParams();
+  card_params->ReadFromFile(argv[2]);
+  unique_ptr<CardAbstraction>
+    card_abstraction(new CardAbstraction(*card_params));
+  unique_ptr<Params> betting_params = CreateBettingAbstractionParams();
+  betting_params->ReadFromFile(argv[3]);
+  unique_ptr<BettingAbstraction>
+    betting_abstraction(new BettingAbstraction(*betting_params));
+  unique_ptr<Params> cfr_params = CreateCFRParams();
+  cfr_params->ReadFromFile(argv[4]);
+  unique_ptr<CFRConfig> cfr_config(new CFRConfig(*cfr_params));
+  int reps;
+  if (sscanf(argv[5], "%i", &reps) != 1 || reps < 1) Usage(argv[0]);
+  vector<string> kernels;
+  for (int a = 6; a < argc; ++a) kernels.push_back(argv[a]);
+  auto selected = [&](const char *kernel) {
+    return kernels.empty() || std::find(kernels.begin(), kernels.end(), kernel) != kernels.end();
+  };
+
+  HandValueTree::Create();
+  BoardTree::Create();
+  Buckets buckets(*card_abstraction, false);
+  int max_street = Game::MaxStreet();
+  vector<BenchResult> results;
+
+  if (selected("hand_value_tree")) BenchHandValueTree(reps, &results);
+  if (selected("canonical_cards") || selected("terminals")) {
+    const int kNumBoards = 256;
+    BenchInputs inputs(kNumBoards);
+    if (selected("canonical_cards")) BenchCanonicalCards(inputs, reps, &results);
+    if (selected("terminals")) {
+      BettingTree betting_tree(*betting_abstraction);
+      BenchTerminals(betting_tree.Root(), inputs, reps, &results);
+    }
+  }
+  if (selected("regret_matching")) BenchRegretMatching(reps, &results);
+  if (selected("buckets") && ! buckets.None(max_street)) BenchBuckets(buckets, reps, &results);
+  if (selected("tcfr") && cfr_config->Algorithm() == "tcfr") {
+    BenchTCFR(*card_abstraction, *betting_abstraction, *cfr_config, buckets, reps, &results);
+  }
+
+  WriteJSON(*card_abstraction, *betting_abstraction, *cfr_config, reps, results);
+}
@@ -1,6 +1,10 @@
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
 #include <memory>
@@ -37,8 +41,9 @@ Node::Node(int id, int street, int player_acting, const shared_ptr<Node> &call_s
     num_bet_succs = bet_succs->size();
     num_succs += num_bet_succs;
   }
+  succs_ = nullptr;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
     int i = 0;
     if (call_succ) succs_[i++] = call_succ;
     if (fold_succ) succs_[i++] = fold_succ;
@@ -67,14 +72,15 @@ Node::Node(int id, int street, int player_acting, const shared_ptr<Node> &call_s
 
 Node::Node(Node *src) {
   int num_succs = src->NumSuccs();
+  succs_ = nullptr;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
   }
   for (int s = 0; s < num_succs; ++s) succs_[s] = NULL;
   id_ = src->id_;
   last_bet_to_ = src->last_bet_to_;
   num_succs_ = src->num_succs_;
-  flags_ = src->flags_;
+  flags_ = src->flags_ & ~kFlatFlag;
   player_acting_ = src->player_acting_;
   num_remaining_ = src->num_remaining_;
 }
@@ -84,11 +90,24 @@ Node::Node(int id, int last_bet_to, int num_succs, unsigned short flags,
   id_ = id;
   last_bet_to_ = last_bet_to;
   num_succs_ = num_succs;
+  succs_ = nullptr;
   if (num_succs > 0) {
-    succs_.reset(new shared_ptr<Node>[num_succs]);
+    succs_ = new shared_ptr<Node>[num_succs];
   }
   for (int s = 0; s < num_succs; ++s) succs_[s] = nullptr;
-  flags_ = flags;
+  flags_ = flags & ~kFlatFlag;
+  player_acting_ = player_acting;
+  num_remaining_ = num_remaining;
+}
+
+Node::Node(int id, int last_bet_to, int num_succs, unsigned short flags,
+	   unsigned char player_acting, unsigned char num_remaining,
+	   long long int succ_links_offset) {
+  succ_links_offset_ = succ_links_offset;
+  id_ = id;
+  last_bet_to_ = last_bet_to;
+  num_succs_ = num_succs;
+  flags_ = flags | kFlatFlag;
   player_acting_ = player_acting;
   num_remaining_ = num_remaining;
 }
@@ -150,7 +169,7 @@ void Node::PrintTree(int depth, const string &name, vector< vector< vector<bool>
       string new_name = name;
       if (st > last_st) new_name += " ";
       new_name += c;
-      succs_[s]->PrintTree(depth + 1, new_name, seen, st);
+      IthSucc(s)->PrintTree(depth + 1, new_name, seen, st);
     }
   }
 }
@@ -245,7 +264,7 @@ void BettingTree::FillTerminalArray(Node *node) {
 
 void BettingTree::FillTerminalArray(void) {
   terminals_.reset(new Node *[num_terminals_]);
-  if (root_.get()) FillTerminalArray(root_.get());
+  if (root_) FillTerminalArray(root_);
 }
 
 #if 0
@@ -411,23 +430,140 @@ Node *BettingTree::GetNodeFromName(const char *str) {
 }
 #endif
 
-// Used by the subtree constructor
-// This doesn't preserve the reentrancy of the source tree
-// It appears we inherit the nonterminal IDs of the source tree, although they may get
-// changed by the caller.
-shared_ptr<Node> BettingTree::Clone(Node *old_n, int *num_terminals) {
-  shared_ptr<Node> new_n(new Node(old_n));
-  if (new_n->Terminal()) {
-    // Need to reindex the terminal nodes
-    new_n->SetTerminalID(*num_terminals);
-    ++*num_terminals;
-  }
-  int num_succs = old_n->NumSuccs();
+static const char kFlatTreeMagic[8] = {'B', 'T', 'R', 'E', 'E', 'F', 'L', '1'};
+
+// Per-node fields gathered by Flatten() before we lay out the nodes
+struct FlatNodeFields {
+  int id;
+  int first_link;
+  unsigned short last_bet_to;
+  unsigned short num_succs;
+  unsigned short flags;
+  unsigned char player_acting;
+  unsigned char num_remaining;
+};
+
+static int FlattenNode(Node *node, bool preserve_reentrancy, int *num_terminals,
+		       unordered_map<Node *, int> *indices, vector<FlatNodeFields> *fields,
+		       vector<int> *links) {
+  if (preserve_reentrancy && ! node->Terminal()) {
+    auto it = indices->find(node);
+    if (it != indices->end()) return it->second;
+  }
+  int i = fields->size();
+  int num_succs = node->NumSuccs();
+  FlatNodeFields f;
+  f.id = node->ID();
+  f.first_link = links->size();
+  f.last_bet_to = node->LastBetTo();
+  f.num_succs = num_succs;
+  f.flags = node->Flags();
+  f.player_acting = node->PlayerActing();
+  f.num_remaining = node->NumRemaining();
+  fields->push_back(f);
+  if (num_succs == 0) {
+    if (num_terminals) (*fields)[i].id = (*num_terminals)++;
+    return i;
+  }
+  if (preserve_reentrancy) (*indices)[node] = i;
+  links->resize(f.first_link + num_succs);
   for (int s = 0; s < num_succs; ++s) {
-    shared_ptr<Node> new_succ(Clone(old_n->IthSucc(s), num_terminals));
-    new_n->SetIthSucc(s, new_succ);
+    int j = FlattenNode(node->IthSucc(s), preserve_reentrancy, num_terminals, indices, fields,
+			links);
+    (*links)[f.first_link + s] = j - i;
+  }
+  return i;
+}
+
+// Lays out the tree below root as a flat image (header, nodes, links).  If preserve_reentrancy
+// is false, a node reachable by multiple paths is laid out once per path.  If renumber_terminals
+// is true, terminal IDs are reassigned in DFS order.  The image is returned in an array of
+// unsigned long longs to guarantee alignment; *size gets its size in bytes.
+unique_ptr<unsigned long long int []> BettingTree::Flatten(Node *root, bool preserve_reentrancy,
+							   bool renumber_terminals,
+							   long long int *size) {
+  static_assert(sizeof(Node) % sizeof(long long int) == 0, "Node size not a multiple of 8");
+  unordered_map<Node *, int> indices;
+  vector<FlatNodeFields> fields;
+  vector<int> links;
+  int num_terminals = 0;
+  FlattenNode(root, preserve_reentrancy, renumber_terminals ? &num_terminals : nullptr,
+	      &indices, &fields, &links);
+  long long int num_nodes = fields.size();
+  long long int num_links = links.size();
+  long long int links_start = sizeof(FlatTreeHeader) + num_nodes * sizeof(Node);
+  *size = links_start + num_links * sizeof(int);
+  long long int num_words = (*size + sizeof(long long int) - 1) / sizeof(long long int);
+  // Zeroed so that padding bytes are written out deterministically
+  unique_ptr<unsigned long long int []> image(new unsigned long long int[num_words]());
+  char *bytes = (char *)image.get();
+  FlatTreeHeader *header = (FlatTreeHeader *)bytes;
+  memcpy(header->magic, kFlatTreeMagic, sizeof(header->magic));
+  header->num_nodes = num_nodes;
+  header->num_links = num_links;
+  header->node_size = sizeof(Node);
+  Node *nodes = (Node *)(bytes + sizeof(FlatTreeHeader));
+  for (long long int i = 0; i < num_nodes; ++i) {
+    const FlatNodeFields &f = fields[i];
+    long long int offset =
+      (links_start + f.first_link * sizeof(int)) - (sizeof(FlatTreeHeader) + i * sizeof(Node));
+    new (&nodes[i]) Node(f.id, f.last_bet_to, f.num_succs, f.flags, f.player_acting,
+			 f.num_remaining, offset);
+  }
+  if (num_links > 0) memcpy(bytes + links_start, links.data(), num_links * sizeof(int));
+  return image;
+}
+
+void BettingTree::WriteFlat(Node *root, const char *filename) {
+  long long int size;
+  unique_ptr<unsigned long long int []> image = Flatten(root, true, false, &size);
+  Writer writer(filename);
+  unsigned char *bytes = (unsigned char *)image.get();
+  const long long int kChunkSize = 1 << 20;
+  for (long long int i = 0; i < size; i += kChunkSize) {
+    long long int n = size - i < kChunkSize ? size - i : kChunkSize;
+    writer.WriteNBytes(bytes + i, n);
+  }
+}
+
+// The nodes are laid out in DFS order, so we can find the terminals and count the nonterminals
+// with a linear scan rather than by walking the (possibly reentrant) tree.
+void BettingTree::InitializeFlat(const FlatTreeHeader *header) {
+  if (header->node_size != sizeof(Node)) {
+    fprintf(stderr, "Flat betting tree node size %llu, expected %zu\n", header->node_size,
+	    sizeof(Node));
+    exit(-1);
+  }
+  long long int num_nodes = header->num_nodes;
+  Node *nodes = (Node *)((char *)header + sizeof(FlatTreeHeader));
+  root_ = &nodes[0];
+  int max_street = Game::MaxStreet();
+  int num_players = Game::NumPlayers();
+  num_nonterminals_.reset(new int[num_players * (max_street + 1)]);
+  for (int i = 0; i < num_players * (max_street + 1); ++i) num_nonterminals_[i] = 0;
+  num_terminals_ = 0;
+  for (long long int i = 0; i < num_nodes; ++i) {
+    Node *node = &nodes[i];
+    if (node->Terminal()) {
+      ++num_terminals_;
+    } else {
+      int index = node->PlayerActing() * (max_street + 1) + node->Street();
+      int nt = node->NonterminalID();
+      if (nt >= num_nonterminals_[index]) num_nonterminals_[index] = nt + 1;
+    }
+  }
+  terminals_.reset(new Node *[num_terminals_]);
+  for (long long int i = 0; i < num_nodes; ++i) {
+    Node *node = &nodes[i];
+    if (! node->Terminal()) continue;
+    int terminal_id = node->TerminalID();
+    if (terminal_id >= num_terminals_) {
+      fprintf(stderr, "Out of bounds terminal ID: %i (num terminals %i)\n",
+	      terminal_id, num_terminals_);
+      exit(-1);
+    }
+    terminals_[terminal_id] = node;
   }
-  return new_n;
 }
 
 shared_ptr<Node> BettingTree::Read(Reader *reader, unordered_map< int, shared_ptr<Node> > *maps) {
@@ -459,7 +595,8 @@ shared_ptr<Node> BettingTree::Read(Reader *reader, unordered_map< int, shared_pt
   return node;
 }
 
-// Maintain a map from ids to shared pointers to nodes.
+// Files in the flat format are mmapped.  We still read files in the old recursive format;
+// for those we maintain a map from ids to shared pointers to nodes.
 void BettingTree::Initialize(int target_player, const BettingAbstraction &ba) {
   char buf[500];
   if (ba.Asymmetric()) {
@@ -471,16 +608,49 @@ void BettingTree::Initialize(int target_player, const BettingAbstraction &ba) {
 	    Game::GameName().c_str(), Game::NumPlayers(),
 	    ba.BettingAbstractionName().c_str());
   }
-  Reader reader(buf);
   initial_street_ = ba.InitialStreet();
   root_ = nullptr;
+  mapped_image_ = nullptr;
+  mapped_size_ = 0;
   num_terminals_ = 0;
+
+  int fd = open(buf, O_RDONLY);
+  if (fd == -1) {
+    fprintf(stderr, "Couldn't open %s\n", buf);
+    exit(-1);
+  }
+  struct stat st_buf;
+  if (fstat(fd, &st_buf) == -1) {
+    fprintf(stderr, "Couldn't stat %s\n", buf);
+    exit(-1);
+  }
+  if (st_buf.st_size >= (long long int)sizeof(FlatTreeHeader)) {
+    // Private writable mapping so that callers can still set IDs on nodes
+    void *image = mmap(nullptr, st_buf.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (image == MAP_FAILED) {
+      fprintf(stderr, "mmap of %s failed\n", buf);
+      exit(-1);
+    }
+    const FlatTreeHeader *header = (const FlatTreeHeader *)image;
+    if (! memcmp(header->magic, kFlatTreeMagic, sizeof(header->magic))) {
+      close(fd);
+      mapped_image_ = image;
+      mapped_size_ = st_buf.st_size;
+      InitializeFlat(header);
+      return;
+    }
+    munmap(image, st_buf.st_size);
+  }
+  close(fd);
+
+  Reader reader(buf);
   int max_street = Game::MaxStreet();
   int num_players = Game::NumPlayers();
   int num_maps = (max_street + 1) * num_players;
   unique_ptr<unordered_map< int, shared_ptr<Node> > []>
     maps(new unordered_map< int, shared_ptr<Node> > [num_maps]);
-  root_ = Read(&reader, maps.get());
+  legacy_root_ = Read(&reader, maps.get());
+  root_ = legacy_root_.get();
   FillTerminalArray();
   num_nonterminals_.reset(new int[num_players * (max_street + 1)]);
   CountNumNonterminals(this, num_nonterminals_.get());
@@ -490,23 +660,37 @@ BettingTree::BettingTree(const BettingAbstraction &ba) {
   Initialize(0, ba);
 }
 
+BettingTree::~BettingTree(void) {
+  if (mapped_image_) munmap(mapped_image_, mapped_size_);
+}
+
 BettingTree::BettingTree(const BettingAbstraction &ba, int target_player) {
   Initialize(target_player, ba);
 }
 
 // A subtree constructor
 // This doesn't preserve the reentrancy of the source tree
+// It appears we inherit the nonterminal IDs of the source tree, although they get changed
+// below.
 BettingTree::BettingTree(Node *subtree_root) {
   int subtree_street = subtree_root->Street();
   initial_street_ = subtree_street;
+  mapped_image_ = nullptr;
+  mapped_size_ = 0;
+  long long int size;
+  flat_image_ = Flatten(subtree_root, false, true, &size);
+  const FlatTreeHeader *header = (const FlatTreeHeader *)flat_image_.get();
+  root_ = (Node *)((char *)flat_image_.get() + sizeof(FlatTreeHeader));
   num_terminals_ = 0;
-  root_ = Clone(subtree_root, &num_terminals_);
+  for (unsigned long long int i = 0; i < header->num_nodes; ++i) {
+    if (root_[i].Terminal()) ++num_terminals_;
+  }
   FillTerminalArray();
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   num_nonterminals_.reset(new int[num_players * (max_street + 1)]);
   // AssignNonterminalIDs() doesn't handle reentrancy yet.  We currently do not preserve the
-  // reentrancy of the source tree inside of Clone().  But if we did, then we would need to
+  // reentrancy of the source tree inside of Flatten().  But if we did, then we would need to
   // modify AssignNonterminalIDs() accordingly.
   AssignNonterminalIDs(this, num_nonterminals_.get());
 }
@@ -20,7 +20,9 @@ public:
   Node(Node *node);
   Node(int id, int last_bet_to, int num_succs, unsigned short flags, unsigned char player_acting,
        unsigned char num_remaining);
-  ~Node(void) {}
+  Node(const Node &) = delete;
+  Node &operator=(const Node &) = delete;
+  ~Node(void) {if (! Flat()) delete [] succs_;}
 
   int PlayerActing(void) const {return player_acting_;}
   bool Terminal(void) const {return NumSuccs() == 0;}
@@ -30,7 +32,13 @@ public:
     return (int)((flags_ & kStreetMask) >> kStreetShift);
   }
   int NumSuccs(void) const {return num_succs_;}
-  Node *IthSucc(int i) const {return succs_[i].get();}
+  Node *IthSucc(int i) const {
+    if (Flat()) {
+      const int *links = (const int *)((const char *)this + succ_links_offset_);
+      return const_cast<Node *>(this) + links[i];
+    }
+    return succs_[i].get();
+  }
   int NumRemaining(void) const {return num_remaining_;}
   bool Showdown(void) const {return Terminal() && num_remaining_ > 1;}
   int LastBetTo(void) const {return last_bet_to_;}
@@ -44,10 +52,11 @@ public:
   bool HasCallSucc(void) const {return (bool)(flags_ & kHasCallSuccFlag);}
   bool HasFoldSucc(void) const {return (bool)(flags_ & kHasFoldSuccFlag);}
   int ID(void) const {return id_;}
-  unsigned short Flags(void) const {return flags_;}
+  unsigned short Flags(void) const {return flags_ & ~kFlatFlag;}
   void SetTerminalID(int id) {id_ = id;}
   void SetNonterminalID(int id) {id_ = id;}
   void SetNumSuccs(int n) {num_succs_ = n;}
+  // Only for nodes under construction; the succs of a flat tree cannot be changed.
   void SetIthSucc(int s, std::shared_ptr<Node> succ) {succs_[s] = succ;}
   void SetHasCallSuccFlag(void) {flags_ |= kHasCallSuccFlag;}
   void SetHasFoldSuccFlag(void) {flags_ |= kHasFoldSuccFlag;}
@@ -58,14 +67,30 @@ public:
   // Bit 1: has-fold-succ
   // Bit 2: special (not currently used)
   // Bits 3,4: street
+  // Bit 5: flat (set on every node of a flat tree, in memory and in flat tree files)
   static const unsigned short kHasCallSuccFlag = 1;
   static const unsigned short kHasFoldSuccFlag = 2;
   static const unsigned short kSpecialFlag = 4;
   static const unsigned short kStreetMask = 24;
   static const int kStreetShift = 3;
+  static const unsigned short kFlatFlag = 32;
 
  private:
-  std::unique_ptr<std::shared_ptr<Node> []> succs_;
+  friend class BettingTree;
+
+  // For laying out nodes of a flat tree
+  Node(int id, int last_bet_to, int num_succs, unsigned short flags, unsigned char player_acting,
+       unsigned char num_remaining, long long int succ_links_offset);
+  bool Flat(void) const {return (bool)(flags_ & kFlatFlag);}
+
+  // Nodes built by BettingTreeBuilder and friends own an array of shared_ptrs to their succs.
+  // Nodes of a flat tree (see BettingTree) instead store the byte offset from the node to its
+  // succ links; each link is the distance in nodes from the node to the succ.  Nothing in a flat
+  // tree is an absolute address, so the tree can be mmapped straight from the file.
+  union {
+    std::shared_ptr<Node> *succs_;
+    long long int succ_links_offset_;
+  };
   int id_;
   short last_bet_to_;
   short num_succs_;
@@ -74,6 +99,18 @@ public:
   unsigned char num_remaining_;
 };
 
+// Betting trees are stored flat: a FlatTreeHeader followed by the nodes in DFS order and then the
+// succ links.  Reentrant nonterminals appear once.  The in-memory layout is identical to the file
+// layout so loading a tree is just an mmap; no pointer chasing through shared_ptr control blocks
+// and no rebuilding the reentrant nodes through hash maps.
+struct FlatTreeHeader {
+  char magic[8];
+  unsigned long long int num_nodes;
+  unsigned long long int num_links;
+  // sizeof(Node) when the file was written
+  unsigned long long int node_size;
+};
+
 class BettingTree {
  public:
   // Normal constructor
@@ -82,24 +119,35 @@ class BettingTree {
   BettingTree(const BettingAbstraction &ba, int target_player);
   // For cloning a (sub)tree
   BettingTree(Node *subtree_root);
-  virtual ~BettingTree(void) {}
+  virtual ~BettingTree(void);
   void Display(void) const;
   void Display(Node *node) const;
-  Node *Root(void) const {return root_.get();}
+  Node *Root(void) const {return root_;}
   int NumTerminals(void) const {return num_terminals_;}
   Node *Terminal(int i) const {return terminals_[i];}
   int NumNonterminals(int p, int st) const;
   int InitialStreet(void) const {return initial_street_;}
+  // Writes the tree below root in the flat format.  Reentrancy is preserved.
+  static void WriteFlat(Node *root, const char *filename);
 
  private:
+  static std::unique_ptr<unsigned long long int []> Flatten(Node *root, bool preserve_reentrancy,
+							    bool renumber_terminals,
+							    long long int *size);
   void FillTerminalArray(void);
   void FillTerminalArray(Node *node);
-  std::shared_ptr<Node> Clone(Node *old_n, int *num_terminals);
+  void InitializeFlat(const FlatTreeHeader *header);
   void Initialize(int target_player, const BettingAbstraction &ba);
   std::shared_ptr<Node> Read(Reader *reader,
 			     std::unordered_map< int, std::shared_ptr<Node> > *maps);
 
-  std::shared_ptr<Node> root_;
+  Node *root_;
+  // Owns the nodes of a tree read from a file in the old recursive format
+  std::shared_ptr<Node> legacy_root_;
+  // The flat image; either owned (subtrees) or mapped from the file
+  std::unique_ptr<unsigned long long int []> flat_image_;
+  void *mapped_image_;
+  long long int mapped_size_;
   int initial_street_;
   int num_terminals_;
   std::unique_ptr<Node * []> terminals_;
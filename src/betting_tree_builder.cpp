@@ -10,7 +10,6 @@
 #include "betting_tree_builder.h"
 #include "files.h"
 #include "game.h"
-#include "io.h"
 
 using std::shared_ptr;
 using std::unordered_map;
@@ -38,35 +37,17 @@ void BettingTreeBuilder::Build(void) {
   num_terminals_ = terminal_id;
 }
 
-// To handle reentrant trees we keep a boolean array of nodes that have
-// already been visited.  Note that even if a node has already been visited,
-// we still write out the properties of the node (ID, flags, pot size, etc.).
-// But we prevent ourselves from redundantly writing out the subtree below
-// the node more than once.
-void BettingTreeBuilder::Write(Node *node, vector< vector<int> > *num_nonterminals,
-			       Writer *writer) {
+// Nonterminal IDs are assigned in DFS order just before writing.  Reentrant nodes are reached
+// more than once; a node that already has an ID has been visited, so we don't descend into its
+// subtree again.
+void BettingTreeBuilder::AssignIDs(Node *node, vector< vector<int> > *num_nonterminals) {
+  if (node->ID() != -1) return;
   int st = node->Street();
-  int id = node->ID();
   int pa = node->PlayerActing();
-  bool nt_first_seen = (id == -1);
-  // Assign IDs during writing
-  if (nt_first_seen) {
-    id = (*num_nonterminals)[pa][st]++;
-    node->SetNonterminalID(id);
-  }
-  writer->WriteUnsignedInt(id);
-  writer->WriteUnsignedShort(node->LastBetTo());
-  writer->WriteUnsignedShort(node->NumSuccs());
-  writer->WriteUnsignedShort(node->Flags());
-  writer->WriteUnsignedChar(pa);
-  writer->WriteUnsignedChar(node->NumRemaining());
-  if (node->Terminal()) {
-    return;
-  }
-  if (! nt_first_seen) return;
+  node->SetNonterminalID((*num_nonterminals)[pa][st]++);
   int num_succs = node->NumSuccs();
   for (int s = 0; s < num_succs; ++s) {
-    Write(node->IthSucc(s), num_nonterminals, writer);
+    AssignIDs(node->IthSucc(s), num_nonterminals);
   }
 }
 
@@ -93,8 +74,8 @@ void BettingTreeBuilder::Write(void) {
     }
   }
   
-  Writer writer(buf);
-  Write(root_.get(), &num_nonterminals, &writer);
+  AssignIDs(root_.get(), &num_nonterminals);
+  BettingTree::WriteFlat(root_.get(), buf);
   for (int st = 0; st <= max_street; ++st) {
     int sum = 0;
     for (int pa = 0; pa < num_players; ++pa) {
@@ -0,0 +1,540 @@
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <memory>
+#include <vector>
+
+#include "block_codec.h"
+#include "io.h"
+
+using std::unique_ptr;
+using std::vector;
+
+// Each run of residuals starts with a kParamBits Rice parameter.  kZeroRun means every residual
+// in the run is zero and nothing else is written.  A quotient of kEscape or more is written as
+// kEscape ones followed by the residual in full.
+static const int kParamBits = 6;
+static const int kMaxParam = 62;
+static const int kZeroRun = 63;
+static const int kEscape = 24;
+
+// Values are mapped to 64-bit keys so that one predictor handles every type.  Keys are
+// differenced with wraparound so the mapping is lossless even when a difference overflows.
+static inline unsigned long long int ToKey(unsigned char c) {return c;}
+static inline unsigned long long int ToKey(unsigned short s) {return s;}
+static inline unsigned long long int ToKey(int i) {return (long long int)i;}
+static inline unsigned long long int ToKey(double d) {
+  unsigned long long int k;
+  memcpy(&k, &d, sizeof(k));
+  return k;
+}
+
+static inline void FromKey(unsigned long long int k, unsigned char *c) {*c = k;}
+static inline void FromKey(unsigned long long int k, unsigned short *s) {*s = k;}
+static inline void FromKey(unsigned long long int k, int *i) {*i = (long long int)k;}
+static inline void FromKey(unsigned long long int k, double *d) {memcpy(d, &k, sizeof(*d));}
+
+static inline unsigned long long int ZigZag(unsigned long long int d) {
+  return (d << 1) ^ (unsigned long long int)((long long int)d >> 63);
+}
+
+static inline unsigned long long int UnZigZag(unsigned long long int z) {
+  return (z >> 1) ^ (0ULL - (z & 1));
+}
+
+static void Corrupt(void) {
+  fprintf(stderr, "BlockCodec: corrupt block\n");
+  exit(-1);
+}
+
+// Most significant bit first.
+class BitWriter {
+public:
+  BitWriter(vector<unsigned char> *out) : out_(out), acc_(0), fill_(0) {}
+  // n <= 32 and v < 2^n
+  void Write(unsigned int v, int n) {
+    acc_ = (acc_ << n) | v;
+    fill_ += n;
+    while (fill_ >= 8) {
+      fill_ -= 8;
+      out_->push_back((unsigned char)(acc_ >> fill_));
+    }
+  }
+  // v < 2^n
+  void WriteLong(unsigned long long int v, int n) {
+    if (n > 32) {
+      Write((unsigned int)(v >> 32), n - 32);
+      Write((unsigned int)(v & 0xffffffffULL), 32);
+    } else {
+      Write((unsigned int)v, n);
+    }
+  }
+  void WriteOnes(int n) {
+    while (n >= 32) {
+      Write(0xffffffffU, 32);
+      n -= 32;
+    }
+    if (n > 0) Write((1U << n) - 1, n);
+  }
+  void Finish(void) {
+    if (fill_ > 0) {
+      out_->push_back((unsigned char)(acc_ << (8 - fill_)));
+      fill_ = 0;
+    }
+  }
+private:
+  vector<unsigned char> *out_;
+  unsigned long long int acc_;
+  int fill_;
+};
+
+// acc_ holds fill_ unconsumed bits, left aligned.  The bits below them are zero.
+class BitReader {
+public:
+  BitReader(const unsigned char *p, const unsigned char *end) :
+    p_(p), end_(end), acc_(0), fill_(0) {}
+  void Refill(void) {
+    while (fill_ <= 56 && p_ < end_) {
+      acc_ |= ((unsigned long long int)*p_++) << (56 - fill_);
+      fill_ += 8;
+    }
+  }
+  // n <= 32
+  unsigned int Read(int n) {
+    if (n == 0) return 0;
+    if (fill_ < n) {
+      Refill();
+      if (fill_ < n) Corrupt();
+    }
+    unsigned int v = acc_ >> (64 - n);
+    acc_ <<= n;
+    fill_ -= n;
+    return v;
+  }
+  unsigned long long int ReadLong(int n) {
+    if (n > 32) {
+      unsigned long long int hi = Read(n - 32);
+      return (hi << 32) | Read(32);
+    } else {
+      return Read(n);
+    }
+  }
+  // Counts ones up to a terminating zero, which is consumed.  Stops (without consuming a zero)
+  // once limit ones have been seen.
+  int ReadUnary(int limit) {
+    int q = 0;
+    while (true) {
+      if (fill_ < 32) {
+	Refill();
+	if (fill_ == 0) Corrupt();
+      }
+      int ones = ~acc_ == 0 ? 64 : __builtin_clzll(~acc_);
+      if (ones > fill_) ones = fill_;
+      if (q + ones >= limit) {
+	int take = limit - q;
+	acc_ <<= take;
+	fill_ -= take;
+	return limit;
+      }
+      if (ones < fill_) {
+	acc_ <<= ones;
+	acc_ <<= 1;
+	fill_ -= ones + 1;
+	return q + ones;
+      }
+      q += ones;
+      acc_ = 0;
+      fill_ = 0;
+    }
+  }
+private:
+  const unsigned char *p_;
+  const unsigned char *end_;
+  unsigned long long int acc_;
+  int fill_;
+};
+
+static long long int RiceCost(const unsigned long long int *r, int n, int k) {
+  long long int cost = 0;
+  for (int i = 0; i < n; ++i) {
+    unsigned long long int q = r[i] >> k;
+    if (q < (unsigned long long int)kEscape) cost += q + 1 + k;
+    else                                     cost += kEscape + 64;
+  }
+  return cost;
+}
+
+// Start from the parameter suggested by the mean residual and try its neighbors.
+static int ChooseParam(const unsigned long long int *r, int n, double sum) {
+  double mean = sum / n;
+  int k0 = 0;
+  while (k0 < kMaxParam && ldexp(1.0, k0 + 1) <= mean) ++k0;
+  int best_k = k0;
+  long long int best_cost = RiceCost(r, n, k0);
+  for (int k = k0 - 1; k <= k0 + 1; k += 2) {
+    if (k < 0 || k > kMaxParam) continue;
+    long long int cost = RiceCost(r, n, k);
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_k = k;
+    }
+  }
+  return best_k;
+}
+
+// Encodes n values (num_holdings x num_succs) forming one block.
+template <typename T>
+static void EncodeBlock(const T *values, int n, int num_succs, vector<unsigned char> *out) {
+  out->clear();
+  BitWriter writer(out);
+  unsigned long long int r[BlockCodec::kSubBlockSize];
+  for (int a0 = 0; a0 < n; a0 += BlockCodec::kSubBlockSize) {
+    int m = n - a0;
+    if (m > BlockCodec::kSubBlockSize) m = BlockCodec::kSubBlockSize;
+    double sum = 0;
+    for (int i = 0; i < m; ++i) {
+      int a = a0 + i;
+      unsigned long long int pred = a >= num_succs ? ToKey(values[a - num_succs]) : 0;
+      r[i] = ZigZag(ToKey(values[a]) - pred);
+      sum += r[i];
+    }
+    if (sum == 0) {
+      writer.Write(kZeroRun, kParamBits);
+      continue;
+    }
+    int k = ChooseParam(r, m, sum);
+    writer.Write(k, kParamBits);
+    for (int i = 0; i < m; ++i) {
+      unsigned long long int q = r[i] >> k;
+      if (q < (unsigned long long int)kEscape) {
+	writer.WriteOnes(q);
+	writer.Write(0, 1);
+	writer.WriteLong(r[i] & ((1ULL << k) - 1), k);
+      } else {
+	writer.WriteOnes(kEscape);
+	writer.WriteLong(r[i], 64);
+      }
+    }
+  }
+  writer.Finish();
+}
+
+template <typename T>
+static void DecodeBlock(const unsigned char *bytes, unsigned int num_bytes, int n, int num_succs,
+			T *values) {
+  BitReader reader(bytes, bytes + num_bytes);
+  for (int a0 = 0; a0 < n; a0 += BlockCodec::kSubBlockSize) {
+    int m = n - a0;
+    if (m > BlockCodec::kSubBlockSize) m = BlockCodec::kSubBlockSize;
+    int k = reader.Read(kParamBits);
+    for (int i = 0; i < m; ++i) {
+      int a = a0 + i;
+      unsigned long long int pred = a >= num_succs ? ToKey(values[a - num_succs]) : 0;
+      unsigned long long int r;
+      if (k == kZeroRun) {
+	r = 0;
+      } else {
+	int q = reader.ReadUnary(kEscape);
+	if (q == kEscape) r = reader.ReadLong(64);
+	else              r = (((unsigned long long int)q) << k) | reader.ReadLong(k);
+      }
+      FromKey(pred + UnZigZag(r), &values[a]);
+    }
+  }
+}
+
+// Work on a set of blocks that can be done in any order.
+class BlockJob {
+public:
+  virtual ~BlockJob(void) {}
+  virtual void Do(int i) = 0;
+};
+
+template <typename T>
+class EncodeJob : public BlockJob {
+public:
+  EncodeJob(const T *values, int num_holdings, int num_succs, vector<unsigned char> *bufs) :
+    values_(values), num_holdings_(num_holdings), num_succs_(num_succs), bufs_(bufs) {}
+  void Do(int b) {
+    int h_begin = b * BlockCodec::kBlockHoldings;
+    int nh = num_holdings_ - h_begin;
+    if (nh > BlockCodec::kBlockHoldings) nh = BlockCodec::kBlockHoldings;
+    EncodeBlock(values_ + (long long int)h_begin * num_succs_, nh * num_succs_, num_succs_,
+		&bufs_[b]);
+  }
+private:
+  const T *values_;
+  int num_holdings_;
+  int num_succs_;
+  vector<unsigned char> *bufs_;
+};
+
+// Decodes blocks b_begin, b_begin + 1, ... of a node with num_holdings holdings.  bytes holds
+// the encoded blocks back to back starting with b_begin.  values receives the values starting
+// with the first holding of b_begin.
+template <typename T>
+class DecodeJob : public BlockJob {
+public:
+  DecodeJob(const unsigned char *bytes, const long long int *starts, const unsigned int *sizes,
+	    int b_begin, int num_holdings, int num_succs, T *values) :
+    bytes_(bytes), starts_(starts), sizes_(sizes), b_begin_(b_begin),
+    num_holdings_(num_holdings), num_succs_(num_succs), values_(values) {}
+  void Do(int i) {
+    int b = b_begin_ + i;
+    int h_begin = b * BlockCodec::kBlockHoldings;
+    int nh = num_holdings_ - h_begin;
+    if (nh > BlockCodec::kBlockHoldings) nh = BlockCodec::kBlockHoldings;
+    DecodeBlock(bytes_ + starts_[b] - starts_[b_begin_], sizes_[b], nh * num_succs_, num_succs_,
+		values_ + (long long int)i * BlockCodec::kBlockHoldings * num_succs_);
+  }
+private:
+  const unsigned char *bytes_;
+  const long long int *starts_;
+  const unsigned int *sizes_;
+  int b_begin_;
+  int num_holdings_;
+  int num_succs_;
+  T *values_;
+};
+
+// A pool of num_threads - 1 threads that lives as long as the BlockCodec, so that we don't
+// create and join threads for every node.  The calling thread is the remaining thread.  For
+// each job, thread t does blocks t, t + num_threads, ...
+class BlockCodecThread;
+
+class BlockCodecPool {
+public:
+  BlockCodecPool(int num_threads);
+  ~BlockCodecPool(void);
+  void Run(BlockJob *job, int num_blocks);
+  void WorkerLoop(int t);
+private:
+  int num_threads_;
+  vector< unique_ptr<BlockCodecThread> > threads_;
+  pthread_mutex_t mutex_;
+  pthread_cond_t start_;
+  pthread_cond_t done_;
+  BlockJob *job_;
+  int num_blocks_;
+  // Incremented for each job so that workers can tell a new job from one they have done
+  long long int generation_;
+  int num_running_;
+  bool quit_;
+};
+
+class BlockCodecThread {
+public:
+  BlockCodecThread(BlockCodecPool *pool, int t) : pool_(pool), t_(t) {}
+  void Run(void) {pool_->WorkerLoop(t_);}
+  void RunThread(void);
+  void Join(void) {pthread_join(pthread_id_, NULL);}
+private:
+  BlockCodecPool *pool_;
+  int t_;
+  pthread_t pthread_id_;
+};
+
+static void *block_codec_thread_run(void *v_t) {
+  BlockCodecThread *t = (BlockCodecThread *)v_t;
+  t->Run();
+  return NULL;
+}
+
+void BlockCodecThread::RunThread(void) {
+  pthread_create(&pthread_id_, NULL, block_codec_thread_run, this);
+}
+
+BlockCodecPool::BlockCodecPool(int num_threads) :
+  num_threads_(num_threads), job_(nullptr), num_blocks_(0), generation_(0), num_running_(0),
+  quit_(false) {
+  pthread_mutex_init(&mutex_, NULL);
+  pthread_cond_init(&start_, NULL);
+  pthread_cond_init(&done_, NULL);
+  for (int t = 1; t < num_threads_; ++t) {
+    threads_.emplace_back(new BlockCodecThread(this, t));
+    threads_.back()->RunThread();
+  }
+}
+
+BlockCodecPool::~BlockCodecPool(void) {
+  pthread_mutex_lock(&mutex_);
+  quit_ = true;
+  pthread_cond_broadcast(&start_);
+  pthread_mutex_unlock(&mutex_);
+  for (size_t i = 0; i < threads_.size(); ++i) threads_[i]->Join();
+  pthread_mutex_destroy(&mutex_);
+  pthread_cond_destroy(&start_);
+  pthread_cond_destroy(&done_);
+}
+
+void BlockCodecPool::WorkerLoop(int t) {
+  long long int generation = 0;
+  pthread_mutex_lock(&mutex_);
+  while (true) {
+    while (generation_ == generation && ! quit_) pthread_cond_wait(&start_, &mutex_);
+    if (quit_) break;
+    generation = generation_;
+    BlockJob *job = job_;
+    int num_blocks = num_blocks_;
+    pthread_mutex_unlock(&mutex_);
+    for (int b = t; b < num_blocks; b += num_threads_) job->Do(b);
+    pthread_mutex_lock(&mutex_);
+    if (--num_running_ == 0) pthread_cond_signal(&done_);
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void BlockCodecPool::Run(BlockJob *job, int num_blocks) {
+  pthread_mutex_lock(&mutex_);
+  job_ = job;
+  num_blocks_ = num_blocks;
+  num_running_ = num_threads_ - 1;
+  ++generation_;
+  pthread_cond_broadcast(&start_);
+  pthread_mutex_unlock(&mutex_);
+  for (int b = 0; b < num_blocks; b += num_threads_) job->Do(b);
+  pthread_mutex_lock(&mutex_);
+  while (num_running_ > 0) pthread_cond_wait(&done_, &mutex_);
+  pthread_mutex_unlock(&mutex_);
+}
+
+void BlockCodec::RunBlocks(BlockJob *job, int num_blocks) {
+  if (pool_ && num_blocks > 1) {
+    pool_->Run(job, num_blocks);
+  } else {
+    for (int b = 0; b < num_blocks; ++b) job->Do(b);
+  }
+}
+
+BlockCodec::BlockCodec(int num_threads) {
+  num_threads_ = num_threads;
+  if (num_threads_ > 1) pool_.reset(new BlockCodecPool(num_threads_));
+}
+
+BlockCodec::~BlockCodec(void) {
+}
+
+template <typename T>
+void BlockCodec::Encode(const T *values, int num_holdings, int num_succs, Writer *writer) {
+  int num_blocks = NumBlocks(num_holdings);
+  if ((int)block_bufs_.size() < num_blocks) block_bufs_.resize(num_blocks);
+  EncodeJob<T> job(values, num_holdings, num_succs, block_bufs_.data());
+  RunBlocks(&job, num_blocks);
+  for (int b = 0; b < num_blocks; ++b) {
+    writer->WriteUnsignedInt(block_bufs_[b].size());
+  }
+  for (int b = 0; b < num_blocks; ++b) {
+    writer->WriteNBytes(block_bufs_[b].data(), block_bufs_[b].size());
+  }
+}
+
+template <typename T>
+void BlockCodec::Decode(Reader *reader, int num_holdings, int num_succs, T *values) {
+  int num_blocks = NumBlocks(num_holdings);
+  block_sizes_.resize(num_blocks);
+  block_starts_.resize(num_blocks);
+  long long int total = 0;
+  for (int b = 0; b < num_blocks; ++b) {
+    block_sizes_[b] = reader->ReadUnsignedIntOrDie();
+    block_starts_[b] = total;
+    total += block_sizes_[b];
+  }
+  if (total > 0xffffffffLL) {
+    fprintf(stderr, "BlockCodec: node too large: %lli bytes\n", total);
+    exit(-1);
+  }
+  in_buf_.resize(total);
+  reader->ReadNBytesOrDie(total, in_buf_.data());
+  DecodeJob<T> job(in_buf_.data(), block_starts_.data(), block_sizes_.data(), 0, num_holdings,
+		   num_succs, values);
+  RunBlocks(&job, num_blocks);
+}
+
+template <typename T>
+long long int BlockCodec::DecodeRange(Reader *reader, long long int offset,
+				      int full_num_holdings, int num_succs, int h_begin, int num,
+				      T *values) {
+  if (h_begin < 0 || num < 0 || h_begin + num > full_num_holdings) {
+    fprintf(stderr, "BlockCodec::DecodeRange(): bad range %i+%i of %i\n", h_begin, num,
+	    full_num_holdings);
+    exit(-1);
+  }
+  reader->SeekTo(offset);
+  int num_blocks = NumBlocks(full_num_holdings);
+  block_sizes_.resize(num_blocks);
+  block_starts_.resize(num_blocks);
+  long long int total = 0;
+  for (int b = 0; b < num_blocks; ++b) {
+    block_sizes_[b] = reader->ReadUnsignedIntOrDie();
+    block_starts_[b] = total;
+    total += block_sizes_[b];
+  }
+  long long int data_offset = offset + (long long int)num_blocks * sizeof(unsigned int);
+  if (num == 0) return data_offset + total;
+  int b_begin = h_begin / kBlockHoldings;
+  int b_end = (h_begin + num - 1) / kBlockHoldings + 1;
+  long long int num_bytes =
+    block_starts_[b_end - 1] + block_sizes_[b_end - 1] - block_starts_[b_begin];
+  if (num_bytes > 0xffffffffLL) {
+    fprintf(stderr, "BlockCodec: range too large: %lli bytes\n", num_bytes);
+    exit(-1);
+  }
+  reader->SeekTo(data_offset + block_starts_[b_begin]);
+  in_buf_.resize(num_bytes);
+  reader->ReadNBytesOrDie(num_bytes, in_buf_.data());
+  int first_h = b_begin * kBlockHoldings;
+  int num_decoded = b_end * kBlockHoldings;
+  if (num_decoded > full_num_holdings) num_decoded = full_num_holdings;
+  num_decoded -= first_h;
+  // Decode whole blocks into a temporary buffer unless they are exactly the range we want.
+  unique_ptr<T []> tmp;
+  T *decoded = values;
+  if (first_h != h_begin || num_decoded != num) {
+    tmp.reset(new T[(long long int)num_decoded * num_succs]);
+    decoded = tmp.get();
+  }
+  DecodeJob<T> job(in_buf_.data(), block_starts_.data(), block_sizes_.data(), b_begin,
+		   full_num_holdings, num_succs, decoded);
+  RunBlocks(&job, b_end - b_begin);
+  if (decoded != values) {
+    memcpy(values, decoded + (long long int)(h_begin - first_h) * num_succs,
+	   (long long int)num * num_succs * sizeof(T));
+  }
+  return data_offset + total;
+}
+
+template void BlockCodec::Encode<unsigned char>(const unsigned char *values, int num_holdings,
+						int num_succs, Writer *writer);
+template void BlockCodec::Encode<unsigned short>(const unsigned short *values, int num_holdings,
+						 int num_succs, Writer *writer);
+template void BlockCodec::Encode<int>(const int *values, int num_holdings, int num_succs,
+				      Writer *writer);
+template void BlockCodec::Encode<double>(const double *values, int num_holdings, int num_succs,
+					 Writer *writer);
+template void BlockCodec::Decode<unsigned char>(Reader *reader, int num_holdings, int num_succs,
+						unsigned char *values);
+template void BlockCodec::Decode<unsigned short>(Reader *reader, int num_holdings,
+						 int num_succs, unsigned short *values);
+template void BlockCodec::Decode<int>(Reader *reader, int num_holdings, int num_succs,
+				      int *values);
+template void BlockCodec::Decode<double>(Reader *reader, int num_holdings, int num_succs,
+					 double *values);
+template long long int BlockCodec::DecodeRange<unsigned char>(Reader *reader,
+							      long long int offset,
+							      int full_num_holdings,
+							      int num_succs, int h_begin, int num,
+							      unsigned char *values);
+template long long int BlockCodec::DecodeRange<unsigned short>(Reader *reader,
+							       long long int offset,
+							       int full_num_holdings,
+							       int num_succs, int h_begin, int num,
+							       unsigned short *values);
+template long long int BlockCodec::DecodeRange<int>(Reader *reader, long long int offset,
+						    int full_num_holdings, int num_succs,
+						    int h_begin, int num, int *values);
+template long long int BlockCodec::DecodeRange<double>(Reader *reader, long long int offset,
+						       int full_num_holdings, int num_succs,
+						       int h_begin, int num, double *values);
@@ -0,0 +1,60 @@
+#ifndef _BLOCK_CODEC_H_
+#define _BLOCK_CODEC_H_
+
+#include <memory>
+#include <vector>
+
+class BlockCodecPool;
+class BlockJob;
+class Reader;
+class Writer;
+
+// Lossless compression of the values of one node of a CFRValues file.  This is the compressor
+// (and decompressor) that CFRValues passes down to CFRStreetValues::WriteNode() and ReadNode().
+//
+// A node's values (num_holdings x num_succs, holding-major) are split into blocks of
+// kBlockHoldings holdings.  Each block is encoded independently so blocks can be encoded and
+// decoded in parallel, and so a range of holdings (e.g., the boards under one subgame root) can
+// be decoded without decoding the whole node.  Within a block, each value is predicted by the
+// value for the same succ at the previous holding.  Hands are sorted by strength within a board
+// so neighboring holdings tend to have similar values.  The residuals are zigzag encoded and
+// written with Rice codes whose parameter is chosen separately for each run of kSubBlockSize
+// residuals.
+//
+// The encoded node is the byte size of each block (as unsigned ints) followed by the blocks.
+// Anything the caller writes afterwards (e.g., scale factors) follows the blocks.
+//
+// Not thread-safe; use one BlockCodec per file.  If num_threads is more than one, the BlockCodec
+// keeps num_threads - 1 threads of its own for its lifetime.
+class BlockCodec {
+public:
+  BlockCodec(int num_threads);
+  ~BlockCodec(void);
+  template <typename T>
+  void Encode(const T *values, int num_holdings, int num_succs, Writer *writer);
+  // Decodes a node starting at the current position of the reader.
+  template <typename T>
+  void Decode(Reader *reader, int num_holdings, int num_succs, T *values);
+  // Decodes holdings h_begin...h_begin+num-1 of a node of full_num_holdings holdings that
+  // starts at the given byte offset.  Returns the byte offset of the end of the node.
+  template <typename T>
+  long long int DecodeRange(Reader *reader, long long int offset, int full_num_holdings,
+			    int num_succs, int h_begin, int num, T *values);
+
+  static const int kBlockHoldings = 4096;
+  static const int kSubBlockSize = 64;
+private:
+  static int NumBlocks(int num_holdings) {
+    return (num_holdings + kBlockHoldings - 1) / kBlockHoldings;
+  }
+  void RunBlocks(BlockJob *job, int num_blocks);
+
+  int num_threads_;
+  std::unique_ptr<BlockCodecPool> pool_;
+  std::vector< std::vector<unsigned char> > block_bufs_;
+  std::vector<unsigned int> block_sizes_;
+  std::vector<long long int> block_starts_;
+  std::vector<unsigned char> in_buf_;
+};
+
+#endif
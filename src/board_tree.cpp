@@ -8,7 +8,6 @@
 // This is useful when we want to solve subgames independently (e.g., in
 // subgame solving and in cfrp.cpp).
 
-#include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -199,26 +198,70 @@ void BoardTree::Delete(void) {
   num_boards_.reset(nullptr);
 }
 
+// Binomial coefficients for the lookup codes; g_choose[n][k] for k up to three (the most cards
+// added on one street).
+static const int kMaxLookupCards = 64;
+static int g_choose[kMaxLookupCards + 1][4];
+
+// Colex rank of the n (at most three) cards added on one street.  Order of the cards doesn't
+// matter.
+static int StreetCode(const Card *cards, int n) {
+  Card sorted[3];
+  for (int i = 0; i < n; ++i) {
+    Card c = cards[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] > c) {
+      sorted[j] = sorted[j - 1];
+      --j;
+    }
+    sorted[j] = c;
+  }
+  int code = 0;
+  for (int i = 0; i < n; ++i) code += g_choose[sorted[i]][i + 1];
+  return code;
+}
+
+// Every canonical board is a canonical board for the previous street plus the cards for the
+// current street.  So lookup_[st] is indexed by the previous street's board index times the number
+// of possible street card combinations, plus the rank of the street cards.  For holdem this is
+// about 3.4MB for the river, rather than the 52^5 ints of a table indexed by the raw cards.
 void BoardTree::CreateLookup(void) {
   if (lookup_) return;
   int max_card1 = Game::MaxCard() + 1;
+  if (max_card1 > kMaxLookupCards) {
+    fprintf(stderr, "BoardTree::CreateLookup: too many cards\n");
+    exit(-1);
+  }
+  for (int n = 0; n <= max_card1; ++n) {
+    g_choose[n][0] = 1;
+    for (int k = 1; k <= 3; ++k) {
+      g_choose[n][k] = n == 0 ? 0 : g_choose[n - 1][k - 1] + g_choose[n - 1][k];
+    }
+  }
   lookup_ = new int *[max_street_ + 1];
   lookup_[0] = new int[1];
   lookup_[0][0] = 0;
+  // Fill streets in order; the boards of street st - 1 must be indexable before street st
   for (int st = 1; st <= max_street_; ++st) {
-    int num_board_cards = Game::NumBoardCards(st);
-    int num_codes = pow(max_card1, num_board_cards);
+    int num_prev_board_cards = Game::NumBoardCards(st - 1);
+    int num_street_cards = Game::NumCardsForStreet(st);
+    if (num_street_cards > 3) {
+      fprintf(stderr, "BoardTree::CreateLookup: can't handle %i street cards\n",
+	      num_street_cards);
+      exit(-1);
+    }
+    int num_street_codes = g_choose[max_card1][num_street_cards];
+    long long int num_codes = ((long long int)num_boards_[st - 1]) * num_street_codes;
     lookup_[st] = new int[num_codes];
-    for (int i = 0; i < num_codes; ++i) {
+    for (long long int i = 0; i < num_codes; ++i) {
       lookup_[st][i] = kMaxInt;
     }
     int num_boards = num_boards_[st];
     for (int bd = 0; bd < num_boards; ++bd) {
       const Card *board = Board(st, bd);
-      int code = 0;
-      for (int i = 0; i < num_board_cards; ++i) {
-	code += board[i] * pow(max_card1, i);
-      }
+      int pbd = st == 1 ? 0 : LookupBoard(board, st - 1);
+      int code = pbd * num_street_codes + StreetCode(board + num_prev_board_cards,
+						       num_street_cards);
       lookup_[st][code] = bd;
     }
   }
@@ -240,20 +283,21 @@ int BoardTree::LookupBoard(const Card *board, int st) {
     exit(-1);
   }
   int max_card1 = Game::MaxCard() + 1;
-  int num_board_cards = Game::NumBoardCards(st);
-  int code = 0;
-  for (int i = 0; i < num_board_cards; ++i) {
-    code += board[i] * pow(max_card1, i);
-  }
-  int ret = lookup_[st][code];
-  if (ret == kMaxInt) {
-    fprintf(stderr, "BoardTree::LookupBoard() invalid board; st %i code %i\n", st, code);
-    OutputNCards(board, num_board_cards);
-    printf("\n");
-    fflush(stdout);
-    exit(-1);
+  int bd = 0;
+  for (int st1 = 1; st1 <= st; ++st1) {
+    int num_street_cards = Game::NumCardsForStreet(st1);
+    int code = bd * g_choose[max_card1][num_street_cards] +
+      StreetCode(board + Game::NumBoardCards(st1 - 1), num_street_cards);
+    bd = lookup_[st1][code];
+    if (bd == kMaxInt) {
+      fprintf(stderr, "BoardTree::LookupBoard() invalid board; st %i code %i\n", st1, code);
+      OutputNCards(board, Game::NumBoardCards(st));
+      printf("\n");
+      fflush(stdout);
+      exit(-1);
+    }
   }
-  return ret;
+  return bd;
 }
 
 void BoardTree::DealRawBoards(Card *board, int st) {
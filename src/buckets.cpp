@@ -8,6 +8,8 @@
 #include "game.h"
 #include "io.h"
 
+using std::unique_ptr;
+
 Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
   BoardTree::Create();
   int max_street = Game::MaxStreet();
@@ -18,6 +20,7 @@ Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
     short_buckets_[st] = nullptr;
     int_buckets_[st] = nullptr;
   }
+  mapped_files_.reset(new unique_ptr<MappedFile>[max_street + 1]);
   char buf[500];
   num_buckets_.reset(new int[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
@@ -44,6 +47,21 @@ Buckets::Buckets(const CardAbstraction &ca, bool numb_only) {
   
       sprintf(buf, "%s/buckets.%s.%i.%i.%i.%s.%i", Files::StaticBase(), Game::GameName().c_str(),
 	      Game::NumRanks(), Game::NumSuits(), max_street, ca.Bucketing(st).c_str(), st);
+      if (ca.MapBuckets()) {
+	// Bucket(st, h) reads straight out of the page cache
+	mapped_files_[st].reset(new MappedFile(buf, ca.PopulateBuckets(), ca.HugePageBuckets()));
+	const void *data = mapped_files_[st]->Data();
+	long long int file_size = mapped_files_[st]->Size();
+	if (file_size == lli_num_hands * 2) {
+	  short_buckets_[st] = (unsigned short *)data;
+	} else if (file_size == lli_num_hands * 4) {
+	  int_buckets_[st] = (int *)data;
+	} else {
+	  fprintf(stderr, "BucketsInstance::Initialize: Unexpected file size %lli\n", file_size);
+	  exit(-1);
+	}
+	continue;
+      }
       Reader reader(buf);
       long long int file_size = reader.FileSize();
       if (file_size == lli_num_hands * 2) {
@@ -74,13 +92,13 @@ Buckets::~Buckets(void) {
   int max_street = Game::MaxStreet();
   if (short_buckets_) {
     for (int st = 0; st <= max_street; ++st) {
-      if (short_buckets_[st]) delete [] short_buckets_[st];
+      if (short_buckets_[st] && ! mapped_files_[st]) delete [] short_buckets_[st];
     }
     delete [] short_buckets_;
   }
   if (int_buckets_) {
     for (int st = 0; st <= max_street; ++st) {
-      if (int_buckets_[st]) delete [] int_buckets_[st];
+      if (int_buckets_[st] && ! mapped_files_[st]) delete [] int_buckets_[st];
     }
     delete [] int_buckets_;
   }
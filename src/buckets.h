@@ -4,6 +4,7 @@
 #include <memory>
 
 class CardAbstraction;
+class MappedFile;
 
 class Buckets {
 public:
@@ -24,9 +25,11 @@ public:
 private:
   std::unique_ptr<bool []> none_;
   // Should make these unique pointers, no?
+  // When the buckets are mapped, these point into mapped_files_ rather than owning the arrays.
   unsigned short **short_buckets_;
   int **int_buckets_;
   std::unique_ptr<int []> num_buckets_;
+  std::unique_ptr<std::unique_ptr<MappedFile> []> mapped_files_;
 };
 
 #endif
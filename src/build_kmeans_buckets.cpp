@@ -49,6 +49,8 @@ static void Write(int st, const string &bucketing, KMeans *kmeans, int *indices,
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <street> <num clusters> <bucketing> <features> "
 	  "<neighbor thresh> <num iterations> <num threads>\n", prog_name);
+  fprintf(stderr, "\nA neighbor thresh of zero uses per-object distance bounds instead of "
+	  "neighbor lists\n");
   exit(-1);
 }
 
@@ -129,11 +131,13 @@ int main(int argc, char *argv[]) {
   fprintf(stderr, "%i unique objects\n", num_unique);
   delete sad;
 
-  float **objects = new float *[num_unique];
+  // KMeans wants one aligned block of zero padded rows
+  float *objects = KMeans::AllocateObjects(num_unique, num_features);
+  int stride = KMeans::Stride(num_features);
   for (int i = 0; i < num_unique; ++i) {
-    objects[i] = new float[num_features];
+    float *obj = objects + (size_t)i * stride;
     for (int f = 0; f < num_features; ++f) {
-      objects[i][f] = (*unique_objects)[i][f];
+      obj[f] = (*unique_objects)[i][f];
     }
     delete [] (*unique_objects)[i];
   }
@@ -144,10 +148,7 @@ int main(int argc, char *argv[]) {
   int num_actual = kmeans.NumClusters();
   fprintf(stderr, "Num actual buckets: %i\n", num_actual);
 
-  for (int i = 0; i < num_unique; ++i) {
-    delete [] objects[i];
-  }
-  delete [] objects;
+  free(objects);
 
   Write(st, bucketing, &kmeans, indices, num_actual);
 
@@ -0,0 +1,78 @@
+// Writes the file of sorted river hand orders that HandTree uses in place of evaluating and
+// sorting the hands on each river board (see river_hand_orders.h).  Requires the hand value tree.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <string>
+
+#include "board_tree.h"
+#include "canonical_cards.h"
+#include "cards.h"
+#include "files.h"
+#include "game.h"
+#include "game_params.h"
+#include "hand_value_tree.h"
+#include "io.h"
+#include "params.h"
+#include "river_hand_orders.h"
+
+using std::string;
+using std::unique_ptr;
+
+static void Usage(const char *prog_name) {
+  fprintf(stderr, "USAGE: %s <game params>\n", prog_name);
+  exit(-1);
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) Usage(argv[0]);
+  Files::Init();
+  unique_ptr<Params> game_params = CreateGameParams();
+  game_params->ReadFromFile(argv[1]);
+  Game::Initialize(*game_params);
+  BoardTree::Create();
+  HandValueTree::Create();
+
+  int max_street = Game::MaxStreet();
+  int num_board_cards = Game::NumBoardCards(max_street);
+  int num_boards = BoardTree::NumBoards(max_street);
+  char buf[500];
+  RiverHandOrders::Filename(buf);
+  Writer writer(buf);
+  int num_hands = -1;
+  unique_ptr<int []> order, hand_values;
+  unique_ptr<unsigned short []> ranks;
+  for (int bd = 0; bd < num_boards; ++bd) {
+    const Card *board = BoardTree::Board(max_street, bd);
+    int sg = BoardTree::SuitGroups(max_street, bd);
+    CanonicalCards hands(2, board, num_board_cards, sg, false);
+    if (num_hands == -1) {
+      num_hands = hands.NumRaw();
+      if (num_hands > 65536) {
+	fprintf(stderr, "Too many hands: %i\n", num_hands);
+	exit(-1);
+      }
+      order.reset(new int[num_hands]);
+      hand_values.reset(new int[num_hands]);
+      ranks.reset(new unsigned short[num_hands]);
+      writer.WriteInt(num_boards);
+      writer.WriteInt(num_hands);
+    } else if (hands.NumRaw() != num_hands) {
+      fprintf(stderr, "Board %i has %i hands; expected %i\n", bd, hands.NumRaw(), num_hands);
+      exit(-1);
+    }
+    hands.HandStrengthOrder(board, order.get(), hand_values.get());
+    int rank = 0;
+    for (int i = 0; i < num_hands; ++i) {
+      if (i > 0 && hand_values[i] != hand_values[i - 1]) ++rank;
+      ranks[i] = rank;
+      writer.WriteUnsignedShort(order[i]);
+    }
+    for (int i = 0; i < num_hands; ++i) {
+      writer.WriteUnsignedShort(ranks[i]);
+    }
+  }
+  fprintf(stderr, "Wrote %i boards of %i hands to %s\n", num_boards, num_hands, buf);
+}
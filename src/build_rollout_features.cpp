@@ -7,7 +7,6 @@
 #include "game.h"
 #include "game_params.h"
 #include "hand_value_tree.h"
-#include "io.h"
 #include "params.h"
 #include "rollout.h"
 
@@ -15,13 +14,13 @@ using namespace std;
 
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <street> <features name> "
-	  "<squashing> [wins|wmls] <pct 0> <pct 1>... <pct n>\n", prog_name);
+	  "<squashing> [wins|wmls] <num threads> <pct 0> <pct 1>... <pct n>\n", prog_name);
   fprintf(stderr, "\nSquashing of 1.0 means no squashing\n");
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc < 7) Usage(argv[0]);
+  if (argc < 8) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -36,17 +35,19 @@ int main(int argc, char *argv[]) {
   if (warg == "wins")      wins = true;
   else if (warg == "wmls") wins = false;
   else                     Usage(argv[0]);
+  int num_threads;
+  if (sscanf(argv[6], "%i", &num_threads) != 1) Usage(argv[0]);
+  if (num_threads < 1)                          Usage(argv[0]);
   
-  int num_percentiles = argc - 6;
+  int num_percentiles = argc - 7;
   double *percentiles = new double[num_percentiles];
   for (int i = 0; i < num_percentiles; ++i) {
-    if (sscanf(argv[6 + i], "%lf", &percentiles[i]) != 1) Usage(argv[0]);
+    if (sscanf(argv[7 + i], "%lf", &percentiles[i]) != 1) Usage(argv[0]);
   }
 
   HandValueTree::Create();
-  // Need this for ComputeRollout()
+  // Need this for WriteRolloutFeatures()
   BoardTree::Create();
-  short *pct_vals = ComputeRollout(street, percentiles, num_percentiles, squashing, wins);
 
   unsigned int num_boards = BoardTree::NumBoards(street);
   unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(street);
@@ -56,12 +57,5 @@ int main(int argc, char *argv[]) {
   char buf[500];
   sprintf(buf, "%s/features.%s.%u.%s.%u", Files::StaticBase(), Game::GameName().c_str(),
 	  Game::NumRanks(), features_name.c_str(), street);
-  Writer writer(buf);
-  writer.WriteInt(num_percentiles);
-
-  for (unsigned int h = 0; h < num_hands; ++h) {
-    for (int p = 0; p < num_percentiles; ++p) {
-      writer.WriteShort(pct_vals[h * num_percentiles + p]);
-    }
-  }
+  WriteRolloutFeatures(street, percentiles, num_percentiles, squashing, wins, num_threads, buf);
 }
@@ -167,11 +167,31 @@ CanonicalCards::CanonicalCards(int n, const Card *previous, int num_previous,
     exit(-1);
   }
   num_raw_ = index;
+  BuildOppEncodings();
 }
 
 CanonicalCards::~CanonicalCards(void) {
 }
 
+long long int CanonicalCards::Bytes(void) const {
+  long long int per_hand = n_ * sizeof(Card) + sizeof(unsigned char) + sizeof(int);
+  if (hand_values_) per_hand += sizeof(int);
+  if (suit_groups_) per_hand += sizeof(int);
+  if (opp_encodings_) per_hand += sizeof(int);
+  return sizeof(*this) + num_raw_ * per_hand;
+}
+
+// Terminal evaluation looks up the opponent reach probability of every hand; precomputing the
+// indices lets it do so with a single gather.
+void CanonicalCards::BuildOppEncodings(void) {
+  if (n_ != 2) return;
+  int max_card1 = Game::MaxCard() + 1;
+  opp_encodings_.reset(new int[num_raw_]);
+  for (int i = 0; i < num_raw_; ++i) {
+    opp_encodings_[i] = cards_[i * 2] * max_card1 + cards_[i * 2 + 1];
+  }
+}
+
 // This version does not resort the cards
 // Returns true if a change was made
 bool CanonicalCards::ToCanon2(const Card *cards, int num_cards, int suit_groups,
@@ -324,11 +344,12 @@ static int g_ui_larger_compare(const void *p1, const void *p2) {
   else                return 0;
 }
 
+// Computes the order (as indices of our current hands) in which SortByHandStrength() puts our
+// hands, and the value of each hand in that order.
 // board is not sorted from high to low
 // Do not assume we can modify board
 // Assume board is a max street board
-// We don't update suit groups (unsafe, no?)
-void CanonicalCards::SortByHandStrength(const Card *board) {
+void CanonicalCards::HandStrengthOrder(const Card *board, int *order, int *hand_values) const {
   int num_board_cards = Game::NumBoardCards(Game::MaxStreet());
   unique_ptr<Card []> sorted_board(new Card[num_board_cards]);
   for (int i = 0; i < num_board_cards; ++i) sorted_board[i] = board[i];
@@ -348,46 +369,67 @@ void CanonicalCards::SortByHandStrength(const Card *board) {
     }
   }
 #endif
+  unique_ptr<int []> hvs(new int[num_raw_]);
+  // We know hole cards are sorted
+  HandValueTree::Vals(sorted_board.get(), cards_.get(), num_raw_, hvs.get());
   vector<Hand> hands(num_raw_);
-  Hand h;
-  int hole_cards[2];
   for (int i = 0; i < num_raw_; ++i) {
-    Card *cards = &cards_[i * n_];
-    hole_cards[0] = cards[0];
-    hole_cards[1] = cards[1];
-    // We know hole cards are sorted
-#if 0
-    for (int j = 0; j < num_board_cards; ++j) {
-      fprintf(stderr, "%i ", (int)sorted_board.get()[j]);
-    }
-    fprintf(stderr, "/ %i %i\n", hole_cards[0], hole_cards[1]);
-#endif
-    h.hv = HandValueTree::Val(sorted_board.get(), hole_cards);
-    h.index = i;
-    hands[i] = h;
+    hands[i].hv = hvs[i];
+    hands[i].index = i;
   }
   std::sort(hands.begin(), hands.end(), g_hand_lower_compare);
 
+  for (int i = 0; i < num_raw_; ++i) {
+    order[i] = hands[i].index;
+    hand_values[i] = hands[i].hv;
+  }
+}
+
+// Hand i of the new order is hand order[i] of the current order.
+void CanonicalCards::Reorder(const int *order, const int *hand_values) {
   hand_values_.reset(new int[num_raw_]);
   Card *new_cards = new Card[num_raw_ * n_];
   unsigned char *new_num_variants = new unsigned char[num_raw_];
   int *new_canon = new int[num_raw_];
 
   for (int i = 0; i < num_raw_; ++i) {
-    int hv = hands[i].hv;
-    int index = hands[i].index;
-    Card hi = cards_[index * n_];
-    Card lo = cards_[index * n_ + 1];
-    new_cards[i * n_] = hi;
-    new_cards[i * n_ + 1] = lo;
+    int index = order[i];
+    for (int j = 0; j < n_; ++j) {
+      new_cards[i * n_ + j] = cards_[index * n_ + j];
+    }
     new_num_variants[i] = num_variants_[index];
     new_canon[i] = canon_[index];
-    hand_values_[i] = hv;
+    hand_values_[i] = hand_values[i];
   }
 
   cards_.reset(new_cards);
   num_variants_.reset(new_num_variants);
   canon_.reset(new_canon);
+  BuildOppEncodings();
+}
+
+// board is not sorted from high to low
+// Do not assume we can modify board
+// Assume board is a max street board
+// We don't update suit groups (unsafe, no?)
+void CanonicalCards::SortByHandStrength(const Card *board) {
+  unique_ptr<int []> order(new int[num_raw_]);
+  unique_ptr<int []> hand_values(new int[num_raw_]);
+  HandStrengthOrder(board, order.get(), hand_values.get());
+  Reorder(order.get(), hand_values.get());
+}
+
+// Like SortByHandStrength() but with an order and hand values computed ahead of time (see
+// RiverHandOrders).  The hand values need only be consistent with the order; e.g., they can be
+// the ranks of the hands on the board.
+void CanonicalCards::SetHandOrder(const unsigned short *order, const unsigned short *hand_values) {
+  unique_ptr<int []> int_order(new int[num_raw_]);
+  unique_ptr<int []> int_hand_values(new int[num_raw_]);
+  for (int i = 0; i < num_raw_; ++i) {
+    int_order[i] = order[i];
+    int_hand_values[i] = hand_values[i];
+  }
+  Reorder(int_order.get(), int_hand_values.get());
 }
 
 int NChooseK(int n, int k) {
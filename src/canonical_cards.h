@@ -12,6 +12,8 @@ class CanonicalCards {
 		 bool maintain_suit_groups);
   virtual ~CanonicalCards(void);
   void SortByHandStrength(const Card *board);
+  void HandStrengthOrder(const Card *board, int *order, int *hand_values) const;
+  void SetHandOrder(const unsigned short *order, const unsigned short *hand_values);
   static bool ToCanon2(const Card *cards, int num_cards,
 		       int suit_groups, Card *canon_cards);
   static void ToCanon(const Card *cards, int num_cards,
@@ -24,8 +26,15 @@ class CanonicalCards {
   const Card *Cards(int i) const {return &cards_[i * n_];}
   int HandValue(int i) const {return hand_values_[i];}
   int SuitGroups(int i) const {return suit_groups_[i];}
+  // Index of each two-card hand into an opponent reach probability array (hi * (max_card + 1) +
+  // lo).  Only maintained when n is 2.
+  const int *OppEncodings(void) const {return opp_encodings_.get();}
+  // Approximate memory footprint
+  long long int Bytes(void) const;
  protected:
   int NumMappings(const Card *cards, int n, int old_suit_groups);
+  void BuildOppEncodings(void);
+  void Reorder(const int *order, const int *hand_values);
 
   int n_;
   std::unique_ptr<Card []> cards_;
@@ -35,6 +44,7 @@ class CanonicalCards {
   int num_raw_;
   int num_canon_;
   std::unique_ptr<int []> suit_groups_;
+  std::unique_ptr<int []> opp_encodings_;
 };
 
 void UpdateSuitGroups(const Card *cards, int num_cards, const int old_suit_groups,
@@ -45,4 +45,7 @@ CardAbstraction::CardAbstraction(const Params &params) {
       bucket_thresholds_[st] = kMaxInt;
     }
   }
+  map_buckets_ = params.GetBooleanValue("MapBuckets");
+  populate_buckets_ = params.GetBooleanValue("PopulateBuckets");
+  huge_page_buckets_ = params.GetBooleanValue("HugePageBuckets");
 }
@@ -15,10 +15,16 @@ class CardAbstraction {
   const std::vector<std::string> &Bucketings(void) const {return bucketings_;}
   const std::string &Bucketing(int st) const {return bucketings_[st];}
   int BucketThreshold(int st) const {return bucket_thresholds_[st];}
+  bool MapBuckets(void) const {return map_buckets_;}
+  bool PopulateBuckets(void) const {return populate_buckets_;}
+  bool HugePageBuckets(void) const {return huge_page_buckets_;}
  private:
   std::string card_abstraction_name_;
   std::vector<std::string> bucketings_;
   std::unique_ptr<int []> bucket_thresholds_;
+  bool map_buckets_;
+  bool populate_buckets_;
+  bool huge_page_buckets_;
 };
 
 #endif
@@ -13,5 +13,10 @@ unique_ptr<Params> CreateCardAbstractionParams(void) {
   params->AddParam("CardAbstractionName", P_STRING);
   params->AddParam("Bucketings", P_STRING);
   params->AddParam("BucketThresholds", P_STRING);
+  // Map the bucket files into memory rather than reading them into private arrays
+  params->AddParam("MapBuckets", P_BOOLEAN);
+  // Only meaningful with MapBuckets
+  params->AddParam("PopulateBuckets", P_BOOLEAN);
+  params->AddParam("HugePageBuckets", P_BOOLEAN);
   return params;
 }
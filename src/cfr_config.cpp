@@ -100,8 +100,8 @@ CFRConfig::CFRConfig(const Params &params) {
 	&conditions);
   num_active_conditions_ = conditions.size();
   if (num_active_conditions_ > 0) {
-    active_streets_.reset(new vector<int>[num_active_conditions_]);
-    active_rems_.reset(new vector<int>[num_active_conditions_]);
+    active_streets_.resize(num_active_conditions_);
+    active_rems_.resize(num_active_conditions_);
     for (int c = 0; c < num_active_conditions_; ++c) {
       vector<string> comps, streets, rems;
       Split(conditions[c].c_str(), ':', false, &comps);
@@ -140,6 +140,12 @@ CFRConfig::CFRConfig(const Params &params) {
 
   uniform_ = params.GetBooleanValue("Uniform");
   deal_twice_ = params.GetBooleanValue("DealTwice");
+  telemetry_interval_ = params.GetIntValue("TelemetryInterval");
+  huge_pages_ = params.GetBooleanValue("HugePages");
+  interleave_data_ = params.GetBooleanValue("InterleaveData");
+  pad_buckets_ = params.GetBooleanValue("PadBuckets");
+  pin_threads_ = params.GetBooleanValue("PinThreads");
+  board_batch_size_ = params.GetIntValue("BoardBatchSize");
   ParseDoubles(params.GetStringValue("BoostThresholds"), &boost_thresholds_);
   ParseInts(params.GetStringValue("Freeze"), &freeze_);
 }
@@ -57,6 +57,12 @@ public:
   }
   bool Uniform(void) const {return uniform_;}
   bool DealTwice(void) const {return deal_twice_;}
+  int TelemetryInterval(void) const {return telemetry_interval_;}
+  bool HugePages(void) const {return huge_pages_;}
+  bool InterleaveData(void) const {return interleave_data_;}
+  bool PadBuckets(void) const {return pad_buckets_;}
+  bool PinThreads(void) const {return pin_threads_;}
+  int BoardBatchSize(void) const {return board_batch_size_;}
   const std::vector<double> &BoostThresholds(void) const {return boost_thresholds_;}
   const std::vector<int> &Freeze(void) const {return freeze_;}
  private:
@@ -85,8 +91,8 @@ public:
   std::unique_ptr<bool []> scaled_streets_;
   int active_mod_;
   int num_active_conditions_;
-  std::unique_ptr<std::vector<int> []> active_streets_;
-  std::unique_ptr<std::vector<int> []> active_rems_;
+  std::vector< std::vector<int> > active_streets_;
+  std::vector< std::vector<int> > active_rems_;
   int batch_size_;
   int save_interval_;
   bool double_regrets_;
@@ -94,6 +100,12 @@ public:
   std::vector<int> compressed_streets_;
   bool uniform_;
   bool deal_twice_;
+  int telemetry_interval_;
+  bool huge_pages_;
+  bool interleave_data_;
+  bool pad_buckets_;
+  bool pin_threads_;
+  int board_batch_size_;
   std::vector<double> boost_thresholds_;
   std::vector<int> freeze_;
 };
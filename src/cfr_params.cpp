@@ -45,6 +45,17 @@ unique_ptr<Params> CreateCFRParams(void) {
   params->AddParam("DealTwice", P_BOOLEAN);
   params->AddParam("BoostThresholds", P_STRING);
   params->AddParam("Freeze", P_STRING);
+  // Seconds between TCFR throughput reports; zero (the default) disables them
+  params->AddParam("TelemetryInterval", P_INT);
+  // Placement of the TCFR tree data: back it with huge pages, interleave it across NUMA nodes,
+  // pad per-bucket records so none straddles a cache line, and pin each thread to a core.
+  params->AddParam("HugePages", P_BOOLEAN);
+  params->AddParam("InterleaveData", P_BOOLEAN);
+  params->AddParam("PadBuckets", P_BOOLEAN);
+  params->AddParam("PinThreads", P_BOOLEAN);
+  // Number of final-street boards that VCFR traverses together; one processes one board at a
+  // time.  Defaults to 16 if unset.
+  params->AddParam("BoardBatchSize", P_INT);
 
   return params;
 }
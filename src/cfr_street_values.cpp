@@ -4,6 +4,7 @@
 #include <memory>
 
 #include "betting_tree.h"
+#include "block_codec.h"
 #include "board_tree.h"
 #include "buckets.h"
 #include "cfr_street_values.h"
@@ -72,6 +73,8 @@ CFRStreetValues<T>::CFRStreetValues(int st, const bool *players, int num_holding
     }
   }
   data_ = nullptr;
+  num_scale_boards_ = 0;
+  scales_ = nullptr;
 }
 
 template <typename T>
@@ -89,13 +92,26 @@ CFRStreetValues<T>::CFRStreetValues(CFRStreetValues<T> *p0_values, CFRStreetValu
   p0_values->data_[0] = nullptr;
   data_[1] = p1_values->data_[1];
   p1_values->data_[1] = nullptr;
+  num_scale_boards_ = 0;
+  scales_ = nullptr;
 }
 
 template <typename T>
 CFRStreetValues<T>::~CFRStreetValues(void) {
+  int num_players = Game::NumPlayers();
+  if (scales_) {
+    for (int p = 0; p < num_players; ++p) {
+      if (scales_[p] == nullptr) continue;
+      int num_nt = num_nonterminals_[p];
+      for (int i = 0; i < num_nt; ++i) {
+	delete [] scales_[p][i];
+      }
+      delete [] scales_[p];
+    }
+    delete [] scales_;
+  }
   // This can happen for values for an all-in subtree.
   if (data_ == nullptr) return;
-  int num_players = Game::NumPlayers();
   for (int p = 0; p < num_players; ++p) {
     if (data_[p] == nullptr) continue;
     int num_nt = num_nonterminals_[p];
@@ -149,6 +165,7 @@ void CFRStreetValues<T>::AllocateAndClear2(Node *node, int p) {
 	for (int a = 0; a < num_actions; ++a) {
 	  data_[p][nt][a] = 0;
 	}
+	AllocateNodeScales(p, nt);
       }
     }
   }
@@ -173,6 +190,39 @@ void CFRStreetValues<T>::AllocateAndClear(Node *node, int p) {
   AllocateAndClear2(node, p);
 }
 
+template <typename T>
+void CFRStreetValues<T>::AllocateNodeScales(int p, int nt) {
+  if (num_scale_boards_ == 0) return;
+  if (scales_[p] == nullptr) {
+    int num_nt = num_nonterminals_[p];
+    scales_[p] = new float *[num_nt];
+    for (int i = 0; i < num_nt; ++i) scales_[p][i] = nullptr;
+  }
+  if (scales_[p][nt] == nullptr) {
+    scales_[p][nt] = new float[num_scale_boards_];
+    for (int bd = 0; bd < num_scale_boards_; ++bd) scales_[p][nt][bd] = 0;
+  }
+}
+
+// Gives every node a zeroed scale factor for each of num_boards boards, both for the nodes
+// already allocated and for those allocated later.  Once scales are enabled, they are written
+// after each node's values and read back by ReadNode().
+template <typename T>
+void CFRStreetValues<T>::AllocateScales(int num_boards) {
+  if (scales_) return;
+  int num_players = Game::NumPlayers();
+  num_scale_boards_ = num_boards;
+  scales_ = new float **[num_players];
+  for (int p = 0; p < num_players; ++p) {
+    scales_[p] = nullptr;
+    if (data_ == nullptr || data_[p] == nullptr) continue;
+    int num_nt = num_nonterminals_[p];
+    for (int nt = 0; nt < num_nt; ++nt) {
+      if (data_[p][nt]) AllocateNodeScales(p, nt);
+    }
+  }
+}
+
 // Compute probs from the current hand values using regret matching.  Normally the values we do this
 // to are regrets, but they may also be sumprobs.
 // May eventually want to take parameters for nonneg, explore, uniform, nonterminal succs,
@@ -232,8 +282,8 @@ void CFRStreetValues<T>::PureProbs(int p, int nt, int offset, int num_succs,
 template <typename T>
 void CFRStreetValues<T>::ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs,
 						int num_succs, int dsi,
-						shared_ptr<double []> *succ_vals,
-						int *street_buckets, shared_ptr<double []> vals)
+						double **succ_vals,
+						int *street_buckets, double *vals)
   const {
   const T *all_cs_vals = data_[pa][nt];
   ::ComputeOurValsBucketed(all_cs_vals, num_hole_card_pairs, num_succs, dsi, succ_vals,
@@ -244,8 +294,8 @@ void CFRStreetValues<T>::ComputeOurValsBucketed(int pa, int nt, int num_hole_car
 // the successor values.  This version for systems employing no card abstraction.
 template <typename T>
 void CFRStreetValues<T>::ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs,
-					int dsi, shared_ptr<double []> *succ_vals, int lbd,
-					shared_ptr<double []> vals)
+					int dsi, double **succ_vals, int lbd,
+					double *vals)
   const {
   const T *all_cs_vals = data_[pa][nt];
   ::ComputeOurVals(all_cs_vals, num_hole_card_pairs, num_succs, dsi, succ_vals, lbd, vals);
@@ -282,16 +332,20 @@ void CFRStreetValues<T>::WriteNode(Node *node, Writer *writer, void *compressor)
   int nt = node->NonterminalID();
   int num_succs = node->NumSuccs();
   if (num_succs <= 1) return;
-  // if (compressed_streets_[st]) {}
   if (compressor) {
-    fprintf(stderr, "Compression not supported yet\n");
-    exit(-1);
+    ((BlockCodec *)compressor)->Encode(data_[p][nt], num_holdings_, num_succs, writer);
   } else {
     int num_actions = num_holdings_ * num_succs;
     for (int a = 0; a < num_actions; ++a) {
       writer->Write(data_[p][nt][a]);
     }
   }
+  // Scales are never compressed
+  if (num_scale_boards_ > 0) {
+    for (int bd = 0; bd < num_scale_boards_; ++bd) {
+      writer->WriteFloat(scales_[p][nt][bd]);
+    }
+  }
 }
 
 // Doesn't support abstraction
@@ -302,12 +356,11 @@ void CFRStreetValues<T>::WriteBoardValuesForNode(Node *node, Writer *writer, voi
   int nt = node->NonterminalID();
   int num_succs = node->NumSuccs();
   if (num_succs <= 1) return;
-  // if (compressed_streets_[st]) {}
+  int offset = lbd * num_hole_card_pairs * num_succs;
   if (compressor) {
-    fprintf(stderr, "Compression not supported yet\n");
-    exit(-1);
+    ((BlockCodec *)compressor)->Encode(data_[p][nt] + offset, num_hole_card_pairs, num_succs,
+				       writer);
   } else {
-    int offset = lbd * num_hole_card_pairs * num_succs;
     int num_actions = num_hole_card_pairs * num_succs;
     for (int a = 0; a < num_actions; ++a) {
       writer->Write(data_[p][nt][offset + a]);
@@ -332,6 +385,7 @@ void CFRStreetValues<T>::InitializeValuesForReading(int p, int nt, int num_succs
     data_[p][nt] = new T[num_actions];
   }
   // Don't need to zero
+  AllocateNodeScales(p, nt);
 }
 
 // raw_probs need not sum to 1.0
@@ -409,12 +463,15 @@ void CFRStreetValues<T>::ReadNode(Node *node, Reader *reader, void *decompressor
     return;
   }
   InitializeValuesForReading(p, nt, num_succs);
-  if (decompressor) {
-    fprintf(stderr, "Decompression not supported yet\n");
-    exit(-1);
-  }
   int num_actions = num_holdings_ * num_succs;
-  if (file_value_type_ == CFRValueType::CFR_CHAR) {
+  if (decompressor) {
+    // Compressed values are decoded as stored, so they must be of our type.
+    if (sizeof(T) == 1 && file_value_type_ != CFRValueType::CFR_CHAR) {
+      fprintf(stderr, "Cannot quantize compressed values\n");
+      exit(-1);
+    }
+    ((BlockCodec *)decompressor)->Decode(reader, num_holdings_, num_succs, data_[p][nt]);
+  } else if (file_value_type_ == CFRValueType::CFR_CHAR) {
     for (int a = 0; a < num_actions; ++a) {
       reader->ReadOrDie(&data_[p][nt][a]);
     }
@@ -475,6 +532,11 @@ void CFRStreetValues<T>::ReadNode(Node *node, Reader *reader, void *decompressor
       }
     }
   }
+  if (num_scale_boards_ > 0) {
+    for (int bd = 0; bd < num_scale_boards_; ++bd) {
+      scales_[p][nt][bd] = reader->ReadFloatOrDie();
+    }
+  }
 }
 
 // Doesn't support abstraction.
@@ -488,17 +550,57 @@ void CFRStreetValues<T>::ReadBoardValuesForNode(Node *node, Reader *reader, void
   int p = node->PlayerActing();
   int nt = node->NonterminalID();
   InitializeValuesForReading(p, nt, num_succs);
+  int offset = lbd * num_hole_card_pairs * num_succs;
   if (decompressor) {
-    fprintf(stderr, "Decompression not supported yet\n");
-    exit(-1);
+    ((BlockCodec *)decompressor)->Decode(reader, num_hole_card_pairs, num_succs,
+					 data_[p][nt] + offset);
+    return;
   }
-  int offset = lbd * num_hole_card_pairs * num_succs;
   int num_actions = num_hole_card_pairs * num_succs;
   for (int a = 0; a < num_actions; ++a) {
     reader->ReadOrDie(&data_[p][nt][a + offset]);
   }
 }
 
+// Reads this object's holdings for one node from a file holding the values of a larger system
+// (typically the full game).  The node's values begin at byte offset in the file and cover
+// full_num_holdings holdings; ours start at holding h_begin.  The file must hold values of type
+// T.  If the file is compressed, only the blocks covering our holdings are decoded.  Doesn't
+// support reentrancy.
+template <typename T>
+void CFRStreetValues<T>::ReadNodeFromFull(Node *node, Reader *reader, void *decompressor,
+					  long long int offset, int full_num_holdings,
+					  int h_begin) {
+  int num_succs = node->NumSuccs();
+  if (num_succs <= 1) return;
+  int p = node->PlayerActing();
+  int nt = node->NonterminalID();
+  if (data_ && data_[p] && data_[p][nt]) {
+    return;
+  }
+  InitializeValuesForReading(p, nt, num_succs);
+  long long int end;
+  if (decompressor) {
+    end = ((BlockCodec *)decompressor)->DecodeRange(reader, offset, full_num_holdings, num_succs,
+						    h_begin, num_holdings_, data_[p][nt]);
+  } else {
+    reader->SeekTo(offset + (long long int)h_begin * num_succs * sizeof(T));
+    int num_actions = num_holdings_ * num_succs;
+    for (int a = 0; a < num_actions; ++a) {
+      reader->ReadOrDie(&data_[p][nt][a]);
+    }
+    end = offset + (long long int)full_num_holdings * num_succs * sizeof(T);
+  }
+  if (num_scale_boards_ > 0) {
+    // The scales for all boards follow the values
+    int bd_begin = h_begin / Game::NumHoleCardPairs(st_);
+    reader->SeekTo(end + bd_begin * sizeof(float));
+    for (int bd = 0; bd < num_scale_boards_; ++bd) {
+      scales_[p][nt][bd] = reader->ReadFloatOrDie();
+    }
+  }
+}
+
 template <typename T>
 void CFRStreetValues<T>::MergeInto(Node *full_node, Node *subgame_node, int root_bd_st,
 				   int root_bd, const CFRStreetValues<T> *subgame_values,
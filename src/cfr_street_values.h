@@ -17,12 +17,12 @@ class AbstractCFRStreetValues {
   virtual void RMProbs(int p, int nt, int offset,  int num_succs, int dsi, double *probs) const = 0;
   virtual void PureProbs(int p, int nt, int offset, int num_succs, double *probs) const = 0;
   virtual void ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs, int num_succs,
-				      int dsi, std::shared_ptr<double []> *succ_vals,
+				      int dsi, double **succ_vals,
 				      int *street_buckets,
-				      std::shared_ptr<double []> vals) const = 0;
+				      double *vals) const = 0;
   virtual void ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-			      std::shared_ptr<double []> *succ_vals, int lbd,
-			      std::shared_ptr<double []> vals) const = 0;
+			      double **succ_vals, int lbd,
+			      double *vals) const = 0;
   virtual void SetCurrentAbstractedStrategy(int pa, int nt, int num_buckets, int num_succs, int dsi,
 					    double *all_cs_probs) const = 0;
   virtual void Floor(int p, int nt, int num_succs, int floor) = 0;
@@ -30,10 +30,13 @@ class AbstractCFRStreetValues {
   virtual void ReadNode(Node *node, Reader *reader, void *decompressor) = 0;
   virtual void ReadBoardValuesForNode(Node *node, Reader *reader, void *decompressor, int lbd,
 				      int num_hole_card_pairs) = 0;
+  virtual void ReadNodeFromFull(Node *node, Reader *reader, void *decompressor,
+				long long int offset, int full_num_holdings, int h_begin) = 0;
   virtual void WriteNode(Node *node, Writer *writer, void *compressor) const = 0;
   virtual void WriteBoardValuesForNode(Node *node, Writer *writer, void *compressor, int lbd,
 				       int num_hole_card_pairs) const = 0;
   virtual CFRValueType MyType(void) const = 0;
+  virtual void AllocateScales(int num_boards) = 0;
   virtual void MergeInto(Node *full_node, Node *subgame_node, int root_bd_st, int root_bd,
 			 const AbstractCFRStreetValues *subgame_values, const Buckets &buckets);
 };
@@ -51,17 +54,21 @@ public:
   int NumHoldings(void) const {return num_holdings_;}
   int NumNonterminals(int p) const {return num_nonterminals_[p];}
   T *AllValues(int p, int nt) const {return data_[p] ? data_[p][nt] : nullptr;}
+  // Per-board scale factors, if any (see AllocateScales()).
+  float *Scales(int p, int nt) const {return scales_ && scales_[p] ? scales_[p][nt] : nullptr;}
+  int NumScaleBoards(void) const {return num_scale_boards_;}
   void AllocateAndClear(Node *node, int p);
+  void AllocateScales(int num_boards);
   // Note: doesn't handle nodes with one succ
   void RMProbs(int p, int nt, int offset, int num_succs, int dsi, double *probs) const;
   // Note: doesn't handle nodes with one succ
   void PureProbs(int p, int nt, int offset, int num_succs, double *probs) const;
   void ComputeOurValsBucketed(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-			      std::shared_ptr<double []> *succ_vals, int *street_buckets,
-			      std::shared_ptr<double []> vals) const;
+			      double **succ_vals, int *street_buckets,
+			      double *vals) const;
   void ComputeOurVals(int pa, int nt, int num_hole_card_pairs, int num_succs, int dsi,
-		      std::shared_ptr<double []> *succ_vals, int lbd,
-		      std::shared_ptr<double []> vals) const;
+		      double **succ_vals, int lbd,
+		      double *vals) const;
   void SetCurrentAbstractedStrategy(int pa, int nt, int num_buckets, int num_succs, int dsi,
 				    double *all_cs_probs) const;
   void Floor(int p, int nt, int num_succs, int floor);
@@ -70,6 +77,8 @@ public:
   void ReadNode(Node *node, Reader *reader, void *decompressor);
   void ReadBoardValuesForNode(Node *node, Reader *reader, void *decompressor, int lbd,
 			      int num_hole_card_pairs);
+  void ReadNodeFromFull(Node *node, Reader *reader, void *decompressor, long long int offset,
+			int full_num_holdings, int h_begin);
   void WriteNode(Node *node, Writer *writer, void *compressor) const;
   void WriteBoardValuesForNode(Node *node, Writer *writer, void *compressor, int lbd,
 			       int num_hole_card_pairs) const;
@@ -77,6 +86,7 @@ public:
 		 const CFRStreetValues<T> *subgame_values, const Buckets &buckets);
 protected:
   void AllocateAndClear2(Node *node, int p);
+  void AllocateNodeScales(int p, int nt);
   unsigned char ***GetUnsignedCharData(void);
   
   int st_;
@@ -84,6 +94,10 @@ protected:
   int num_holdings_;
   std::unique_ptr<int []> num_nonterminals_;
   T ***data_;
+  // Quantized regrets are stored as q * scale where each board at each node has its own scale.
+  // scales_ is null unless AllocateScales() has been called.
+  int num_scale_boards_;
+  float ***scales_;
   CFRValueType file_value_type_;
 };
 
@@ -56,81 +56,146 @@ template void RMProbs<unsigned short>(const unsigned short *vals, int num_succs,
 template void RMProbs<unsigned char>(const unsigned char *vals, int num_succs, int dsi,
 				     double *probs);
 
+// The kernels below work on blocks of hands at a time, with loops running across hands for a
+// fixed successor, so that the compiler can vectorize them.  Each is compiled for AVX-512, for
+// AVX2 and for the baseline instruction set; the best version the CPU supports is chosen at
+// load time.
+#define SIMD_KERNEL __attribute__((target_clones("avx512f", "avx2", "default")))
+
+static const int kBlockSize = 64;
+static const int kMaxSuccs = 50;
+
+// Regret matching for a block of num (<= kBlockSize) hands.  The values for hand i start at
+// all_vals + offsets[i].  probs is laid out successor-major: probs[s * kBlockSize + i].  Produces
+// exactly the same probabilities as RMProbs().
+template <typename T> SIMD_KERNEL
+static void BlockRMProbs(const T *all_vals, const int *offsets, int num, int num_succs, int dsi,
+			 double *probs) {
+  double sums[kBlockSize];
+  for (int i = 0; i < num; ++i) sums[i] = 0;
+  for (int s = 0; s < num_succs; ++s) {
+    for (int i = 0; i < num; ++i) {
+      T v = all_vals[offsets[i] + s];
+      sums[i] += v > 0 ? (double)v : 0;
+    }
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    double def = s == dsi ? 1.0 : 0;
+    double *my_probs = probs + s * kBlockSize;
+    for (int i = 0; i < num; ++i) {
+      T v = all_vals[offsets[i] + s];
+      double pv = v > 0 ? (double)v : 0;
+      my_probs[i] = sums[i] == 0 ? def : pv / sums[i];
+    }
+  }
+}
+
+// vals[i] += sum over s of succ_vals[s][i] * probs[s][i] for a block of hands.
+SIMD_KERNEL
+static void BlockWeightedSum(double **succ_vals, const double *probs, int i0, int num,
+			     int num_succs, double *vals) {
+  double *my_vals = vals + i0;
+  for (int s = 0; s < num_succs; ++s) {
+    const double *my_succ_vals = succ_vals[s] + i0;
+    const double *my_probs = probs + s * kBlockSize;
+    for (int i = 0; i < num; ++i) {
+      my_vals[i] += my_succ_vals[i] * my_probs[i];
+    }
+  }
+}
+
+static void CheckNumSuccs(int num_succs) {
+  if (num_succs > kMaxSuccs) {
+    fprintf(stderr, "Too many succs: %i\n", num_succs);
+    exit(-1);
+  }
+}
+
 // Uses the current strategy (from regrets or sumprobs) to compute the weighted average of
 // the successor values.  This version for systems employing card abstraction.
 template <typename T> void ComputeOurValsBucketed(const T *all_cs_vals, int num_hole_card_pairs,
-						  int num_succs, int dsi,
-						  shared_ptr<double []> *succ_vals,
-						  int *street_buckets, shared_ptr<double []> vals) {
-  unique_ptr<double []> current_probs(new double[num_succs]);
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
-    int b = street_buckets[i];
-    RMProbs(all_cs_vals + b * num_succs, num_succs, dsi, current_probs.get());
-    for (int s = 0; s < num_succs; ++s) {
-      vals[i] += succ_vals[s][i] * current_probs[s];
-    }
+						  int num_succs, int dsi, double **succ_vals,
+						  int *street_buckets, double *vals) {
+  CheckNumSuccs(num_succs);
+  int offsets[kBlockSize];
+  double probs[kMaxSuccs * kBlockSize];
+  for (int i0 = 0; i0 < num_hole_card_pairs; i0 += kBlockSize) {
+    int num = num_hole_card_pairs - i0;
+    if (num > kBlockSize) num = kBlockSize;
+    for (int i = 0; i < num; ++i) offsets[i] = street_buckets[i0 + i] * num_succs;
+    BlockRMProbs(all_cs_vals, offsets, num, num_succs, dsi, probs);
+    BlockWeightedSum(succ_vals, probs, i0, num, num_succs, vals);
   }
 }
 
 template void ComputeOurValsBucketed<double>(const double *all_cs_vals, int num_hole_card_pairs,
 					     int num_succs, int dsi,
-					     shared_ptr<double []> *succ_vals,
-					     int *street_buckets, shared_ptr<double []> vals);
+					     double **succ_vals,
+					     int *street_buckets, double *vals);
 template void ComputeOurValsBucketed<int>(const int *all_cs_vals, int num_hole_card_pairs,
-					  int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-					  int *street_buckets, shared_ptr<double []> vals);
+					  int num_succs, int dsi, double **succ_vals,
+					  int *street_buckets, double *vals);
 template void ComputeOurValsBucketed<unsigned short>(const unsigned short *all_cs_vals, 
 						     int num_hole_card_pairs, int num_succs,
-						     int dsi, shared_ptr<double []> *succ_vals,
+						     int dsi, double **succ_vals,
 						     int *street_buckets,
-						     shared_ptr<double []> vals);
+						     double *vals);
 template void ComputeOurValsBucketed<unsigned char>(const unsigned char *all_cs_vals,
 						    int num_hole_card_pairs,
 						    int num_succs, int dsi,
-						    shared_ptr<double []> *succ_vals,
+						    double **succ_vals,
 						    int *street_buckets,
-						    shared_ptr<double []> vals);
+						    double *vals);
 
 // Uses the current strategy (from regrets or sumprobs) to compute the weighted average of
 // the successor values.  This version for unabstracted systems.
 template <typename T> void ComputeOurVals(const T *all_cs_vals, int num_hole_card_pairs,
-					  int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-					  int lbd, shared_ptr<double []> vals) {
-  unique_ptr<double []> current_probs(new double[num_succs]);
+					  int num_succs, int dsi, double **succ_vals,
+					  int lbd, double *vals) {
+  CheckNumSuccs(num_succs);
+  int offsets[kBlockSize];
+  double probs[kMaxSuccs * kBlockSize];
   int base = lbd * num_hole_card_pairs * num_succs;
-  for (int i = 0; i < num_hole_card_pairs; ++i) {
-    int offset = base + i * num_succs;
-    RMProbs(all_cs_vals + offset, num_succs, dsi, current_probs.get());
-    for (int s = 0; s < num_succs; ++s) {
-      vals[i] += succ_vals[s][i] * current_probs[s];
-    }
+  for (int i0 = 0; i0 < num_hole_card_pairs; i0 += kBlockSize) {
+    int num = num_hole_card_pairs - i0;
+    if (num > kBlockSize) num = kBlockSize;
+    for (int i = 0; i < num; ++i) offsets[i] = base + (i0 + i) * num_succs;
+    BlockRMProbs(all_cs_vals, offsets, num, num_succs, dsi, probs);
+    BlockWeightedSum(succ_vals, probs, i0, num, num_succs, vals);
   }
 }
 
 template void ComputeOurVals<double>(const double *all_cs_vals, int num_hole_card_pairs,
-				     int num_succs, int dsi, shared_ptr<double []> *succ_vals,
-				     int lbd, shared_ptr<double []> vals);
+				     int num_succs, int dsi, double **succ_vals,
+				     int lbd, double *vals);
 template void ComputeOurVals<int>(const int *all_cs_vals, int num_hole_card_pairs, int num_succs,
-				  int dsi, shared_ptr<double []> *succ_vals, int lbd,
-				  shared_ptr<double []> vals);
+				  int dsi, double **succ_vals, int lbd,
+				  double *vals);
 template void ComputeOurVals<unsigned short>(const unsigned short *all_cs_vals,
 					     int num_hole_card_pairs, int num_succs, int dsi,
-					     shared_ptr<double []> *succ_vals, int lbd,
-					     shared_ptr<double []> vals);
+					     double **succ_vals, int lbd,
+					     double *vals);
 template void ComputeOurVals<unsigned char>(const unsigned char *all_cs_vals,
 					    int num_hole_card_pairs, int num_succs, int dsi,
-					    shared_ptr<double []> *succ_vals, int lbd,
-					    shared_ptr<double []> vals);
+					    double **succ_vals, int lbd,
+					    double *vals);
 
 template <typename T> void SetCurrentAbstractedStrategy(const T *all_regrets, int num_buckets,
 							int num_succs, int dsi,
 							double *all_cs_probs) {
-  unique_ptr<double []> current_probs(new double[num_succs]);
-  for (int b = 0; b < num_buckets; ++b) {
-    int offset = b * num_succs;
-    RMProbs(all_regrets + offset, num_succs, dsi, current_probs.get());
-    for (int s = 0; s < num_succs; ++s) {
-      all_cs_probs[b * num_succs + s] = current_probs[s];
+  CheckNumSuccs(num_succs);
+  int offsets[kBlockSize];
+  double probs[kMaxSuccs * kBlockSize];
+  for (int b0 = 0; b0 < num_buckets; b0 += kBlockSize) {
+    int num = num_buckets - b0;
+    if (num > kBlockSize) num = kBlockSize;
+    for (int i = 0; i < num; ++i) offsets[i] = (b0 + i) * num_succs;
+    BlockRMProbs(all_regrets, offsets, num, num_succs, dsi, probs);
+    for (int i = 0; i < num; ++i) {
+      double *my_cs_probs = all_cs_probs + (b0 + i) * num_succs;
+      for (int s = 0; s < num_succs; ++s) {
+	my_cs_probs[s] = probs[s * kBlockSize + i];
+      }
     }
   }
 }
@@ -146,16 +211,132 @@ template void SetCurrentAbstractedStrategy<unsigned char>(const unsigned char *a
 							  int num_buckets, int num_succs, int dsi,
 							  double *all_cs_probs);
 
-shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
-			       double sum_opp_probs, double *total_card_probs) {
+// Regret updates for unabstracted systems.  Every hand has its own regrets, so we can run across
+// hands for a fixed successor.  (Bucketed updates can't be done this way because two hands in
+// the same bucket update the same regrets.)
+SIMD_KERNEL
+void UpdateHandRegrets(int *regrets, int num_hole_card_pairs, int num_succs, const double *vals,
+		       double **succ_vals, bool nn_regrets, double regret_scaling, int floor,
+		       int ceiling) {
+  if (nn_regrets) {
+    for (int s = 0; s < num_succs; ++s) {
+      const double *my_succ_vals = succ_vals[s];
+      for (int i = 0; i < num_hole_card_pairs; ++i) {
+	double d = my_succ_vals[i] - vals[i];
+	int ri = regrets[i * num_succs + s] + (int)lrint(d * regret_scaling);
+	regrets[i * num_succs + s] = ri < floor ? floor : (ri > ceiling ? ceiling : ri);
+      }
+    }
+  } else {
+    for (int s = 0; s < num_succs; ++s) {
+      const double *my_succ_vals = succ_vals[s];
+      for (int i = 0; i < num_hole_card_pairs; ++i) {
+	double d = my_succ_vals[i] - vals[i];
+	regrets[i * num_succs + s] += lrint(d * regret_scaling);
+      }
+    }
+    // Halve all the regrets of any hand that is in danger of overflowing
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      int *my_regrets = regrets + i * num_succs;
+      bool overflow = false;
+      for (int s = 0; s < num_succs; ++s) {
+	if (my_regrets[s] < -2000000000 || my_regrets[s] > 2000000000) {
+	  overflow = true;
+	}
+      }
+      if (overflow) {
+	for (int s = 0; s < num_succs; ++s) {
+	  my_regrets[s] /= 2;
+	}
+      }
+    }
+  }
+}
+
+// This implementation does not round regrets to ints, nor do scaling.
+SIMD_KERNEL
+void UpdateHandRegrets(double *regrets, int num_hole_card_pairs, int num_succs,
+		       const double *vals, double **succ_vals, bool nn_regrets, double floor,
+		       double ceiling) {
+  for (int s = 0; s < num_succs; ++s) {
+    const double *my_succ_vals = succ_vals[s];
+    if (nn_regrets) {
+      for (int i = 0; i < num_hole_card_pairs; ++i) {
+	double newr = regrets[i * num_succs + s] + my_succ_vals[i] - vals[i];
+	regrets[i * num_succs + s] = newr < floor ? floor : (newr > ceiling ? ceiling : newr);
+      }
+    } else {
+      for (int i = 0; i < num_hole_card_pairs; ++i) {
+	regrets[i * num_succs + s] += my_succ_vals[i] - vals[i];
+      }
+    }
+  }
+}
+
+// Regret updates for unabstracted systems with quantized regrets.  The regrets of one board at
+// one node are stored as q * scale, with a single scale for the board.  Each update decodes the
+// regrets, adds the new regrets, floors the result at zero (so this is only for CFR+) and
+// re-encodes with a new scale chosen so that the largest regret maps to the top of the range.
+// Rounding is stochastic so that regret increments smaller than the scale are not systematically
+// lost.  The dither is a hash of seed and the index, which keeps results deterministic.
+template <typename T> SIMD_KERNEL
+static void UpdateQuantizedRegrets(T *regrets, float *scale, int num_hole_card_pairs,
+				   int num_succs, const double *vals, double **succ_vals,
+				   unsigned int seed) {
+  const double max_q = (T)~(T)0;
+  double old_scale = *scale;
+  double max_r = 0;
+  for (int s = 0; s < num_succs; ++s) {
+    const double *my_succ_vals = succ_vals[s];
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      double r = regrets[i * num_succs + s] * old_scale + my_succ_vals[i] - vals[i];
+      max_r = r > max_r ? r : max_r;
+    }
+  }
+  float new_scale = max_r / max_q;
+  if (new_scale == 0) {
+    int num = num_hole_card_pairs * num_succs;
+    for (int a = 0; a < num; ++a) regrets[a] = 0;
+    *scale = 0;
+    return;
+  }
+  double inv_scale = 1.0 / new_scale;
+  for (int s = 0; s < num_succs; ++s) {
+    const double *my_succ_vals = succ_vals[s];
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      int a = i * num_succs + s;
+      double r = regrets[a] * old_scale + my_succ_vals[i] - vals[i];
+      unsigned int h = (a + seed) * 2654435761u;
+      h ^= h >> 15;
+      h *= 2246822519u;
+      h ^= h >> 13;
+      double q = (r > 0 ? r * inv_scale : 0) + (h >> 8) * (1.0 / 16777216.0);
+      regrets[a] = q >= max_q ? (T)max_q : (T)(int)q;
+    }
+  }
+  *scale = new_scale;
+}
+
+void UpdateHandRegrets(unsigned char *regrets, float *scale, int num_hole_card_pairs,
+		       int num_succs, const double *vals, double **succ_vals, unsigned int seed) {
+  UpdateQuantizedRegrets(regrets, scale, num_hole_card_pairs, num_succs, vals, succ_vals, seed);
+}
+
+void UpdateHandRegrets(unsigned short *regrets, float *scale, int num_hole_card_pairs,
+		       int num_succs, const double *vals, double **succ_vals, unsigned int seed) {
+  UpdateQuantizedRegrets(regrets, scale, num_hole_card_pairs, num_succs, vals, succ_vals, seed);
+}
+
+// Writes the values of each of our hands at a showdown node into vals.  The win probs are
+// staged in vals, so no scratch space is needed.
+void Showdown(Node *node, const CanonicalCards *hands, double *opp_probs, double sum_opp_probs,
+	      double *total_card_probs, double *vals) {
   int max_card1 = Game::MaxCard() + 1;
   double cum_prob = 0;
   double cum_card_probs[52];
   for (Card c = 0; c < max_card1; ++c) cum_card_probs[c] = 0;
   int num_hole_card_pairs = hands->NumRaw();
-  unique_ptr<double []> win_probs(new double[num_hole_card_pairs]);
   double half_pot = node->LastBetTo();
-  shared_ptr<double []> vals(new double[num_hole_card_pairs]);
 
   int j = 0;
   while (j < num_hole_card_pairs) {
@@ -171,7 +352,7 @@ shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *
       const Card *cards = hands->Cards(j);
       Card hi = cards[0];
       Card lo = cards[1];
-      win_probs[j] = cum_prob - cum_card_probs[hi] - cum_card_probs[lo];
+      vals[j] = cum_prob - cum_card_probs[hi] - cum_card_probs[lo];
       ++j;
     }
     // Positions begin_range...j-1 (inclusive) all have the same hand value
@@ -193,17 +374,21 @@ shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *
       double better_lo_prob = total_card_probs[lo] - cum_card_probs[lo];
       double lose_prob = (sum_opp_probs - cum_prob) -
 	better_hi_prob - better_lo_prob;
-      vals[k] = (win_probs[k] - lose_prob) * half_pot;
-      // fprintf(stderr, "vals[%u] %f sop %f\n", k, vals[k], sum_opp_probs);
+      vals[k] = (vals[k] - lose_prob) * half_pot;
     }
   }
-  // fprintf(stderr, "showdown %i vals[0] %f\n", node->TerminalID(), vals[0]);
+}
 
+shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
+			       double sum_opp_probs, double *total_card_probs) {
+  shared_ptr<double []> vals(new double[hands->NumRaw()]);
+  Showdown(node, hands, opp_probs, sum_opp_probs, total_card_probs, vals.get());
   return vals;
 }
 
-shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
-			   double sum_opp_probs, double *total_card_probs) {
+// Writes the values of each of our hands at a fold node into vals.
+void Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
+	  double sum_opp_probs, double *total_card_probs, double *vals) {
   int max_card1 = Game::MaxCard() + 1;
   // Sign of half_pot reflects who wins the pot
   double half_pot;
@@ -215,7 +400,6 @@ shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, doubl
     half_pot = -node->LastBetTo();
   }
   int num_hole_card_pairs = hands->NumRaw();
-  shared_ptr<double []> vals(new double[num_hole_card_pairs]);
 
   for (int i = 0; i < num_hole_card_pairs; ++i) {
     const Card *cards = hands->Cards(i);
@@ -226,10 +410,113 @@ shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, doubl
     vals[i] = half_pot *
       (sum_opp_probs + opp_prob - (total_card_probs[hi] + total_card_probs[lo]));
   }
+}
 
+shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
+			   double sum_opp_probs, double *total_card_probs) {
+  shared_ptr<double []> vals(new double[hands->NumRaw()]);
+  Fold(node, p, hands, opp_probs, sum_opp_probs, total_card_probs, vals.get());
   return vals;
 }
 
+// Gathers the opponent reach probability of each hand into probs and returns their sum.
+SIMD_KERNEL
+static double GatherOppProbs(const int *opp_encodings, int num_hole_card_pairs,
+			     const double *opp_probs, double *probs) {
+  double sum = 0;
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    double prob = opp_probs[opp_encodings[i]];
+    probs[i] = prob;
+    sum += prob;
+  }
+  return sum;
+}
+
+// Turns the reach probability of each hand into the opponent reach probability not blocked by
+// the hand.
+SIMD_KERNEL
+static void UnblockedOppProbs(const Card *cards, int num_hole_card_pairs, double sum_opp_probs,
+			      const double *total_card_probs, double *probs) {
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    Card hi = cards[2 * i];
+    Card lo = cards[2 * i + 1];
+    probs[i] = sum_opp_probs + probs[i] - (total_card_probs[hi] + total_card_probs[lo]);
+  }
+}
+
+// Computes, in one pass over our hands, everything that the values at any fold or showdown
+// node facing opp_probs depend on, so that siblings need not repeat the work.  fold_probs[i]
+// gets the opponent reach probability not blocked by hand i.  If showdown_probs is non-null,
+// showdown_probs[i] gets the probability hand i wins minus the probability it loses; this
+// requires the hands to be sorted by hand strength.  Allocates no memory.
+void TerminalProbs(const CanonicalCards *hands, const double *opp_probs, double *fold_probs,
+		   double *showdown_probs) {
+  int max_card1 = Game::MaxCard() + 1;
+  int num_hole_card_pairs = hands->NumRaw();
+  const Card *cards = hands->Cards(0);
+  // fold_probs temporarily holds the reach probability of each hand
+  double sum_opp_probs = GatherOppProbs(hands->OppEncodings(), num_hole_card_pairs, opp_probs,
+					fold_probs);
+  double total_card_probs[52];
+  for (Card c = 0; c < max_card1; ++c) total_card_probs[c] = 0;
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    double prob = fold_probs[i];
+    total_card_probs[cards[2 * i]] += prob;
+    total_card_probs[cards[2 * i + 1]] += prob;
+  }
+  if (showdown_probs) {
+    // As in Showdown(), but the reach probs are already gathered.
+    double cum_prob = 0;
+    double cum_card_probs[52];
+    for (Card c = 0; c < max_card1; ++c) cum_card_probs[c] = 0;
+    int j = 0;
+    while (j < num_hole_card_pairs) {
+      int last_hand_val = hands->HandValue(j);
+      int begin_range = j;
+      while (j < num_hole_card_pairs && hands->HandValue(j) == last_hand_val) {
+	Card hi = cards[2 * j];
+	Card lo = cards[2 * j + 1];
+	showdown_probs[j] = cum_prob - cum_card_probs[hi] - cum_card_probs[lo];
+	++j;
+      }
+      for (int k = begin_range; k < j; ++k) {
+	double prob = fold_probs[k];
+	cum_card_probs[cards[2 * k]] += prob;
+	cum_card_probs[cards[2 * k + 1]] += prob;
+	cum_prob += prob;
+      }
+      for (int k = begin_range; k < j; ++k) {
+	Card hi = cards[2 * k];
+	Card lo = cards[2 * k + 1];
+	double better_hi_prob = total_card_probs[hi] - cum_card_probs[hi];
+	double better_lo_prob = total_card_probs[lo] - cum_card_probs[lo];
+	double lose_prob = (sum_opp_probs - cum_prob) - better_hi_prob - better_lo_prob;
+	showdown_probs[k] -= lose_prob;
+      }
+    }
+  }
+  UnblockedOppProbs(cards, num_hole_card_pairs, sum_opp_probs, total_card_probs, fold_probs);
+}
+
+// Values at a terminal node given the output of TerminalProbs().
+SIMD_KERNEL
+static void ScaleTerminalProbs(const double *terminal_probs, int num_hole_card_pairs,
+			       double half_pot, double *vals) {
+  for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = half_pot * terminal_probs[i];
+}
+
+void FoldVals(Node *node, int p, int num_hole_card_pairs, const double *fold_probs,
+	      double *vals) {
+  // Player acting encodes player remaining at fold nodes
+  double half_pot = p == node->PlayerActing() ? node->LastBetTo() : -node->LastBetTo();
+  ScaleTerminalProbs(fold_probs, num_hole_card_pairs, half_pot, vals);
+}
+
+void ShowdownVals(Node *node, int num_hole_card_pairs, const double *showdown_probs,
+		  double *vals) {
+  ScaleTerminalProbs(showdown_probs, num_hole_card_pairs, node->LastBetTo(), vals);
+}
+
 void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_probs,
 			    double *ret_sum_opp_probs, double *total_card_probs) {
   double sum_opp_probs = 0;
@@ -252,7 +539,7 @@ void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_pro
 
 static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_prob,
 					  double *current_probs,
-					  shared_ptr<double []> *succ_opp_probs, int it,
+					  double **succ_opp_probs, int it,
 					  int soft_warmup, int hard_warmup, double sumprob_scaling,
 					  double *sumprobs) {
   for (int s = 0; s < num_succs; ++s) {
@@ -278,7 +565,7 @@ static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_p
 
 static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_prob,
 					  double *current_probs,
-					  shared_ptr<double []> *succ_opp_probs, int it,
+					  double **succ_opp_probs, int it,
 					  int soft_warmup, int hard_warmup, double sumprob_scaling,
 					  int *sumprobs) {
   bool downscale = false;
@@ -320,7 +607,7 @@ static void UpdateSumprobsAndSuccOppProbs(int enc, int num_succs, double reach_p
 // current probs.
 template <typename T>
 void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_buckets,
-		     double *opp_probs, shared_ptr<double []> *succ_opp_probs,
+		     double *opp_probs, double **succ_opp_probs,
 		     double *current_probs, int it, int soft_warmup, int hard_warmup,
 		     double sumprob_scaling, CFRStreetValues<T> *sumprobs) {
   int st = node->Street();
@@ -360,20 +647,20 @@ void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_bucket
 
 // Instantiate
 template void ProcessOppProbs<int>(Node *node, const CanonicalCards *hands, int *street_buckets,
-				   double *opp_probs, shared_ptr<double []> *succ_opp_probs,
+				   double *opp_probs, double **succ_opp_probs,
 				   double *current_probs, int it, int soft_warmup,
 				   int hard_warmup, double sumprob_scaling,
 				   CFRStreetValues<int> *sumprobs);
 template void ProcessOppProbs<double>(Node *node, const CanonicalCards *hands,
 				      int *street_buckets, double *opp_probs,
-				      shared_ptr<double []> *succ_opp_probs,
+				      double **succ_opp_probs,
 				      double *current_probs, int it, int soft_warmup,
 				      int hard_warmup, double sumprob_scaling,
 				      CFRStreetValues<double> *sumprobs);
 
 template <typename T1, typename T2>
 void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
-		     int *street_buckets, double *opp_probs, shared_ptr<double []> *succ_opp_probs,
+		     int *street_buckets, double *opp_probs, double **succ_opp_probs,
 		     const CFRStreetValues<T1> &cs_vals, int dsi, int it, int soft_warmup,
 		     int hard_warmup, double sumprob_scaling, CFRStreetValues<T2> *sumprobs) {
   int st = node->Street();
@@ -422,28 +709,28 @@ void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool buck
 template void
 ProcessOppProbs<int, int>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
 			  int *street_buckets, double *opp_probs,
-			  shared_ptr<double []> *succ_opp_probs,
+			  double **succ_opp_probs,
 			  const CFRStreetValues<int> &cs_vals, int dsi, int it,
 			  int soft_warmup, int hard_warmup, double sumprob_scaling,
 			  CFRStreetValues<int> *sumprobs);
 template void
 ProcessOppProbs<double, double>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
 				int *street_buckets, double *opp_probs,
-				shared_ptr<double []> *succ_opp_probs,
+				double **succ_opp_probs,
 				const CFRStreetValues<double> &cs_vals,
 				int dsi, int it, int soft_warmup, int hard_warmup,
 				double sumprob_scaling,	CFRStreetValues<double> *sumprobs);
 template void
 ProcessOppProbs<int, double>(Node *node, int lbd, const CanonicalCards *hands,
 			     bool bucketed, int *street_buckets, double *opp_probs,
-			     shared_ptr<double []> *succ_opp_probs,
+			     double **succ_opp_probs,
 			     const CFRStreetValues<int> &cs_vals, int dsi, int it,
 			     int soft_warmup, int hard_warmup, double sumprob_scaling,
 			     CFRStreetValues<double> *sumprobs);
 template void
 ProcessOppProbs<double, int>(Node *node, int lbd, const CanonicalCards *hands,
 			     bool bucketed, int *street_buckets, double *opp_probs,
-			     shared_ptr<double []> *succ_opp_probs,
+			     double **succ_opp_probs,
 			     const CFRStreetValues<double> &cs_vals, int dsi,
 			     int it, int soft_warmup, int hard_warmup,
 			     double sumprob_scaling,
@@ -451,10 +738,31 @@ ProcessOppProbs<double, int>(Node *node, int lbd, const CanonicalCards *hands,
 template void
 ProcessOppProbs<unsigned char, int>(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
 				    int *street_buckets, double *opp_probs,
-				    shared_ptr<double []> *succ_opp_probs,
+				    double **succ_opp_probs,
 				    const CFRStreetValues<unsigned char> &cs_vals, int dsi, int it,
 				    int soft_warmup, int hard_warmup, double sumprob_scaling,
 				    CFRStreetValues<int> *sumprobs);
+template void
+ProcessOppProbs<unsigned char, double>(Node *node, int lbd, const CanonicalCards *hands,
+				       bool bucketed, int *street_buckets, double *opp_probs,
+				       double **succ_opp_probs,
+				       const CFRStreetValues<unsigned char> &cs_vals, int dsi,
+				       int it, int soft_warmup, int hard_warmup,
+				       double sumprob_scaling, CFRStreetValues<double> *sumprobs);
+template void
+ProcessOppProbs<unsigned short, int>(Node *node, int lbd, const CanonicalCards *hands,
+				     bool bucketed, int *street_buckets, double *opp_probs,
+				     double **succ_opp_probs,
+				     const CFRStreetValues<unsigned short> &cs_vals, int dsi,
+				     int it, int soft_warmup, int hard_warmup,
+				     double sumprob_scaling, CFRStreetValues<int> *sumprobs);
+template void
+ProcessOppProbs<unsigned short, double>(Node *node, int lbd, const CanonicalCards *hands,
+					bool bucketed, int *street_buckets, double *opp_probs,
+					double **succ_opp_probs,
+					const CFRStreetValues<unsigned short> &cs_vals, int dsi,
+					int it, int soft_warmup, int hard_warmup,
+					double sumprob_scaling, CFRStreetValues<double> *sumprobs);
 
 #if 0
 // Abstracted, integer regrets
@@ -562,7 +870,9 @@ void DeleteOldFiles(const CardAbstraction &ca, const string &betting_abstraction
       string filename(full_path, j + 1, full_path_len - (j + 1));
       vector<string> comps;
       Split(filename.c_str(), '.', false, &comps);
-      if (comps.size() != 8) {
+      // Checksum and index sidecars have an extra ".crc" or ".idx" component
+      if (comps.size() != 8 &&
+	  ! (comps.size() == 9 && (comps[8] == "crc" || comps[8] == "idx"))) {
 	fprintf(stderr, "File \"%s\" has wrong number of components\n",
 		full_path.c_str());
 	exit(-1);
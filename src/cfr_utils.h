@@ -13,31 +13,51 @@ class Node;
 template <typename T> void RMProbs(const T *vals, int num_succs, int dsi, double *probs);
 template <typename T> void ComputeOurValsBucketed(const T *all_cs_vals, int num_hole_card_pairs,
 						  int num_succs, int dsi,
-						  std::shared_ptr<double []> *succ_vals,
+						  double **succ_vals,
 						  int *street_buckets,
-						  std::shared_ptr<double []> vals);
+						  double *vals);
 template <typename T> void ComputeOurVals(const T *all_cs_vals, int num_hole_card_pairs,
 					  int num_succs, int dsi,
-					  std::shared_ptr<double []> *succ_vals, int lbd,
-					  std::shared_ptr<double []> vals);
+					  double **succ_vals, int lbd,
+					  double *vals);
 template <typename T> void SetCurrentAbstractedStrategy(const T *all_regrets, int num_buckets,
 							int num_succs, int dsi,
 							double *all_cs_probs);
+void UpdateHandRegrets(int *regrets, int num_hole_card_pairs, int num_succs, const double *vals,
+		       double **succ_vals, bool nn_regrets, double regret_scaling, int floor,
+		       int ceiling);
+void UpdateHandRegrets(double *regrets, int num_hole_card_pairs, int num_succs,
+		       const double *vals, double **succ_vals, bool nn_regrets, double floor,
+		       double ceiling);
+void UpdateHandRegrets(unsigned char *regrets, float *scale, int num_hole_card_pairs,
+		       int num_succs, const double *vals, double **succ_vals, unsigned int seed);
+void UpdateHandRegrets(unsigned short *regrets, float *scale, int num_hole_card_pairs,
+		       int num_succs, const double *vals, double **succ_vals, unsigned int seed);
+void Showdown(Node *node, const CanonicalCards *hands, double *opp_probs, double sum_opp_probs,
+	      double *total_card_probs, double *vals);
 std::shared_ptr<double []> Showdown(Node *node, const CanonicalCards *hands, double *opp_probs,
 				    double sum_opp_probs, double *total_card_probs);
+void Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
+	  double sum_opp_probs, double *total_card_probs, double *vals);
 std::shared_ptr<double []> Fold(Node *node, int p, const CanonicalCards *hands, double *opp_probs,
 				double sum_opp_probs, double *total_card_probs);
+void TerminalProbs(const CanonicalCards *hands, const double *opp_probs, double *fold_probs,
+		   double *showdown_probs);
+void FoldVals(Node *node, int p, int num_hole_card_pairs, const double *fold_probs,
+	      double *vals);
+void ShowdownVals(Node *node, int num_hole_card_pairs, const double *showdown_probs,
+		  double *vals);
 void CommonBetResponseCalcs(int st, const CanonicalCards *hands, double *opp_probs,
 			    double *sum_opp_probs, double *total_card_probs);
 template <typename T>
 void ProcessOppProbs(Node *node, const CanonicalCards *hands, int *street_buckets,
-		     double *opp_probs, std::shared_ptr<double []> *succ_opp_probs,
+		     double *opp_probs, double **succ_opp_probs,
 		     double *current_probs, int it, int soft_warmup, int hard_warmup,
 		     double sumprob_scaling, CFRStreetValues<T> *sumprobs);
 template <typename T1, typename T2>
 void ProcessOppProbs(Node *node, int lbd, const CanonicalCards *hands, bool bucketed,
 		     int *street_buckets, double *opp_probs,
-		     std::shared_ptr<double []> *succ_opp_probs,
+		     double **succ_opp_probs,
 		     const CFRStreetValues<T1> &cs_vals, int dsi, int it, int soft_warmup,
 		     int hard_warmup, double sumprob_scaling,
 		     CFRStreetValues<T2> *sumprobs);
@@ -1,22 +1,27 @@
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "betting_tree.h"
 #include "betting_trees.h"
+#include "block_codec.h"
 #include "board_tree.h"
 #include "buckets.h"
 #include "cfr_street_values.h"
 #include "cfr_value_type.h"
 #include "cfr_values.h"
 #include "game.h"
+#include "instrument.h"
 #include "io.h"
 #include "nonterminal_ids.h"
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 void CFRValues::Initialize(const bool *players, const bool *streets, int root_bd, int root_bd_st,
 			   const Buckets &buckets) {
@@ -50,6 +55,10 @@ void CFRValues::Initialize(const bool *players, const bool *streets, int root_bd
 
   street_values_.reset(new AbstractCFRStreetValues *[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) street_values_[st] = nullptr;
+
+  compressed_streets_.reset(new bool[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) compressed_streets_[st] = false;
+  num_codec_threads_ = 1;
 }
 
 CFRValues::CFRValues(const bool *players, const bool *streets, int root_bd, int root_bd_st,
@@ -137,6 +146,9 @@ CFRValues::CFRValues(const CFRValues &p0_values, const CFRValues &p1_values) {
       exit(-1);
     }
   }
+  compressed_streets_.reset(new bool[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) compressed_streets_[st] = false;
+  num_codec_threads_ = 1;
   // Don't need to fill out num_nonterminals_
 }
 
@@ -212,6 +224,18 @@ void CFRValues::AllocateAndClear(const BettingTree *betting_tree, CFRValueType v
   AllocateAndClear(betting_tree, value_types.get(), quantize, only_p);
 }
 
+void CFRValues::AllocateScales(int st) {
+  street_values_[st]->AllocateScales(num_holdings_[st] / Game::NumHoleCardPairs(st));
+}
+
+void CFRValues::SetCompressedStreets(const bool *compressed_streets, int num_threads) {
+  int max_street = Game::MaxStreet();
+  for (int st = 0; st <= max_street; ++st) {
+    compressed_streets_[st] = compressed_streets[st];
+  }
+  num_codec_threads_ = num_threads;
+}
+
 void CFRValues::CreateStreetValues(int st, CFRValueType value_type, bool quantize) {
   if (street_values_[st] == nullptr) {
     if (value_type == CFRValueType::CFR_CHAR) {
@@ -272,32 +296,35 @@ void CFRValues::Read(Node *node, Reader ***readers, void ***decompressors, int p
   }
 }
 
+// Compressed files have a "z" appended to the suffix (e.g., ".dz").
 Reader *CFRValues::InitializeReader(const char *dir, int p, int st, int it,
 				    const string &action_sequence, int root_bd_st, int root_bd,
-				    bool sumprobs, CFRValueType *value_type) {
+				    bool sumprobs, CFRValueType *value_type, bool *compressed) {
   char buf[500];
 
   int t;
-  for (t = 0; t < 4; ++t) {
+  for (t = 0; t < 8; ++t) {
     unsigned char suffix;
-    if (t == 0) {
+    *compressed = t >= 4;
+    if (t % 4 == 0) {
       suffix = 'd';
       *value_type = CFRValueType::CFR_DOUBLE;
-    } else if (t == 1) {
+    } else if (t % 4 == 1) {
       suffix = 'i';
       *value_type = CFRValueType::CFR_INT;
-    } else if (t == 2) {
+    } else if (t % 4 == 2) {
       suffix = 'c';
       *value_type = CFRValueType::CFR_CHAR;
-    } else if (t == 3) {
+    } else {
       suffix = 's';
       *value_type = CFRValueType::CFR_SHORT;
     }
-    sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c", dir, sumprobs ? "sumprobs" : "regrets",
-	    action_sequence.c_str(), root_bd_st, root_bd, st, it, p, suffix);
+    sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c%s", dir, sumprobs ? "sumprobs" : "regrets",
+	    action_sequence.c_str(), root_bd_st, root_bd, st, it, p, suffix,
+	    *compressed ? "z" : "");
     if (FileExists(buf)) break;
   }
-  if (t == 4) {
+  if (t == 8) {
     fprintf(stderr, "Couldn't find file\n");
     fprintf(stderr, "buf: %s\n", buf);
     exit(-1);
@@ -308,31 +335,44 @@ Reader *CFRValues::InitializeReader(const char *dir, int p, int st, int it,
 
 void CFRValues::Read(const char *dir, int it, const BettingTree *betting_tree,
 		     const string &action_sequence, int only_p, bool sumprobs, bool quantize) {
+  SCOPED_TIMER(kTimerCFRValuesRead, -1);
   int num_players = Game::NumPlayers();
   Reader ***readers = new Reader **[num_players];
-  void ***decompressors = nullptr;
+  void ***decompressors = new void **[num_players];
   int max_street = Game::MaxStreet();
 
   for (int p = 0; p < num_players; ++p) {
     if (only_p != -1 && p != only_p) {
       readers[p] = nullptr;
+      decompressors[p] = nullptr;
       continue;
     }
     if (! players_[p]) {
       readers[p] = nullptr;
+      decompressors[p] = nullptr;
       continue;
     }
     readers[p] = new Reader *[max_street + 1];
+    decompressors[p] = new void *[max_street + 1];
     for (int st = 0; st <= max_street; ++st) {
+      decompressors[p][st] = nullptr;
       if (! streets_[st]) {
 	readers[p][st] = nullptr;
 	continue;
       }
       CFRValueType value_type;
+      bool compressed;
       readers[p][st] = InitializeReader(dir, p, st, it, action_sequence, root_bd_st_, root_bd_,
-					sumprobs, &value_type);
+					sumprobs, &value_type, &compressed);
+      // The checksum is accumulated as we read rather than by rereading the file afterwards
+      readers[p][st]->EnableChecksum();
+      if (compressed) decompressors[p][st] = new BlockCodec(num_codec_threads_);
       if (street_values_[st] == nullptr) {
 	CreateStreetValues(st, value_type, quantize);
+	if (! sumprobs && (value_type == CFRValueType::CFR_CHAR ||
+			   value_type == CFRValueType::CFR_SHORT)) {
+	  AllocateScales(st);
+	}
       }
     }
   }
@@ -354,9 +394,12 @@ void CFRValues::Read(const char *dir, int it, const BettingTree *betting_tree,
 	fprintf(stderr, "File size: %lli\n", readers[p][st]->FileSize());
 	exit(-1);
       }
+      VerifyChecksumFile(readers[p][st]->Filename().c_str(), readers[p][st]->Checksum());
       delete readers[p][st];
+      delete (BlockCodec *)decompressors[p][st];
     }
     delete [] readers[p];
+    delete [] decompressors[p];
   }
   delete [] readers;
   delete [] decompressors;
@@ -368,33 +411,45 @@ void CFRValues::Read(const char *dir, int it, const BettingTree *betting_tree,
 void CFRValues::ReadAsymmetric(const char *dir, int it, const BettingTrees &betting_trees,
 			       const string &action_sequence, int only_p, bool sumprobs,
 			       bool quantize) {
+  SCOPED_TIMER(kTimerCFRValuesRead, -1);
   int num_players = Game::NumPlayers();
   Reader ***readers = new Reader **[num_players];
-  void ***decompressors = nullptr;
+  void ***decompressors = new void **[num_players];
   int max_street = Game::MaxStreet();
   char asym_dir[500];
 
   for (int p = 0; p < num_players; ++p) {
     if (only_p != -1 && p != only_p) {
       readers[p] = nullptr;
+      decompressors[p] = nullptr;
       continue;
     }
     if (! players_[p]) {
       readers[p] = nullptr;
+      decompressors[p] = nullptr;
       continue;
     }
     sprintf(asym_dir, "%s.p%i", dir, p);
     readers[p] = new Reader *[max_street + 1];
+    decompressors[p] = new void *[max_street + 1];
     for (int st = 0; st <= max_street; ++st) {
+      decompressors[p][st] = nullptr;
       if (! streets_[st]) {
 	readers[p][st] = nullptr;
 	continue;
       }
       CFRValueType value_type;
+      bool compressed;
       readers[p][st] = InitializeReader(asym_dir, p, st, it, action_sequence, root_bd_st_, root_bd_,
-					sumprobs, &value_type);
+					sumprobs, &value_type, &compressed);
+      readers[p][st]->EnableChecksum();
+      if (compressed) decompressors[p][st] = new BlockCodec(num_codec_threads_);
       if (street_values_[st] == nullptr) {
 	CreateStreetValues(st, value_type, quantize);
+	if (! sumprobs && (value_type == CFRValueType::CFR_CHAR ||
+			   value_type == CFRValueType::CFR_SHORT)) {
+	  AllocateScales(st);
+	}
       }
     }
   }
@@ -416,34 +471,247 @@ void CFRValues::ReadAsymmetric(const char *dir, int it, const BettingTrees &bett
 	fprintf(stderr, "File size: %lli\n", readers[p][st]->FileSize());
 	exit(-1);
       }
+      VerifyChecksumFile(readers[p][st]->Filename().c_str(), readers[p][st]->Checksum());
       delete readers[p][st];
+      delete (BlockCodec *)decompressors[p][st];
     }
     delete [] readers[p];
+    delete [] decompressors[p];
   }
   delete [] readers;
   delete [] decompressors;
 }
 
-// Prevent redundant writing with reentrant trees
-void CFRValues::Write(Node *node, Writer ***writers, void ***compressors, bool ***seen) const {
+// The index for a values file is a sidecar file (with an extra ".idx" suffix) holding the byte
+// offset of each node's values, indexed by nonterminal ID.  Nodes without values (e.g., those
+// with only one succ) have an offset of -1.  Within a node, values are laid out by holding, so
+// the offset of any one board (or range of boards) can be computed from the node offset.
+static void WriteIndexFile(const char *filename, const long long int *offsets, int num_nt) {
+  string idx_filename = string(filename) + ".idx";
+  Writer writer(idx_filename.c_str());
+  for (int nt = 0; nt < num_nt; ++nt) {
+    writer.WriteLong(offsets[nt]);
+  }
+}
+
+// Returns null if there is no index file
+static unique_ptr<long long int []> ReadIndexFile(const char *filename, int *num_nt) {
+  string idx_filename = string(filename) + ".idx";
+  if (! FileExists(idx_filename.c_str())) return nullptr;
+  Reader reader(idx_filename.c_str());
+  *num_nt = reader.FileSize() / sizeof(long long int);
+  unique_ptr<long long int []> offsets(new long long int[*num_nt]);
+  for (int nt = 0; nt < *num_nt; ++nt) {
+    offsets[nt] = reader.ReadLongOrDie();
+  }
+  return offsets;
+}
+
+// For uncompressed files written before we had index files.  Recomputes the node offsets by
+// walking the full tree in the same order as WriteFile().  Each node with values takes up
+// node_bytes_per_succ bytes per succ plus scale_bytes.  pos is the running byte offset.
+static void ComputeOffsets(Node *node, int p, int st, long long int node_bytes_per_succ,
+			   long long int scale_bytes, vector<bool> *seen, long long int *pos,
+			   vector<long long int> *offsets) {
   if (node->Terminal()) return;
+  int node_st = node->Street();
+  if (node_st > st) return;
+  if (node_st == st && node->PlayerActing() == p) {
+    int nt = node->NonterminalID();
+    if (nt >= (int)seen->size()) {
+      seen->resize(nt + 1, false);
+      offsets->resize(nt + 1, -1);
+    }
+    if ((*seen)[nt]) return;
+    (*seen)[nt] = true;
+    int num_succs = node->NumSuccs();
+    if (num_succs > 1) {
+      (*offsets)[nt] = *pos;
+      *pos += num_succs * node_bytes_per_succ + scale_bytes;
+    }
+  }
   int num_succs = node->NumSuccs();
-  int st = node->Street();
-  int pa = node->PlayerActing();
-  if (street_values_[st] && players_[pa] && writers[pa]) {
+  for (int s = 0; s < num_succs; ++s) {
+    ComputeOffsets(node->IthSucc(s), p, st, node_bytes_per_succ, scale_bytes, seen, pos,
+		   offsets);
+  }
+}
+
+void CFRValues::ReadSubtreeFromFull(Node *full_node, Node *subtree_node, int p, int st,
+				    Reader *reader, void *decompressor,
+				    const long long int *offsets, int num_nt,
+				    int full_num_holdings, int h_begin) {
+  if (full_node->Terminal()) return;
+  int node_st = full_node->Street();
+  if (node_st > st) return;
+  int num_succs = full_node->NumSuccs();
+  if (subtree_node->NumSuccs() != num_succs) {
+    fprintf(stderr, "CFRValues::ReadSubtreeFromFull(): mismatched subtree\n");
+    exit(-1);
+  }
+  if (node_st == st && full_node->PlayerActing() == p && num_succs > 1) {
+    int nt = full_node->NonterminalID();
+    if (nt >= num_nt || offsets[nt] < 0) {
+      fprintf(stderr, "CFRValues::ReadSubtreeFromFull(): no offset for p %i st %i nt %i\n", p,
+	      st, nt);
+      exit(-1);
+    }
+    street_values_[st]->ReadNodeFromFull(subtree_node, reader, decompressor, offsets[nt],
+					 full_num_holdings, h_begin);
+  }
+  for (int s = 0; s < num_succs; ++s) {
+    ReadSubtreeFromFull(full_node->IthSucc(s), subtree_node->IthSucc(s), p, st, reader,
+			decompressor, offsets, num_nt, full_num_holdings, h_begin);
+  }
+}
+
+// Reads the values for the subtree rooted at full_subtree_root (a node of the full betting tree on
+// street root_bd_st_) from the files written for the full tree, keeping only the boards under
+// root_bd_.  The values are stored under the nonterminal IDs of subtree_root, which must have
+// the same shape as full_subtree_root (and may be the same node).  num_full_holdings gives the
+// number of holdings on each street in the full files.  full_root is the root of the tree the
+// files were written for.
+//
+// We use the index written alongside each file to seek directly to each node and, within it, to
+// the range of boards we want (or, for compressed files, the blocks that hold them), so the cost
+// is proportional to the size of the subtree rather than the size of the full tree.  Uncompressed
+// files written before we had indexes are handled by recomputing the offsets from full_root.  We
+// don't verify checksums since that would require reading the whole file.
+void CFRValues::ReadSubtreeFromFull(const char *dir, int it, Node *full_root,
+				    Node *full_subtree_root, Node *subtree_root,
+				    const string &action_sequence, const int *num_full_holdings,
+				    int only_p, bool sumprobs) {
+  SCOPED_TIMER(kTimerCFRValuesRead, -1);
+  int num_players = Game::NumPlayers();
+  int max_street = Game::MaxStreet();
+  if (full_subtree_root->Street() != root_bd_st_) {
+    fprintf(stderr, "CFRValues::ReadSubtreeFromFull(): subtree root should be on street %i\n",
+	    root_bd_st_);
+    exit(-1);
+  }
+  for (int p = 0; p < num_players; ++p) {
+    if (only_p != -1 && p != only_p) continue;
+    if (! players_[p]) continue;
+    for (int st = root_bd_st_; st <= max_street; ++st) {
+      if (! streets_[st]) continue;
+      CFRValueType value_type;
+      bool compressed;
+      unique_ptr<Reader> reader(InitializeReader(dir, p, st, it, action_sequence, 0, 0, sumprobs,
+						 &value_type, &compressed));
+      unique_ptr<BlockCodec> decompressor;
+      if (compressed) decompressor.reset(new BlockCodec(num_codec_threads_));
+      if (street_values_[st] == nullptr) {
+	CreateStreetValues(st, value_type, false);
+	if (! sumprobs && (value_type == CFRValueType::CFR_CHAR ||
+			   value_type == CFRValueType::CFR_SHORT)) {
+	  AllocateScales(st);
+	}
+      }
+      int num_nt;
+      unique_ptr<long long int []> offsets = ReadIndexFile(reader->Filename().c_str(), &num_nt);
+      if (! offsets) {
+	if (compressed) {
+	  fprintf(stderr, "Missing index file for compressed %s\n", reader->Filename().c_str());
+	  exit(-1);
+	}
+	int value_size;
+	if (value_type == CFRValueType::CFR_CHAR)       value_size = sizeof(unsigned char);
+	else if (value_type == CFRValueType::CFR_SHORT) value_size = sizeof(unsigned short);
+	else if (value_type == CFRValueType::CFR_INT)   value_size = sizeof(int);
+	else                                            value_size = sizeof(double);
+	long long int scale_bytes = 0;
+	if (! sumprobs && (value_type == CFRValueType::CFR_CHAR ||
+			   value_type == CFRValueType::CFR_SHORT)) {
+	  scale_bytes = (num_full_holdings[st] / Game::NumHoleCardPairs(st)) * sizeof(float);
+	}
+	vector<bool> seen;
+	vector<long long int> v_offsets;
+	long long int pos = 0;
+	ComputeOffsets(full_root, p, st, (long long int)num_full_holdings[st] * value_size,
+		       scale_bytes, &seen, &pos, &v_offsets);
+	if (pos != reader->FileSize()) {
+	  fprintf(stderr, "No index file for %s and computed size %lli doesn't match file size "
+		  "%lli\n", reader->Filename().c_str(), pos, reader->FileSize());
+	  exit(-1);
+	}
+	num_nt = v_offsets.size();
+	offsets.reset(new long long int[num_nt]);
+	for (int nt = 0; nt < num_nt; ++nt) offsets[nt] = v_offsets[nt];
+      }
+      // With card abstraction (or a preflop root) we want all the holdings.  Otherwise our
+      // holdings are the contiguous range of boards that descend from root_bd_.
+      int h_begin = 0;
+      if (num_holdings_[st] != num_full_holdings[st]) {
+	h_begin = BoardTree::GlobalIndex(root_bd_st_, root_bd_, st, 0) *
+	  Game::NumHoleCardPairs(st);
+      }
+      ReadSubtreeFromFull(full_subtree_root, subtree_root, p, st, reader.get(),
+			  decompressor.get(), offsets.get(), num_nt, num_full_holdings[st],
+			  h_begin);
+    }
+  }
+}
+
+// Writes the values for player p and street st only.  The seen array (for that player and
+// street) prevents redundant writing with reentrant trees.  If offsets is not null, records the
+// byte offset in the file of each node's values, indexed by nonterminal ID.
+void CFRValues::WriteFile(Node *node, int p, int st, Writer *writer, void *compressor,
+			  bool *seen, long long int *offsets) const {
+  if (node->Terminal()) return;
+  int node_st = node->Street();
+  // Streets never decrease as we descend
+  if (node_st > st) return;
+  if (node_st == st && node->PlayerActing() == p) {
     int nt = node->NonterminalID();
     // If we have seen this node, we have also seen all the descendants of it,
     // so we can just return.
-    if (seen) {
-      if (seen[st][pa][nt]) return;
-      seen[st][pa][nt] = true;
-    }
-    street_values_[st]->WriteNode(node, writers[pa][st],
-				  compressors ? compressors[pa][st] : nullptr);
+    if (seen[nt]) return;
+    seen[nt] = true;
+    if (offsets && node->NumSuccs() > 1) offsets[nt] = writer->Pos();
+    street_values_[st]->WriteNode(node, writer, compressor);
   }
+  int num_succs = node->NumSuccs();
   for (int s = 0; s < num_succs; ++s) {
-    Write(node->IthSucc(s), writers, compressors, seen);
+    WriteFile(node->IthSucc(s), p, st, writer, compressor, seen, offsets);
+  }
+}
+
+// Writes one player/street file.  CFRValues::Write() runs one of these per file in parallel.
+class CFRValuesFileWriter {
+public:
+  CFRValuesFileWriter(const CFRValues &values, Node *root, int p, int st, Writer *writer,
+		      void *compressor, bool *seen, int num_nt) :
+    values_(values), root_(root), p_(p), st_(st), writer_(writer), compressor_(compressor),
+    seen_(seen), num_nt_(num_nt) {}
+  void Run(void) {
+    unique_ptr<long long int []> offsets(new long long int[num_nt_]);
+    for (int nt = 0; nt < num_nt_; ++nt) offsets[nt] = -1;
+    values_.WriteFile(root_, p_, st_, writer_, compressor_, seen_, offsets.get());
+    WriteChecksumFile(writer_->Filename().c_str(), writer_->Checksum());
+    WriteIndexFile(writer_->Filename().c_str(), offsets.get(), num_nt_);
   }
+  void RunThread(void);
+  void Join(void) {pthread_join(pthread_id_, NULL);}
+private:
+  const CFRValues &values_;
+  Node *root_;
+  int p_;
+  int st_;
+  Writer *writer_;
+  void *compressor_;
+  bool *seen_;
+  int num_nt_;
+  pthread_t pthread_id_;
+};
+
+static void *file_writer_thread_run(void *v_t) {
+  CFRValuesFileWriter *t = (CFRValuesFileWriter *)v_t;
+  t->Run();
+  return NULL;
+}
+
+void CFRValuesFileWriter::RunThread(void) {
+  pthread_create(&pthread_id_, NULL, file_writer_thread_run, this);
 }
 
 static void DeleteWriters(Writer ***writers, void ***compressors) {
@@ -452,10 +720,7 @@ static void DeleteWriters(Writer ***writers, void ***compressors) {
   for (int p = 0; p < num_players; ++p) {
     if (writers[p] == nullptr) continue;
     for (int st = 0; st <= max_street; ++st) {
-      if (compressors[p][st]) {
-	fprintf(stderr, "Didn't expect compressors\n");
-	exit(-1);
-      }
+      delete (BlockCodec *)compressors[p][st];
       delete writers[p][st];
     }
     delete [] writers[p];
@@ -473,6 +738,17 @@ Writer ***CFRValues::InitializeWriters(const char *dir, int it, const string &ac
   Writer ***writers = new Writer **[num_players];
   *compressors = new void **[num_players];
   int max_street = Game::MaxStreet();
+  // Write() runs one thread per file, so split the codec threads among the files rather than
+  // giving each file's compressor all of them.
+  int num_files = 0;
+  for (int p = 0; p < num_players; ++p) {
+    if ((only_p != -1 && p != only_p) || ! players_[p]) continue;
+    for (int st = 0; st <= max_street; ++st) {
+      if (street_values_[st] != nullptr) ++num_files;
+    }
+  }
+  int num_threads_per_file = num_files > 0 ? num_codec_threads_ / num_files : 1;
+  if (num_threads_per_file < 1) num_threads_per_file = 1;
   for (int p = 0; p < num_players; ++p) {
     if (only_p != -1 && p != only_p) {
       writers[p] = nullptr;
@@ -499,11 +775,14 @@ Writer ***CFRValues::InitializeWriters(const char *dir, int it, const string &ac
       else if (value_type == CFRValueType::CFR_SHORT)  suffix = 's';
       else if (value_type == CFRValueType::CFR_INT)    suffix = 'i';
       else if (value_type == CFRValueType::CFR_DOUBLE) suffix = 'd';
-      sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c", dir,
+      bool compressed = compressed_streets_[st];
+      sprintf(buf, "%s/%s.%s.%u.%u.%u.%u.p%u.%c%s", dir,
 	      sumprobs ? "sumprobs" : "regrets", action_sequence.c_str(),
-	      root_bd_st_, root_bd_, st, it, p, suffix);
-      writers[p][st] = new Writer(buf);
-      (*compressors)[p][st] = nullptr;
+	      root_bd_st_, root_bd_, st, it, p, suffix, compressed ? "z" : "");
+      writers[p][st] = new Writer(buf, kCheckpointBufSize);
+      writers[p][st]->EnableChecksum();
+      if (compressed) (*compressors)[p][st] = new BlockCodec(num_threads_per_file);
+      else            (*compressors)[p][st] = nullptr;
     }
   }
   return writers;
@@ -511,6 +790,7 @@ Writer ***CFRValues::InitializeWriters(const char *dir, int it, const string &ac
 
 void CFRValues::Write(const char *dir, int it, Node *root, const string &action_sequence,
 		      int only_p, bool sumprobs) const {
+  SCOPED_TIMER(kTimerCFRValuesWrite, -1);
   int max_street = Game::MaxStreet();
   int num_players = Game::NumPlayers();
   bool ***seen = new bool **[max_street + 1];
@@ -530,7 +810,21 @@ void CFRValues::Write(const char *dir, int it, Node *root, const string &action_
   }
   void ***compressors;
   Writer ***writers = InitializeWriters(dir, it, action_sequence, only_p, sumprobs, &compressors);
-  Write(root, writers, compressors, seen);
+  vector<unique_ptr<CFRValuesFileWriter>> file_writers;
+  for (int p = 0; p < num_players; ++p) {
+    if (writers[p] == nullptr) continue;
+    for (int st = root_st; st <= max_street; ++st) {
+      if (writers[p][st] == nullptr) continue;
+      int num_nt = num_nonterminals[p * (max_street + 1) + st];
+      file_writers.emplace_back(new CFRValuesFileWriter(*this, root, p, st, writers[p][st],
+							compressors[p][st], seen[st][p],
+							num_nt));
+    }
+  }
+  int num_file_writers = file_writers.size();
+  for (int i = 1; i < num_file_writers; ++i) file_writers[i]->RunThread();
+  if (num_file_writers > 0) file_writers[0]->Run();
+  for (int i = 1; i < num_file_writers; ++i) file_writers[i]->Join();
   DeleteWriters(writers, compressors);
   for (int st = root_st; st <= max_street; ++st) {
     for (int p = 0; p < num_players; ++p) {
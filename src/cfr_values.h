@@ -27,13 +27,26 @@ class CFRValues {
   void AllocateAndClear(const BettingTree *betting_tree, CFRValueType value_type, bool quantize,
 			int only_p);
   void CreateStreetValues(int st, CFRValueType value_type, bool quantize);
+  // Quantized (char or short) regrets carry a scale factor for each board at each node.  Only
+  // for unabstracted streets.
+  void AllocateScales(int st);
+  // Values on the given streets are written compressed (see BlockCodec) using num_threads
+  // threads per file.  Compressed files are recognized by their suffix when reading.
+  void SetCompressedStreets(const bool *compressed_streets, int num_threads);
   void Read(const char *dir, int it, const BettingTree *betting_tree,
 	    const std::string &action_sequence, int only_p, bool sumprobs, bool quantize);
   void ReadAsymmetric(const char *dir, int it, const BettingTrees &betting_trees,
 		      const std::string &action_sequence, int only_p, bool sumprobs,
 		      bool quantize);
+  void ReadSubtreeFromFull(const char *dir, int it, Node *full_root, Node *full_subtree_root,
+			   Node *subtree_root, const std::string &action_sequence,
+			   const int *num_full_holdings, int only_p, bool sumprobs);
+  // Writes each player/street file on its own thread, along with a checksum that Read()
+  // verifies and an index of node offsets that ReadSubtreeFromFull() uses.
   void Write(const char *dir, int it, Node *root, const std::string &action_sequence, int only_p,
 	     bool sumprobs) const;
+  void WriteFile(Node *node, int p, int st, Writer *writer, void *compressor, bool *seen,
+		 long long int *offsets) const;
   // Note: doesn't handle nodes with one succ
   void RMProbs(int st, int p, int nt, int offset, int num_succs, int dsi,
 	       double *probs) const {
@@ -64,11 +77,15 @@ class CFRValues {
   int RootSt(void) const {return root_bd_st_;}
   int RootBd(void) const {return root_bd_;}
  protected:
+  static const int kCheckpointBufSize = 4 << 20;
+
   void Read(Node *node, Reader ***readers, void ***decompressors, int p);
+  void ReadSubtreeFromFull(Node *full_node, Node *subtree_node, int p, int st, Reader *reader,
+			   void *decompressor, const long long int *offsets, int num_nt,
+			   int full_num_holdings, int h_begin);
   Reader *InitializeReader(const char *dir, int p, int st, int it,
 			   const std::string &action_sequence, int root_bd_st, int root_bd,
-			   bool sumprobs, CFRValueType *value_type);
-  void Write(Node *node, Writer ***writers, void ***compressors, bool ***seen) const;
+			   bool sumprobs, CFRValueType *value_type, bool *compressed);
   Writer ***InitializeWriters(const char *dir, int it, const std::string &action_sequence,
 			      int only_p, bool sumprobs, void ****compressors) const;
   void MergeInto(Node *full_node, Node *subgame_node, int root_bd_st, int root_bd,
@@ -83,6 +100,8 @@ class CFRValues {
   int root_bd_st_;
   std::unique_ptr<int []> num_holdings_;
   std::unique_ptr<int []> num_nonterminals_;
+  std::unique_ptr<bool []> compressed_streets_;
+  int num_codec_threads_;
 };
 
 #endif
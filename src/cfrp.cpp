@@ -18,6 +18,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "betting_abstraction.h"
 #include "betting_trees.h"
@@ -43,6 +44,7 @@
 using std::shared_ptr;
 using std::string;
 using std::unique_ptr;
+using std::vector;
 
 // Called from run_cfrp
 void CFRP::Initialize(const BettingAbstraction &ba, int target_p) {
@@ -83,12 +85,41 @@ void CFRP::Initialize(const BettingAbstraction &ba, int target_p) {
 				  betting_trees_->GetBettingTree()));
   }
 
+  compressed_streets_.reset(new bool[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) compressed_streets_[st] = false;
+  const vector<int> &csv = cfr_config_.CompressedStreets();
+  int num_csv = csv.size();
+  for (int i = 0; i < num_csv; ++i) {
+    int st = csv[i];
+    if (st < 0 || st > max_street) {
+      fprintf(stderr, "Bad compressed street %i\n", st);
+      exit(-1);
+    }
+    compressed_streets_[st] = true;
+  }
+  regrets_->SetCompressedStreets(compressed_streets_.get(), num_threads_);
+  sumprobs_->SetCompressedStreets(compressed_streets_.get(), num_threads_);
+
   unique_ptr<bool []> bucketed_streets(new bool[max_street + 1]);
   bucketed_ = false;
   for (int st = 0; st <= max_street; ++st) {
     bucketed_streets[st] = ! buckets_.None(st);
     if (bucketed_streets[st]) bucketed_ = true;
   }
+  // Quantized regrets are only supported for unabstracted streets under CFR+ (see
+  // UpdateHandRegrets()).
+  for (int st = 0; st <= max_street; ++st) {
+    if (cfr_config_.CharQuantizedStreet(st) || cfr_config_.ShortQuantizedStreet(st)) {
+      if (bucketed_streets[st]) {
+	fprintf(stderr, "Quantized regrets not supported on bucketed street %i\n", st);
+	exit(-1);
+      }
+      if (! nn_regrets_) {
+	fprintf(stderr, "Quantized regrets require nonnegative regrets\n");
+	exit(-1);
+      }
+    }
+  }
   if (bucketed_) {
     // Hmm, we only want to allocate this for the streets that need it
     current_strategy_.reset(new CFRValues(nullptr, bucketed_streets.get(), 0, 0, buckets_,
@@ -363,12 +394,25 @@ void CFRP::Run(int start_it, int end_it) {
   } else {
     bool double_regrets = cfr_config_.DoubleRegrets();
     bool double_sumprobs = cfr_config_.DoubleSumprobs();
-    if (double_regrets) {
-      regrets_->AllocateAndClear(betting_trees_->GetBettingTree(), CFRValueType::CFR_DOUBLE, false,
-				 -1);
-    } else {
-      regrets_->AllocateAndClear(betting_trees_->GetBettingTree(), CFRValueType::CFR_INT, false,
-				 -1);
+    int max_street = Game::MaxStreet();
+    unique_ptr<CFRValueType []> regret_types(new CFRValueType[max_street + 1]);
+    for (int st = 0; st <= max_street; ++st) {
+      if (cfr_config_.CharQuantizedStreet(st)) {
+	regret_types[st] = CFRValueType::CFR_CHAR;
+      } else if (cfr_config_.ShortQuantizedStreet(st)) {
+	regret_types[st] = CFRValueType::CFR_SHORT;
+      } else if (double_regrets) {
+	regret_types[st] = CFRValueType::CFR_DOUBLE;
+      } else {
+	regret_types[st] = CFRValueType::CFR_INT;
+      }
+    }
+    regrets_->AllocateAndClear(betting_trees_->GetBettingTree(), regret_types.get(), false, -1);
+    for (int st = 0; st <= max_street; ++st) {
+      if (regrets_->Street(st) && (regret_types[st] == CFRValueType::CFR_CHAR ||
+				   regret_types[st] == CFRValueType::CFR_SHORT)) {
+	regrets_->AllocateScales(st);
+      }
     }
     if (double_sumprobs) {
       sumprobs_->AllocateAndClear(betting_trees_->GetBettingTree(), CFRValueType::CFR_DOUBLE, false,
@@ -43,7 +43,7 @@ public:
   std::unique_ptr<BettingTrees> betting_trees_;
   std::unique_ptr<HandTree> hand_tree_;
   int target_p_;
-  bool *compressed_streets_;
+  std::unique_ptr<bool []> compressed_streets_;
   bool bucketed_;
   int last_checkpoint_it_;
   // std::shared_ptr<double []> ***final_vals_;
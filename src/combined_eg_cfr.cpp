@@ -10,6 +10,7 @@
 #include "combined_eg_cfr.h"
 #include "game.h"
 #include "hand_tree.h"
+#include "instrument.h"
 #include "reach_probs.h"
 #include "resolving_method.h"
 #include "vcfr_state.h"
@@ -197,6 +198,7 @@ void CombinedEGCFR::SolveSubgame(BettingTrees *subtrees, int solve_bd,
 				 const HandTree *hand_tree, double *opp_cvs, int target_p,
 				 bool both_players, int num_its) {
   int subtree_st = subtrees->Root()->Street();
+  SCOPED_TIMER(kTimerSolveSubgame, subtree_st);
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   
@@ -58,7 +58,10 @@ ECFRThread::ECFRThread(const CFRConfig &cfr_config, const Buckets &buckets, ECFR
   buckets_(buckets), root_(root), batch_size_(batch_size), board_table_(board_table),
   num_raw_boards_(num_raw_boards), total_its_(total_its), thread_index_(thread_index),
   num_threads_(num_threads) {
-  srand48_r(seed, &rand_buf_);
+  rng_.Seed(seed);
+  // Distinct, non-overlapping stream per thread
+  for (int t = 0; t < thread_index; ++t) rng_.Jump();
+  full_deck_ = FullDeck();
   int max_street = Game::MaxStreet();
   canon_bds_.reset(new int[max_street + 1]);
   canon_bds_[0] = 0;
@@ -89,9 +92,7 @@ static void RMProbs(double *regrets, double *probs, int num_succs) {
 }
 
 void ECFRThread::Deal(void) {
-  double r;
-  drand48_r(&rand_buf_, &r);
-  unsigned int msbd = board_table_[(int)(r * num_raw_boards_)];
+  unsigned int msbd = board_table_[rng_.RandBelow(num_raw_boards_)];
   int max_street = Game::MaxStreet();
   canon_bds_[max_street] = msbd;
   for (int st = 1; st < max_street; ++st) {
@@ -103,29 +104,13 @@ void ECFRThread::Deal(void) {
   for (unsigned int i = 0; i < num_ms_board_cards; ++i) {
     cards[i+2] = board[i];
   }
-  int end_cards = Game::MaxCard() + 1;
 
   int num_players = Game::NumPlayers();
+  unsigned long long int deck = RemoveCards(full_deck_, board, num_ms_board_cards);
+  DealHands(&rng_, num_players, 2, &deck, hole_cards_.get());
   for (int p = 0; p < num_players; ++p) {
-    int c1, c2;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c1 = end_cards * r;
-      if (InCards(c1, board, num_ms_board_cards)) continue;
-      if (InCards(c1, hole_cards_.get(), 2 * p)) continue;
-      break;
-    }
-    hole_cards_[2 * p] = c1;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c2 = end_cards * r;
-      if (InCards(c2, board, num_ms_board_cards)) continue;
-      if (InCards(c2, hole_cards_.get(), 2 * p + 1)) continue;
-      break;
-    }
-    hole_cards_[2 * p + 1] = c2;
-    if (c1 > c2) {hi_cards_[p] = c1; lo_cards_[p] = c2;}
-    else         {hi_cards_[p] = c2; lo_cards_[p] = c1;}
+    hi_cards_[p] = hole_cards_[2 * p];
+    lo_cards_[p] = hole_cards_[2 * p + 1];
   }
 
   for (int p = 0; p < num_players; ++p) hvs_[p] = 0;
@@ -261,8 +246,7 @@ double ECFRThread::Process(ECFRNode *node) {
 #else
     unique_ptr<double []> probs(new double[num_succs]);
     RMProbs(regrets, probs.get(), num_succs);
-    double r;
-    drand48_r(&rand_buf_, &r);
+    double r = rng_.RandZeroToOne();
     // fprintf(stderr, "st %i r %f (opp)\n", st, r);
     double cum = 0;
     int s;
@@ -343,7 +327,10 @@ void ECFR::Read(int batch_index) {
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   int num_readers = num_players * (max_street + 1);
-  
+  if (num_readers <= 0) {
+    fprintf(stderr, "ECFR::Read: bad num readers %i\n", num_readers);
+    exit(-1);
+  }
   unique_ptr< unique_ptr<Reader> []> regret_readers(new unique_ptr<Reader> [num_readers]);
   for (int p = 0; p < num_players; ++p) {
     for (int st = 0; st <= max_street; ++st) {
@@ -414,7 +401,10 @@ void ECFR::Write(int batch_index) {
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   int num_writers = num_players * (max_street + 1);
-  
+  if (num_writers <= 0) {
+    fprintf(stderr, "ECFR::Write: bad num writers %i\n", num_writers);
+    exit(-1);
+  }
   unique_ptr< unique_ptr<Writer> []> regret_writers(new unique_ptr<Writer> [num_writers]);
   for (int p = 0; p < num_players; ++p) {
     for (int st = 0; st <= max_street; ++st) {
@@ -450,16 +440,14 @@ void ECFR::Run(void) {
 }
 
 void ECFR::RunBatch(int batch_index, int batch_size) {
-  srand48_r(batch_index, &rand_buf_);
+  if (num_cfr_threads_ < 1) {
+    fprintf(stderr, "ECFR::RunBatch: bad num threads %i\n", num_cfr_threads_);
+    exit(-1);
+  }
   cfr_threads_.reset(new unique_ptr<ECFRThread> [num_cfr_threads_]);
   for (int t = 0; t < num_cfr_threads_; ++t) {
-    // Temporary
-#if 0
-    double r;
-    drand48_r(&rand_buf_, &r);
-    int seed = r * 100000.0;
-#endif
-    int seed = 0;
+    // Every thread gets the same seed; the threads jump to disjoint streams.
+    int seed = batch_index;
     cfr_threads_[t].reset(new ECFRThread(cfr_config_, buckets_, root_.get(), seed, batch_size,
 					  board_table_.get(), num_raw_boards_, &total_its_, t,
 					  num_cfr_threads_));
@@ -3,6 +3,8 @@
 
 #include <memory>
 
+#include "sampler.h"
+
 class ECFRNode;
 class ECFRThread;
 class BettingAbstraction;
@@ -66,7 +68,8 @@ private:
   std::unique_ptr<int []> lo_cards_;
   std::unique_ptr<int []> hvs_;
   std::unique_ptr<int []> hand_buckets_;
-  struct drand48_data rand_buf_;
+  RNG rng_;
+  unsigned long long int full_deck_;
   int it_;
   int p_;
   int p1_outcome_;
@@ -96,7 +99,6 @@ private:
   std::unique_ptr<ECFRNode> root_;
   std::unique_ptr<int []> board_table_;
   int num_raw_boards_;
-  struct drand48_data rand_buf_;
   int num_cfr_threads_;
   std::unique_ptr<std::unique_ptr<ECFRThread> []> cfr_threads_;
   unsigned long long int total_its_;
@@ -3,9 +3,14 @@
 // preflop.  For large games, you might create the HandTree for all hands
 // rooted at a particular flop board.
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #include <vector>
 
 #include "board_tree.h"
@@ -14,54 +19,175 @@
 #include "game.h"
 #include "hand_tree.h"
 #include "hand_value_tree.h"
+#include "river_hand_orders.h"
 
+using std::list;
+using std::shared_ptr;
+using std::unordered_map;
 using std::vector;
 
+// Process-wide LRU cache of the hands for each board.  Hands are built outside the lock so
+// that threads can build hands for different boards concurrently.  If two threads build the
+// hands for the same board at once, the first one inserted wins.
+class HandsCache {
+public:
+  HandsCache(void) : num_bytes_(0), budget_(1LL << 30) {
+    pthread_mutex_init(&mutex_, NULL);
+  }
+  ~HandsCache(void) {
+    pthread_mutex_destroy(&mutex_);
+  }
+  shared_ptr<const CanonicalCards> Get(int st, int gbd);
+  void SetBudget(long long int bytes);
+private:
+  struct Entry {
+    shared_ptr<const CanonicalCards> hands;
+    list<long long int>::iterator lru_it;
+  };
+
+  static shared_ptr<const CanonicalCards> Build(int st, int gbd);
+  void Evict(void);
+
+  pthread_mutex_t mutex_;
+  unordered_map<long long int, Entry> entries_;
+  // Most recently used at the front
+  list<long long int> lru_;
+  long long int num_bytes_;
+  long long int budget_;
+};
+
+static HandsCache g_hands_cache;
+// The river hand orders are mapped (if the file exists) when the first river hands are built
+static std::once_flag g_river_hand_orders_once;
+
+shared_ptr<const CanonicalCards> HandsCache::Build(int st, int gbd) {
+  int num_board_cards = Game::NumBoardCards(st);
+  const Card *board = BoardTree::Board(st, gbd);
+  int sg = BoardTree::SuitGroups(st, gbd);
+  CanonicalCards *hands = new CanonicalCards(2, board, num_board_cards, sg, false);
+  if (st == Game::MaxStreet()) {
+    std::call_once(g_river_hand_orders_once, RiverHandOrders::Create);
+    if (RiverHandOrders::Created()) {
+      if (hands->NumRaw() != RiverHandOrders::NumHands()) {
+	fprintf(stderr, "River hand orders have %i hands; expected %i\n",
+		RiverHandOrders::NumHands(), hands->NumRaw());
+	exit(-1);
+      }
+      hands->SetHandOrder(RiverHandOrders::Order(gbd), RiverHandOrders::Ranks(gbd));
+    } else {
+      hands->SortByHandStrength(board);
+    }
+  }
+  return shared_ptr<const CanonicalCards>(hands);
+}
+
+// Caller must hold the lock
+void HandsCache::Evict(void) {
+  while (num_bytes_ > budget_ && ! lru_.empty()) {
+    auto it = entries_.find(lru_.back());
+    num_bytes_ -= it->second.hands->Bytes();
+    entries_.erase(it);
+    lru_.pop_back();
+  }
+}
+
+shared_ptr<const CanonicalCards> HandsCache::Get(int st, int gbd) {
+  long long int key = (((long long int)st) << 32) | gbd;
+  pthread_mutex_lock(&mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    shared_ptr<const CanonicalCards> hands = it->second.hands;
+    pthread_mutex_unlock(&mutex_);
+    return hands;
+  }
+  pthread_mutex_unlock(&mutex_);
+
+  shared_ptr<const CanonicalCards> hands = Build(st, gbd);
+
+  pthread_mutex_lock(&mutex_);
+  it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    hands = it->second.hands;
+  } else {
+    lru_.push_front(key);
+    Entry &entry = entries_[key];
+    entry.hands = hands;
+    entry.lru_it = lru_.begin();
+    num_bytes_ += hands->Bytes();
+    Evict();
+  }
+  pthread_mutex_unlock(&mutex_);
+  return hands;
+}
+
+void HandsCache::SetBudget(long long int bytes) {
+  pthread_mutex_lock(&mutex_);
+  budget_ = bytes;
+  Evict();
+  pthread_mutex_unlock(&mutex_);
+}
+
+void HandTree::SetCacheBudget(long long int bytes) {
+  g_hands_cache.SetBudget(bytes);
+}
+
 HandTree::HandTree(int root_st, int root_bd, int final_st) {
   root_st_ = root_st;
   root_bd_ = root_bd;
   final_st_ = final_st;
-  hands_ = new CanonicalCards **[final_st_ + 1];
+  hands_ = new std::atomic<const CanonicalCards *> *[final_st_ + 1];
+  owned_hands_ = new shared_ptr<const CanonicalCards> *[final_st_ + 1];
   for (int st = 0; st < root_st_; ++st) {
-    hands_[st] = NULL;
+    hands_[st] = nullptr;
+    owned_hands_[st] = nullptr;
   }
   BoardTree::Create();
   int max_street = Game::MaxStreet();
-  // if (final_st == max_street) HandValueTree::Create();
-  // Used to lazily instantiate, but that doesn't currently work in
-  // multi-threaded environment because HandValueTree::Create() is not
-  // threadsafe.  Fix that?  May not be trivial.
+  // HandValueTree::Create() is not threadsafe, so the hand value tree must exist before we
+  // lazily create any river hands.
   if (final_st >= max_street && ! HandValueTree::Created()) {
     fprintf(stderr, "Hand value tree has not been created\n");
     exit(-1);
   }
   for (int st = root_st_; st <= final_st_; ++st) {
-    int num_local_boards =
-      BoardTree::NumLocalBoards(root_st_, root_bd_, st);
-    int num_board_cards = Game::NumBoardCards(st);
-    hands_[st] = new CanonicalCards *[num_local_boards];
+    int num_local_boards = BoardTree::NumLocalBoards(root_st_, root_bd_, st);
+    hands_[st] = new std::atomic<const CanonicalCards *>[num_local_boards];
     for (int lbd = 0; lbd < num_local_boards; ++lbd) {
-      int gbd = BoardTree::GlobalIndex(root_st_, root_bd_, st, lbd);
-      const Card *board = BoardTree::Board(st, gbd);
-      int sg = BoardTree::SuitGroups(st, gbd);
-      hands_[st][lbd] = new CanonicalCards(2, board, num_board_cards, sg, false);
-      if (st == max_street) {
-	hands_[st][lbd]->SortByHandStrength(board);
-      }
+      hands_[st][lbd].store(nullptr, std::memory_order_relaxed);
     }
+    owned_hands_[st] = new shared_ptr<const CanonicalCards>[num_local_boards];
   }
+  pthread_mutex_init(&mutex_, NULL);
 }
 
 HandTree::~HandTree(void) {
   for (int st = root_st_; st <= final_st_; ++st) {
-    int num_local_boards =
-      BoardTree::NumLocalBoards(root_st_, root_bd_, st);
-    for (int lbd = 0; lbd < num_local_boards; ++lbd) {
-      delete hands_[st][lbd];
-    }
     delete [] hands_[st];
+    delete [] owned_hands_[st];
   }
   delete [] hands_;
+  delete [] owned_hands_;
+  pthread_mutex_destroy(&mutex_);
+}
+
+// Slow path of Hands().  The cache is consulted (and the hands possibly built) without holding
+// our lock so that threads can create the hands for different boards concurrently.  We only lock
+// to store the result.  If another thread got there first we use its hands.  The shared pointer
+// is stored before the raw pointer is published so a reader that sees the raw pointer can rely on
+// it staying valid.
+const CanonicalCards *HandTree::CreateHands(int st, int lbd, int gbd) const {
+  shared_ptr<const CanonicalCards> cached = g_hands_cache.Get(st, gbd);
+  pthread_mutex_lock(&mutex_);
+  const CanonicalCards *hands = hands_[st][lbd].load(std::memory_order_relaxed);
+  if (hands == nullptr) {
+    owned_hands_[st][lbd] = cached;
+    hands = cached.get();
+    hands_[st][lbd].store(hands, std::memory_order_release);
+  }
+  pthread_mutex_unlock(&mutex_);
+  return hands;
 }
 
 // Assumes hole cards are ordered
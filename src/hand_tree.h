@@ -1,18 +1,31 @@
 #ifndef _HAND_TREE_H_
 #define _HAND_TREE_H_
 
+#include <pthread.h>
+
+#include <atomic>
+#include <memory>
+
 #include "board_tree.h"
 #include "cards.h"
 
 class CanonicalCards;
 
+// The hands for each board are created lazily on first use.  They come from a process-wide
+// cache keyed by street and global board index, so hand trees rooted at different boards (e.g.,
+// one per subgame) share the hands for the boards they have in common, and hands are not
+// rebuilt when a subgame is revisited.  A hand tree keeps the hands it has used alive for its
+// lifetime; the cache evicts least recently used hands once the hands it retains exceed its
+// budget.  Hands() can be called from multiple threads.
 class HandTree {
 public:
   HandTree(int root_st, int root_bd, int final_st);
   ~HandTree(void);
   const CanonicalCards *Hands(int st, int gbd) const {
     int lbd = LocalBoardIndex(st, gbd);
-    return hands_[st][lbd];
+    const CanonicalCards *hands = hands_[st][lbd].load(std::memory_order_acquire);
+    if (hands) return hands;
+    return CreateHands(st, lbd, gbd);
   }
   int FinalSt(void) const {return final_st_;}
   int RootSt(void) const {return root_st_;}
@@ -20,11 +33,18 @@ public:
   int LocalBoardIndex(int st, int gbd) const {
     return BoardTree::LocalIndex(root_st_, root_bd_, st, gbd);
   }
+  // Approximate bytes of hands the cache may retain (default 1 GB).  Evicted hands live on
+  // while a hand tree is using them.
+  static void SetCacheBudget(long long int bytes);
 private:
+  const CanonicalCards *CreateHands(int st, int lbd, int gbd) const;
+
   int root_st_;
   int root_bd_;
   int final_st_;
-  CanonicalCards ***hands_;
+  std::atomic<const CanonicalCards *> **hands_;
+  std::shared_ptr<const CanonicalCards> **owned_hands_;
+  mutable pthread_mutex_t mutex_;
 };
 
 int HCPIndex(int st, const Card *cards);
@@ -1,6 +1,8 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "cards.h"
@@ -9,571 +11,128 @@
 #include "hand_value_tree.h"
 #include "io.h"
 
+using std::unique_ptr;
 using std::vector;
 
 int HandValueTree::num_board_cards_ = 0;
+int HandValueTree::num_hole_cards_ = 0;
 int HandValueTree::num_cards_ = 0;
-int *HandValueTree::tree1_ = NULL;
-int **HandValueTree::tree2_ = NULL;
-int ***HandValueTree::tree3_ = NULL;
-int ****HandValueTree::tree4_ = NULL;
-int *****HandValueTree::tree5_ = NULL;
-int ******HandValueTree::tree6_ = NULL;
-int *******HandValueTree::tree7_ = NULL;
+unique_ptr<MappedFile> HandValueTree::file_;
+const int *HandValueTree::vals_ = nullptr;
+int HandValueTree::choose_[kMaxCards][kMaxNumCards + 1];
 
 // Note: currently you need to make sure that this is called from only one thread.
 void HandValueTree::Create(void) {
   // Check if already created
   if (num_cards_ != 0) return;
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree3_ = NULL;
-  tree4_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
   int max_street = Game::MaxStreet();
   num_board_cards_ = Game::NumBoardCards(max_street);
-  num_cards_ = num_board_cards_ + Game::NumCardsForStreet(0);
-  if (num_cards_ == 1)      ReadOne();
-  else if (num_cards_ == 2) ReadTwo();
-  else if (num_cards_ == 3) ReadThree();
-  else if (num_cards_ == 4) ReadFour();
-  else if (num_cards_ == 5) ReadFive();
-  else if (num_cards_ == 6) ReadSix();
-  else if (num_cards_ == 7) ReadSeven();
-}
-
-bool HandValueTree::Created(void) {
-  return num_cards_ != 0;
-}
-
-#if 0
-HandValueTree::HandValueTree(int st) {
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
-  num_board_cards_ = Game::NumBoardCards(st);
-  num_cards_ = num_board_cards_ + Game::NumCardsForStreet(0);
-  if (num_cards_ == 1)      ReadOne();
-  else if (num_cards_ == 2) ReadTwo();
-  else if (num_cards_ == 3) ReadThree();
-  else if (num_cards_ == 5) ReadFive();
-  else if (num_cards_ == 6) ReadSix();
-  else if (num_cards_ == 7) ReadSeven();
-}
-#endif
-
-void HandValueTree::ReadOne(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  num_cards_);
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree1_ = new int[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree1_[i] = 0;
-  for (int i1 = 0; i1 < num_cards; ++i1) {
-    tree1_[i1] = reader.ReadIntOrDie();
-  }
-}
-
-void HandValueTree::ReadTwo(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(),
-	  num_cards_);
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree2_ = new int *[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree2_[i] = NULL;
-  for (int i1 = 1; i1 < num_cards; ++i1) {
-    int *tree1 = new int[i1];
-    tree2_[i1] = tree1;
-    for (int i2 = 0; i2 < i1; ++i2) {
-      tree1[i2] = reader.ReadIntOrDie();
-    }
-  }
-}
-
-void HandValueTree::ReadThree(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.3", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree3_ = new int **[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree3_[i] = NULL;
-  for (int i1 = 2; i1 < num_cards; ++i1) {
-    int **tree1 = new int *[i1];
-    tree3_[i1] = tree1;
-    for (int i2 = 1; i2 < i1; ++i2) {
-      int *tree2 = new int[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 0; i3 < i2; ++i3) {
-	tree2[i3] = reader.ReadIntOrDie();
-      }
-    }
-  }
-}
-
-void HandValueTree::ReadFour(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.4", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree4_ = new int ***[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree4_[i] = NULL;
-  for (int i1 = 3; i1 < num_cards; ++i1) {
-    int ***tree1 = new int **[i1];
-    tree4_[i1] = tree1;
-    for (int i2 = 2; i2 < i1; ++i2) {
-      int **tree2 = new int *[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 1; i3 < i2; ++i3) {
-	int *tree3 = new int[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 0; i4 < i3; ++i4) {
-	  tree3[i4] = reader.ReadIntOrDie();
-	}
-      }
-    }
+  num_hole_cards_ = Game::NumCardsForStreet(0);
+  int num_cards = num_board_cards_ + num_hole_cards_;
+  int num_deck_cards = Game::MaxCard() + 1;
+  if (num_cards < 1 || num_cards > kMaxNumCards || num_deck_cards > kMaxCards) {
+    fprintf(stderr, "HandValueTree::Create: unexpected number of cards: %i\n", num_cards);
+    exit(-1);
   }
-}
-
-void HandValueTree::ReadFive(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.5", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree5_ = new int ****[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree5_[i] = NULL;
-  for (int i1 = 4; i1 < num_cards; ++i1) {
-    int ****tree1 = new int ***[i1];
-    tree5_[i1] = tree1;
-    for (int i2 = 3; i2 < i1; ++i2) {
-      int ***tree2 = new int **[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 2; i3 < i2; ++i3) {
-	int **tree3 = new int *[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 1; i4 < i3; ++i4) {
-	  int *tree4 = new int[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 0; i5 < i4; ++i5) {
-	    tree4[i5] = reader.ReadIntOrDie();
-	  }
-	}
-      }
+  for (int c = 0; c < num_deck_cards; ++c) {
+    choose_[c][0] = 1;
+    for (int k = 1; k <= num_cards; ++k) {
+      choose_[c][k] = c == 0 ? 0 : choose_[c - 1][k - 1] + choose_[c - 1][k];
     }
   }
-}
-
-void HandValueTree::ReadSix(void) {
-  int max_card = Game::MaxCard();
   char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.6", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree6_ = new int *****[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree6_[i] = NULL;
-  for (int i1 = 5; i1 < num_cards; ++i1) {
-    int *****tree1 = new int ****[i1];
-    tree6_[i1] = tree1;
-    for (int i2 = 4; i2 < i1; ++i2) {
-      int ****tree2 = new int ***[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 3; i3 < i2; ++i3) {
-	int ***tree3 = new int **[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 2; i4 < i3; ++i4) {
-	  int **tree4 = new int *[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 1; i5 < i4; ++i5) {
-	    int *tree5 = new int[i5];
-	    tree4[i5] = tree5;
-	    for (int i6 = 0; i6 < i5; ++i6) {
-	      tree5[i6] = reader.ReadIntOrDie();
-	    }
-	  }
-	}
-      }
-    }
+  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.%i", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(), num_cards);
+  file_.reset(new MappedFile(buf, false, false));
+  // Number of sets of num_cards cards out of the deck
+  long long int num_sets = (long long int)choose_[num_deck_cards - 1][num_cards] +
+    choose_[num_deck_cards - 1][num_cards - 1];
+  if (file_->Size() != num_sets * (long long int)sizeof(int)) {
+    fprintf(stderr, "HandValueTree::Create: unexpected size %lli of %s; expected %lli\n",
+	    file_->Size(), buf, num_sets * (long long int)sizeof(int));
+    exit(-1);
   }
+  vals_ = (const int *)file_->Data();
+  num_cards_ = num_cards;
 }
 
-void HandValueTree::ReadSeven(void) {
-  int max_card = Game::MaxCard();
-  char buf[500];
-  sprintf(buf, "%s/hand_value_tree.%s.%i.%i.7", Files::StaticBase(),
-	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits());
-  Reader reader(buf);
-  int num_cards = max_card + 1;
-  tree7_ = new int ******[num_cards];
-  for (int i = 0; i < num_cards; ++i) tree7_[i] = NULL;
-  for (int i1 = 6; i1 < num_cards; ++i1) {
-    int ******tree1 = new int *****[i1];
-    tree7_[i1] = tree1;
-    for (int i2 = 5; i2 < i1; ++i2) {
-      int *****tree2 = new int ****[i2];
-      tree1[i2] = tree2;
-      for (int i3 = 4; i3 < i2; ++i3) {
-	int ****tree3 = new int ***[i3];
-	tree2[i3] = tree3;
-	for (int i4 = 3; i4 < i3; ++i4) {
-	  int ***tree4 = new int **[i4];
-	  tree3[i4] = tree4;
-	  for (int i5 = 2; i5 < i4; ++i5) {
-	    int **tree5 = new int *[i5];
-	    tree4[i5] = tree5;
-	    for (int i6 = 1; i6 < i5; ++i6) {
-	      int *tree6 = new int[i6];
-	      tree5[i6] = tree6;
-	      for (int i7 = 0; i7 < i6; ++i7) {
-		tree6[i7] = reader.ReadIntOrDie();
-	      }
-	    }
-	  }
-	}
-      }
-    }
-  }
+bool HandValueTree::Created(void) {
+  return num_cards_ != 0;
 }
 
 void HandValueTree::Delete(void) {
-  int max_card = Game::MaxCard();
-  if (num_cards_ == 1) {
-    delete [] tree1_;
-  } else if (num_cards_ == 2) {
-    for (int i1 = 1; i1 <= max_card; ++i1) {
-      delete [] tree2_[i1];
-    }
-    delete [] tree2_;
-  } else if (num_cards_ == 3) {
-    for (int i1 = 2; i1 <= max_card; ++i1) {
-      int **tree1 = tree3_[i1];
-      for (int i2 = 1; i2 < i1; ++i2) {
-	delete [] tree1[i2];
-      }
-      delete [] tree1;
-    }
-    delete [] tree3_;
-  } else if (num_cards_ == 4) {
-    for (int i1 = 3; i1 <= max_card; ++i1) {
-      int ***tree1 = tree4_[i1];
-      for (int i2 = 2; i2 < i1; ++i2) {
-	int **tree2 = tree1[i2];
-	for (int i3 = 1; i3 < i2; ++i3) {
-	  delete [] tree2[i3];
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 5) {
-    for (int i1 = 4; i1 <= max_card; ++i1) {
-      int ****tree1 = tree5_[i1];
-      for (int i2 = 3; i2 < i1; ++i2) {
-	int ***tree2 = tree1[i2];
-	for (int i3 = 2; i3 < i2; ++i3) {
-	  int **tree3 = tree2[i3];
-	  for (int i4 = 1; i4 < i3; ++i4) {
-	    delete [] tree3[i4];
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 6) {
-    for (int i1 = 5; i1 <= max_card; ++i1) {
-      int *****tree1 = tree6_[i1];
-      for (int i2 = 4; i2 < i1; ++i2) {
-	int ****tree2 = tree1[i2];
-	for (int i3 = 3; i3 < i2; ++i3) {
-	  int ***tree3 = tree2[i3];
-	  for (int i4 = 2; i4 < i3; ++i4) {
-	    int **tree4 = tree3[i4];
-	    for (int i5 = 1; i5 < i4; ++i5) {
-	      delete [] tree4[i5];
-	    }
-	    delete [] tree4;
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree5_;
-  } else if (num_cards_ == 7) {
-    for (int i1 = 6; i1 <= max_card; ++i1) {
-      int ******tree1 = tree7_[i1];
-      for (int i2 = 5; i2 < i1; ++i2) {
-	int *****tree2 = tree1[i2];
-	for (int i3 = 4; i3 < i2; ++i3) {
-	  int ****tree3 = tree2[i3];
-	  for (int i4 = 3; i4 < i3; ++i4) {
-	    int ***tree4 = tree3[i4];
-	    for (int i5 = 2; i5 < i4; ++i5) {
-	      int **tree5 = tree4[i5];
-	      for (int i6 = 1; i6 < i5; ++i6) {
-		delete [] tree5[i6];
-	      }
-	      delete [] tree5;
-	    }
-	    delete [] tree4;
-	  }
-	  delete [] tree3;
-	}
-	delete [] tree2;
-      }
-      delete [] tree1;
-    }
-    delete [] tree7_;
-  }
-  tree1_ = NULL;
-  tree2_ = NULL;
-  tree3_ = NULL;
-  tree4_ = NULL;
-  tree5_ = NULL;
-  tree6_ = NULL;
-  tree7_ = NULL;
   // So HandValueTree::Create() will do something on next call
   num_cards_ = 0;
+  vals_ = nullptr;
+  file_.reset(nullptr);
 }
 
-#if 0
-// Just do a selection sort.  We assume num is small.
-static void SortCards(Card *cards, int num) {
-  if (num == 1) return;
-  for (int i = 0; i < num - 1; ++i) {
-    Card maxc = cards[i];
-    int maxi = i;
-    for (int j = i + 1; j < num; ++j) {
-      Card c = cards[j];
-      if (c > maxc) {
-	maxc = c;
-	maxi = j;
-      }
-    }
-    if (i != maxi) {
-      cards[maxi] = cards[i];
-      cards[i] = maxc;
-    }
-  }
-}
-#endif
-
 int HandValueTree::Val(const Card *cards) {
-  if (num_cards_ == 1) {
-    return tree1_[(int)cards[0]];
-  } else if (num_cards_ == 2) {
-    vector<int> v(2);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    std::sort(v.begin(), v.end());
-    return tree2_[v[1]][v[0]];
-  } else if (num_cards_ == 3) {
-    vector<int> v(3);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    std::sort(v.begin(), v.end());
-    return tree3_[v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 4) {
-    vector<int> v(4);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    std::sort(v.begin(), v.end());
-    return tree4_[v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 5) {
-    vector<int> v(5);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    std::sort(v.begin(), v.end());
-    return tree5_[v[4]][v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 6) {
-    vector<int> v(6);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    v[5] = cards[5];
-    std::sort(v.begin(), v.end());
-    return tree6_[v[5]][v[4]][v[3]][v[2]][v[1]][v[0]];
-  } else if (num_cards_ == 7) {
-    vector<int> v(7);
-    v[0] = cards[0];
-    v[1] = cards[1];
-    v[2] = cards[2];
-    v[3] = cards[3];
-    v[4] = cards[4];
-    v[5] = cards[5];
-    v[6] = cards[6];
-    std::sort(v.begin(), v.end());
-    return tree7_[v[6]][v[5]][v[4]][v[3]][v[2]][v[1]][v[0]];
-#if 0
-    Card s[7];
-    s[0] = cards[0];
-    s[1] = cards[1];
-    s[2] = cards[2];
-    s[3] = cards[3];
-    s[4] = cards[4];
-    s[5] = cards[5];
-    s[6] = cards[6];
-    SortCards(s, 7);
-    return tree7_[s[0]][s[1]][s[2]][s[3]][s[4]][s[5]][s[6]];
-#endif
-  } else {
-    fprintf(stderr, "HandValueTree::Val: unexpected number of cards: %u\n",
-	    num_cards_);
-    exit(-1);
+  // Insertion sort from high to low; there are at most seven cards.
+  Card sorted[kMaxNumCards];
+  for (int i = 0; i < num_cards_; ++i) {
+    Card c = cards[i];
+    int j = i;
+    while (j > 0 && sorted[j - 1] < c) {
+      sorted[j] = sorted[j - 1];
+      --j;
+    }
+    sorted[j] = c;
   }
+  int index = 0;
+  for (int i = 0; i < num_cards_; ++i) index += choose_[sorted[i]][num_cards_ - i];
+  return vals_[index];
 }
 
 // board and hole_cards should be sorted from high to low.
 int HandValueTree::Val(const int *board, const int *hole_cards) {
-  if (num_cards_ == 1) {
-    return tree1_[hole_cards[0]];
-  } else if (num_cards_ == 2 && num_board_cards_ == 1) {
-    int b = board[0];
-    int h = hole_cards[0];
-    if (b < h) {
-      return tree2_[h][b];
+  // Some callers pass unsorted hole cards when there is no board
+  if (num_board_cards_ == 0) return Val(hole_cards);
+  // Merge the two sorted lists, accumulating the index as we go.
+  int i = 0, j = 0, index = 0;
+  for (int k = 0; k < num_cards_; ++k) {
+    int c;
+    if (j == num_hole_cards_ || (i < num_board_cards_ && board[i] > hole_cards[j])) {
+      c = board[i++];
     } else {
-      return tree2_[b][h];
-    }
-  } else if (num_cards_ == 2 && num_board_cards_ == 0) {
-    int h0 = hole_cards[0];
-    int h1 = hole_cards[1];
-    if (h0 < h1) {
-      return tree2_[h1][h0];
-    } else {
-      return tree2_[h0][h1];
-    }
-  } else if (num_cards_ == 3) {
-    int a[3];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 1 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
+      c = hole_cards[j++];
     }
-    return tree3_[a[0]][a[1]][a[2]];
-  } else if (num_cards_ == 4) {
-    int a[4];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 2 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 2) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
-    }
-    return tree4_[a[0]][a[1]][a[2]][a[3]];
-  } else if (num_cards_ == 5) {
-    int a[5];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 3 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 3) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
-    }
-    return tree5_[a[0]][a[1]][a[2]][a[3]][a[4]];
-  } else if (num_cards_ == 6) {
-    int a[6];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 4 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 4) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
-    }
-    return tree6_[a[0]][a[1]][a[2]][a[3]][a[4]][a[5]];
-  } else if (num_cards_ == 7) {
-    int a[7];
-    int i = 0, j = 0, k = 0;
-    int b = board[i];
-    int h = hole_cards[j];
-    while (i < 5 || j < 2) {
-      if (b > h) {
-	a[k++] = b;
-	++i;
-	if (i < 5) b = board[i];
-	else       b = -1;
-      } else {
-	a[k++] = h;
-	++j;
-	if (j < 2) h = hole_cards[j];
-	else       h = -1;
-      }
+    index += choose_[c][num_cards_ - k];
+  }
+  return vals_[index];
+}
+
+// A card's position in the merged list is its position among its own cards plus the number of
+// cards from the other list that are higher.  For the board cards, only that second count varies
+// from hand to hand, so we tabulate the index contribution of each board card for each possible
+// count; for a hole card, the count of higher board cards depends only on the card.
+void HandValueTree::Vals(const Card *board, const Card *hole_cards, int num_hands, int *vals) {
+  int num_deck_cards = Game::MaxCard() + 1;
+  int board_contribs[kMaxNumCards][kMaxNumCards];
+  for (int i = 0; i < num_board_cards_; ++i) {
+    for (int g = 0; g <= num_hole_cards_; ++g) {
+      board_contribs[i][g] = choose_[board[i]][num_cards_ - (i + g)];
     }
-#if 0
-    printf("    %u %u %u %u %u %u %u\n", a[0], a[1], a[2], a[3], a[4], a[5],
-	   a[6]);
-    fflush(stdout);
-#endif
-    return tree7_[a[0]][a[1]][a[2]][a[3]][a[4]][a[5]][a[6]];
-  } else {
-    fprintf(stderr, "HandValueTree::Val: unexpected number of cards: %u\n",
-	    num_cards_);
-    exit(-1);
+  }
+  int num_higher_board[kMaxCards];
+  for (int c = 0; c < num_deck_cards; ++c) {
+    int n = 0;
+    for (int i = 0; i < num_board_cards_; ++i) n += board[i] > c;
+    num_higher_board[c] = n;
+  }
+  for (int h = 0; h < num_hands; ++h) {
+    const Card *hole = hole_cards + h * num_hole_cards_;
+    int index = 0;
+    for (int j = 0; j < num_hole_cards_; ++j) {
+      Card c = hole[j];
+      index += choose_[c][num_cards_ - (j + num_higher_board[c])];
+    }
+    for (int i = 0; i < num_board_cards_; ++i) {
+      int g = 0;
+      for (int j = 0; j < num_hole_cards_; ++j) g += hole[j] > board[i];
+      index += board_contribs[i][g];
+    }
+    vals[h] = vals_[index];
   }
 }
 
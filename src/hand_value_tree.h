@@ -1,8 +1,17 @@
 #ifndef _HAND_VALUE_TREE_H_
 #define _HAND_VALUE_TREE_H_
 
+#include <memory>
+
 #include "cards.h"
 
+class MappedFile;
+
+// The hand value "tree" is a flat table of the value of every set of N cards (N = hole cards plus
+// board cards at the final street), written by build_hand_value_tree.  Sets are in colex order:
+// the value of cards c1 > c2 > ... > cN is at index C(c1, N) + C(c2, N-1) + ... + C(cN, 1).  The
+// table is memory mapped, so all processes on a machine share one copy, and Val() is a single
+// lookup.
 class HandValueTree {
 public:
   // Note: currently you need to make sure that this is called from only one thread.
@@ -13,27 +22,23 @@ public:
   static int Val(const Card *cards);
   // board and hole_cards should be sorted from high to low.
   static int Val(const int *board, const int *hole_cards);
+  // Values of num_hands hands on one board.  board and each hand's hole cards (consecutive in
+  // hole_cards) should be sorted from high to low.
+  static void Vals(const Card *board, const Card *hole_cards, int num_hands, int *vals);
   static int DiskRead(Card *cards);
 private:
   HandValueTree(void) {}
 
-  static void ReadOne(void);
-  static void ReadTwo(void);
-  static void ReadThree(void);
-  static void ReadFour(void);
-  static void ReadFive(void);
-  static void ReadSix(void);
-  static void ReadSeven(void);
+  static const int kMaxNumCards = 7;
+  static const int kMaxCards = 52;
 
   static int num_board_cards_;
+  static int num_hole_cards_;
   static int num_cards_;
-  static int *tree1_;
-  static int **tree2_;
-  static int ***tree3_;
-  static int ****tree4_;
-  static int *****tree5_;
-  static int ******tree6_;
-  static int *******tree7_;
+  static std::unique_ptr<MappedFile> file_;
+  static const int *vals_;
+  // choose_[c][k] is C(c, k)
+  static int choose_[kMaxCards][kMaxNumCards + 1];
 };
 
 #endif
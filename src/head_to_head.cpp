@@ -20,9 +20,13 @@
 //
 // Leaking CanonicalCards objects?
 //
-// If we do turn resolving and sample all river boards then we get lots of redundant turn
-// resolving.  For each river board we resolve every turn subtree - even though lots of river
-// boards correspond to the same turn board.
+// Max street boards are evaluated in parallel by PlayerThreads.  Each thread takes units of
+// consecutive boards; the outcome for each board is recorded separately and the outcomes are
+// summed in board order at the end, so the result does not depend on the number of threads.
+//
+// If we do turn resolving then many river boards correspond to the same turn board.  All the
+// river boards for a turn board go in the same unit and the thread caches its turn resolves, so
+// each turn subgame is only resolved once.
 
 #include <math.h>
 #include <pthread.h>
@@ -32,6 +36,7 @@
 #include <sys/time.h> // gettimeofday()
 
 #include <algorithm>
+#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -69,6 +74,8 @@ using std::string;
 using std::unique_ptr;
 using std::vector;
 
+class PlayerThread;
+
 class Player {
 public:
   Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
@@ -77,21 +84,27 @@ public:
 	 const CardAbstraction &as_ca, const BettingAbstraction &as_ba, const CFRConfig &as_cc,
 	 const CardAbstraction &bs_ca, const BettingAbstraction &bs_ba, const CFRConfig &bc_cc,
 	 bool a_quantize, bool b_quantize);
-  ~Player(void) {}
-  void Go(int num_sampled_max_street_boards, bool deterministic);
+  ~Player(void);
+  void Go(int num_sampled_max_street_boards, bool deterministic, int num_threads);
+  bool NextUnit(int *begin, int *end);
+  void ReportBoard(int i, double b_outcome, double p0_outcome, double p1_outcome,
+		   double weight);
+  void ReportResolve(const string &action_sequence, int b_pos, int id, int last_bet_to);
 private:
-  void Showdown(Node *a_node, Node *b_node, const ReachProbs &reach_probs);
-  void Fold(Node *a_node, Node *b_node, const ReachProbs &reach_probs);
-  void Nonterminal(Node *a_node, Node *b_node, const string &action_sequence,
-		   const ReachProbs &reach_probs);
-  void Walk(Node *a_node, Node *b_node, const string &action_sequence,
-	    const ReachProbs &reach_probs, int last_st);
-  void ProcessMaxStreetBoard(int msbd);
+  friend class PlayerThread;
 
   const BettingAbstraction &a_betting_abstraction_;
   const BettingAbstraction &b_betting_abstraction_;
   const BettingAbstraction &a_subgame_betting_abstraction_;
   const BettingAbstraction &b_subgame_betting_abstraction_;
+  const CardAbstraction &a_card_abstraction_;
+  const CardAbstraction &b_card_abstraction_;
+  const CardAbstraction &a_subgame_card_abstraction_;
+  const CardAbstraction &b_subgame_card_abstraction_;
+  const CFRConfig &a_cfr_config_;
+  const CFRConfig &b_cfr_config_;
+  const CFRConfig &a_subgame_cfr_config_;
+  const CFRConfig &b_subgame_cfr_config_;
   // bool a_asymmetric_;
   // bool b_asymmetric_;
   unique_ptr<BettingTrees> a_betting_trees_;
@@ -103,32 +116,25 @@ private:
   int resolve_st_;
   bool resolve_a_;
   bool resolve_b_;
-  // When we resolve a street, the board index may change.  This is why we have separate
-  // a boards and b boards.  Only one player may be resolving.
-  unique_ptr<int []> a_gbds_;
-  unique_ptr<int []> a_lbds_;
-  unique_ptr<int []> b_gbds_;
-  unique_ptr<int []> b_lbds_;
-  // The number of times we sampled this board.
-  int num_samples_;
-  int msbd_;
-  int b_pos_;
-  // shared_ptr<HandTree> hand_tree_;
-  shared_ptr<HandTree> resolve_hand_tree_;
-  unique_ptr<shared_ptr<CanonicalCards> []> street_hands_;
-  double sum_b_outcomes_;
-  double sum_p0_outcomes_;
-  double sum_p1_outcomes_;
-  double sum_weights_;
   shared_ptr<Buckets> a_subgame_buckets_;
   shared_ptr<Buckets> b_subgame_buckets_;
-  unique_ptr<BettingTrees> a_subtrees_;
-  unique_ptr<BettingTrees> b_subtrees_;
-  unique_ptr<EGCFR> a_eg_cfr_;
-  unique_ptr<EGCFR> b_eg_cfr_;
   int num_subgame_its_;
-  int num_resolves_;
-  double resolving_secs_;
+  // The max street boards to evaluate and the number of times each was sampled.  Boards are
+  // handed out to threads in units of consecutive boards; see Go().
+  vector<int> boards_;
+  vector<int> board_samples_;
+  vector<int> unit_begins_;
+  int next_unit_;
+  // Per-board outcomes written by the threads.  Summed in board order at the end so that the
+  // result does not depend on the number of threads.
+  unique_ptr<double []> board_b_outcomes_;
+  unique_ptr<double []> board_p0_outcomes_;
+  unique_ptr<double []> board_p1_outcomes_;
+  unique_ptr<double []> board_weights_;
+  int num_sampled_max_street_boards_;
+  int so_far_;
+  bool report_progress_;
+  pthread_mutex_t mutex_;
 };
 
 Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
@@ -139,24 +145,16 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
 	       const BettingAbstraction &bs_ba, const CFRConfig &bs_cc, bool a_quantize,
 	       bool b_quantize) :
   a_betting_abstraction_(a_ba), b_betting_abstraction_(b_ba),
-  a_subgame_betting_abstraction_(as_ba), b_subgame_betting_abstraction_(bs_ba) {
+  a_subgame_betting_abstraction_(as_ba), b_subgame_betting_abstraction_(bs_ba),
+  a_card_abstraction_(a_ca), b_card_abstraction_(b_ca), a_subgame_card_abstraction_(as_ca),
+  b_subgame_card_abstraction_(bs_ca), a_cfr_config_(a_cc), b_cfr_config_(b_cc),
+  a_subgame_cfr_config_(as_cc), b_subgame_cfr_config_(bs_cc) {
   int max_street = Game::MaxStreet();
-  a_gbds_.reset(new int[max_street + 1]);
-  a_lbds_.reset(new int[max_street + 1]);
-  b_gbds_.reset(new int[max_street + 1]);
-  b_lbds_.reset(new int[max_street + 1]);
-  a_gbds_[0] = 0;
-  a_lbds_[0] = 0;
-  b_gbds_[0] = 0;
-  b_lbds_[0] = 0;
-  sum_b_outcomes_ = 0;
-  sum_p0_outcomes_ = 0;
-  sum_p1_outcomes_ = 0;
-  sum_weights_ = 0;
   resolve_a_ = resolve_a;
   resolve_b_ = resolve_b;
   resolve_st_ = resolve_st;
   num_subgame_its_ = 200;
+  pthread_mutex_init(&mutex_, NULL);
 
   a_base_buckets_.reset(new Buckets(a_ca, false));
   if (a_ca.CardAbstractionName() == b_ca.CardAbstractionName()) {
@@ -174,8 +172,6 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
   a_betting_trees_.reset(new BettingTrees(a_ba));
   b_betting_trees_.reset(new BettingTrees(b_ba));
 
-  street_hands_.reset(new shared_ptr<CanonicalCards>[max_street + 1]);
-  
   bool shared_probs = 
     (a_ca.CardAbstractionName().c_str() == b_ca.CardAbstractionName() &&
      a_ba.BettingAbstractionName().c_str() == b_ba.BettingAbstractionName() &&
@@ -246,16 +242,189 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
   // Check for dups for buckets
   if (resolve_a_) {
     a_subgame_buckets_.reset(new Buckets(as_ca, false));
-    a_eg_cfr_.reset(new UnsafeEGCFR(as_ca, a_ca, a_ba, as_cc, a_cc, *a_subgame_buckets_, 1));
   }
   if (resolve_b_) {
     b_subgame_buckets_.reset(new Buckets(bs_ca, false));
-    b_eg_cfr_.reset(new UnsafeEGCFR(bs_ca, b_ca, b_ba, bs_cc, b_cc, *b_subgame_buckets_, 1));
+  }
+}
+
+Player::~Player(void) {
+  pthread_mutex_destroy(&mutex_);
+}
+
+// Hands out the next unit of boards (indices begin...end-1 into boards_).  Returns false when
+// there is no work left.
+bool Player::NextUnit(int *begin, int *end) {
+  pthread_mutex_lock(&mutex_);
+  int num_units = unit_begins_.size() - 1;
+  bool ret = next_unit_ < num_units;
+  if (ret) {
+    *begin = unit_begins_[next_unit_];
+    *end = unit_begins_[next_unit_ + 1];
+    ++next_unit_;
+  }
+  pthread_mutex_unlock(&mutex_);
+  return ret;
+}
+
+void Player::ReportBoard(int i, double b_outcome, double p0_outcome, double p1_outcome,
+			 double weight) {
+  board_b_outcomes_[i] = b_outcome;
+  board_p0_outcomes_[i] = p0_outcome;
+  board_p1_outcomes_[i] = p1_outcome;
+  board_weights_[i] = weight;
+  if (report_progress_) {
+    pthread_mutex_lock(&mutex_);
+    so_far_ += board_samples_[i];
+    fprintf(stderr, "Processed %i/%i\n", so_far_, num_sampled_max_street_boards_);
+    pthread_mutex_unlock(&mutex_);
+  }
+}
+
+// Printed under the mutex so that lines from different threads don't interleave.
+void Player::ReportResolve(const string &action_sequence, int b_pos, int id, int last_bet_to) {
+  pthread_mutex_lock(&mutex_);
+  printf("Resolving %s b_pos_ %i id %i lbt %i\n", action_sequence.c_str(), b_pos, id,
+	 last_bet_to);
+  fflush(stdout);
+  pthread_mutex_unlock(&mutex_);
+}
+
+// A PlayerThread evaluates the boards that Player::NextUnit() hands it.  The betting trees,
+// buckets and base strategies are owned by the Player and shared read-only by all threads.
+// Everything that varies from board to board, including the resolved subgames, is private to
+// the thread.
+class PlayerThread {
+public:
+  PlayerThread(Player *player);
+  ~PlayerThread(void) {}
+  void Go(void);
+  void RunThread(void);
+  void Join(void);
+  int NumResolves(void) const {return num_resolves_;}
+  int NumCacheHits(void) const {return num_cache_hits_;}
+  double ResolvingSecs(void) const {return resolving_secs_;}
+private:
+  // A solved subgame.  Kept so that we can reuse it for other max street boards with the same
+  // resolve street board.
+  struct ResolvedSubgame {
+    shared_ptr<BettingTrees> subtrees;
+    shared_ptr<CFRValues> sumprobs;
+  };
+  
+  void Showdown(Node *a_node, Node *b_node, const ReachProbs &reach_probs);
+  void Fold(Node *a_node, Node *b_node, const ReachProbs &reach_probs);
+  void Nonterminal(Node *a_node, Node *b_node, const string &action_sequence,
+		   const ReachProbs &reach_probs);
+  Node *Resolve(bool a, Node *node, const string &action_sequence,
+		const ReachProbs &reach_probs);
+  void Walk(Node *a_node, Node *b_node, const string &action_sequence,
+	    const ReachProbs &reach_probs, int last_st);
+  void ProcessMaxStreetBoard(int msbd);
+
+  Player *player_;
+  const BettingAbstraction &a_betting_abstraction_;
+  const BettingAbstraction &b_betting_abstraction_;
+  const BettingAbstraction &a_subgame_betting_abstraction_;
+  const BettingAbstraction &b_subgame_betting_abstraction_;
+  const BettingTrees *a_betting_trees_;
+  const BettingTrees *b_betting_trees_;
+  shared_ptr<Buckets> a_base_buckets_;
+  shared_ptr<Buckets> b_base_buckets_;
+  shared_ptr<CFRValues> a_probs_;
+  shared_ptr<CFRValues> b_probs_;
+  int resolve_st_;
+  bool resolve_a_;
+  bool resolve_b_;
+  // When we resolve a street, the board index may change.  This is why we have separate
+  // a boards and b boards.  Only one player may be resolving.
+  unique_ptr<int []> a_gbds_;
+  unique_ptr<int []> a_lbds_;
+  unique_ptr<int []> b_gbds_;
+  unique_ptr<int []> b_lbds_;
+  // The number of times we sampled this board.
+  int num_samples_;
+  int msbd_;
+  int b_pos_;
+  // shared_ptr<HandTree> hand_tree_;
+  // The board on resolve_st_ that resolve_hand_tree_ and resolve_cache_ correspond to.
+  int root_bd_;
+  shared_ptr<HandTree> resolve_hand_tree_;
+  unique_ptr<shared_ptr<CanonicalCards> []> street_hands_;
+  double sum_b_outcomes_;
+  double sum_p0_outcomes_;
+  double sum_p1_outcomes_;
+  double sum_weights_;
+  shared_ptr<Buckets> a_subgame_buckets_;
+  shared_ptr<Buckets> b_subgame_buckets_;
+  shared_ptr<BettingTrees> a_subtrees_;
+  shared_ptr<BettingTrees> b_subtrees_;
+  unique_ptr<EGCFR> a_eg_cfr_;
+  unique_ptr<EGCFR> b_eg_cfr_;
+  // If we resolve before the max street, the reach probs at the root of a subgame and the
+  // resolve hand tree depend only on the resolve street board, so every max street board in the
+  // unit would lead to identical resolves.  We solve each subgame once and keep it until we move
+  // to a new resolve street board.  Keyed by system, b_pos_ and action sequence.
+  bool cache_resolves_;
+  std::map<string, ResolvedSubgame> resolve_cache_;
+  int num_subgame_its_;
+  int num_resolves_;
+  int num_cache_hits_;
+  double resolving_secs_;
+  pthread_t pthread_id_;
+};
+
+PlayerThread::PlayerThread(Player *player) :
+  player_(player),
+  a_betting_abstraction_(player->a_betting_abstraction_),
+  b_betting_abstraction_(player->b_betting_abstraction_),
+  a_subgame_betting_abstraction_(player->a_subgame_betting_abstraction_),
+  b_subgame_betting_abstraction_(player->b_subgame_betting_abstraction_) {
+  int max_street = Game::MaxStreet();
+  a_betting_trees_ = player->a_betting_trees_.get();
+  b_betting_trees_ = player->b_betting_trees_.get();
+  a_base_buckets_ = player->a_base_buckets_;
+  b_base_buckets_ = player->b_base_buckets_;
+  a_probs_ = player->a_probs_;
+  b_probs_ = player->b_probs_;
+  resolve_st_ = player->resolve_st_;
+  resolve_a_ = player->resolve_a_;
+  resolve_b_ = player->resolve_b_;
+  a_subgame_buckets_ = player->a_subgame_buckets_;
+  b_subgame_buckets_ = player->b_subgame_buckets_;
+  num_subgame_its_ = player->num_subgame_its_;
+  a_gbds_.reset(new int[max_street + 1]);
+  a_lbds_.reset(new int[max_street + 1]);
+  b_gbds_.reset(new int[max_street + 1]);
+  b_lbds_.reset(new int[max_street + 1]);
+  a_gbds_[0] = 0;
+  a_lbds_[0] = 0;
+  b_gbds_[0] = 0;
+  b_lbds_[0] = 0;
+  root_bd_ = -1;
+  street_hands_.reset(new shared_ptr<CanonicalCards>[max_street + 1]);
+  cache_resolves_ = (resolve_a_ || resolve_b_) && resolve_st_ < max_street;
+  num_resolves_ = 0;
+  num_cache_hits_ = 0;
+  resolving_secs_ = 0;
+
+  // Each thread solves its own subgames so the EGCFR objects cannot be shared.
+  if (resolve_a_) {
+    a_eg_cfr_.reset(new UnsafeEGCFR(player->a_subgame_card_abstraction_,
+				    player->a_card_abstraction_, a_betting_abstraction_,
+				    player->a_subgame_cfr_config_, player->a_cfr_config_,
+				    *a_subgame_buckets_, 1));
+  }
+  if (resolve_b_) {
+    b_eg_cfr_.reset(new UnsafeEGCFR(player->b_subgame_card_abstraction_,
+				    player->b_card_abstraction_, b_betting_abstraction_,
+				    player->b_subgame_cfr_config_, player->b_cfr_config_,
+				    *b_subgame_buckets_, 1));
   }
 }
 
 // Compute outcome from B's perspective
-void Player::Showdown(Node *a_node, Node *b_node, const ReachProbs &reach_probs) {
+void PlayerThread::Showdown(Node *a_node, Node *b_node, const ReachProbs &reach_probs) {
   Card max_card1 = Game::MaxCard() + 1;
 
   // double *a_probs = b_pos_ == 0 ? reach_probs[1].get() : reach_probs[0].get();
@@ -353,7 +522,7 @@ void Player::Showdown(Node *a_node, Node *b_node, const ReachProbs &reach_probs)
 }
   
 // Compute outcome from B's perspective
-void Player::Fold(Node *a_node, Node *b_node, const ReachProbs &reach_probs) {
+void PlayerThread::Fold(Node *a_node, Node *b_node, const ReachProbs &reach_probs) {
   Card max_card1 = Game::MaxCard() + 1;
 
   double half_pot = a_node->LastBetTo();
@@ -423,8 +592,8 @@ void Player::Fold(Node *a_node, Node *b_node, const ReachProbs &reach_probs) {
   sum_weights_ += wtd_sum_joint_probs;
 }
 
-void Player::Nonterminal(Node *a_node, Node *b_node, const string &action_sequence,
-			 const ReachProbs &reach_probs) {
+void PlayerThread::Nonterminal(Node *a_node, Node *b_node, const string &action_sequence,
+			       const ReachProbs &reach_probs) {
   int st = a_node->Street();
   int pa = a_node->PlayerActing();
   // A and B may have different numbers of succs.  I think this may only be the case if either
@@ -497,66 +666,72 @@ void Player::Nonterminal(Node *a_node, Node *b_node, const string &action_sequen
 #endif
 }
  
-void Player::Walk(Node *a_node, Node *b_node, const string &action_sequence,
-		  const ReachProbs &reach_probs, int last_st) {
+// Resolves the subgame rooted at node for system A (if a is true) or system B.  Returns the
+// root of the subtree to walk.
+Node *PlayerThread::Resolve(bool a, Node *node, const string &action_sequence,
+			    const ReachProbs &reach_probs) {
+  int st = node->Street();
+  int max_street = Game::MaxStreet();
+  EGCFR *eg_cfr = a ? a_eg_cfr_.get() : b_eg_cfr_.get();
+  shared_ptr<BettingTrees> subtrees;
+  string key = (a ? "A" : "B") + std::to_string(b_pos_) + action_sequence;
+  auto it = resolve_cache_.find(key);
+  if (it != resolve_cache_.end()) {
+    subtrees = it->second.subtrees;
+    eg_cfr->SetSumprobs(it->second.sumprobs);
+    ++num_cache_hits_;
+  } else {
+    const BettingAbstraction &subgame_ba =
+      a ? a_subgame_betting_abstraction_ : b_subgame_betting_abstraction_;
+    subtrees.reset(CreateSubtrees(st, node->PlayerActing(), node->LastBetTo(), -1, subgame_ba));
+    if (! a) {
+      player_->ReportResolve(action_sequence, b_pos_, node->NonterminalID(), node->LastBetTo());
+    }
+    struct timespec start, finish;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    eg_cfr->SolveSubgame(subtrees.get(), root_bd_, reach_probs, action_sequence,
+			 resolve_hand_tree_.get(), nullptr, -1, true, num_subgame_its_);
+    clock_gettime(CLOCK_MONOTONIC, &finish);
+    resolving_secs_ += (finish.tv_sec - start.tv_sec);
+    resolving_secs_ += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
+    ++num_resolves_;
+    if (cache_resolves_) {
+      ResolvedSubgame &subgame = resolve_cache_[key];
+      subgame.subtrees = subtrees;
+      subgame.sumprobs = eg_cfr->Sumprobs();
+    }
+  }
+  int *lbds = a ? a_lbds_.get() : b_lbds_.get();
+  for (int st1 = st; st1 <= max_street; ++st1) {
+    int gbd;
+    if (st1 == max_street) gbd = msbd_;
+    else                   gbd = BoardTree::PredBoard(msbd_, st1);
+    lbds[st1] = BoardTree::LocalIndex(st, root_bd_, st1, gbd);
+  }
+  // Keep the subtrees alive while we walk them
+  if (a) a_subtrees_ = subtrees;
+  else   b_subtrees_ = subtrees;
+  return subtrees->Root();
+}
+
+void PlayerThread::Walk(Node *a_node, Node *b_node, const string &action_sequence,
+			const ReachProbs &reach_probs, int last_st) {
   int st = a_node->Street();
   if (st > last_st && st == resolve_st_) {
     Node *next_a_node, *next_b_node;
     if (resolve_a_ && a_node->LastBetTo() < a_betting_abstraction_.StackSize()) {
-      a_subtrees_.reset(CreateSubtrees(st, a_node->PlayerActing(), a_node->LastBetTo(), -1,
-				       a_subgame_betting_abstraction_));
-      int max_street = Game::MaxStreet();
-      int root_bd;
-      if (st == max_street) root_bd = msbd_;
-      else                  root_bd = BoardTree::PredBoard(msbd_, st);
-      struct timespec start, finish;
-      clock_gettime(CLOCK_MONOTONIC, &start);
-      a_eg_cfr_->SolveSubgame(a_subtrees_.get(), root_bd, reach_probs, action_sequence,
-			      resolve_hand_tree_.get(), nullptr, -1, true, num_subgame_its_);
-      clock_gettime(CLOCK_MONOTONIC, &finish);
-      resolving_secs_ += (finish.tv_sec - start.tv_sec);
-      resolving_secs_ += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
-      ++num_resolves_;
-      next_a_node = a_subtrees_->Root();
-      for (int st1 = st; st1 <= max_street; ++st1) {
-	int gbd;
-	if (st1 == max_street) gbd = msbd_;
-	else                   gbd = BoardTree::PredBoard(msbd_, st1);
-	a_lbds_[st1] = BoardTree::LocalIndex(st, root_bd, st1, gbd);
-      }
+      next_a_node = Resolve(true, a_node, action_sequence, reach_probs);
     } else {
       next_a_node = a_node;
     }
     if (resolve_b_ && b_node->LastBetTo() < b_betting_abstraction_.StackSize()) {
-      b_subtrees_.reset(CreateSubtrees(st, b_node->PlayerActing(), b_node->LastBetTo(), -1,
-				       b_subgame_betting_abstraction_));
-      int max_street = Game::MaxStreet();
-      int root_bd;
-      if (st == max_street) root_bd = msbd_;
-      else                  root_bd = BoardTree::PredBoard(msbd_, st);
-      printf("Resolving %s b_pos_ %i id %i lbt %i\n", action_sequence.c_str(), b_pos_,
-	     b_node->NonterminalID(), b_node->LastBetTo());
-      fflush(stdout);
-      struct timespec start, finish;
-      clock_gettime(CLOCK_MONOTONIC, &start);
-      b_eg_cfr_->SolveSubgame(b_subtrees_.get(), root_bd, reach_probs, action_sequence,
-			      resolve_hand_tree_.get(), nullptr, -1, true, num_subgame_its_);
-      clock_gettime(CLOCK_MONOTONIC, &finish);
-      resolving_secs_ += (finish.tv_sec - start.tv_sec);
-      resolving_secs_ += (finish.tv_nsec - start.tv_nsec) / 1000000000.0;
-      ++num_resolves_;
-      next_b_node = b_subtrees_->Root();
-      for (int st1 = st; st1 <= max_street; ++st1) {
-	int gbd;
-	if (st1 == max_street) gbd = msbd_;
-	else                   gbd = BoardTree::PredBoard(msbd_, st1);
-	b_lbds_[st1] = BoardTree::LocalIndex(st, root_bd, st1, gbd);
-      }
+      next_b_node = Resolve(false, b_node, action_sequence, reach_probs);
     } else {
       next_b_node = b_node;
     }
     Walk(next_a_node, next_b_node, action_sequence, reach_probs, st);
-    // Release the memory now.  And make sure stale sumprobs are not accidentally used later.
+    // Release the memory now (unless cached).  And make sure stale sumprobs are not accidentally
+    // used later.
     if (resolve_a_) {
       a_eg_cfr_->ClearSumprobs();
     }
@@ -584,7 +759,7 @@ void Player::Walk(Node *a_node, Node *b_node, const string &action_sequence,
   }
 }
 
-void Player::ProcessMaxStreetBoard(int msbd) {
+void PlayerThread::ProcessMaxStreetBoard(int msbd) {
   int max_street = Game::MaxStreet();
   msbd_ = msbd;
   a_gbds_[max_street] = msbd_;
@@ -600,11 +775,13 @@ void Player::ProcessMaxStreetBoard(int msbd) {
   }
 
   if (resolve_a_ || resolve_b_) {
-    if (resolve_st_ < max_street) {
-      resolve_hand_tree_.reset(new HandTree(resolve_st_, BoardTree::PredBoard(msbd_, resolve_st_),
-					    max_street));
-    } else {
-      resolve_hand_tree_.reset(new HandTree(max_street, msbd_, max_street));
+    int root_bd;
+    if (resolve_st_ < max_street) root_bd = BoardTree::PredBoard(msbd_, resolve_st_);
+    else                          root_bd = msbd_;
+    if (root_bd != root_bd_) {
+      root_bd_ = root_bd;
+      resolve_hand_tree_.reset(new HandTree(resolve_st_, root_bd_, max_street));
+      resolve_cache_.clear();
     }
   }
   
@@ -629,9 +806,36 @@ void Player::ProcessMaxStreetBoard(int msbd) {
   }
 }
 
-void Player::Go(int num_sampled_max_street_boards, bool deterministic) {
-  num_resolves_ = 0;
-  resolving_secs_ = 0;
+void PlayerThread::Go(void) {
+  int begin, end;
+  while (player_->NextUnit(&begin, &end)) {
+    for (int i = begin; i < end; ++i) {
+      sum_b_outcomes_ = 0;
+      sum_p0_outcomes_ = 0;
+      sum_p1_outcomes_ = 0;
+      sum_weights_ = 0;
+      num_samples_ = player_->board_samples_[i];
+      ProcessMaxStreetBoard(player_->boards_[i]);
+      player_->ReportBoard(i, sum_b_outcomes_, sum_p0_outcomes_, sum_p1_outcomes_, sum_weights_);
+    }
+  }
+}
+
+static void *player_thread_run(void *v_t) {
+  PlayerThread *t = (PlayerThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void PlayerThread::RunThread(void) {
+  pthread_create(&pthread_id_, NULL, player_thread_run, this);
+}
+
+void PlayerThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+void Player::Go(int num_sampled_max_street_boards, bool deterministic, int num_threads) {
   int max_street = Game::MaxStreet();
   int num_max_street_boards = BoardTree::NumBoards(max_street);
   if (num_sampled_max_street_boards == 0 ||
@@ -639,12 +843,15 @@ void Player::Go(int num_sampled_max_street_boards, bool deterministic) {
     num_sampled_max_street_boards = num_max_street_boards;
   }
 
+  boards_.clear();
+  board_samples_.clear();
   if (num_sampled_max_street_boards == num_max_street_boards) {
     fprintf(stderr, "Processing all max street boards\n");
     for (int bd = 0; bd < num_max_street_boards; ++bd) {
-      num_samples_ = BoardTree::BoardCount(max_street, bd);
-      ProcessMaxStreetBoard(bd);
+      boards_.push_back(bd);
+      board_samples_.push_back(BoardTree::BoardCount(max_street, bd));
     }
+    report_progress_ = false;
   } else {
     unique_ptr<int []> max_street_board_samples(new int[num_max_street_boards]);
     for (int bd = 0; bd < num_max_street_boards; ++bd) max_street_board_samples[bd] = 0;
@@ -671,34 +878,89 @@ void Player::Go(int num_sampled_max_street_boards, bool deterministic) {
       ++max_street_board_samples[bd];
     }
 
-    int so_far = 0;
     for (int bd = 0; bd < num_max_street_boards; ++bd) {
-      num_samples_ = max_street_board_samples[bd];
-      if (num_samples_ == 0) continue;
-      ProcessMaxStreetBoard(bd);
-      so_far += num_samples_;
-      fprintf(stderr, "Processed %i/%i\n", so_far, num_sampled_max_street_boards);
+      if (max_street_board_samples[bd] == 0) continue;
+      boards_.push_back(bd);
+      board_samples_.push_back(max_street_board_samples[bd]);
     }
+    report_progress_ = true;
   }
 
-  double avg_b_outcome = sum_b_outcomes_ / sum_weights_;
+  // Partition the boards into units.  If we resolve before the max street, all the max street
+  // boards that share a resolve street board go in the same unit so that one thread can reuse
+  // its resolves for all of them.  Otherwise each board is its own unit.
+  int num_boards = boards_.size();
+  bool group = (resolve_a_ || resolve_b_) && resolve_st_ < max_street;
+  unit_begins_.clear();
+  int last_key = -1;
+  for (int i = 0; i < num_boards; ++i) {
+    int key = group ? BoardTree::PredBoard(boards_[i], resolve_st_) : boards_[i];
+    if (i == 0 || key != last_key) unit_begins_.push_back(i);
+    last_key = key;
+  }
+  unit_begins_.push_back(num_boards);
+  next_unit_ = 0;
+  num_sampled_max_street_boards_ = num_sampled_max_street_boards;
+  so_far_ = 0;
+  board_b_outcomes_.reset(new double[num_boards]);
+  board_p0_outcomes_.reset(new double[num_boards]);
+  board_p1_outcomes_.reset(new double[num_boards]);
+  board_weights_.reset(new double[num_boards]);
+
+  if (num_threads < 1) {
+    fprintf(stderr, "Player::Go: bad num threads %i\n", num_threads);
+    exit(-1);
+  }
+  vector< unique_ptr<PlayerThread> > threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new PlayerThread(this));
+  }
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->RunThread();
+  }
+  // Execute thread 0 in main execution thread
+  threads[0]->Go();
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->Join();
+  }
+
+  double sum_b_outcomes = 0, sum_p1_outcomes = 0, sum_weights = 0;
+  for (int i = 0; i < num_boards; ++i) {
+    sum_b_outcomes += board_b_outcomes_[i];
+    sum_p1_outcomes += board_p1_outcomes_[i];
+    sum_weights += board_weights_[i];
+  }
+  int num_resolves = 0, num_cache_hits = 0;
+  double resolving_secs = 0;
+  for (int t = 0; t < num_threads; ++t) {
+    num_resolves += threads[t]->NumResolves();
+    num_cache_hits += threads[t]->NumCacheHits();
+    resolving_secs += threads[t]->ResolvingSecs();
+  }
+
+  double avg_b_outcome = sum_b_outcomes / sum_weights;
   // avg_b_outcome is in units of the small blind
   double b_mbb_g = (avg_b_outcome / 2.0) * 1000.0;
   fprintf(stderr, "Avg B outcome: %f (%.1f mbb/g)\n", avg_b_outcome, b_mbb_g);
-  double avg_p1_outcome = sum_p1_outcomes_ / sum_weights_;
+  double avg_p1_outcome = sum_p1_outcomes / sum_weights;
   double p1_mbb_g = (avg_p1_outcome / 2.0) * 1000.0;
   fprintf(stderr, "Avg P1 outcome: %f (%.1f mbb/g)\n", avg_p1_outcome, p1_mbb_g);
-  fprintf(stderr, "%.1f secs spent resolving\n", resolving_secs_);
-  if (num_resolves_ > 0) {
-    fprintf(stderr, "Avg %.2f secs per resolve (%i resolves)\n", resolving_secs_ / num_resolves_,
-	    num_resolves_);
+  // Summed over threads
+  fprintf(stderr, "%.1f secs spent resolving\n", resolving_secs);
+  if (num_resolves > 0) {
+    fprintf(stderr, "Avg %.2f secs per resolve (%i resolves)\n", resolving_secs / num_resolves,
+	    num_resolves);
+  }
+  if (num_cache_hits > 0) {
+    fprintf(stderr, "%i resolves avoided by reusing turn subgames\n", num_cache_hits);
   }
 }
 
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <A card params> <B card params> "
 	  "<A betting abstraction params> <B betting abstraction params> <A CFR params> "
-	  "<B CFR params> <A it> <B it> <num sampled max street boards> [quantize|raw] "
+	  "<B CFR params> <A it> <B it> <num sampled max street boards> <num threads> "
+	  "[quantize|raw] "
 	  "[quantize|raw] [deterministic|nondeterministic] <resolve A> <resolve B> "
 	  "(<resolve st>) (<A resolve card params> <A resolve betting params> "
 	  "<A resolve CFR config>) (<B resolve card params> <B resolve betting params> "
@@ -710,7 +972,7 @@ static void Usage(const char *prog_name) {
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 16 && argc != 20 && argc != 23) Usage(argv[0]);
+  if (argc != 17 && argc != 21 && argc != 24) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -740,46 +1002,48 @@ int main(int argc, char *argv[]) {
   unique_ptr<CFRConfig>
     b_cfr_config(new CFRConfig(*b_cfr_params));
 
-  int a_it, b_it, num_sampled_max_street_boards;
+  int a_it, b_it, num_sampled_max_street_boards, num_threads;
   if (sscanf(argv[8], "%i", &a_it) != 1)                           Usage(argv[0]);
   if (sscanf(argv[9], "%i", &b_it) != 1)                           Usage(argv[0]);
   if (sscanf(argv[10], "%i", &num_sampled_max_street_boards) != 1) Usage(argv[0]);
+  if (sscanf(argv[11], "%i", &num_threads) != 1)                   Usage(argv[0]);
+  if (num_threads < 1)                                             Usage(argv[0]);
 
   bool a_quantize = false, b_quantize = false;
-  string qa = argv[11];
+  string qa = argv[12];
   if (qa == "quantize") a_quantize = true;
   else if (qa == "raw") a_quantize = false;
   else                  Usage(argv[0]);
-  string qb = argv[12];
+  string qb = argv[13];
   if (qb == "quantize") b_quantize = true;
   else if (qb == "raw") b_quantize = false;
   else                  Usage(argv[0]);
 
   bool deterministic = false;
-  string da = argv[13];
+  string da = argv[14];
   if (da == "deterministic")         deterministic = true;
   else if (da == "nondeterministic") deterministic = false;
   else                               Usage(argv[0]);
   
   bool resolve_a = false;
   bool resolve_b = false;
-  string ra = argv[14];
+  string ra = argv[15];
   if (ra == "true")       resolve_a = true;
   else if (ra == "false") resolve_a = false;
   else                    Usage(argv[0]);
-  string rb = argv[15];
+  string rb = argv[16];
   if (rb == "true")       resolve_b = true;
   else if (rb == "false") resolve_b = false;
   else                    Usage(argv[0]);
 
-  if (resolve_a && resolve_b && argc != 23)     Usage(argv[0]);
-  if (resolve_a && ! resolve_b && argc != 20)   Usage(argv[0]);
-  if (! resolve_a && resolve_b && argc != 20)   Usage(argv[0]);
-  if (! resolve_a && ! resolve_b && argc != 16) Usage(argv[0]);
+  if (resolve_a && resolve_b && argc != 24)     Usage(argv[0]);
+  if (resolve_a && ! resolve_b && argc != 21)   Usage(argv[0]);
+  if (! resolve_a && resolve_b && argc != 21)   Usage(argv[0]);
+  if (! resolve_a && ! resolve_b && argc != 17) Usage(argv[0]);
 
   int resolve_st = -1;
   if (resolve_a || resolve_b) {
-    if (sscanf(argv[16], "%i", &resolve_st) != 1) Usage(argv[0]);
+    if (sscanf(argv[17], "%i", &resolve_st) != 1) Usage(argv[0]);
   }
   
   unique_ptr<CardAbstraction> a_subgame_card_abstraction, b_subgame_card_abstraction;
@@ -787,17 +1051,17 @@ int main(int argc, char *argv[]) {
   unique_ptr<CFRConfig> a_subgame_cfr_config, b_subgame_cfr_config;
   if (resolve_a) {
     unique_ptr<Params> subgame_card_params = CreateCardAbstractionParams();
-    subgame_card_params->ReadFromFile(argv[17]);
+    subgame_card_params->ReadFromFile(argv[18]);
     a_subgame_card_abstraction.reset(new CardAbstraction(*subgame_card_params));
     unique_ptr<Params> subgame_betting_params = CreateBettingAbstractionParams();
-    subgame_betting_params->ReadFromFile(argv[18]);
+    subgame_betting_params->ReadFromFile(argv[19]);
     a_subgame_betting_abstraction.reset(new BettingAbstraction(*subgame_betting_params));
     unique_ptr<Params> subgame_cfr_params = CreateCFRParams();
-    subgame_cfr_params->ReadFromFile(argv[19]);
+    subgame_cfr_params->ReadFromFile(argv[20]);
     a_subgame_cfr_config.reset(new CFRConfig(*subgame_cfr_params));
   }
   if (resolve_b) {
-    int a = resolve_a ? 20 : 17;
+    int a = resolve_a ? 21 : 18;
     unique_ptr<Params> subgame_card_params = CreateCardAbstractionParams();
     subgame_card_params->ReadFromFile(argv[a]);
     b_subgame_card_abstraction.reset(new CardAbstraction(*subgame_card_params));
@@ -816,5 +1080,5 @@ int main(int argc, char *argv[]) {
 		resolve_a, resolve_b, *a_subgame_card_abstraction, *a_subgame_betting_abstraction,
 		*a_subgame_cfr_config, *b_subgame_card_abstraction, *b_subgame_betting_abstraction,
 		*b_subgame_cfr_config, a_quantize, b_quantize);
-  player.Go(num_sampled_max_street_boards, deterministic);
+  player.Go(num_sampled_max_street_boards, deterministic, num_threads);
 }
@@ -0,0 +1,134 @@
+#ifdef INSTRUMENT
+
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "instrument.h"
+
+static const char *kTimerNames[kNumInstrumentTimers] = {
+  "vcfr_process", "terminal_eval", "regret_update", "street_initial", "split", "queue_wait",
+  "tcfr_process", "solve_subgame", "cfr_values_read", "cfr_values_write"
+};
+
+static const char *kNodeTypeNames[kNumInstrumentNodeTypes] = {
+  "showdown", "fold", "our_choice", "opp_choice", "street_initial"
+};
+
+// The totals of all threads that have exited.  The summary is printed when this object is
+// destroyed at process exit, which happens after the main thread's thread-local counters have
+// been merged in.
+class InstrumentTotals {
+public:
+  InstrumentTotals(void) {
+    pthread_mutex_init(&mutex_, NULL);
+    memset(&totals_, 0, sizeof(totals_));
+  }
+  ~InstrumentTotals(void) {
+    Report();
+    pthread_mutex_destroy(&mutex_);
+  }
+  void Merge(const InstrumentCounters &counters);
+private:
+  void Report(void) const;
+
+  pthread_mutex_t mutex_;
+  InstrumentCounters totals_;
+};
+
+static InstrumentTotals g_totals;
+
+void InstrumentTotals::Merge(const InstrumentCounters &counters) {
+  pthread_mutex_lock(&mutex_);
+  for (int t = 0; t < kNumInstrumentTimers; ++t) {
+    for (int s = 0; s < kInstrumentNumSlots; ++s) {
+      totals_.calls[t][s] += counters.calls[t][s];
+      totals_.nsecs[t][s] += counters.nsecs[t][s];
+    }
+  }
+  for (int s = 0; s < kInstrumentNumSlots; ++s) {
+    for (int n = 0; n < kNumInstrumentNodeTypes; ++n) {
+      totals_.nodes[s][n] += counters.nodes[s][n];
+    }
+  }
+  pthread_mutex_unlock(&mutex_);
+}
+
+void InstrumentTotals::Report(void) const {
+  bool any_calls = false;
+  for (int t = 0; t < kNumInstrumentTimers; ++t) {
+    for (int s = 0; s < kInstrumentNumSlots; ++s) {
+      if (totals_.calls[t][s] > 0) any_calls = true;
+    }
+  }
+  if (any_calls) {
+    fprintf(stderr, "Timers (inclusive, summed over threads)\n");
+    fprintf(stderr, "  %-18s %-6s %14s %12s\n", "timer", "street", "calls", "secs");
+    for (int t = 0; t < kNumInstrumentTimers; ++t) {
+      for (int s = 0; s < kInstrumentNumSlots; ++s) {
+	if (totals_.calls[t][s] == 0) continue;
+	char street[10];
+	if (s == kInstrumentMaxStreets) strcpy(street, "-");
+	else                            sprintf(street, "%i", s);
+	fprintf(stderr, "  %-18s %-6s %14llu %12.3f\n", kTimerNames[t], street,
+		totals_.calls[t][s], totals_.nsecs[t][s] / 1e9);
+      }
+    }
+  }
+  bool any_nodes = false;
+  for (int s = 0; s < kInstrumentNumSlots; ++s) {
+    for (int n = 0; n < kNumInstrumentNodeTypes; ++n) {
+      if (totals_.nodes[s][n] > 0) any_nodes = true;
+    }
+  }
+  if (any_nodes) {
+    fprintf(stderr, "Node visits\n");
+    fprintf(stderr, "  %-6s", "street");
+    for (int n = 0; n < kNumInstrumentNodeTypes; ++n) {
+      fprintf(stderr, " %14s", kNodeTypeNames[n]);
+    }
+    fprintf(stderr, "\n");
+    for (int s = 0; s < kInstrumentNumSlots; ++s) {
+      bool any = false;
+      for (int n = 0; n < kNumInstrumentNodeTypes; ++n) {
+	if (totals_.nodes[s][n] > 0) any = true;
+      }
+      if (! any) continue;
+      if (s == kInstrumentMaxStreets) fprintf(stderr, "  %-6s", "-");
+      else                            fprintf(stderr, "  %-6i", s);
+      for (int n = 0; n < kNumInstrumentNodeTypes; ++n) {
+	fprintf(stderr, " %14llu", totals_.nodes[s][n]);
+      }
+      fprintf(stderr, "\n");
+    }
+  }
+}
+
+// Per-thread counters.  Merged into g_totals when the thread exits.
+class ThreadInstrumentation {
+public:
+  ThreadInstrumentation(void) {
+    memset(&counters_, 0, sizeof(counters_));
+    memset(depths_, 0, sizeof(depths_));
+  }
+  ~ThreadInstrumentation(void) {
+    g_totals.Merge(counters_);
+  }
+  InstrumentCounters *Counters(void) {return &counters_;}
+  int *Depths(void) {return depths_;}
+private:
+  InstrumentCounters counters_;
+  int depths_[kNumInstrumentTimers * kInstrumentNumSlots];
+};
+
+static thread_local ThreadInstrumentation tl_instrumentation;
+
+InstrumentCounters *ThreadInstrumentCounters(void) {
+  return tl_instrumentation.Counters();
+}
+
+int *ThreadInstrumentDepths(void) {
+  return tl_instrumentation.Depths();
+}
+
+#endif
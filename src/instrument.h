@@ -0,0 +1,107 @@
+#ifndef _INSTRUMENT_H_
+#define _INSTRUMENT_H_
+
+// Lightweight instrumentation for the solvers.  Build with -DINSTRUMENT (e.g., "make INSTRUMENT=1"
+// after removing obj/*.o) to enable it; otherwise the macros below compile to nothing.
+//
+// SCOPED_TIMER(timer, st) times the enclosing scope and attributes the time to the given timer
+// and street (-1 if there is no meaningful street).  Timers are inclusive.  If a timer is
+// re-entered on the same street by the same thread (e.g., recursive calls to VCFR::Process()) only
+// the outermost scope contributes time, although every scope counts as a call.
+//
+// COUNT_NODE(st, type) counts a visit to a node of the given type on the given street.
+//
+// Each thread accumulates into its own thread-local block, which is merged into the global totals
+// when the thread exits.  A summary of the totals is printed to stderr when the process exits.
+
+enum InstrumentTimer {
+  kTimerVCFRProcess,
+  kTimerTerminalEval,
+  kTimerRegretUpdate,
+  kTimerStreetInitial,
+  kTimerSplit,
+  kTimerQueueWait,
+  kTimerTCFRProcess,
+  kTimerSolveSubgame,
+  kTimerCFRValuesRead,
+  kTimerCFRValuesWrite,
+  kNumInstrumentTimers
+};
+
+enum InstrumentNodeType {
+  kNodeShowdown,
+  kNodeFold,
+  kNodeOurChoice,
+  kNodeOppChoice,
+  kNodeStreetInitial,
+  kNumInstrumentNodeTypes
+};
+
+#ifdef INSTRUMENT
+
+#include <time.h>
+
+// One slot per street plus a final slot for "no street".
+static const int kInstrumentMaxStreets = 4;
+static const int kInstrumentNumSlots = kInstrumentMaxStreets + 1;
+
+struct InstrumentCounters {
+  unsigned long long int calls[kNumInstrumentTimers][kInstrumentNumSlots];
+  unsigned long long int nsecs[kNumInstrumentTimers][kInstrumentNumSlots];
+  unsigned long long int nodes[kInstrumentNumSlots][kNumInstrumentNodeTypes];
+};
+
+InstrumentCounters *ThreadInstrumentCounters(void);
+int *ThreadInstrumentDepths(void);
+
+static inline int InstrumentSlot(int st) {
+  return st >= 0 && st < kInstrumentMaxStreets ? st : kInstrumentMaxStreets;
+}
+
+static inline unsigned long long int InstrumentNow(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((unsigned long long int)ts.tv_sec) * 1000000000ULL + ts.tv_nsec;
+}
+
+class ScopedTimer {
+public:
+  ScopedTimer(int timer, int st) {
+    int slot = InstrumentSlot(st);
+    index_ = timer * kInstrumentNumSlots + slot;
+    counters_ = ThreadInstrumentCounters();
+    ++counters_->calls[timer][slot];
+    depth_ = ThreadInstrumentDepths() + index_;
+    start_ = (*depth_)++ == 0 ? InstrumentNow() : 0;
+  }
+  ~ScopedTimer(void) {
+    if (--(*depth_) == 0) {
+      (&counters_->nsecs[0][0])[index_] += InstrumentNow() - start_;
+    }
+  }
+  ScopedTimer(const ScopedTimer &) = delete;
+  ScopedTimer &operator=(const ScopedTimer &) = delete;
+private:
+  InstrumentCounters *counters_;
+  int *depth_;
+  int index_;
+  unsigned long long int start_;
+};
+
+static inline void CountNode(int st, int type) {
+  ++ThreadInstrumentCounters()->nodes[InstrumentSlot(st)][type];
+}
+
+#define INSTRUMENT_CONCAT2(a, b) a ## b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT2(a, b)
+#define SCOPED_TIMER(timer, st) ScopedTimer INSTRUMENT_CONCAT(scoped_timer_, __LINE__)(timer, st)
+#define COUNT_NODE(st, type) CountNode(st, type)
+
+#else
+
+#define SCOPED_TIMER(timer, st)
+#define COUNT_NODE(st, type) ((void)0)
+
+#endif
+
+#endif
@@ -2,10 +2,12 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <x86intrin.h>
 
 #include <string>
 #include <vector>
@@ -15,6 +17,102 @@
 using std::string;
 using std::vector;
 
+MappedFile::MappedFile(const char *filename, bool populate, bool huge_pages) {
+  int fd = open(filename, O_RDONLY, 0);
+  if (fd == -1) {
+    fprintf(stderr, "MappedFile: failed to open \"%s\", errno %i\n", filename, errno);
+    exit(-1);
+  }
+  struct stat stbuf;
+  if (fstat(fd, &stbuf) == -1) {
+    fprintf(stderr, "MappedFile: couldn't stat %s\n", filename);
+    exit(-1);
+  }
+  size_ = stbuf.st_size;
+  data_ = nullptr;
+  if (size_ > 0) {
+    int flags = MAP_SHARED;
+    if (populate) flags |= MAP_POPULATE;
+    data_ = mmap(nullptr, size_, PROT_READ, flags, fd, 0);
+    if (data_ == MAP_FAILED) {
+      fprintf(stderr, "MappedFile: mmap of %s failed, errno %i\n", filename, errno);
+      exit(-1);
+    }
+    // Only advice; not all kernels and filesystems support huge pages for file mappings.
+    if (huge_pages) madvise(data_, size_, MADV_HUGEPAGE);
+  }
+  // The mapping remains valid after the descriptor is closed
+  close(fd);
+}
+
+MappedFile::~MappedFile(void) {
+  if (data_) munmap(data_, size_);
+}
+
+#ifndef __SSE4_2__
+class CRCTable {
+public:
+  CRCTable(void) {
+    for (unsigned int i = 0; i < 256; ++i) {
+      unsigned int c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? (c >> 1) ^ 0x82f63b78 : c >> 1;
+      entries_[i] = c;
+    }
+  }
+  unsigned int operator[](int i) const {return entries_[i];}
+private:
+  unsigned int entries_[256];
+};
+#endif
+
+unsigned int CRC32C(unsigned int crc, const unsigned char *data, unsigned long long int n) {
+  crc = ~crc;
+#ifdef __SSE4_2__
+  unsigned long long int c = crc;
+  while (n >= 8) {
+    unsigned long long int v;
+    memcpy(&v, data, 8);
+    c = _mm_crc32_u64(c, v);
+    data += 8;
+    n -= 8;
+  }
+  crc = c;
+  while (n-- > 0) crc = _mm_crc32_u8(crc, *data++);
+#else
+  // Initialization of a function-local static is thread-safe
+  static const CRCTable table;
+  while (n-- > 0) crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+#endif
+  return ~crc;
+}
+
+void WriteChecksumFile(const char *filename, unsigned int crc) {
+  string crc_filename = string(filename) + ".crc";
+  FILE *fp = fopen(crc_filename.c_str(), "w");
+  if (fp == NULL) {
+    fprintf(stderr, "Couldn't open %s for writing\n", crc_filename.c_str());
+    exit(-1);
+  }
+  fprintf(fp, "%08x\n", crc);
+  fclose(fp);
+}
+
+void VerifyChecksumFile(const char *filename, unsigned int crc) {
+  string crc_filename = string(filename) + ".crc";
+  FILE *fp = fopen(crc_filename.c_str(), "r");
+  if (fp == NULL) return;
+  unsigned int expected;
+  if (fscanf(fp, "%x", &expected) != 1) {
+    fprintf(stderr, "Couldn't parse %s\n", crc_filename.c_str());
+    exit(-1);
+  }
+  fclose(fp);
+  if (crc != expected) {
+    fprintf(stderr, "Checksum mismatch for %s: %08x, expected %08x\n", filename, crc, expected);
+    exit(-1);
+  }
+}
+
 // Note that stat() is very slow.  We've replaced the call to stat() with
 // a call to open().
 bool FileExists(const char *filename) {
@@ -74,6 +172,8 @@ void Reader::OpenFile(const char *filename) {
 
   overflow_size_ = 0;
   byte_pos_ = 0;
+  checksum_ = false;
+  crc_ = 0;
 }
 
 Reader::Reader(const char *filename) {
@@ -109,6 +209,8 @@ Reader::Reader(const char *filename, long long int file_size) {
 
   overflow_size_ = 0;
   byte_pos_ = 0;
+  checksum_ = false;
+  crc_ = 0;
 
   buf_size_ = kBufSize;
   if (remaining_ < buf_size_) buf_size_ = remaining_;
@@ -142,7 +244,22 @@ bool Reader::AtEnd(void) const {
   return (buf_ptr_ == end_read_ && remaining_ == 0 && overflow_size_ == 0);
 }
 
+// Must be called before anything has been read.  The bytes that the constructor already read
+// into the buffer are the start of the file.
+void Reader::EnableChecksum(void) {
+  if (byte_pos_ != 0 || remaining_ + (end_read_ - buf_.get()) != file_size_) {
+    fprintf(stderr, "Reader::EnableChecksum: %s already read from\n", filename_.c_str());
+    exit(-1);
+  }
+  checksum_ = true;
+  crc_ = CRC32C(0, buf_.get(), end_read_ - buf_.get());
+}
+
 void Reader::SeekTo(long long int offset) {
+  if (checksum_) {
+    fprintf(stderr, "Reader::SeekTo: can't seek in checksummed file %s\n", filename_.c_str());
+    exit(-1);
+  }
   long long int ret = lseek(fd_, offset, SEEK_SET);
   if (ret == -1) {
     fprintf(stderr, "lseek failed, offset %lli, ret %lli, errno %i, fd %i\n",
@@ -177,6 +294,7 @@ bool Reader::Refresh(void) {
     exit(-1);
   }
 
+  if (checksum_) crc_ = CRC32C(crc_, read_into, to_read);
   remaining_ -= to_read;
   end_read_ = read_into + to_read;
   overflow_size_ = 0;
@@ -446,8 +564,10 @@ void Reader::ReadOrDie(double *d) {
   *d = ReadDoubleOrDie();
 }
 
+// Copies a buffer's worth at a time
 void Reader::ReadNBytesOrDie(unsigned int num_bytes, unsigned char *buf) {
-  for (unsigned int i = 0; i < num_bytes; ++i) {
+  unsigned int i = 0;
+  while (i < num_bytes) {
     if (buf_ptr_ + 1 > end_read_) {
       if (! Refresh()) {
 	fprintf(stderr, "Couldn't read %i bytes\n", num_bytes);
@@ -459,8 +579,12 @@ void Reader::ReadNBytesOrDie(unsigned int num_bytes, unsigned char *buf) {
 	exit(-1);
       }
     }
-    buf[i] = *buf_ptr_++;
-    ++byte_pos_;
+    unsigned int n = end_read_ - buf_ptr_;
+    if (n > num_bytes - i) n = num_bytes - i;
+    memcpy(buf + i, buf_ptr_, n);
+    buf_ptr_ += n;
+    byte_pos_ += n;
+    i += n;
   }
 }
 
@@ -618,6 +742,8 @@ void Writer::Init(const char *filename, bool modify, int buf_size) {
   buf_.reset(new unsigned char[buf_size_]);
   end_buf_ = buf_.get() + buf_size_;
   buf_ptr_ = buf_.get();
+  checksum_ = false;
+  crc_ = 0;
 }
 
 Writer::Writer(const char *filename, int buf_size) {
@@ -642,6 +768,7 @@ Writer::~Writer(void) {
 void Writer::Flush(void) {
   if (buf_ptr_ > buf_.get()) {
     int left_to_write = (int)(buf_ptr_ - buf_.get());
+    if (checksum_) crc_ = CRC32C(crc_, buf_.get(), left_to_write);
     while (left_to_write > 0) {
       int written = write(fd_, buf_.get(), left_to_write);
       if (written < 0) {
@@ -659,6 +786,11 @@ void Writer::Flush(void) {
   buf_ptr_ = buf_.get();
 }
 
+unsigned int Writer::Checksum(void) {
+  Flush();
+  return crc_;
+}
+
 // Only makes sense to call if we created the Writer with modify=true
 void Writer::SeekTo(long long int offset) {
   Flush();
@@ -676,6 +808,10 @@ long long int Writer::Tell(void) {
   return lseek(fd_, 0LL, SEEK_CUR);
 }
 
+long long int Writer::Pos(void) {
+  return lseek(fd_, 0LL, SEEK_CUR) + (buf_ptr_ - buf_.get());
+}
+
 void Writer::WriteInt(int i) {
   if (buf_ptr_ + sizeof(int) > end_buf_) {
     Flush();
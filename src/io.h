@@ -7,7 +7,7 @@
 
 class Reader {
 public:
-  Reader(void) {}
+  Reader(void) : checksum_(false), crc_(0) {}
   Reader(const char *filename);
   // This constructor for use by NewReaderMaybe().  Doesn't call stat().
   Reader(const char *filename, long long int file_size);
@@ -51,6 +51,11 @@ public:
   void ReadEverythingLeft(unsigned char *data);
   int FD(void) const {return fd_;}
   const std::string &Filename(void) const {return filename_;}
+  // Maintain a running CRC-32C of everything read.  Must be called right after construction.
+  // Sequential reads only; SeekTo() is an error afterwards.
+  void EnableChecksum(void);
+  // The checksum of the bytes read so far
+  unsigned int Checksum(void) const {return crc_;}
 
  protected:
   void OpenFile(const char *filename);
@@ -70,6 +75,8 @@ public:
   // Doesn't do the expected thing for CompressedReader
   long long int byte_pos_;
   std::string filename_;
+  bool checksum_;
+  unsigned int crc_;
 };
 
 Reader *NewReaderMaybe(const char *filename);
@@ -105,10 +112,17 @@ class Writer {
   void WriteText(const char *s);
   void SeekTo(long long int offset);
   long long int Tell(void);
+  // Like Tell() but counts buffered bytes rather than flushing them
+  long long int Pos(void);
   const std::string &Filename(void) const {return filename_;}
   int fd(void) const {return fd_;}
   virtual void Flush(void);
   int BufPos(void);
+  // Maintain a running CRC-32C of everything written.  Only meaningful for sequential writes
+  // (no SeekTo()).
+  void EnableChecksum(void) {checksum_ = true;}
+  // Flushes and returns the checksum of the bytes written so far
+  unsigned int Checksum(void);
 
  protected:
   static const int kBufSize = 65536;
@@ -121,6 +135,8 @@ class Writer {
   unsigned char *end_buf_;
   int buf_size_;
   std::string filename_;
+  bool checksum_;
+  unsigned int crc_;
 };
 
 class ReadWriter {
@@ -135,6 +151,30 @@ private:
   std::string filename_;
 };
 
+// A read-only mapping of an entire file.  Processes mapping the same file share one copy of it
+// in the page cache.  If populate is true, the file is read in at construction rather than a page
+// at a time on first touch.  If huge_pages is true, we ask the kernel to back the mapping with
+// huge pages (which it may or may not do).
+class MappedFile {
+public:
+  MappedFile(const char *filename, bool populate, bool huge_pages);
+  ~MappedFile(void);
+  const void *Data(void) const {return data_;}
+  long long int Size(void) const {return size_;}
+private:
+  void *data_;
+  long long int size_;
+};
+
+// CRC-32C (Castagnoli) of n bytes, continuing from crc.  Pass zero initially.
+unsigned int CRC32C(unsigned int crc, const unsigned char *data, unsigned long long int n);
+// Checksums are kept in a sidecar file named <filename>.crc
+void WriteChecksumFile(const char *filename, unsigned int crc);
+// Exits with an error if the sidecar exists and doesn't match crc, the checksum of the contents
+// of filename (e.g., from Reader::Checksum()).  Files written before we had checksums have no
+// sidecar and pass.
+void VerifyChecksumFile(const char *filename, unsigned int crc);
+
 bool FileExists(const char *filename);
 long long int FileSize(const char *filename);
 bool IsADirectory(const char *path);
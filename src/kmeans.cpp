@@ -1,15 +1,21 @@
 // May need to make sure we don't assign items to empty clusters.
 // Might want to call EliminateEmpty() on every iteration.
-// If you do this, then must set num_clusters in KMeansThread separately on each iteration.
 // Would like for code to be as generic as possible.  But different objects
 // being clustered will have different types of features.
-// Have to take the square root or the triangle equality based test will not
-// work properly.
+// The triangle inequality based tests operate on distances, not squared
+// distances.  We compare squared distances against four times the squared
+// bound instead of taking a square root for every centroid.
 
+#include <float.h>
 #include <math.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
 
 #include <algorithm>
 #include <vector>
@@ -23,37 +29,63 @@ using std::vector;
 
 static int g_it = 0;
 
+// Squared Euclidean distance between two rows.  Both rows are aligned and
+// zero padded out to stride, so the padding contributes nothing.
+static inline float SqDist(const float *a, const float *b, int stride) {
+#ifdef __AVX__
+  __m256 acc = _mm256_setzero_ps();
+  for (int d = 0; d < stride; d += KMeans::kFloatsPerVector) {
+    __m256 delta = _mm256_sub_ps(_mm256_load_ps(a + d), _mm256_load_ps(b + d));
+#ifdef __FMA__
+    acc = _mm256_fmadd_ps(delta, delta, acc);
+#else
+    acc = _mm256_add_ps(acc, _mm256_mul_ps(delta, delta));
+#endif
+  }
+  __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+  s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+  s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+  return _mm_cvtss_f32(s);
+#else
+  float dist_sq = 0;
+  for (int d = 0; d < stride; ++d) {
+    float delta = a[d] - b[d];
+    dist_sq += delta * delta;
+  }
+  return dist_sq;
+#endif
+}
+
 class KMeansThread {
 public:
-  KMeansThread(int num_objects, int num_clusters, float **objects, int dim, double neighbor_thresh,
-	       int *cluster_sizes, float **means, int *assignments,
-	       vector< pair<float, int> > *neighbor_vectors, int thread_index, int num_threads);
+  KMeansThread(KMeans *kmeans, int thread_index, int num_threads);
   ~KMeansThread(void) {}
   void Assign(void);
   void ComputeIntraCentroidDistances(void);
-  void SortNeighbors();
+  void ComputeHalfNearest(void);
+  void SortNeighbors(void);
+  void Update(void);
+  void SeedDistances(void);
   void RunAssign(void);
   void RunIntra(void);
+  void RunHalfNearest(void);
   void RunSort(void);
+  void RunUpdate(void);
+  void RunSeed(void);
   void Join(void);
   int NumChanged(void) const {return num_changed_;}
   double SumDists(void) const {return sum_dists_;}
 private:
-  int ExhaustiveNearest(int o, float *obj, int guess_c, double guess_min_dist,
-			double *ret_min_dist);
-  int Nearest(int o, float *obj, double *ret_min_dist);
-
-  int num_objects_;
-  int num_clusters_;
-  float **objects_;
-  int dim_;
-  double neighbor_thresh_;
-  int *cluster_sizes_;
-  float **means_;
-  int *assignments_;
-  vector< pair<float, int> > *neighbor_vectors_;
+  int ExhaustiveNearest(const float *obj, float *ret_min_sq, float *ret_second_sq);
+  int Nearest(int o, const float *obj, double *ret_min_dist);
+  int BoundedNearest(int o, const float *obj, double *ret_min_dist);
+
+  KMeans *kmeans_;
   int thread_index_;
   int num_threads_;
+  // Contiguous range of objects this thread assigns
+  int begin_;
+  int end_;
   int num_changed_;
   double sum_dists_;
   unsigned long long int exhaustive_count_;
@@ -62,113 +94,45 @@ private:
   pthread_t pthread_id_;
 };
 
-KMeansThread::KMeansThread(int num_objects, int num_clusters, float **objects, int dim,
-			   double neighbor_thresh, int *cluster_sizes, float **means,
-			   int *assignments, vector< pair<float, int> > *neighbor_vectors,
-			   int thread_index, int num_threads) {
-  num_objects_ = num_objects;
-  num_clusters_ = num_clusters;
-  objects_ = objects;
-  dim_ = dim;
-  neighbor_thresh_ = neighbor_thresh;
-  cluster_sizes_ = cluster_sizes;
-  means_ = means;
-  assignments_ = assignments;
-  neighbor_vectors_ = neighbor_vectors;
+KMeansThread::KMeansThread(KMeans *kmeans, int thread_index, int num_threads) {
+  kmeans_ = kmeans;
   thread_index_ = thread_index;
   num_threads_ = num_threads;
+  long long int num_objects = kmeans->num_objects_;
+  begin_ = num_objects * thread_index / num_threads;
+  end_ = num_objects * (thread_index + 1) / num_threads;
   num_changed_ = 0;
+  sum_dists_ = 0;
 }
 
-#if 0
-// Could add early termination when dist exceeds min dist
-unsigned int KMeansThread::Nearest(unsigned int o, float *obj,
-				   double *ret_min_dist) {
-  // Initialize best_c to the current assignment.  This will make the triangle
-  // inequality based optimization work better.
-  unsigned int best_c = assignments_[o];
-  if (best_c == kMaxUInt) {
-    // Arbitrarily set best_c to first cluster with non-zero size
-    unsigned int c;
-    for (c = 0; c < num_clusters_; ++c) {
-      if (cluster_sizes_[c] > 0) {
-	best_c = c;
-	break;
-      }
-    }
-    if (c == num_clusters_) {
-      fprintf(stderr, "No clusters with non-zero size?!?\n");
-      exit(-1);
-    }
-  }
-  float orig_min_dist = 0;
-  for (unsigned int d = 0; d < dim_; ++d) {
-    float ov = obj[d];
-    float cm = means_[best_c][d];
-    float dim_delta = ov - cm;
-    orig_min_dist += dim_delta * dim_delta;
-  }
-  orig_min_dist = sqrt(orig_min_dist);
-  float min_dist = orig_min_dist;
-  unsigned char *neighbors = nearest_centroids_[best_c];
-  while (true) {
-    unsigned int c = *(unsigned int *)neighbors;
-    if (c == kMaxUInt) break;
-    if (c == best_c) continue;
-    if (cluster_sizes_[c] == 0) continue;
-    neighbors += sizeof(unsigned int);
-    float centroid_dist = *(float *)neighbors;
-    neighbors += sizeof(float);
-    if (centroid_dist >= 2 * orig_min_dist) {
-      continue;
-    }
-
-    float *cluster_means = means_[c];
-    float dist_sq = 0;
-    for (unsigned int d = 0; d < dim_; ++d) {
-      float ov = obj[d];
-      float cm = cluster_means[d];
-      float dim_delta = ov - cm;
-      dist_sq += dim_delta * dim_delta;
-    }
-    float dist = sqrt(dist_sq);
-    if (dist < min_dist) {
+// Returns the nearest nonempty cluster, breaking ties in favor of the lower
+// numbered cluster.  Also returns the squared distance to the nearest and
+// second nearest nonempty clusters.
+int KMeansThread::ExhaustiveNearest(const float *obj, float *ret_min_sq, float *ret_second_sq) {
+  int num_clusters = kmeans_->num_clusters_;
+  int stride = kmeans_->stride_;
+  const int *cluster_sizes = kmeans_->cluster_sizes_;
+  const float *means = kmeans_->means_;
+  float min_sq = FLT_MAX, second_sq = FLT_MAX;
+  int best_c = -1;
+  for (int c = 0; c < num_clusters; ++c) {
+    if (cluster_sizes[c] == 0) continue;
+    float dist_sq = SqDist(obj, means + (size_t)c * stride, stride);
+    if (dist_sq < min_sq) {
+      second_sq = min_sq;
       best_c = c;
-      min_dist = dist;
+      min_sq = dist_sq;
+    } else if (dist_sq < second_sq) {
+      second_sq = dist_sq;
     }
   }
-  *ret_min_dist = min_dist;
-  return best_c;
-}
-#endif
-
-int KMeansThread::ExhaustiveNearest(int o, float *obj, int guess_c, double guess_min_dist,
-				    double *ret_min_dist) {
-  float min_dist = guess_min_dist;
-  int best_c = guess_c;
-  for (int c = 0; c < num_clusters_; ++c) {
-    if (c == best_c) continue;
-    if (cluster_sizes_[c] == 0) continue;
-
-    float *cluster_means = means_[c];
-    float dist_sq = 0;
-    for (int d = 0; d < dim_; ++d) {
-      float ov = obj[d];
-      float cm = cluster_means[d];
-      float dim_delta = ov - cm;
-      dist_sq += dim_delta * dim_delta;
-    }
-    float dist = sqrt(dist_sq);
-    ++dist_count_;
-    if (dist < min_dist) {
-      best_c = c;
-      min_dist = dist;
-    } else if (dist == min_dist) {
-      // In case of tie, choose the lower numbered cluster
-      if (c < best_c) best_c = c;
-    }
+  dist_count_ += num_clusters;
+  if (best_c == -1) {
+    fprintf(stderr, "No clusters with non-zero size?!?\n");
+    exit(-1);
   }
-  *ret_min_dist = min_dist;
+  *ret_min_sq = min_sq;
+  *ret_second_sq = second_sq;
   return best_c;
 }
 
@@ -185,69 +149,53 @@ int KMeansThread::ExhaustiveNearest(int o, float *obj, int guess_c, double guess
 // with ExhaustiveNearest().  Hopefully this doesn't happen too often.  In
 // case (1) we can instead repeat the process we just followed, this time
 // using the neighbors list of the new best candidate.
-int KMeansThread::Nearest(int o, float *obj, double *ret_min_dist) {
+int KMeansThread::Nearest(int o, const float *obj, double *ret_min_dist) {
+  int num_clusters = kmeans_->num_clusters_;
+  int stride = kmeans_->stride_;
+  const int *cluster_sizes = kmeans_->cluster_sizes_;
+  const float *means = kmeans_->means_;
   // Initialize orig_best_c to the current assignment.  This will make the
   // triangle inequality based optimization work better.
-  int orig_best_c = assignments_[o];
+  int orig_best_c = kmeans_->assignments_[o];
   if (orig_best_c == -1) {
     // Arbitrarily set orig_best_c to first cluster with non-zero size
     int c;
-    for (c = 0; c < num_clusters_; ++c) {
-      if (cluster_sizes_[c] > 0) {
+    for (c = 0; c < num_clusters; ++c) {
+      if (cluster_sizes[c] > 0) {
 	orig_best_c = c;
 	break;
       }
     }
-    if (c == num_clusters_) {
+    if (c == num_clusters) {
       fprintf(stderr, "No clusters with non-zero size?!?\n");
       exit(-1);
     }
   }
-  float orig_dist = 0;
-  for (int d = 0; d < dim_; ++d) {
-    float ov = obj[d];
-    float cm = means_[orig_best_c][d];
-    float dim_delta = ov - cm;
-    orig_dist += dim_delta * dim_delta;
-  }
-  orig_dist = sqrt(orig_dist);
+  float orig_sq = SqDist(obj, means + (size_t)orig_best_c * stride, stride);
   ++dist_count_;
-  // For testing purposes, if we can just call ExhaustiveNearest() here if
-  // we suspect a bug in the optimized code below.
-  if (neighbor_vectors_ == NULL) {
-    return ExhaustiveNearest(o, obj, orig_best_c, orig_dist, ret_min_dist);
-  }
-  float min_dist = orig_dist;
+  float min_sq = orig_sq;
   int best_c = orig_best_c;
   while (true) {
-    const vector< pair<float, int> > &v = neighbor_vectors_[best_c];
+    const vector< pair<float, int> > &v = kmeans_->neighbor_vectors_[best_c];
     int num = v.size();
     for (int i = 0; i < num; ++i) {
-      float intra_dist = v[i].first;
+      float intra_sq = v[i].first;
       int c = v[i].second;
-      if (cluster_sizes_[c] == 0) continue;
-      // Has to be orig_dist, not min_dist.
-      if (intra_dist >= 2 * orig_dist) {
+      if (cluster_sizes[c] == 0) continue;
+      // Has to be orig_sq, not min_sq.
+      if (intra_sq >= 4 * orig_sq) {
 	// We sorted neighbors by distance so we can skip all other clusters
 	++abbreviated_count_;
-	*ret_min_dist = min_dist;
+	*ret_min_dist = sqrt(min_sq);
 	return best_c;
       }
 
-      float *cluster_means = means_[c];
-      float dist_sq = 0;
-      for (int d = 0; d < dim_; ++d) {
-	float ov = obj[d];
-	float cm = cluster_means[d];
-	float dim_delta = ov - cm;
-	dist_sq += dim_delta * dim_delta;
-      }
-      float dist = sqrt(dist_sq);
+      float dist_sq = SqDist(obj, means + (size_t)c * stride, stride);
       ++dist_count_;
-      if (dist < min_dist) {
+      if (dist_sq < min_sq) {
 	best_c = c;
-	min_dist = dist;
-      } else if (dist == min_dist) {
+	min_sq = dist_sq;
+      } else if (dist_sq == min_sq) {
 	// In case of tie, choose the lower numbered cluster
 	if (c < best_c) best_c = c;
       }
@@ -258,14 +206,17 @@ int KMeansThread::Nearest(int o, float *obj, double *ret_min_dist) {
       // best cluster.  All we can do now is an exhaustive search of all
       // the clusters.
       ++exhaustive_count_;
-      return ExhaustiveNearest(o, obj, best_c, min_dist, ret_min_dist);
+      float second_sq;
+      best_c = ExhaustiveNearest(obj, &min_sq, &second_sq);
+      *ret_min_dist = sqrt(min_sq);
+      return best_c;
     } else {
       // We got to the end of the neighbors list and we could not prove
       // that we had the best cluster, *but* we did find a better candidate
       // cluster.  So we can now try to search the neighbors of this new
       // better candidate.
       orig_best_c = best_c;
-      orig_dist = min_dist;
+      orig_sq = min_sq;
       continue;
     }
   }
@@ -274,6 +225,38 @@ int KMeansThread::Nearest(int o, float *obj, double *ret_min_dist) {
   exit(-1);
 }
 
+// Hamerly's algorithm.  lower_bounds_[o] is a lower bound on the distance
+// from o to every cluster other than its current one.  Centroid movement
+// in Update() loosens it by the largest drift of any other cluster.  If o
+// is closer to its current cluster than both that bound and half the
+// distance from its cluster to the nearest other cluster, o cannot move.
+// Otherwise fall back to an exhaustive search, which also refreshes the
+// bound.  The skip test is strict so ties resolve as in ExhaustiveNearest().
+int KMeansThread::BoundedNearest(int o, const float *obj, double *ret_min_dist) {
+  int c = kmeans_->assignments_[o];
+  float *lower_bounds = kmeans_->lower_bounds_;
+  if (c != -1) {
+    int stride = kmeans_->stride_;
+    float drift = c == kmeans_->max_drift_c_ ? kmeans_->second_max_drift_ :
+      kmeans_->max_drift_;
+    float lower = lower_bounds[o] - drift;
+    float dist = sqrt(SqDist(obj, kmeans_->means_ + (size_t)c * stride, stride));
+    ++dist_count_;
+    if (dist < lower || dist < kmeans_->half_nearest_[c]) {
+      ++abbreviated_count_;
+      lower_bounds[o] = lower;
+      *ret_min_dist = dist;
+      return c;
+    }
+  }
+  ++exhaustive_count_;
+  float min_sq, second_sq;
+  int best_c = ExhaustiveNearest(obj, &min_sq, &second_sq);
+  lower_bounds[o] = sqrt(second_sq);
+  *ret_min_dist = sqrt(min_sq);
+  return best_c;
+}
+
 void KMeansThread::Assign(void) {
   abbreviated_count_ = 0ULL;
   exhaustive_count_ = 0ULL;
@@ -281,15 +264,19 @@ void KMeansThread::Assign(void) {
   num_changed_ = 0;
   double dist;
   sum_dists_ = 0;
-  for (int o = thread_index_; o < num_objects_; o += num_threads_) {
-    if (g_it == 0 && thread_index_ == 0 && (o / num_threads_) % 10000 == 0) {
-      fprintf(stderr, "It %i o %i/%i\n", g_it, o, num_objects_);
-    }
-    float *obj = objects_[o];
-    int nearest = Nearest(o, obj, &dist);
+  const float *objects = kmeans_->objects_;
+  int stride = kmeans_->stride_;
+  int *assignments = kmeans_->assignments_;
+  bool bounds = kmeans_->lower_bounds_ != NULL;
+  for (int o = begin_; o < end_; ++o) {
+    if (g_it == 0 && thread_index_ == 0 && (o - begin_) % 10000 == 0) {
+      fprintf(stderr, "It %i o %i/%i\n", g_it, o, end_);
+    }
+    const float *obj = objects + (size_t)o * stride;
+    int nearest = bounds ? BoundedNearest(o, obj, &dist) : Nearest(o, obj, &dist);
     sum_dists_ += dist;
-    if (nearest != assignments_[o]) ++num_changed_;
-    assignments_[o] = nearest;
+    if (nearest != assignments[o]) ++num_changed_;
+    assignments[o] = nearest;
   }
   if (thread_index_ == 0) {
     fprintf(stderr, "Abbreviated: %.2f%% (%llu/%llu)\n",
@@ -300,46 +287,138 @@ void KMeansThread::Assign(void) {
     fprintf(stderr, "Dist count: %llu\n", dist_count_);
     // Divide by num_threads because we are reporting numbers for one thread
     unsigned long long int naive_dist_count =
-      ((unsigned long long int)num_objects_) *
-      ((unsigned long long int)num_clusters_) / num_threads_;
+      ((unsigned long long int)kmeans_->num_objects_) *
+      ((unsigned long long int)kmeans_->num_clusters_) / num_threads_;
     fprintf(stderr, "Dist pct: %.2f%%\n",
 	    100.0 * dist_count_ / (double)naive_dist_count);
   }
 }
 
 void KMeansThread::ComputeIntraCentroidDistances(void) {
+  int num_clusters = kmeans_->num_clusters_;
+  int stride = kmeans_->stride_;
+  const int *cluster_sizes = kmeans_->cluster_sizes_;
+  const float *means = kmeans_->means_;
+  float thresh_sq = kmeans_->neighbor_thresh_ * kmeans_->neighbor_thresh_;
+  vector< pair<float, int> > *neighbor_vectors = kmeans_->neighbor_vectors_;
   // First loop puts c1 on c2's list for c1 < c2
-  for (int c1 = 0; c1 < num_clusters_ - 1; ++c1) {
-    if (cluster_sizes_[c1] == 0) continue;
-    float *cluster_means1 = means_[c1];
-    for (int c2 = c1 + 1; c2 < num_clusters_; ++c2) {
-      if (cluster_sizes_[c2] == 0) continue;
+  for (int c1 = 0; c1 < num_clusters - 1; ++c1) {
+    if (cluster_sizes[c1] == 0) continue;
+    const float *cluster_means1 = means + (size_t)c1 * stride;
+    for (int c2 = c1 + 1; c2 < num_clusters; ++c2) {
+      if (cluster_sizes[c2] == 0) continue;
       // Only do work that is mine
       if (c2 % num_threads_ != thread_index_) continue;
-      float *cluster_means2 = means_[c2];
-      float dist_sq = 0;
-      for (int d = 0; d < dim_; ++d) {
-	float cm1 = cluster_means1[d];
-	float cm2 = cluster_means2[d];
-	float delta = cm2 - cm1;
-	dist_sq += delta * delta;
+      float dist_sq = SqDist(cluster_means1, means + (size_t)c2 * stride, stride);
+      if (dist_sq >= thresh_sq) continue;
+      neighbor_vectors[c2].push_back(make_pair(dist_sq, c1));
+    }
+  }
+}
+
+// Half the distance from each cluster to the nearest other nonempty cluster.
+// An object closer than this to its own cluster cannot be closer to any other.
+void KMeansThread::ComputeHalfNearest(void) {
+  int num_clusters = kmeans_->num_clusters_;
+  int stride = kmeans_->stride_;
+  const int *cluster_sizes = kmeans_->cluster_sizes_;
+  const float *means = kmeans_->means_;
+  for (int c1 = thread_index_; c1 < num_clusters; c1 += num_threads_) {
+    float min_sq = FLT_MAX;
+    if (cluster_sizes[c1] > 0) {
+      const float *cluster_means1 = means + (size_t)c1 * stride;
+      for (int c2 = 0; c2 < num_clusters; ++c2) {
+	if (c2 == c1 || cluster_sizes[c2] == 0) continue;
+	float dist_sq = SqDist(cluster_means1, means + (size_t)c2 * stride, stride);
+	if (dist_sq < min_sq) min_sq = dist_sq;
       }
-      float dist = sqrt(dist_sq);
-      if (dist >= neighbor_thresh_) continue;
-      neighbor_vectors_[c2].push_back(make_pair(dist, c1));
     }
+    kmeans_->half_nearest_[c1] = 0.5 * sqrt(min_sq);
   }
 }
 
 void KMeansThread::SortNeighbors(void) {
-  for (int c = 0; c < num_clusters_; ++c) {
+  int num_clusters = kmeans_->num_clusters_;
+  for (int c = 0; c < num_clusters; ++c) {
     // Only do work that is mine
     if (c % num_threads_ != thread_index_) continue;
-    vector< pair<float, int> > *v = &neighbor_vectors_[c];
+    vector< pair<float, int> > *v = &kmeans_->neighbor_vectors_[c];
     std::sort(v->begin(), v->end(), g_pfui_lower_compare);
   }
 }
 
+// Each thread owns the clusters c with c % num_threads == thread_index and
+// sums the objects assigned to them in object order, so the new means do
+// not depend on the number of threads.  Also records how far each centroid
+// moved for BoundedNearest().
+void KMeansThread::Update(void) {
+  int num_objects = kmeans_->num_objects_;
+  int num_clusters = kmeans_->num_clusters_;
+  int dim = kmeans_->dim_;
+  int stride = kmeans_->stride_;
+  const float *objects = kmeans_->objects_;
+  const int *assignments = kmeans_->assignments_;
+  int *cluster_sizes = kmeans_->cluster_sizes_;
+  float *means = kmeans_->means_;
+  double *sums = kmeans_->sums_.data();
+  for (int c = thread_index_; c < num_clusters; c += num_threads_) {
+    double *cluster_sums = sums + (size_t)c * stride;
+    for (int d = 0; d < dim; ++d) cluster_sums[d] = 0;
+    cluster_sizes[c] = 0;
+  }
+  for (int o = 0; o < num_objects; ++o) {
+    int c = assignments[o];
+    // During initialization we will assign some objects to cluster -1
+    // meaning they are unassigned
+    if (c == -1 || c % num_threads_ != thread_index_) continue;
+    const float *obj = objects + (size_t)o * stride;
+    double *cluster_sums = sums + (size_t)c * stride;
+    for (int d = 0; d < dim; ++d) {
+      cluster_sums[d] += obj[d];
+    }
+    ++cluster_sizes[c];
+  }
+  for (int c = thread_index_; c < num_clusters; c += num_threads_) {
+    const double *cluster_sums = sums + (size_t)c * stride;
+    float *cluster_means = means + (size_t)c * stride;
+    int size = cluster_sizes[c];
+    double drift_sq = 0;
+    for (int d = 0; d < dim; ++d) {
+      float m = size > 0 ? cluster_sums[d] / size : 0;
+      float delta = m - cluster_means[d];
+      drift_sq += delta * delta;
+      cluster_means[d] = m;
+    }
+    if (kmeans_->drifts_) kmeans_->drifts_[c] = sqrt(drift_sq);
+  }
+}
+
+// Lowers each object's squared distance to its nearest seed to account for
+// the new seed seed_c_ and recomputes the running sums within each chunk.
+// Chunks are interleaved across threads.
+void KMeansThread::SeedDistances(void) {
+  int num_objects = kmeans_->num_objects_;
+  int stride = kmeans_->stride_;
+  const float *objects = kmeans_->objects_;
+  const float *seed = kmeans_->means_ + (size_t)kmeans_->seed_c_ * stride;
+  float *sq_distance_to_nearest = kmeans_->sq_distance_to_nearest_;
+  double *cum_sq_distance_to_nearest = kmeans_->cum_sq_distance_to_nearest_;
+  for (int ch = thread_index_; ch < kmeans_->num_chunks_; ch += num_threads_) {
+    int begin = ch * KMeans::kSeedChunkSize;
+    int end = std::min(begin + KMeans::kSeedChunkSize, num_objects);
+    double cum_sq_dist = 0;
+    for (int o = begin; o < end; ++o) {
+      float sq_dist = SqDist(objects + (size_t)o * stride, seed, stride);
+      if (sq_dist < sq_distance_to_nearest[o]) {
+	sq_distance_to_nearest[o] = sq_dist;
+      }
+      cum_sq_dist += sq_distance_to_nearest[o];
+      cum_sq_distance_to_nearest[o] = cum_sq_dist;
+    }
+    kmeans_->chunk_sums_[ch] = cum_sq_dist;
+  }
+}
+
 static void *thread_run_assign(void *v_t) {
   KMeansThread *t = (KMeansThread *)v_t;
   t->Assign();
@@ -360,6 +439,16 @@ void KMeansThread::RunIntra(void) {
   pthread_create(&pthread_id_, NULL, thread_run_intra, this);
 }
 
+static void *thread_run_half_nearest(void *v_t) {
+  KMeansThread *t = (KMeansThread *)v_t;
+  t->ComputeHalfNearest();
+  return NULL;
+}
+
+void KMeansThread::RunHalfNearest(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_half_nearest, this);
+}
+
 static void *thread_run_sort(void *v_t) {
   KMeansThread *t = (KMeansThread *)v_t;
   t->SortNeighbors();
@@ -370,148 +459,112 @@ void KMeansThread::RunSort(void) {
   pthread_create(&pthread_id_, NULL, thread_run_sort, this);
 }
 
+static void *thread_run_update(void *v_t) {
+  KMeansThread *t = (KMeansThread *)v_t;
+  t->Update();
+  return NULL;
+}
+
+void KMeansThread::RunUpdate(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_update, this);
+}
+
+static void *thread_run_seed(void *v_t) {
+  KMeansThread *t = (KMeansThread *)v_t;
+  t->SeedDistances();
+  return NULL;
+}
+
+void KMeansThread::RunSeed(void) {
+  pthread_create(&pthread_id_, NULL, thread_run_seed, this);
+}
+
 void KMeansThread::Join(void) {
   pthread_join(pthread_id_, NULL); 
 }
 
-int KMeans::BinarySearch(double r, int begin, int end, double *cum_sq_distance_to_nearest,
-			 bool *used) {
-  if (end == begin + 1) {
-    // Is it possible that we will select a used object?
-    if (used[begin]) {
-      fprintf(stderr, "Ended up with used object?!?\n");
-      fprintf(stderr, "r %f cum_sq_distance_to_nearest %f %f %f %f\n", r,
-	      cum_sq_distance_to_nearest[begin - 2],
-	      cum_sq_distance_to_nearest[begin - 1],
-	      cum_sq_distance_to_nearest[begin],
-	      cum_sq_distance_to_nearest[end]);
-      exit(-1);
-    }
-    return begin;
-  } else {
-    // The median may be an already used object, but cum_sq_distance_to_nearest
-    // is set appropriately.
-    int median = (end + begin) / 2;
-    double median_val = cum_sq_distance_to_nearest[median];
-    if (r < median_val) {
-      if (median == 0) return 0;
-      // Find the previous object that is not used
-      int prev;
-      for (prev = median - 1; prev >= 0; --prev) {
-	if (! used[prev]) {
-	  if (r >= cum_sq_distance_to_nearest[prev]) {
-	    return median;
-	  } else {
-	    return BinarySearch(r, begin, median, cum_sq_distance_to_nearest, used);
-	  }
-	}
-      }
-      // If we get here, median is the first unused object
-      return median;
-    } else if (r > median_val) {
-      return BinarySearch(r, median + 1, end, cum_sq_distance_to_nearest, used);
-      // r is >= median_val
-    } else {
-      // r is exactly equal to median_val!  (Quite a coincidence.)
-      // First look for the first unused object and or before median.  If
-      // we find one, return it.
-      for (int i = median; i >= 0; --i) {
-	if (! used[i]) return i;
-      }
-      // Coincidences on top of coincidences!  There was no prior object.
-      // Look for a later object.
-      for (int i = median + 1; i < (int)end; ++i) {
-	if (! used[i]) return i;
-      }
-      fprintf(stderr, "Shouldn't get here\n");
-      exit(-1);
-    }
-  }
+float *KMeans::AllocateObjects(int num_objects, int dim) {
+  size_t num_bytes = (size_t)num_objects * Stride(dim) * sizeof(float);
+  // aligned_alloc() wants a nonzero multiple of the alignment
+  if (num_bytes == 0) num_bytes = kFloatsPerVector * sizeof(float);
+  float *p = (float *)aligned_alloc(kFloatsPerVector * sizeof(float), num_bytes);
+  if (p == nullptr) {
+    fprintf(stderr, "KMeans: failed to allocate %zu bytes\n", num_bytes);
+    exit(-1);
+  }
+  memset(p, 0, num_bytes);
+  return p;
 }
 
-// Use the KMeans++ method of seeding
-// Should maintain cum_sq_distance_to_nearest, do binary search on it
-// for lookup.  Still need O(n) update to sq_distance_to_nearest though.
-// Can we update sq_distance_to_nearest only occasionally?
-void KMeans::SeedPlusPlus(void) {
-  bool *used = new bool[num_objects_];
-  for (int o = 0; o < num_objects_; ++o) used[o] = false;
-  // For the first centroid, choose one of the input objects at random
-  int o = RandBetween(0, num_objects_ - 1);
-  used[o] = true;
-  for (int f = 0; f < dim_; ++f) {
-    means_[0][f] = objects_[o][f];
-  }
-  double *sq_distance_to_nearest = new double[num_objects_];
-  double *cum_sq_distance_to_nearest = new double[num_objects_];
+// Picks the next k-means++ seed with probability proportional to its squared
+// distance to the nearest existing seed.  First find the chunk, then binary
+// search the running sums within it.  Objects already chosen have distance
+// zero so they never start a new step in the running sums and can never be
+// returned.
+int KMeans::SampleSeed(void) {
   double sum_min_sq_dist = 0;
-  double cum_sq_dist = 0;
-  for (int o = 0; o < num_objects_; ++o) {
-    if (used[o]) {
-      cum_sq_distance_to_nearest[o] = cum_sq_dist;
-      continue;
-    }
-    double sq_dist = 0;
-    float *obj = objects_[o];
-    for (int d = 0; d < dim_; ++d) {
-      double ov = obj[d];
-      double cm = means_[0][d];
-      float dim_delta = ov - cm;
-      sq_dist += dim_delta * dim_delta;
-    }
-    sq_distance_to_nearest[o] = sq_dist;
-    cum_sq_dist += sq_dist;
-    cum_sq_distance_to_nearest[o] = cum_sq_dist;
-    sum_min_sq_dist += sq_dist;
-  }
-  for (int c = 1; c < num_clusters_; ++c) {
+  for (int ch = 0; ch < num_chunks_; ++ch) sum_min_sq_dist += chunk_sums_[ch];
+  if (sum_min_sq_dist == 0) {
+    fprintf(stderr, "SampleSeed: no unused objects left\n");
+    exit(-1);
+  }
+  double x = RandZeroToOne() * sum_min_sq_dist;
+  int ch;
+  for (ch = 0; ch < num_chunks_; ++ch) {
+    if (x < chunk_sums_[ch]) break;
+    x -= chunk_sums_[ch];
+  }
+  if (ch == num_chunks_) {
+    // Rounding carried us off the end.  Take the last object with nonzero
+    // weight.
+    for (ch = num_chunks_ - 1; chunk_sums_[ch] == 0; --ch) ;
+    x = chunk_sums_[ch];
+  }
+  double *begin = cum_sq_distance_to_nearest_ + (size_t)ch * kSeedChunkSize;
+  double *end = cum_sq_distance_to_nearest_ +
+    std::min((size_t)(ch + 1) * kSeedChunkSize, (size_t)num_objects_);
+  double *p = std::upper_bound(begin, end, x);
+  if (p == end) p = std::lower_bound(begin, end, chunk_sums_[ch]);
+  return p - cum_sq_distance_to_nearest_;
+}
+
+// Use the KMeans++ method of seeding.  Each new seed costs one pass over the
+// objects to update their distance to the nearest seed; that pass is spread
+// across the threads.
+void KMeans::SeedPlusPlus(void) {
+  num_chunks_ = (num_objects_ + kSeedChunkSize - 1) / kSeedChunkSize;
+  sq_distance_to_nearest_ = new float[num_objects_];
+  cum_sq_distance_to_nearest_ = new double[num_objects_];
+  chunk_sums_ = new double[num_chunks_];
+  for (int o = 0; o < num_objects_; ++o) sq_distance_to_nearest_[o] = FLT_MAX;
+  for (int c = 0; c < num_clusters_; ++c) {
     if (c % 1000 == 0) {
       fprintf(stderr, "SeedPlusPlus: c %i/%i\n", c, num_clusters_);
     }
-    double x = RandZeroToOne() * sum_min_sq_dist;
-    int o;
-#if 1
-    o = BinarySearch(x, 0, num_objects_, cum_sq_distance_to_nearest, used);
-#else
-    double cum = 0;
-    for (o = 0; o < num_objects_; ++o) {
-      if (used[o]) continue;
-      cum += sq_distance_to_nearest[o];
-      if (x <= cum) break;
-    }
-#endif
-    used[o] = true;
-    // Helps with old version of search
-    sq_distance_to_nearest[o] = 0;
-    for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
-    }
-    sum_min_sq_dist = 0;
-    double cum_sq_dist = 0;
-    for (int o = 0; o < num_objects_; ++o) {
-      if (used[o]) {
-	cum_sq_distance_to_nearest[o] = cum_sq_dist;
-	continue;
-      }
-      float *obj = objects_[o];
-      double sq_dist = 0;
-      for (int d = 0; d < dim_; ++d) {
-	double ov = obj[d];
-	double cm = means_[c][d];
-	float dim_delta = ov - cm;
-	sq_dist += dim_delta * dim_delta;
-      }
-      if (sq_dist < sq_distance_to_nearest[o]) {
-	sq_distance_to_nearest[o] = sq_dist;
-      }
-      sum_min_sq_dist += sq_distance_to_nearest[o];
-      cum_sq_dist += sq_distance_to_nearest[o];
-      cum_sq_distance_to_nearest[o] = cum_sq_dist;
-    }
-  }
-  delete [] sq_distance_to_nearest;
-  delete [] cum_sq_distance_to_nearest;
-  delete [] used;
+    // For the first centroid, choose one of the input objects at random
+    int o = c == 0 ? RandBetween(0, num_objects_ - 1) : SampleSeed();
+    const float *obj = objects_ + (size_t)o * stride_;
+    float *cluster_means = means_ + (size_t)c * stride_;
+    for (int d = 0; d < stride_; ++d) {
+      cluster_means[d] = obj[d];
+    }
+    if (c == num_clusters_ - 1) break;
+    seed_c_ = c;
+    for (int i = 1; i < num_threads_; ++i) {
+      threads_[i]->RunSeed();
+    }
+    // Execute thread 0 in main execution thread
+    threads_[0]->SeedDistances();
+    for (int i = 1; i < num_threads_; ++i) {
+      threads_[i]->Join();
+    }
+  }
+  delete [] sq_distance_to_nearest_;
+  delete [] cum_sq_distance_to_nearest_;
+  delete [] chunk_sums_;
+  sq_distance_to_nearest_ = NULL;
+  cum_sq_distance_to_nearest_ = NULL;
+  chunk_sums_ = NULL;
 }
 
 // Choose one item at random to serve as the seed of each cluster
@@ -524,8 +577,10 @@ void KMeans::Seed1(void) {
       o = RandBetween(0, num_objects_ - 1);
     } while (used[o]);
     used[o] = true;
-    for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects_[o][f];
+    const float *obj = objects_ + (size_t)o * stride_;
+    float *cluster_means = means_ + (size_t)c * stride_;
+    for (int f = 0; f < stride_; ++f) {
+      cluster_means[f] = obj[f];
     }
   }
   delete [] used;
@@ -541,34 +596,34 @@ void KMeans::Seed2(void) {
     for (int f = 0; f < dim_; ++f) sums[f] = 0;
     for (int i = 0; i < num_sample; ++i) {
       int o = RandBetween(0, num_objects_ - 1);
+      const float *obj = objects_ + (size_t)o * stride_;
       for (int f = 0; f < dim_; ++f) {
-	sums[f] += objects_[o][f];
+	sums[f] += obj[f];
       }
     }
+    float *cluster_means = means_ + (size_t)c * stride_;
     for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = sums[f] / num_sample;
+      cluster_means[f] = sums[f] / num_sample;
     }
   }
   delete [] sums;
 }
 
 // Should I assume dups have been removed?
-void KMeans::SingleObjectClusters(int num_clusters, int dim, int num_objects, float **objects) {
+void KMeans::SingleObjectClusters(int dim, int num_objects, const float *objects) {
   num_clusters_ = num_objects;
   dim_ = dim;
+  stride_ = Stride(dim);
   num_objects_ = num_objects;
   objects_ = objects;
   cluster_sizes_ = new int[num_clusters_];
-  means_ = new float *[num_clusters_];
-  for (int c = 0; c < num_clusters_; ++c) {
-    means_[c] = new float[dim];
-  }
+  means_ = AllocateObjects(num_clusters_, dim_);
   assignments_ = new int[num_objects_];
   for (int o = 0; o < num_objects_; ++o) {
     int c = o;
     assignments_[o] = c;
-    for (int f = 0; f < dim_; ++f) {
-      means_[c][f] = objects[o][f];
+    for (int f = 0; f < stride_; ++f) {
+      means_[(size_t)c * stride_ + f] = objects[(size_t)o * stride_ + f];
     }
     cluster_sizes_[c] = 1;
   }
@@ -576,36 +631,51 @@ void KMeans::SingleObjectClusters(int num_clusters, int dim, int num_objects, fl
   num_threads_ = 0;
 }
 
-KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, double neighbor_thresh,
-	       int num_threads) {
+KMeans::KMeans(int num_clusters, int dim, int num_objects, const float *objects,
+	       double neighbor_thresh, int num_threads) {
   neighbor_vectors_ = NULL;
   cluster_sizes_ = NULL;
   means_ = NULL;
   assignments_ = NULL;
+  lower_bounds_ = NULL;
+  half_nearest_ = NULL;
+  drifts_ = NULL;
+  sq_distance_to_nearest_ = NULL;
+  cum_sq_distance_to_nearest_ = NULL;
+  chunk_sums_ = NULL;
   threads_ = NULL;
+  if (num_clusters < 1 || dim < 1 || num_threads < 1) {
+    fprintf(stderr, "KMeans: bad num clusters %i, dim %i or num threads %i\n", num_clusters, dim,
+	    num_threads);
+    exit(-1);
+  }
   if (num_clusters >= num_objects) {
     fprintf(stderr, "Assigning every object to its own cluster\n");
-    SingleObjectClusters(num_clusters, dim, num_objects, objects);
+    SingleObjectClusters(dim, num_objects, objects);
     return;
   }
   num_clusters_ = num_clusters;
   fprintf(stderr, "%i objects\n", num_objects);
   fprintf(stderr, "Using target num clusters: %i\n", num_clusters_);
   dim_ = dim;
+  stride_ = Stride(dim);
   num_objects_ = num_objects;
   objects_ = objects;
   neighbor_thresh_ = neighbor_thresh;
   cluster_sizes_ = new int[num_clusters_];
-  means_ = new float *[num_clusters_];
-  for (int c = 0; c < num_clusters_; ++c) {
-    means_[c] = new float[dim];
-  }
+  means_ = AllocateObjects(num_clusters_, dim_);
   assignments_ = new int[num_objects_];
   for (int o = 0; o < num_objects_; ++o) assignments_[o] = -1;
 
   intra_time_ = 0;
   assign_time_ = 0;
 
+  num_threads_ = num_threads;
+  threads_ = new KMeansThread *[num_threads_];
+  for (int t = 0; t < num_threads_; ++t) {
+    threads_[t] = new KMeansThread(this, t, num_threads_);
+  }
+
   // SeedPlusPlus() is pretty slow.  For now don't use when >= 10,000
   // clusters and more than 1m objects.  Could do 10k clusters and 3m objects
   // OK.
@@ -624,23 +694,21 @@ KMeans::KMeans(int num_clusters, int dim, int num_objects, float **objects, doub
   // properly in Update().
   for (int c = 0; c < num_clusters_; ++c) cluster_sizes_[c] = 1;
 
-  // If neighbor_thresh_ is zero, don't compute neighbors lists.
+  sums_.resize((size_t)num_clusters_ * (size_t)stride_);
+
+  // If neighbor_thresh_ is zero, don't compute neighbors lists.  Use bounds
+  // instead.
   if (neighbor_thresh_ > 0) {
-    neighbor_vectors_ = new vector< pair<float, int> >[num_clusters_];
+    neighbor_vectors_ = new vector< pair<float, int> >[num_clusters];
   } else {
-    neighbor_vectors_ = NULL;
-  }
-
-  num_threads_ = num_threads;
-  threads_ = new KMeansThread *[num_threads_];
-  for (int t = 0; t < num_threads_; ++t) {
-    threads_[t] = new KMeansThread(num_objects_, num_clusters_, objects_, dim_, neighbor_thresh_,
-				   cluster_sizes_, means_, assignments_, neighbor_vectors_,
-				   t, num_threads_);
+    lower_bounds_ = new float[num_objects_];
+    half_nearest_ = new float[num_clusters_];
+    drifts_ = new float[num_clusters_];
   }
 
   // Normally we call this at the end of each iteration.  Call it once now
   // before the first iteration to speed up the first call to Assign().
+  // The first call to Assign() is exhaustive in the bounds variant anyway.
   if (neighbor_thresh_ > 0) {
     fprintf(stderr, "Calling initial ComputeIntraCentroidDistances()\n");
     ComputeIntraCentroidDistances();
@@ -659,11 +727,11 @@ KMeans::~KMeans(void) {
   }
   delete [] neighbor_vectors_;
   delete [] cluster_sizes_;
-  for (int c = 0; c < num_clusters_; ++c) {
-    delete [] means_[c];
-  }
-  delete [] means_;
+  free(means_);
   delete [] assignments_;
+  delete [] lower_bounds_;
+  delete [] half_nearest_;
+  delete [] drifts_;
 }
 
 // Assumes cluster means are up-to-date
@@ -689,9 +757,9 @@ void KMeans::ComputeIntraCentroidDistances(void) {
     vector< pair<float, int> > *v = &neighbor_vectors_[c1];
     int num = v->size();
     for (int i = 0; i < num; ++i) {
-      float dist = (*v)[i].first;
+      float dist_sq = (*v)[i].first;
       int c0 = (*v)[i].second;
-      neighbor_vectors_[c0].push_back(make_pair(dist, c1));
+      neighbor_vectors_[c0].push_back(make_pair(dist_sq, c1));
     }
   }
 
@@ -716,6 +784,25 @@ void KMeans::ComputeIntraCentroidDistances(void) {
   fprintf(stderr, "Cum intra time: %f\n", intra_time_);
 }
 
+// Assumes cluster means are up-to-date
+void KMeans::ComputeHalfNearest(void) {
+  time_t start_t = time(NULL);
+
+  for (int i = 1; i < num_threads_; ++i) {
+    threads_[i]->RunHalfNearest();
+  }
+  // Execute thread 0 in main execution thread
+  threads_[0]->ComputeHalfNearest();
+  for (int i = 1; i < num_threads_; ++i) {
+    threads_[i]->Join();
+  }
+
+  time_t end_t = time(NULL);
+  double diff_sec = difftime(end_t, start_t);
+  intra_time_ += diff_sec;
+  fprintf(stderr, "Cum intra time: %f\n", intra_time_);
+}
+
 int KMeans::Assign(double *avg_dist) {
   time_t start_t = time(NULL);
 
@@ -744,36 +831,33 @@ int KMeans::Assign(double *avg_dist) {
 }
 
 void KMeans::Update(void) {
-  float **sums = new float *[num_clusters_];
-  for (int c = 0; c < num_clusters_; ++c) {
-    sums[c] = new float[dim_];
-    for (int d = 0; d < dim_; ++d) {
-      sums[c][d] = 0;
-    }
-    cluster_sizes_[c] = 0;
+  for (int i = 1; i < num_threads_; ++i) {
+    threads_[i]->RunUpdate();
   }
-  for (int o = 0; o < num_objects_; ++o) {
-    int c = assignments_[o];
-    // During initialization we will assign some objects to cluster -1
-    // meaning they are unassigned
-    if (c == -1) continue;
-    float *obj = objects_[o];
-    for (int d = 0; d < dim_; ++d) {
-      sums[c][d] += obj[d];
-    }
-    ++cluster_sizes_[c];
+  // Execute thread 0 in main execution thread
+  threads_[0]->Update();
+  for (int i = 1; i < num_threads_; ++i) {
+    threads_[i]->Join();
   }
-  for (int c = 0; c < num_clusters_; ++c) {
-    if (cluster_sizes_[c] > 0) {
-      for (int d = 0; d < dim_; ++d) {
-	means_[c][d] = sums[c][d] / cluster_sizes_[c];
+  if (drifts_) {
+    // BoundedNearest() loosens each lower bound by the largest drift of any
+    // cluster other than the object's own.  Empty clusters are never
+    // candidates so their drift doesn't matter.
+    max_drift_ = 0;
+    second_max_drift_ = 0;
+    max_drift_c_ = -1;
+    for (int c = 0; c < num_clusters_; ++c) {
+      if (cluster_sizes_[c] == 0) continue;
+      float drift = drifts_[c];
+      if (drift > max_drift_) {
+	second_max_drift_ = max_drift_;
+	max_drift_ = drift;
+	max_drift_c_ = c;
+      } else if (drift > second_max_drift_) {
+	second_max_drift_ = drift;
       }
-    } else {
-      for (int d = 0; d < dim_; ++d) means_[c][d] = 0;
     }
-    delete [] sums[c];
   }
-  delete [] sums;
 }
 
 void KMeans::EliminateEmpty(void) {
@@ -786,8 +870,8 @@ void KMeans::EliminateEmpty(void) {
     if (cluster_sizes_[j] > 0) {
       mapping[j] = i;
       cluster_sizes_[i] = cluster_sizes_[j];
-      for (int d = 0; d < dim_; ++d) {
-	means_[i][d] = means_[j][d];
+      for (int d = 0; d < stride_; ++d) {
+	means_[(size_t)i * stride_ + d] = means_[(size_t)j * stride_ + d];
       }
       ++i;
     }
@@ -822,6 +906,8 @@ void KMeans::Cluster(int num_its) {
 
     if (neighbor_thresh_ > 0) {
       ComputeIntraCentroidDistances();
+    } else {
+      ComputeHalfNearest();
     }
 
     ++it;
@@ -7,40 +7,72 @@ using namespace std;
 
 class KMeansThread;
 
+// Objects and means are stored as one contiguous block of rows.  Each row is Stride(dim) floats
+// long, starts on a 32-byte boundary and is zero padded past dim so that the distance kernel
+// can process whole AVX vectors without a remainder loop.
+//
+// If neighbor_thresh is positive, Assign() searches the sorted neighbor lists of the current
+// cluster.  If neighbor_thresh is zero, Assign() instead maintains a Hamerly-style lower bound on
+// each object's distance to its second nearest centroid and only does a full search for objects
+// whose bounds fail.
 class KMeans {
 public:
-  KMeans(int num_clusters, int dim, int num_objects, float **objects, double neighbor_thresh,
+  KMeans(int num_clusters, int dim, int num_objects, const float *objects, double neighbor_thresh,
 	 int num_threads);
   ~KMeans(void);
   void Cluster(int num_its);
   int Assignment(int o) const {return assignments_[o];}
   int NumClusters(void) const {return num_clusters_;}
   int ClusterSize(int c) const {return cluster_sizes_[c];}
-  void SingleObjectClusters(int num_clusters, int dim, int num_objects, float **objects);
+  void SingleObjectClusters(int dim, int num_objects, const float *objects);
 
-  static const int kMaxNeighbors = 10000;
+  static int Stride(int dim) {return (dim + kFloatsPerVector - 1) & ~(kFloatsPerVector - 1);}
+  // Returns a zeroed, suitably aligned block for num_objects rows.  Release with free().
+  static float *AllocateObjects(int num_objects, int dim);
 
+  static const int kMaxNeighbors = 10000;
+  static const int kFloatsPerVector = 8;
+  // Objects per k-means++ seeding chunk.  Fixed so that seeding does not depend on the number
+  // of threads.
+  static const int kSeedChunkSize = 65536;
 
  protected:
   void ComputeIntraCentroidDistances(void);
-  int Nearest(int o, float *obj) const;
+  void ComputeHalfNearest(void);
   int Assign(double *avg_dist);
   void Update(void);
   void EliminateEmpty(void);
-  int BinarySearch(double r, int begin, int end, double *cum_sq_distance_to_nearest, bool *used);
+  int SampleSeed(void);
   void SeedPlusPlus(void);
   void Seed1();
   void Seed2();
 
+  friend class KMeansThread;
+
   int num_objects_;
   int num_clusters_;
-  float **objects_;
+  const float *objects_;
   int dim_;
+  int stride_;
   double neighbor_thresh_;
   int *cluster_sizes_;
-  float **means_;
+  float *means_;
   int *assignments_;
   vector< pair<float, int> > *neighbor_vectors_;
+  // Only used by the bounds variant of Assign()
+  float *lower_bounds_;
+  float *half_nearest_;
+  float *drifts_;
+  float max_drift_;
+  float second_max_drift_;
+  int max_drift_c_;
+  // Scratch space for Update() and SeedPlusPlus()
+  vector<double> sums_;
+  float *sq_distance_to_nearest_;
+  double *cum_sq_distance_to_nearest_;
+  double *chunk_sums_;
+  int num_chunks_;
+  int seed_c_;
   double intra_time_;
   double assign_time_;
   int num_threads_;
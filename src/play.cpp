@@ -13,6 +13,10 @@
 // In each "duplicate" hand, we play N hands where strategy B is assigned to each of the N
 // positions one-by-one.
 //
+// Duplicate hands are played in parallel.  Hands are dealt from per-block RNG streams and
+// outcomes are summed in block order, so for a given seed the results are the same for any
+// number of threads.
+//
 // If I want to support asymmetric systems again, I may need to go back to having a separate
 // CFRValues object for each position.
 
@@ -23,8 +27,10 @@
 #include <string.h>
 #include <sys/time.h> // gettimeofday()
 
+#include <atomic>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "betting_abstraction.h"
 #include "betting_abstraction_params.h"
@@ -47,11 +53,34 @@
 #include "hand_value_tree.h"
 #include "io.h"
 #include "params.h"
-#include "rand.h"
+#include "sampler.h"
 #include "sorting.h"
 
 using std::string;
 using std::unique_ptr;
+using std::vector;
+
+
+// Duplicate hands are dealt in blocks of kHandsPerBlock.  Each block gets its own RNG stream,
+// seeded from the block index, so the hands dealt (and therefore the results) do not depend on
+// which thread plays a block or on the number of threads.
+static const unsigned long long int kHandsPerBlock = 1024;
+// Blocks are played in rounds of kBlocksPerRound.  After each round we print a running
+// confidence interval and check whether we have reached the target standard error.
+static const int kBlocksPerRound = 64;
+
+// Mixes the seed and the block index with splitmix64.  Simply adding them would make block b of
+// a run seeded with s the same as block b + d of a run seeded with s - d; e.g., two runs seeded
+// from the clock a few milliseconds apart.
+static unsigned long long int BlockSeed(unsigned long long int seed,
+					unsigned long long int block) {
+  unsigned long long int z = seed ^ (block * 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+class PlayerThread;
 
 class Player {
 public:
@@ -59,13 +88,10 @@ public:
 	 const CardAbstraction &a_ca, const CardAbstraction &b_ca, const CFRConfig &a_cc,
 	 const CFRConfig &b_cc, int a_it, int b_it);
   ~Player(void);
-  void Go(unsigned long long int num_duplicate_hands);
+  void Go(unsigned long long int num_duplicate_hands, int num_threads, double target_std_err,
+	  unsigned long long int seed);
 private:
-  void DealNCards(Card *cards, int n);
-  void SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board);
-  void Play(Node **nodes, int b_pos, int *contributions, int last_bet_to, bool *folded,
-	    int num_remaining, int last_player_acting, int last_st, double *outcomes);
-  void PlayDuplicateHand(unsigned long long int h, const Card *cards, double *a_sum, double *b_sum);
+  friend class PlayerThread;
 
   int num_players_;
   bool a_asymmetric_;
@@ -76,17 +102,59 @@ private:
   const Buckets *b_buckets_;
   unique_ptr<CFRValues> a_probs_;
   unique_ptr<CFRValues> b_probs_;
+  unsigned short **sorted_hcps_;
+  unsigned long long int num_duplicate_hands_;
+  unsigned long long int seed_;
+  // The blocks of the current round.  Threads claim blocks by incrementing next_block_ and
+  // write each block's sums into its own slot, so no locking is needed.
+  unsigned long long int round_first_block_;
+  int round_num_blocks_;
+  std::atomic<int> next_block_;
+  unique_ptr<double []> block_sum_a_outcomes_;
+  unique_ptr<double []> block_sum_b_outcomes_;
+  unique_ptr<double []> block_sum_sqd_b_outcomes_;
+  // Indexed by block * num_players_ + position
+  unique_ptr<double []> block_sum_pos_outcomes_;
+};
+
+// A PlayerThread plays blocks of duplicate hands.  The betting trees, buckets and strategies
+// belong to the Player and are shared read-only; the per-hand state is private to the thread.
+class PlayerThread {
+public:
+  PlayerThread(Player *player);
+  ~PlayerThread(void);
+  void Go(void);
+  void RunThread(void);
+  void Join(void);
+private:
+  void DealNCards(Card *cards, int n);
+  void SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board);
+  void Play(Node **nodes, int b_pos, int *contributions, int last_bet_to, bool *folded,
+	    int num_remaining, int last_player_acting, int last_st, double *outcomes);
+  void PlayDuplicateHand(unsigned long long int h, const Card *cards, double *a_sum, double *b_sum);
+  void PlayBlock(int i);
+
+  Player *player_;
+  int num_players_;
+  const BettingTrees *a_betting_trees_;
+  const BettingTrees *b_betting_trees_;
+  const Buckets *a_buckets_;
+  const Buckets *b_buckets_;
+  const CFRValues *a_probs_;
+  const CFRValues *b_probs_;
+  unsigned short **sorted_hcps_;
   int *boards_;
   int **raw_hcps_;
   unique_ptr<int []> hvs_;
   unique_ptr<bool []> winners_;
-  unsigned short **sorted_hcps_;
   unique_ptr<double []> sum_pos_outcomes_;
-  struct drand48_data rand_buf_;
+  RNG rng_;
+  pthread_t pthread_id_;
 };
 
-void Player::Play(Node **nodes, int b_pos, int *contributions, int last_bet_to, bool *folded,
-		  int num_remaining, int last_player_acting, int last_st, double *outcomes) {
+void PlayerThread::Play(Node **nodes, int b_pos, int *contributions, int last_bet_to,
+			bool *folded, int num_remaining, int last_player_acting, int last_st,
+			double *outcomes) {
   Node *p0_node = nodes[0];
   if (p0_node->Terminal()) {
     if (num_remaining == 1) {
@@ -206,8 +274,7 @@ void Player::Play(Node **nodes, int b_pos, int *contributions, int last_bet_to,
     if (num_succs == 1) {
       s = 0;
     } else {
-      double r;
-      drand48_r(&rand_buf_, &r);
+      double r = rng_.RandZeroToOne();
     
       double cum = 0;
       unique_ptr<double []> probs(new double[num_succs]);
@@ -281,8 +348,8 @@ static int PrecedingPlayer(int p) {
 
 // Play one hand of duplicate, which is a pair of regular hands.  Return
 // outcome from A's perspective.
-void Player::PlayDuplicateHand(unsigned long long int h, const Card *cards, double *a_sum,
-			       double *b_sum) {
+void PlayerThread::PlayDuplicateHand(unsigned long long int h, const Card *cards,
+				     double *a_sum, double *b_sum) {
   unique_ptr<double []> outcomes(new double[num_players_]);
   unique_ptr<int []> contributions(new int[num_players_]);
   unique_ptr<bool []> folded(new bool[num_players_]);
@@ -318,26 +385,12 @@ void Player::PlayDuplicateHand(unsigned long long int h, const Card *cards, doub
   }
 }
 
-void Player::DealNCards(Card *cards, int n) {
-  int max_card = Game::MaxCard();
-  for (int i = 0; i < n; ++i) {
-    Card c;
-    while (true) {
-      // c = RandBetween(0, max_card);
-      double r;
-      drand48_r(&rand_buf_, &r);
-      c = (max_card + 1) * r;
-      int j;
-      for (j = 0; j < i; ++j) {
-	if (cards[j] == c) break;
-      }
-      if (j == i) break;
-    }
-    cards[i] = c;
-  }
+void PlayerThread::DealNCards(Card *cards, int n) {
+  unsigned long long int deck = FullDeck();
+  DealCards(&rng_, n, &deck, cards);
 }
 
-void Player::SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board) {
+void PlayerThread::SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board) {
   int max_street = Game::MaxStreet();
   for (int st = 0; st <= max_street; ++st) {
     if (st == 0) {
@@ -369,9 +422,17 @@ void Player::SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board) {
   }
 }
 
-void Player::Go(unsigned long long int num_duplicate_hands) {
-  double sum_a_outcomes = 0, sum_b_outcomes = 0;
-  double sum_sqd_a_outcomes = 0, sum_sqd_b_outcomes = 0;
+// Plays the ith block of the current round and records its outcomes in the Player.
+void PlayerThread::PlayBlock(int i) {
+  unsigned long long int block = player_->round_first_block_ + i;
+  unsigned long long int begin_h = block * kHandsPerBlock;
+  unsigned long long int end_h = begin_h + kHandsPerBlock;
+  if (end_h > player_->num_duplicate_hands_) end_h = player_->num_duplicate_hands_;
+  rng_.Seed(BlockSeed(player_->seed_, block));
+  for (int p = 0; p < num_players_; ++p) {
+    sum_pos_outcomes_[p] = 0;
+  }
+  double sum_a_outcomes = 0, sum_b_outcomes = 0, sum_sqd_b_outcomes = 0;
   int max_street = Game::MaxStreet();
   int num_board_cards = Game::NumBoardCards(max_street);
   Card cards[100], hand_cards[7];
@@ -379,10 +440,7 @@ void Player::Go(unsigned long long int num_duplicate_hands) {
   for (int p = 0; p < num_players_; ++p) {
     hole_cards[p] = new Card[2];
   }
-  struct timeval time; 
-  gettimeofday(&time, NULL);
-  srand48_r((time.tv_sec * 1000) + (time.tv_usec / 1000), &rand_buf_);
-  for (unsigned long long int h = 0; h < num_duplicate_hands; ++h) {
+  for (unsigned long long int h = begin_h; h < end_h; ++h) {
     // Assume 2 hole cards
     DealNCards(cards, num_board_cards + 2 * num_players_);
 #if 0
@@ -422,44 +480,171 @@ void Player::Go(unsigned long long int num_duplicate_hands) {
     PlayDuplicateHand(h, cards, &a_outcome, &b_outcome);
     sum_a_outcomes += a_outcome;
     sum_b_outcomes += b_outcome;
-    sum_sqd_a_outcomes += a_outcome * a_outcome;
     sum_sqd_b_outcomes += b_outcome * b_outcome;
   }
   for (int p = 0; p < num_players_; ++p) {
     delete [] hole_cards[p];
   }
   delete [] hole_cards;
+
+  player_->block_sum_a_outcomes_[i] = sum_a_outcomes;
+  player_->block_sum_b_outcomes_[i] = sum_b_outcomes;
+  player_->block_sum_sqd_b_outcomes_[i] = sum_sqd_b_outcomes;
+  for (int p = 0; p < num_players_; ++p) {
+    player_->block_sum_pos_outcomes_[i * num_players_ + p] = sum_pos_outcomes_[p];
+  }
+}
+
+void PlayerThread::Go(void) {
+  while (true) {
+    int i = player_->next_block_.fetch_add(1, std::memory_order_relaxed);
+    if (i >= player_->round_num_blocks_) break;
+    PlayBlock(i);
+  }
+}
+
+static void *player_thread_run(void *v_t) {
+  PlayerThread *t = (PlayerThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void PlayerThread::RunThread(void) {
+  pthread_create(&pthread_id_, NULL, player_thread_run, this);
+}
+
+void PlayerThread::Join(void) {
+  pthread_join(pthread_id_, NULL);
+}
+
+PlayerThread::PlayerThread(Player *player) : player_(player) {
+  num_players_ = player->num_players_;
+  a_betting_trees_ = player->a_betting_trees_.get();
+  b_betting_trees_ = player->b_betting_trees_.get();
+  a_buckets_ = player->a_buckets_;
+  b_buckets_ = player->b_buckets_;
+  a_probs_ = player->a_probs_.get();
+  b_probs_ = player->b_probs_.get();
+  sorted_hcps_ = player->sorted_hcps_;
+  hvs_.reset(new int[num_players_]);
+  winners_.reset(new bool[num_players_]);
+  sum_pos_outcomes_.reset(new double[num_players_]);
+  int max_street = Game::MaxStreet();
+  boards_ = new int[max_street + 1];
+  boards_[0] = 0;
+  raw_hcps_ = new int *[num_players_];
+  for (int p = 0; p < num_players_; ++p) {
+    raw_hcps_[p] = new int[max_street + 1];
+  }
+}
+
+PlayerThread::~PlayerThread(void) {
+  delete [] boards_;
+  for (int p = 0; p < num_players_; ++p) {
+    delete [] raw_hcps_[p];
+  }
+  delete [] raw_hcps_;
+}
+
+// Mean and standard error of B's outcome in mbb/g.  sum_b_outcomes and sum_sqd_b_outcomes are
+// sums over duplicate hands of B's total outcome (across all positions) and of its square.
+static void BOutcomeStats(double sum_b_outcomes, double sum_sqd_b_outcomes,
+			  unsigned long long int num_duplicate_hands, int num_players,
+			  double *mbb_g, double *std_err) {
+  double n = num_duplicate_hands;
+  double mean = sum_b_outcomes / n;
+  // Variance is the mean of the squares minus the square of the means
+  double var = sum_sqd_b_outcomes / n - mean * mean;
+  if (var < 0) var = 0;
+  // Divide by num_players because we evaluate B that many times (once for each position).
+  // Need to divide by two to convert from small blind units to big blind units.
+  // Multiply by 1000 to go from big blinds to milli-big-blinds.
+  double scale = 1000.0 / (2.0 * num_players);
+  *mbb_g = mean * scale;
+  *std_err = sqrt(var / n) * scale;
+}
+
+// If target_std_err is positive, we stop early once the standard error of B's outcome (in mbb/g)
+// falls to target_std_err or below.  We only check at the end of a round so that when we stop
+// does not depend on the number of threads either.
+void Player::Go(unsigned long long int num_duplicate_hands, int num_threads,
+		double target_std_err, unsigned long long int seed) {
+  num_duplicate_hands_ = num_duplicate_hands;
+  seed_ = seed;
+  unsigned long long int num_blocks = (num_duplicate_hands + kHandsPerBlock - 1) / kHandsPerBlock;
+  block_sum_a_outcomes_.reset(new double[kBlocksPerRound]);
+  block_sum_b_outcomes_.reset(new double[kBlocksPerRound]);
+  block_sum_sqd_b_outcomes_.reset(new double[kBlocksPerRound]);
+  block_sum_pos_outcomes_.reset(new double[kBlocksPerRound * num_players_]);
+  if (num_threads < 1) {
+    fprintf(stderr, "Player::Go: bad num threads %i\n", num_threads);
+    exit(-1);
+  }
+  vector< unique_ptr<PlayerThread> > threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new PlayerThread(this));
+  }
+
+  double sum_a_outcomes = 0, sum_b_outcomes = 0, sum_sqd_b_outcomes = 0;
+  unique_ptr<double []> sum_pos_outcomes(new double[num_players_]);
+  for (int p = 0; p < num_players_; ++p) {
+    sum_pos_outcomes[p] = 0;
+  }
+  unsigned long long int num_played = 0;
+  double b_mbb_g = 0, std_err = 0;
+  for (round_first_block_ = 0; round_first_block_ < num_blocks;
+       round_first_block_ += kBlocksPerRound) {
+    if (round_first_block_ + kBlocksPerRound <= num_blocks) {
+      round_num_blocks_ = kBlocksPerRound;
+    } else {
+      round_num_blocks_ = num_blocks - round_first_block_;
+    }
+    next_block_ = 0;
+    for (int t = 1; t < num_threads; ++t) {
+      threads[t]->RunThread();
+    }
+    // Execute thread 0 in main execution thread
+    threads[0]->Go();
+    for (int t = 1; t < num_threads; ++t) {
+      threads[t]->Join();
+    }
+    // Sum in block order so the result does not depend on the number of threads
+    for (int i = 0; i < round_num_blocks_; ++i) {
+      sum_a_outcomes += block_sum_a_outcomes_[i];
+      sum_b_outcomes += block_sum_b_outcomes_[i];
+      sum_sqd_b_outcomes += block_sum_sqd_b_outcomes_[i];
+      for (int p = 0; p < num_players_; ++p) {
+	sum_pos_outcomes[p] += block_sum_pos_outcomes_[i * num_players_ + p];
+      }
+    }
+    num_played = (round_first_block_ + round_num_blocks_) * kHandsPerBlock;
+    if (num_played > num_duplicate_hands) num_played = num_duplicate_hands;
+    BOutcomeStats(sum_b_outcomes, sum_sqd_b_outcomes, num_played, num_players_, &b_mbb_g,
+		  &std_err);
+    fprintf(stderr, "%llu dup hands: B %.1f mbb/g (%.1f-%.1f)\n", num_played, b_mbb_g,
+	    b_mbb_g - 1.96 * std_err, b_mbb_g + 1.96 * std_err);
+    if (target_std_err > 0 && std_err <= target_std_err) {
+      fprintf(stderr, "Reached target std err %f\n", target_std_err);
+      break;
+    }
+  }
 #if 0
   unsigned long long int num_a_hands =
-    (num_players_ - 1) * num_players_ * num_duplicate_hands;
+    (num_players_ - 1) * num_players_ * num_played;
   double mean_a_outcome = sum_a_outcomes / (double)num_a_hands;
 #endif
   // Divide by num_players because we evaluate B that many times (once for
   // each position).
-  unsigned long long int num_b_hands = num_duplicate_hands * num_players_;
+  unsigned long long int num_b_hands = num_played * num_players_;
   double mean_b_outcome = sum_b_outcomes / (double)num_b_hands;
-  // Need to divide by two to convert from small blind units to big blind units
-  // Multiply by 1000 to go from big blinds to milli-big-blinds
-  double b_mbb_g = (mean_b_outcome / 2.0) * 1000.0;
   fprintf(stderr, "Avg B outcome: %f (%.1f mbb/g) over %llu dup hands\n", mean_b_outcome, b_mbb_g,
-	  num_duplicate_hands);
-  // Variance is the mean of the squares minus the square of the means
-  double var_b =
-    (sum_sqd_b_outcomes / ((double)num_b_hands)) -
-    (mean_b_outcome * mean_b_outcome);
-  double stddev_b = sqrt(var_b);
-  double match_stddev = stddev_b * sqrt(num_b_hands);
-  double match_lower = sum_b_outcomes - 1.96 * match_stddev;
-  double match_upper = sum_b_outcomes + 1.96 * match_stddev;
-  double mbb_lower =
-    ((match_lower / (num_b_hands)) / 2.0) * 1000.0;
-  double mbb_upper =
-    ((match_upper / (num_b_hands)) / 2.0) * 1000.0;
-  fprintf(stderr, "MBB confidence interval: %f-%f\n", mbb_lower, mbb_upper);
+	  num_played);
+  fprintf(stderr, "MBB confidence interval: %f-%f\n", b_mbb_g - 1.96 * std_err,
+	  b_mbb_g + 1.96 * std_err);
 
   for (int p = 0; p < num_players_; ++p) {
     double avg_outcome =
-      sum_pos_outcomes_[p] / (double)(num_players_ * num_duplicate_hands);
+      sum_pos_outcomes[p] / (double)(num_players_ * num_played);
     fprintf(stderr, "Avg P%u outcome: %f\n", p, avg_outcome);
   }
 }
@@ -474,9 +659,6 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
     b_buckets_ = a_buckets_;
   }
   num_players_ = Game::NumPlayers();
-  hvs_.reset(new int[num_players_]);
-  winners_.reset(new bool[num_players_]);
-  sum_pos_outcomes_.reset(new double[num_players_]);
   BoardTree::Create();
   BoardTree::CreateLookup();
 
@@ -526,13 +708,6 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
 #endif
 
   int max_street = Game::MaxStreet();
-  boards_ = new int[max_street + 1];
-  boards_[0] = 0;
-  raw_hcps_ = new int *[num_players_];
-  for (int p = 0; p < num_players_; ++p) {
-    raw_hcps_[p] = new int[max_street + 1];
-  }
-
   if (a_buckets_->None(max_street) || b_buckets_->None(max_street)) {
     int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
     int num_boards = BoardTree::NumBoards(max_street);
@@ -563,10 +738,6 @@ Player::Player(const BettingAbstraction &a_ba, const BettingAbstraction &b_ba,
     sorted_hcps_ = nullptr;
     fprintf(stderr, "Not creating sorted_hcps_\n");
   }
-
-  for (int p = 0; p < num_players_; ++p) {
-    sum_pos_outcomes_[p] = 0;
-  }
 }
 
 Player::~Player(void) {
@@ -578,11 +749,6 @@ Player::~Player(void) {
     }
     delete [] sorted_hcps_;
   }
-  delete [] boards_;
-  for (int p = 0; p < num_players_; ++p) {
-    delete [] raw_hcps_[p];
-  }
-  delete [] raw_hcps_;
   if (b_buckets_ != a_buckets_) delete b_buckets_;
   delete a_buckets_;
 }
@@ -590,12 +756,15 @@ Player::~Player(void) {
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <A card params> <B card params> "
 	  "<A betting abstraction params> <B betting abstraction params> <A CFR params> "
-	  "<B CFR params> <A it> <B it> <num duplicate hands>\n", prog_name);
+	  "<B CFR params> <A it> <B it> <num duplicate hands> <num threads> <target std err> "
+	  "[deterministic|nondeterministic]\n", prog_name);
+  fprintf(stderr, "\n");
+  fprintf(stderr, "<target std err> is in mbb/g; specify 0 to play all the hands\n");
   exit(-1);
 }
 
 int main(int argc, char *argv[]) {
-  if (argc != 11) Usage(argv[0]);
+  if (argc != 14) Usage(argv[0]);
   Files::Init();
   unique_ptr<Params> game_params = CreateGameParams();
   game_params->ReadFromFile(argv[1]);
@@ -630,12 +799,25 @@ int main(int argc, char *argv[]) {
   if (sscanf(argv[9], "%i", &b_it) != 1) Usage(argv[0]);
   unsigned long long int num_duplicate_hands;
   if (sscanf(argv[10], "%llu", &num_duplicate_hands) != 1) Usage(argv[0]);
+  int num_threads;
+  if (sscanf(argv[11], "%i", &num_threads) != 1) Usage(argv[0]);
+  if (num_threads < 1)                           Usage(argv[0]);
+  double target_std_err;
+  if (sscanf(argv[12], "%lf", &target_std_err) != 1) Usage(argv[0]);
+  unsigned long long int seed = 0;
+  string da = argv[13];
+  if (da == "deterministic") {
+    seed = 0;
+  } else if (da == "nondeterministic") {
+    struct timeval time; 
+    gettimeofday(&time, NULL);
+    seed = (time.tv_sec * 1000) + (time.tv_usec / 1000);
+  } else {
+    Usage(argv[0]);
+  }
   HandValueTree::Create();
 
-  // Leave this in if we don't want reproducibility
-  InitRand();
-
   Player player(*a_betting_abstraction, *b_betting_abstraction, *a_card_abstraction,
 		*b_card_abstraction, *a_cfr_config, *b_cfr_config, a_it, b_it);
-  player.Go(num_duplicate_hands);
+  player.Go(num_duplicate_hands, num_threads, target_std_err, seed);
 }
@@ -49,23 +49,121 @@ RGBR::RGBR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
     }
   }
 
+  trees_target_p_ = -1;
+  next_job_ = 0;
+
   BoardTree::Create();
 }
 
 RGBR::~RGBR(void) {
 }
 
+RGBRJob::RGBRJob(Node *p0_node, Node *p1_node, int pgbd, const VCFRState &pred_state,
+		 const int *prev_canons) :
+  VCFRJob(BoardTree::SuccBoardBegin(p0_node->Street() - 1, pgbd, p0_node->Street()),
+	  BoardTree::SuccBoardEnd(p0_node->Street() - 1, pgbd, p0_node->Street())),
+  p0_node_(p0_node), p1_node_(p1_node), pgbd_(pgbd) {
+  notify_finished_ = true;
+  finished_.store(false, std::memory_order_relaxed);
+  // The predecessor state lives on the stack of the trunk traversal, so we need our own copy of
+  // the opponent reach probabilities.
+  int max_card1 = Game::MaxCard() + 1;
+  int num_enc = Game::NumCardsForStreet(0) == 1 ? max_card1 : max_card1 * max_card1;
+  opp_probs_.reset(new double[num_enc]);
+  memcpy(opp_probs_.get(), pred_state.OppProbs(), num_enc * sizeof(double));
+  state_.reset(new VCFRState(pred_state.P(), opp_probs_.get(), pred_state.GetHandTree(),
+			     pred_state.ActionSequence(), nullptr));
+  int num_encodings = max_card1 * max_card1;
+  prev_canons_.reset(new int[num_encodings]);
+  memcpy(prev_canons_.get(), prev_canons, num_encodings * sizeof(int));
+  int prev_num_hole_card_pairs = Game::NumHoleCardPairs(p0_node->Street() - 1);
+  vals_.reset(new double[prev_num_hole_card_pairs]);
+  for (int i = 0; i < prev_num_hole_card_pairs; ++i) vals_[i] = 0;
+}
+
+RGBRJob::~RGBRJob(void) {
+}
+
+// Called on the split street from VCFR::StreetInitial().  On the first pass over the trunk we
+// queue up the boards under this node and return right away, leaving vals zero.  On the second
+// pass we return the values the first pass computed.  The two passes visit the split-street nodes
+// in the same order.  Later streets are split as usual.
+void RGBR::Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state, int *prev_canons,
+		 double *vals) {
+  int nst = p0_node->Street();
+  if (nst != split_street_) {
+    VCFR::Split(p0_node, p1_node, pgbd, state, prev_canons, vals);
+    return;
+  }
+  if (pre_phase_) {
+    RGBRJob *job = new RGBRJob(p0_node, p1_node, pgbd, *state, prev_canons);
+    jobs_.emplace_back(job);
+    int pst = nst - 1;
+    int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
+    int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+    int t = WorkerIndex();
+    num_pending_.fetch_add(ngbd_end - ngbd_begin, std::memory_order_relaxed);
+    for (int ngbd = ngbd_end - 1; ngbd >= ngbd_begin; --ngbd) {
+      workers_[t]->Push(VCFRTask(p0_node, p1_node, ngbd, &job->State(), job));
+    }
+    NotifyWorkers();
+    return;
+  }
+  if (next_job_ >= jobs_.size()) {
+    fprintf(stderr, "RGBR::Split: no job for street %i node\n", nst);
+    exit(-1);
+  }
+  RGBRJob *job = jobs_[next_job_++].get();
+  if (job->P0Node() != p0_node || job->P1Node() != p1_node || job->PGBD() != pgbd) {
+    fprintf(stderr, "RGBR::Split: job mismatch on street %i\n", nst);
+    exit(-1);
+  }
+  int prev_num_hole_card_pairs = Game::NumHoleCardPairs(nst - 1);
+  const double *job_vals = job->Vals();
+  for (int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = job_vals[i];
+}
+
+// Combines the board values in board order, exactly as VCFR::Split() would, and releases them.
+void RGBR::JobFinished(VCFRJob *job) {
+  RGBRJob *rgbr_job = static_cast<RGBRJob *>(job);
+  int nst = rgbr_job->P0Node()->Street();
+  int pst = nst - 1;
+  int pgbd = rgbr_job->PGBD();
+  int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
+  int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+  const VCFRState &state = rgbr_job->State();
+  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+    AccumulateBoardVals(nst, ngbd, state.Hands(nst, ngbd), rgbr_job->PrevCanons(),
+			job->BoardVals(ngbd).get(), rgbr_job->Vals());
+  }
+  job->ClearBoardVals();
+  rgbr_job->SetFinished();
+}
+
+// Helps process boards until every job queued on the first pass has been combined.
+void RGBR::WaitForJobs(void) {
+  int t = WorkerIndex();
+  size_t num_jobs = jobs_.size();
+  for (size_t j = 0; j < num_jobs; ++j) HelpUntilDone(t, *jobs_[j]);
+}
+
 double RGBR::Go(int it, int p, const BettingAbstraction &ba) {
   it_ = it;
   // If P0 is the best-responder, then we will want sumprobs generated in
   // the P1 CFR run.
   target_p_ = p^1;
 
+  // The betting trees are reused when we evaluate the other player or another checkpoint.
   asymmetric_ = ba.Asymmetric();
-  if (asymmetric_) {
-    betting_trees_.reset(new BettingTrees(ba, target_p_));
-  } else {
-    betting_trees_.reset(new BettingTrees(ba));
+  if (! betting_trees_ || ba.BettingAbstractionName() != betting_abstraction_name_ ||
+      (asymmetric_ && target_p_ != trees_target_p_)) {
+    if (asymmetric_) {
+      betting_trees_.reset(new BettingTrees(ba, target_p_));
+    } else {
+      betting_trees_.reset(new BettingTrees(ba));
+    }
+    betting_abstraction_name_ = ba.BettingAbstractionName();
+    trees_target_p_ = target_p_;
   }
 
   char dir[500];
@@ -120,31 +218,27 @@ double RGBR::Go(int it, int p, const BettingAbstraction &ba) {
 
   delete [] streets;
 
-  // Some of this logic is replicated in CFRP::HalfIteration().
-
-#if 0
-  if (subgame_street_ >= 0 && subgame_street_ <= max_street) {
-    // subgame_running_ should be false for all threads
-    // active_subgames_ should be nullptr for all threads
-    for (int t = 0; t < num_threads_; ++t) {
-      int ret = sem_post(&available_);
-      if (ret != 0) {
-	fprintf(stderr, "sem_post failed\n");
-	exit(-1);
-      }
-    }
+  // With multiple threads we make two passes over the trunk.  The first pass computes the
+  // opponent reach probabilities at every split-street street-initial node and queues up all the
+  // boards under all of those nodes (see Split()).  Threads steal boards from anywhere in the
+  // tree, and turn boards get split further, rather than everyone waiting at each flop node for
+  // the last of its boards.  The second pass picks up the combined values.  The trunk is cheap
+  // compared to what lies below the split street.
+  bool two_pass = num_threads_ > 1 && subgame_street_ == -1 && split_street_ <= max_street;
+  if (two_pass) {
+    pre_phase_ = true;
+    ProcessRoot(betting_trees_.get(), p, hand_tree_.get());
+    WaitForJobs();
+    pre_phase_ = false;
+    next_job_ = 0;
   }
-#endif
-
-  // if (subgame_street_ >= 0 && subgame_street_ <= max_street) pre_phase_ = true;
   shared_ptr<double []> vals = ProcessRoot(betting_trees_.get(), p, hand_tree_.get());
-#if 0
-  if (subgame_street_ >= 0 && subgame_street_ <= max_street) {
-    WaitForFinalSubgames();
-    pre_phase_ = false;
-    vals = ProcessRoot(betting_trees_.get(), p, hand_tree_.get());
+  if (next_job_ != jobs_.size()) {
+    fprintf(stderr, "RGBR::Go: only %zu of %zu jobs used\n", next_job_, jobs_.size());
+    exit(-1);
   }
-#endif
+  jobs_.clear();
+  next_job_ = 0;
   
   int num_hole_card_pairs = Game::NumHoleCardPairs(0);
 
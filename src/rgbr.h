@@ -1,12 +1,47 @@
 #ifndef _RGBR_H_
 #define _RGBR_H_
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 #include "cfrp.h"
 
 class BettingAbstraction;
 class Buckets;
 class CardAbstraction;
 class CFRConfig;
+class VCFRState;
+
+// The boards under one split-street street-initial node.  Created during the first pass over the
+// trunk (see RGBR::Go()); holds the opponent reach probabilities at the node so that the boards
+// can be processed after the trunk traversal has moved on.  The thread that finishes the last
+// board combines the board values into vals_ and releases them.
+class RGBRJob : public VCFRJob {
+public:
+  RGBRJob(Node *p0_node, Node *p1_node, int pgbd, const VCFRState &pred_state,
+	  const int *prev_canons);
+  ~RGBRJob(void);
+  Node *P0Node(void) const {return p0_node_;}
+  Node *P1Node(void) const {return p1_node_;}
+  int PGBD(void) const {return pgbd_;}
+  const VCFRState &State(void) const {return *state_;}
+  const int *PrevCanons(void) const {return prev_canons_.get();}
+  double *Vals(void) const {return vals_.get();}
+  void SetFinished(void) {finished_.store(true, std::memory_order_release);}
+  bool Finished(void) const {return finished_.load(std::memory_order_acquire);}
+  // Done only once RGBR::JobFinished() has combined the board values.
+  bool Done(void) const {return Finished();}
+private:
+  Node *p0_node_;
+  Node *p1_node_;
+  int pgbd_;
+  std::unique_ptr<double []> opp_probs_;
+  std::unique_ptr<VCFRState> state_;
+  std::unique_ptr<int []> prev_canons_;
+  std::unique_ptr<double []> vals_;
+  std::atomic<bool> finished_;
+};
 
 class RGBR : public CFRP {
 public:
@@ -15,7 +50,17 @@ public:
   virtual ~RGBR(void);
   double Go(int it, int p, const BettingAbstraction &ba);
  private:
+  void Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state, int *prev_canons,
+	     double *vals);
+  void JobFinished(VCFRJob *job);
+  void WaitForJobs(void);
+
   bool quantize_;
+  // The target player the betting trees were built for; only matters if asymmetric.
+  int trees_target_p_;
+  // Split-street jobs in the order the trunk traversal encounters them
+  std::vector< std::unique_ptr<RGBRJob> > jobs_;
+  size_t next_job_;
 };
 
 #endif
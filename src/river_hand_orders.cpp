@@ -0,0 +1,39 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+
+#include "board_tree.h"
+#include "files.h"
+#include "game.h"
+#include "io.h"
+#include "river_hand_orders.h"
+
+using std::unique_ptr;
+
+int RiverHandOrders::num_hands_ = 0;
+unique_ptr<MappedFile> RiverHandOrders::file_;
+const unsigned short *RiverHandOrders::orders_ = nullptr;
+
+void RiverHandOrders::Filename(char *buf) {
+  sprintf(buf, "%s/river_hand_orders.%s.%i.%i.%i", Files::StaticBase(),
+	  Game::GameName().c_str(), Game::NumRanks(), Game::NumSuits(), Game::MaxStreet());
+}
+
+void RiverHandOrders::Create(void) {
+  if (orders_ != nullptr) return;
+  char buf[500];
+  Filename(buf);
+  if (! FileExists(buf)) return;
+  file_.reset(new MappedFile(buf, false, false));
+  const int *header = (const int *)file_->Data();
+  long long int num_boards = BoardTree::NumBoards(Game::MaxStreet());
+  if (file_->Size() < 2 * (long long int)sizeof(int) || header[0] != num_boards ||
+      file_->Size() != 2 * (long long int)sizeof(int) +
+      num_boards * 2 * header[1] * (long long int)sizeof(unsigned short)) {
+    fprintf(stderr, "RiverHandOrders::Create: unexpected size or header of %s\n", buf);
+    exit(-1);
+  }
+  num_hands_ = header[1];
+  orders_ = (const unsigned short *)(header + 2);
+}
@@ -0,0 +1,39 @@
+#ifndef _RIVER_HAND_ORDERS_H_
+#define _RIVER_HAND_ORDERS_H_
+
+#include <memory>
+
+class MappedFile;
+
+// For each river board, the order in which SortByHandStrength() puts the board's hands (as
+// indices into the unsorted CanonicalCards hands) and the rank of each hand in that order
+// (0 for the weakest; tied hands have the same rank, so the ties that Showdown() groups together
+// are the runs of equal ranks).  Written by build_river_hand_orders.  The file holds two ints
+// (the number of river boards and the number of hands per board) followed by, for each board,
+// num_hands unsigned shorts of order and then num_hands unsigned shorts of rank.  It is memory
+// mapped, so all processes on a machine share one copy.
+//
+// HandTree uses these instead of evaluating and sorting the hands when the file exists.
+class RiverHandOrders {
+public:
+  // Maps the file if it exists.  Requires the board tree.  Not thread-safe; the hands cache in
+  // hand_tree.cpp calls it exactly once, when it builds the first river hands.
+  static void Create(void);
+  static bool Created(void) {return orders_ != nullptr;}
+  static const unsigned short *Order(int gbd) {
+    return orders_ + 2LL * gbd * num_hands_;
+  }
+  static const unsigned short *Ranks(int gbd) {
+    return orders_ + (2LL * gbd + 1) * num_hands_;
+  }
+  static int NumHands(void) {return num_hands_;}
+  static void Filename(char *buf);
+private:
+  RiverHandOrders(void) {}
+
+  static int num_hands_;
+  static std::unique_ptr<MappedFile> file_;
+  static const unsigned short *orders_;
+};
+
+#endif
@@ -7,10 +7,12 @@
 // about this.
 
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #include <algorithm>
+#include <memory>
 #include <vector>
 
 #include "board_tree.h"
@@ -19,53 +21,160 @@
 #include "constants.h"
 #include "game.h"
 #include "hand_value_tree.h"
+#include "io.h"
 #include "rollout.h"
 #include "sorting.h"
 
 using std::pair;
+using std::unique_ptr;
 using std::vector;
 
-static short *RiverHandStrength(const Card *board, bool wins) {
+// Postflop boards are computed this many per thread at a time
+static const int kBoardsPerThread = 64;
+
+
+// Per-thread state for computing rollout features.  Scratch space for
+// RiverHandStrength() and for the rollout samples of one board is allocated
+// once and reused for every board.
+class RolloutThread {
+public:
+  RolloutThread(int st, const double *percentiles, int num_percentiles, bool wins,
+		int thread_index, int num_threads);
+  ~RolloutThread(void) {}
+  void SetRound(int begin_bd, int end_bd, short *round_vals);
+  void Go(void);
+  void Run(void);
+  void Join(void);
+  int *WMLCounts(void) const {return wml_counts_.get();}
+private:
+  const short *RiverHandStrength(const Card *board);
+  void Enumerate(int num_board_cards, int end_card, int num_left);
+  void ComputeBoard(int bd, short *pct_vals);
+  void CountPreflop(void);
+
+  int st_;
+  const double *percentiles_;
+  int num_percentiles_;
+  bool wins_;
+  int thread_index_;
+  int num_threads_;
+  int max_card_;
+  int num_enc_;
+  // Number of ways the unordered set of future board cards can be dealt
+  // street by street.  Each set is only evaluated once.
+  int weight_;
+  int max_samples_;
+  Card board_[7];
+  int num_st_board_cards_;
+  std::unique_ptr<pair<int, int> []> hvs_;
+  std::unique_ptr<Card []> hole_cards_;
+  std::unique_ptr<int []> vals_;
+  std::unique_ptr<short []> values_;
+  std::unique_ptr<int []> seen_;
+  std::unique_ptr<int []> beats_;
+  std::unique_ptr<int []> hand_index_;
+  std::unique_ptr<short []> samples_;
+  std::unique_ptr<int []> num_samples_;
+  std::unique_ptr<int []> wml_counts_;
+  int begin_bd_;
+  int end_bd_;
+  short *round_vals_;
+  pthread_t pthread_id_;
+};
+
+static int Choose(int n, int k) {
+  if (k < 0 || k > n) return 0;
+  long long int c = 1;
+  for (int i = 1; i <= k; ++i) c = c * (n - k + i) / i;
+  return c;
+}
+
+RolloutThread::RolloutThread(int st, const double *percentiles, int num_percentiles, bool wins,
+			     int thread_index, int num_threads) :
+  st_(st), percentiles_(percentiles), num_percentiles_(num_percentiles), wins_(wins),
+  thread_index_(thread_index), num_threads_(num_threads) {
+  int max_street = Game::MaxStreet();
+  max_card_ = Game::MaxCard();
+  num_enc_ = (max_card_ + 1) * (max_card_ + 1);
+  int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
+  hvs_.reset(new pair<int, int>[num_hole_card_pairs]);
+  hole_cards_.reset(new Card[2 * num_hole_card_pairs]);
+  vals_.reset(new int[num_hole_card_pairs]);
+  values_.reset(new short[num_enc_]);
+  seen_.reset(new int[max_card_ + 1]);
+  beats_.reset(new int[num_hole_card_pairs]);
+  if (st == 0) {
+    // Preflop pools histograms over every river board instead
+    int num_remaining = Game::NumCardsInDeck() - Game::NumBoardCards(max_street) -
+      Game::NumCardsForStreet(0);
+    int max_wml = num_remaining * (num_remaining - 1) / 2;
+    int num_wmls = 2 * max_wml + 1;
+    wml_counts_.reset(new int[num_enc_ * num_wmls]);
+    for (int i = 0; i < num_enc_ * num_wmls; ++i) wml_counts_[i] = 0;
+    return;
+  }
+  num_st_board_cards_ = Game::NumBoardCards(st);
+  int num_new = Game::NumBoardCards(max_street) - num_st_board_cards_;
+  max_samples_ = Choose(Game::NumCardsInDeck() - num_st_board_cards_, num_new);
+  // num_new! / prod over later streets of (cards on street)!
+  long long int weight = 1;
+  int n = 0;
+  for (int st1 = st + 1; st1 <= max_street; ++st1) {
+    int num_street_cards = Game::NumCardsForStreet(st1);
+    for (int i = 1; i <= num_street_cards; ++i) {
+      ++n;
+      weight = weight * n / i;
+    }
+  }
+  weight_ = weight;
+  hand_index_.reset(new int[num_enc_]);
+  int num_st_hole_card_pairs = Game::NumHoleCardPairs(st);
+  samples_.reset(new short[num_st_hole_card_pairs * max_samples_]);
+  num_samples_.reset(new int[num_st_hole_card_pairs]);
+}
+
+// Returns the strength of every hand on the given river board, indexed by
+// hole card encoding, with 32000 for hands that conflict with the board.
+// Either the number of hands beaten or the number beaten minus the number
+// lost to (WML).
+const short *RolloutThread::RiverHandStrength(const Card *board) {
   int max_street = Game::MaxStreet();
   int num_board_cards = Game::NumBoardCards(max_street);
 
-  vector<int> vb(num_board_cards);
-  for (int i = 0; i < num_board_cards; ++i) vb[i] = board[i];
-  std::sort(vb.begin(), vb.end());
-  int *sorted_board = new int[num_board_cards];
-  for (int i = 0; i < num_board_cards; ++i) {
-    sorted_board[(num_board_cards - 1) - i] = vb[i];
-  }
+  Card sorted_board[7];
+  for (int i = 0; i < num_board_cards; ++i) sorted_board[i] = board[i];
+  std::sort(sorted_board, sorted_board + num_board_cards, [](Card a, Card b) {return a > b;});
   int num_hole_card_pairs = Game::NumHoleCardPairs(max_street);
-  vector< pair<int, int> > v(num_hole_card_pairs);
-  int max_card = Game::MaxCard();
-  int hole_cards[2];
+  int max_card = max_card_;
+  Card *hole_cards = hole_cards_.get();
   int hcp = 0;
   for (int hi = 1; hi <= max_card; ++hi) {
     if (InCards(hi, board, num_board_cards)) continue;
-    hole_cards[0] = hi;
     for (int lo = 0; lo < hi; ++lo) {
       if (InCards(lo, board, num_board_cards)) continue;
-      hole_cards[1] = lo;
-      int hv = HandValueTree::Val(sorted_board, hole_cards);
-      int enc = hi * (max_card + 1) + lo;
-      v[hcp] = std::make_pair(hv, enc);
+      hole_cards[2 * hcp] = hi;
+      hole_cards[2 * hcp + 1] = lo;
       ++hcp;
     }
   }
-  delete [] sorted_board;
-  sort(v.begin(), v.end(), g_pii_lower_compare);
+  int *vals = vals_.get();
+  HandValueTree::Vals(sorted_board, hole_cards, num_hole_card_pairs, vals);
+  pair<int, int> *v = hvs_.get();
+  for (int i = 0; i < num_hole_card_pairs; ++i) {
+    int enc = hole_cards[2 * i] * (max_card + 1) + hole_cards[2 * i + 1];
+    v[i] = std::make_pair(vals[i], enc);
+  }
+  std::sort(v, v + num_hole_card_pairs, g_pii_lower_compare);
 
-  int num_enc = (max_card + 1) * (max_card + 1);
-  short *values = new short[num_enc];
+  short *values = values_.get();
   // Necessary?
-  for (int i = 0; i < num_enc; ++i) values[i] = 32000;
+  for (int i = 0; i < num_enc_; ++i) values[i] = 32000;
   int num_cards_in_deck = Game::NumCardsInDeck();
   // The number of possible hole card pairs containing a given card
   int num_buddies = (num_cards_in_deck - num_board_cards) - 1;
-  int *seen = new int[max_card + 1];
+  int *seen = seen_.get();
   for (int i = 0; i <= max_card; ++i) seen[i] = 0;
-  int *beats = new int[num_hole_card_pairs];
+  int *beats = beats_.get();
   int last_hv = -1;
   int j = 0;
   while (j < num_hole_card_pairs) {
@@ -94,7 +203,7 @@ static short *RiverHandStrength(const Card *board, bool wins) {
       ++seen[hi];
       ++seen[lo];
     }
-    if (wins) {
+    if (wins_) {
       for (int k = begin_range; k < j; ++k) {
 	int enc = v[k].second;
 	values[enc] = (short)beats[k];
@@ -113,70 +222,169 @@ static short *RiverHandStrength(const Card *board, bool wins) {
 	// beats[k] - lose is the WML
 	short wml = ((short)beats[k]) - lose;
 	values[enc] = wml;
-	// OutputTwoCards(hi, lo);
-	// printf(" %i %i %i %u\n", (int)wml, beats[k], (int)lose, enc);
       }
     }
   }
-  delete [] seen;
-  delete [] beats;
   return values;
 }
 
-static void GetPercentiles(vector<short> &wmls, double *percentiles, int num_percentiles,
-			   short *my_percentiles) {
-  sort(wmls.begin(), wmls.end());
-  int num = wmls.size();
-  for (int i = 0; i < num_percentiles; ++i) {
-    double percentile = percentiles[i];
-    int j = percentile * (num - 1) + 0.5;
-    if (j >= num) {
-      fprintf(stderr, "OOB pct %f j %u num %u\n", percentile, j, num);
-      exit(-1);
+// Deals the remaining num_left board cards in descending order, all below
+// end_card, so that every set of future cards is visited once.  At the
+// river, appends each hand's strength to its samples.
+void RolloutThread::Enumerate(int num_board_cards, int end_card, int num_left) {
+  if (num_left == 0) {
+    const short *values = RiverHandStrength(board_);
+    for (int enc = 0; enc < num_enc_; ++enc) {
+      int h = hand_index_[enc];
+      if (h == -1) continue;
+      short val = values[enc];
+      if (val == 32000) continue;
+      samples_[h * max_samples_ + num_samples_[h]++] = val;
     }
-    short wml = wmls[j];
-    my_percentiles[i] = wml;
+    return;
+  }
+  for (int c = end_card - 1; c >= num_left - 1; --c) {
+    if (InCards(c, board_, num_st_board_cards_)) continue;
+    board_[num_board_cards] = c;
+    Enumerate(num_board_cards + 1, c, num_left - 1);
   }
 }
 
-// We need to pool the WMLs for all the variants of each canonical hand.
-// What about for the flop/turn/river?
-static short *ComputePreflopPercentiles(double *percentiles, int num_percentiles,
-					bool wins) {
-  BoardTree::BuildBoardCounts();
+// On the turn, deal out all river cards.  Compute WML for all hands.  Hands
+// are output in increasing order of hole card encoding.
+//
+// The old approach visited each set of future cards once per order in which
+// it could be dealt and sorted the pooled samples.  Visiting each set once
+// gives the same pooled samples with every value repeated weight_ times, so
+// element j of the pooled samples is element j / weight_ of ours.
+void RolloutThread::ComputeBoard(int bd, short *pct_vals) {
+  const Card *st_board = BoardTree::Board(st_, bd);
+  for (int i = 0; i < num_st_board_cards_; ++i) board_[i] = st_board[i];
+  int num_hands = 0;
+  for (int enc = 0; enc < num_enc_; ++enc) {
+    int hi = enc / (max_card_ + 1);
+    int lo = enc % (max_card_ + 1);
+    if (lo < hi && ! InCards(hi, board_, num_st_board_cards_) &&
+	! InCards(lo, board_, num_st_board_cards_)) {
+      num_samples_[num_hands] = 0;
+      hand_index_[enc] = num_hands++;
+    } else {
+      hand_index_[enc] = -1;
+    }
+  }
+  int num_new = Game::NumBoardCards(Game::MaxStreet()) - num_st_board_cards_;
+  Enumerate(num_st_board_cards_, max_card_ + 1, num_new);
+  for (int h = 0; h < num_hands; ++h) {
+    short *samples = samples_.get() + h * max_samples_;
+    int num = num_samples_[h];
+    std::sort(samples, samples + num);
+    int num_pooled = num * weight_;
+    for (int p = 0; p < num_percentiles_; ++p) {
+      double percentile = percentiles_[p];
+      int j = percentile * (num_pooled - 1) + 0.5;
+      if (j >= num_pooled) {
+	fprintf(stderr, "OOB pct %f j %u num %u\n", percentile, j, num_pooled);
+	exit(-1);
+      }
+      pct_vals[h * num_percentiles_ + p] = samples[j / weight_];
+    }
+  }
+}
+
+// Accumulate histograms of river strengths for every hand over this
+// thread's share of the canonical river boards, weighted by board count.
+void RolloutThread::CountPreflop(void) {
   int max_street = Game::MaxStreet();
-  int num_ms_board_cards = Game::NumBoardCards(max_street);
-  // Num cards left after board cards and hole cards for target player
-  // removed from deck.
-  int num_remaining = Game::NumCardsInDeck() - num_ms_board_cards -
+  int num_remaining = Game::NumCardsInDeck() - Game::NumBoardCards(max_street) -
     Game::NumCardsForStreet(0);
-  // Assume two hole cards
   int max_wml = num_remaining * (num_remaining - 1) / 2;
   int num_wmls = 2 * max_wml + 1;
-  int max_card = Game::MaxCard();
-  int num_enc = (max_card + 1) * (max_card + 1);
-  int **wml_counts = new int *[num_enc];
-  for (int enc = 0; enc < num_enc; ++enc) {
-    wml_counts[enc] = new int[num_wmls];
-    for (int w = 0; w < num_wmls; ++w) wml_counts[enc][w] = 0;
-  }
   int num_boards = BoardTree::NumBoards(max_street);
-  for (int bd = 0; bd < num_boards; ++bd) {
-    if (bd % 1000 == 0) fprintf(stderr, "bd %i/%i\n", bd, num_boards);
+  int *wml_counts = wml_counts_.get();
+  for (int bd = thread_index_; bd < num_boards; bd += num_threads_) {
+    if (thread_index_ == 0 && bd % 1000 == 0) fprintf(stderr, "bd %i/%i\n", bd, num_boards);
     const Card *board = BoardTree::Board(max_street, bd);
     int board_count = BoardTree::BoardCount(max_street, bd);
-    short *river_wmls = RiverHandStrength(board, wins);
-    for (int enc = 0; enc < num_enc; ++enc) {
+    const short *river_wmls = RiverHandStrength(board);
+    for (int enc = 0; enc < num_enc_; ++enc) {
       short wml = river_wmls[enc];
       if (wml != 32000) {
 	// The raw WML values can be negative.  They range from -990 to 990,
 	// I think, for full-deck holdem.  We normalize them to the range
 	// 0 to 1980.
 	int norm_wml = wml + max_wml;
-	wml_counts[enc][norm_wml] += board_count;
+	wml_counts[enc * num_wmls + norm_wml] += board_count;
       }
     }
-    delete [] river_wmls;
+  }
+}
+
+void RolloutThread::SetRound(int begin_bd, int end_bd, short *round_vals) {
+  begin_bd_ = begin_bd;
+  end_bd_ = end_bd;
+  round_vals_ = round_vals;
+}
+
+void RolloutThread::Go(void) {
+  if (st_ == 0) {
+    CountPreflop();
+    return;
+  }
+  int num_vals_per_board = Game::NumHoleCardPairs(st_) * num_percentiles_;
+  for (int bd = begin_bd_ + thread_index_; bd < end_bd_; bd += num_threads_) {
+    ComputeBoard(bd, round_vals_ + (bd - begin_bd_) * num_vals_per_board);
+  }
+}
+
+static void *rollout_thread_run(void *v_t) {
+  RolloutThread *t = (RolloutThread *)v_t;
+  t->Go();
+  return NULL;
+}
+
+void RolloutThread::Run(void) {
+  pthread_create(&pthread_id_, NULL, rollout_thread_run, this);
+}
+
+void RolloutThread::Join(void) {
+  pthread_join(pthread_id_, NULL); 
+}
+
+static void RunThreads(const vector< unique_ptr<RolloutThread> > &threads) {
+  int num_threads = threads.size();
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->Run();
+  }
+  // Execute thread 0 in main execution thread
+  threads[0]->Go();
+  for (int t = 1; t < num_threads; ++t) {
+    threads[t]->Join();
+  }
+}
+
+// We need to pool the WMLs for all the variants of each canonical hand.
+// What about for the flop/turn/river?
+static short *ComputePreflopPercentiles(const vector< unique_ptr<RolloutThread> > &threads,
+					const double *percentiles, int num_percentiles) {
+  BoardTree::BuildBoardCounts();
+  int max_street = Game::MaxStreet();
+  int num_ms_board_cards = Game::NumBoardCards(max_street);
+  // Num cards left after board cards and hole cards for target player
+  // removed from deck.
+  int num_remaining = Game::NumCardsInDeck() - num_ms_board_cards -
+    Game::NumCardsForStreet(0);
+  // Assume two hole cards
+  int max_wml = num_remaining * (num_remaining - 1) / 2;
+  int num_wmls = 2 * max_wml + 1;
+  int max_card = Game::MaxCard();
+  int num_enc = (max_card + 1) * (max_card + 1);
+  RunThreads(threads);
+  // Sum the per-thread histograms into thread 0's
+  int num_threads = threads.size();
+  int *all_counts = threads[0]->WMLCounts();
+  for (int t = 1; t < num_threads; ++t) {
+    const int *counts = threads[t]->WMLCounts();
+    for (int i = 0; i < num_enc * num_wmls; ++i) all_counts[i] += counts[i];
   }
   CanonicalCards preflop_hands(2, NULL, 0, 0, false);
   int num_hole_card_pairs = Game::NumHoleCardPairs(0);
@@ -191,8 +399,8 @@ static short *ComputePreflopPercentiles(double *percentiles, int num_percentiles
       if (preflop_hands.NumVariants(hcp) == 0) {
 	int canon_enc = preflop_hands.Canon(hcp);
 	for (int w = 0; w < num_wmls; ++w) {
-	  wml_counts[canon_enc][w] += wml_counts[enc][w];
-	  wml_counts[enc][w] = 0;
+	  all_counts[canon_enc * num_wmls + w] += all_counts[enc * num_wmls + w];
+	  all_counts[enc * num_wmls + w] = 0;
 	}
       }
       ++hcp;
@@ -206,7 +414,7 @@ static short *ComputePreflopPercentiles(double *percentiles, int num_percentiles
       if (preflop_hands.NumVariants(hcp) > 0) {
 	int enc = hi * (max_card + 1) + lo;
 	canon_enc_to_hcp[enc] = hcp;
-	int *counts = wml_counts[enc];
+	int *counts = all_counts + enc * num_wmls;
 	int sum_counts = 0;
 	for (int w = 0; w < num_wmls; ++w) sum_counts += counts[w];
 	int p = 0, cum = 0;
@@ -234,11 +442,6 @@ static short *ComputePreflopPercentiles(double *percentiles, int num_percentiles
     }
   }
 
-  for (int enc = 0; enc < num_enc; ++enc) {
-    delete [] wml_counts[enc];
-  }
-  delete [] wml_counts;
-
   // Copy the percentile values from the canonical hands to the
   // non-canonical ones.
   hcp = 0;
@@ -260,120 +463,62 @@ static short *ComputePreflopPercentiles(double *percentiles, int num_percentiles
   return pct_vals;
 }
 
-// Not practical for preflop for full-deck holdem.
-static vector<short> *ComputeRollout(Card *board, bool wins, unsigned int st) {
-  unsigned int max_street = Game::MaxStreet();
-  unsigned int max_card = Game::MaxCard();
-  unsigned int num_enc = (max_card + 1) * (max_card + 1);
-  vector<short> *wmls = new vector<short>[num_enc];
-  if (st == max_street) {
-    short *wmls1 = RiverHandStrength(board, wins);
-    for (unsigned int i = 0; i < num_enc; ++i) {
-      short wml = wmls1[i];
-      if (wml != 32000) {
-	wmls[i].push_back(wml);
-      }
-    }
-    delete [] wmls1;
-  } else {
-    unsigned int num_board_cards = Game::NumBoardCards(st);
-    unsigned int nst = st + 1;
-    unsigned int num_new_board_cards = Game::NumCardsForStreet(nst);
-    if (num_new_board_cards == 1) {
-      for (unsigned int c = 0; c <= max_card; ++c) {
-	if (InCards(c, board, num_board_cards)) continue;
-	board[num_board_cards] = c;
-	vector<short> *next_wmls = ComputeRollout(board, wins, nst);
-	for (unsigned int i = 0; i < num_enc; ++i) {
-	  vector<short> &v = next_wmls[i];
-	  unsigned int num = v.size();
-	  for (unsigned int j = 0; j < num; ++j) {
-	    wmls[i].push_back(v[j]);
-	  }
-	}
-	delete [] next_wmls;
-      }
-    } else if (num_new_board_cards == 3) {
-      unsigned int hi, mid, lo;
-      for (hi = 2; hi <= max_card; ++hi) {
-	fprintf(stderr, "hi %u/%u\n", hi, max_card + 1);
-	if (InCards(hi, board, num_board_cards)) continue;
-	board[num_board_cards] = hi;
-	for (mid = 1; mid < hi; ++mid) {
-	  if (InCards(mid, board, num_board_cards)) continue;
-	  board[num_board_cards + 1] = mid;
-	  for (lo = 0; lo < mid; ++lo) {
-	    board[num_board_cards + 2] = lo;
-	    vector<short> *next_wmls = ComputeRollout(board, wins, nst);
-	    for (unsigned int i = 0; i < num_enc; ++i) {
-	      vector<short> &v = next_wmls[i];
-	      unsigned int num = v.size();
-	      for (unsigned int j = 0; j < num; ++j) {
-		wmls[i].push_back(v[j]);
-	      }
-	    }
-	    delete [] next_wmls;
-	  }
-	}
-      }
-    } else {
-      fprintf(stderr, "Unhandled number of new board cards: %u\n",
-	      num_new_board_cards);
-      exit(-1);
-    }
+// Renormalize vals so that worse hands have higher values and the lowest
+// value is zero.  Then squash by raising to the given power.  Rewrites the
+// values in place after the header; the writer never gets ahead of the
+// reader.
+static void Squash(const char *filename, long long int num_vals, short max_val, double squashing) {
+  Reader reader(filename);
+  Writer writer(filename, true);
+  writer.WriteInt(reader.ReadIntOrDie());
+  for (long long int i = 0; i < num_vals; ++i) {
+    short val = reader.ReadShortOrDie();
+    short norm_val = -(val - max_val);
+    writer.WriteShort((short)pow(norm_val, squashing));
   }
-  return wmls;
 }
 
-// On turn, deal out all river cards.  Compute WML for all hands.
-short *ComputeRollout(unsigned int st, double *percentiles, unsigned int num_percentiles,
-		      double squashing, bool wins) {
-  unsigned int num_boards = BoardTree::NumBoards(st);
-  unsigned int num_board_cards = Game::NumBoardCards(st);
-  unsigned int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  unsigned int num_hands = num_boards * num_hole_card_pairs;
-  unsigned int num_vals = num_hands * num_percentiles;
-  short *pct_vals;
-  if (st == 0) {
-    pct_vals = ComputePreflopPercentiles(percentiles, num_percentiles, wins);
-  } else {
-    pct_vals = new short[num_vals];
-    Card board[5];
-    for (unsigned int bd = 0; bd < num_boards; ++bd) {
-      fprintf(stderr, "bd %u/%u\n", bd, num_boards);
-      const Card *st_board = BoardTree::Board(st, bd);
-      for (unsigned int i = 0; i < num_board_cards; ++i) {
-	board[i] = st_board[i];
+// Boards are processed in rounds of kBoardsPerThread boards per thread.
+// Within a round boards are interleaved across threads; the main thread
+// writes each round out in board order once all threads finish it.
+void WriteRolloutFeatures(int st, const double *percentiles, int num_percentiles,
+			  double squashing, bool wins, int num_threads, const char *filename) {
+  int num_boards = BoardTree::NumBoards(st);
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  long long int num_vals = ((long long int)num_boards) * num_hole_card_pairs * num_percentiles;
+  vector< unique_ptr<RolloutThread> > threads(num_threads);
+  for (int t = 0; t < num_threads; ++t) {
+    threads[t].reset(new RolloutThread(st, percentiles, num_percentiles, wins, t, num_threads));
+  }
+  short max_val = -32700;
+  {
+    Writer writer(filename);
+    writer.WriteInt(num_percentiles);
+    if (st == 0) {
+      unique_ptr<short []> pct_vals(ComputePreflopPercentiles(threads, percentiles,
+							      num_percentiles));
+      for (long long int i = 0; i < num_vals; ++i) {
+	writer.WriteShort(pct_vals[i]);
+	if (pct_vals[i] > max_val) max_val = pct_vals[i];
       }
-      unsigned int h = bd * num_hole_card_pairs;
-      vector<short> *wmls = ComputeRollout(board, wins, st);
-      unsigned int max_card = Game::MaxCard();
-      unsigned int num_enc = (max_card + 1) * (max_card + 1);
-      for (unsigned int i = 0; i < num_enc; ++i) {
-	vector<short> &v = wmls[i];
-	if (v.size() == 0) continue;
-	GetPercentiles(v, percentiles, num_percentiles, &pct_vals[h * num_percentiles]);
-	++h;
+    } else {
+      int boards_per_round = kBoardsPerThread * num_threads;
+      int num_vals_per_board = num_hole_card_pairs * num_percentiles;
+      unique_ptr<short []> round_vals(new short[boards_per_round * num_vals_per_board]);
+      for (int begin_bd = 0; begin_bd < num_boards; begin_bd += boards_per_round) {
+	int end_bd = std::min(begin_bd + boards_per_round, num_boards);
+	fprintf(stderr, "bd %i/%i\n", begin_bd, num_boards);
+	for (int t = 0; t < num_threads; ++t) {
+	  threads[t]->SetRound(begin_bd, end_bd, round_vals.get());
+	}
+	RunThreads(threads);
+	int num_round_vals = (end_bd - begin_bd) * num_vals_per_board;
+	for (int i = 0; i < num_round_vals; ++i) {
+	  writer.WriteShort(round_vals[i]);
+	  if (round_vals[i] > max_val) max_val = round_vals[i];
+	}
       }
-      delete [] wmls;
     }
   }
-  if (squashing == 1.0) {
-    return pct_vals;
-  }
-  short min_val = 32700;
-  short max_val = -32700;
-  for (unsigned int i = 0; i < num_vals; ++i) {
-    short val = pct_vals[i];
-    if (val < min_val) min_val = val;
-    if (val > max_val) max_val = val;
-  }
-  // Renormalize vals so that worse hands have higher values and the lowest
-  // value is zero.  Then squash by raising to the given power.
-  for (unsigned int i = 0; i < num_vals; ++i) {
-    short val = pct_vals[i];
-    short norm_val = -(val - max_val);
-    pct_vals[i] = (short)pow(norm_val, squashing);
-  }
-  return pct_vals;
+  if (squashing != 1.0) Squash(filename, num_vals, max_val, squashing);
 }
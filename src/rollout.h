@@ -1,10 +1,11 @@
 #ifndef _ROLLOUT_H_
 #define _ROLLOUT_H_
 
-#include "cards.h"
-
-short *ComputeRollout(unsigned int st, double *percentiles,
-		      unsigned int num_percentiles,
-		      double squashing, bool wins);
+// Writes rollout features for every hand on every board of street st to
+// filename: the number of percentiles, then the given percentiles of each
+// hand's river strength over all future boards, as shorts.  Squashing of
+// 1.0 means no squashing.  Requires HandValueTree and BoardTree.
+void WriteRolloutFeatures(int st, const double *percentiles, int num_percentiles,
+			  double squashing, bool wins, int num_threads, const char *filename);
 
 #endif
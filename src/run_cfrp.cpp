@@ -73,6 +73,7 @@ int main(int argc, char *argv[]) {
     CFRP cfr(*card_abstraction, *cfr_config, buckets, num_threads);
     cfr.Initialize(*betting_abstraction, target_p);
     cfr.Run(start_it, end_it);
+    cfr.ReportArenaStats();
   } else {
     fprintf(stderr, "Unknown algorithm: %s\n",
 	    cfr_config->Algorithm().c_str());
@@ -27,8 +27,9 @@ using std::vector;
 
 static void Usage(const char *prog_name) {
   fprintf(stderr, "USAGE: %s <game params> <card params> <betting params> "
-	  "<CFR params> <num threads> <it> [current|avg] [quantize|raw] (<streets>)\n",
+	  "<CFR params> <num threads> <its> [current|avg] [quantize|raw] (<streets>)\n",
 	  prog_name);
+  fprintf(stderr, "\n<its> is a comma-separated list of iterations to evaluate in turn.\n");
   exit(-1);
 }
 
@@ -49,9 +50,16 @@ int main(int argc, char *argv[]) {
   unique_ptr<Params> cfr_params = CreateCFRParams();
   cfr_params->ReadFromFile(argv[4]);
   unique_ptr<CFRConfig> cfr_config(new CFRConfig(*cfr_params));
-  int num_threads, it;
+  int num_threads;
   if (sscanf(argv[5], "%i", &num_threads) != 1) Usage(argv[0]);
-  if (sscanf(argv[6], "%i", &it) != 1)          Usage(argv[0]);
+  vector<string> it_comps;
+  Split(argv[6], ',', false, &it_comps);
+  int num_its = it_comps.size();
+  if (num_its == 0) Usage(argv[0]);
+  unique_ptr<int []> its(new int[num_its]);
+  for (int i = 0; i < num_its; ++i) {
+    if (sscanf(it_comps[i].c_str(), "%i", &its[i]) != 1) Usage(argv[0]);
+  }
   string carg = argv[7];
   bool current;
   if (carg == "current")  current = true;
@@ -83,36 +91,42 @@ int main(int argc, char *argv[]) {
   Buckets buckets(*card_abstraction, false);
 
   int num_players = Game::NumPlayers();
+  if (betting_abstraction->Asymmetric() && num_players > 2) {
+    fprintf(stderr, "How to handle more than two players?!?\n");
+    exit(-1);
+  }
   unique_ptr<double []> evs(new double[num_players]);
-  for (int p = 0; p < num_players; ++p) evs[p] = 0;
 
+  // One RGBR object for all the iterations so that the worker threads and betting trees are
+  // created only once.
   RGBR rgbr(*card_abstraction, *cfr_config, buckets, current, quantize, num_threads,
 	    streets.get());
-  if (betting_abstraction->Asymmetric()) {
-    if (num_players > 2) {
-      fprintf(stderr, "How to handle more than two players?!?\n");
-      exit(-1);
+  for (int i = 0; i < num_its; ++i) {
+    int it = its[i];
+    for (int p = 0; p < num_players; ++p) evs[p] = 0;
+    if (betting_abstraction->Asymmetric()) {
+      for (int target_p = 0; target_p < num_players; ++target_p) {
+	int responder_p = target_p^1;
+	evs[responder_p] = rgbr.Go(it, responder_p, *betting_abstraction);
+      }
+    } else {
+      for (int p = 0; p < num_players; ++p) {
+	evs[p] = rgbr.Go(it, p, *betting_abstraction);
+      }
     }
-    for (int target_p = 0; target_p < num_players; ++target_p) {
-      int responder_p = target_p^1;
-      evs[responder_p] = rgbr.Go(it, responder_p, *betting_abstraction);
-    }
-  } else {
+
+    if (num_its > 1) printf("It %i\n", it);
+    double gap = 0;
     for (int p = 0; p < num_players; ++p) {
-      evs[p] = rgbr.Go(it, p, *betting_abstraction);
+      // Divide by two to convert chips into big blinds (assumption is that the
+      // small blind is one chip).  Multiply by 1000 to convert big blinds into
+      // milli-big-blinds.
+      printf("P%u best response: %f (%.2f mbb/g)\n", p, evs[p],
+	     (evs[p] / 2.0) * 1000.0);
+      gap += evs[p];
     }
+    printf("Gap: %f\n", gap);
+    printf("Exploitability: %.2f mbb/g\n", ((gap / 2.0) / num_players) * 1000.0);
+    fflush(stdout);
   }
-
-  double gap = 0;
-  for (int p = 0; p < num_players; ++p) {
-    // Divide by two to convert chips into big blinds (assumption is that the
-    // small blind is one chip).  Multiply by 1000 to convert big blinds into
-    // milli-big-blinds.
-    printf("P%u best response: %f (%.2f mbb/g)\n", p, evs[p],
-	   (evs[p] / 2.0) * 1000.0);
-    gap += evs[p];
-  }
-  printf("Gap: %f\n", gap);
-  printf("Exploitability: %.2f mbb/g\n", ((gap / 2.0) / num_players) * 1000.0);
-  fflush(stdout);
 }
@@ -31,7 +31,7 @@
 #include "hand_value_tree.h"
 #include "io.h"
 #include "params.h"
-#include "rand.h"
+#include "sampler.h"
 #include "sorting.h"
 
 using std::string;
@@ -71,7 +71,7 @@ private:
   int **raw_hcps_;
   unsigned short **sorted_hcps_;
   unique_ptr<int []> hvs_;
-  struct drand48_data rand_buf_;
+  RNG rng_;
   // Index by terminal ID and bucket
   long long int **sum_terminal_cvs_;
   long long int **num_terminal_cvs_;
@@ -212,8 +212,7 @@ SampledBR::SampledBR(const BettingAbstraction &ba, const CardAbstraction &target
 }
 
 long long int SampledBR::Round(double d) {
-  double rnd;
-  drand48_r(&rand_buf_, &rnd);
+  double rnd = rng_.RandZeroToOne();
   if (d < 0) {
     long long int below = d;
     double rem = below - d;
@@ -413,8 +412,7 @@ void SampledBR::Nonterminal(Node *node, int *contributions, int last_bet_to, boo
       int b = target_buckets_->Bucket(st, h);
       offset = b * num_succs;
     }
-    double r;
-    drand48_r(&rand_buf_, &r);
+    double r = rng_.RandZeroToOne();
     unique_ptr<double []> probs(new double[num_succs]);
     probs_[node_pa]->RMProbs(st, node_pa, nt, offset, num_succs, dsi, probs.get());
     double cum = 0;
@@ -477,22 +475,8 @@ void SampledBR::PlayHand(const Card *cards, bool deterministic) {
 }
 
 void SampledBR::DealNCards(Card *cards, int n) {
-  int max_card = Game::MaxCard();
-  for (int i = 0; i < n; ++i) {
-    Card c;
-    while (true) {
-      // c = RandBetween(0, max_card);
-      double r;
-      drand48_r(&rand_buf_, &r);
-      c = (max_card + 1) * r;
-      int j;
-      for (j = 0; j < i; ++j) {
-	if (cards[j] == c) break;
-      }
-      if (j == i) break;
-    }
-    cards[i] = c;
-  }
+  unsigned long long int deck = FullDeck();
+  DealCards(&rng_, n, &deck, cards);
 }
 
 void SampledBR::SetHCPsAndBoards(Card **raw_hole_cards, const Card *raw_board) {
@@ -589,7 +573,7 @@ void SampledBR::Go(long long int num_samples, bool deterministic) {
     exit(-1);
   }
   if (! deterministic) {
-    srand48_r(time(0), &rand_buf_);
+    rng_.Seed(time(0));
   }
 
   for (long long int i = 0; i < num_samples; ++i) {
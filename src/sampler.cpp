@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cards.h"
+#include "game.h"
+#include "sampler.h"
+
+// Fills the state from the seed with splitmix64, as recommended by the xoshiro authors.
+void RNG::Seed(unsigned long long int seed) {
+  unsigned long long int x = seed;
+  for (int i = 0; i < 4; ++i) {
+    unsigned long long int z = (x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    s_[i] = z ^ (z >> 31);
+  }
+}
+
+void RNG::Jump(void) {
+  static const unsigned long long int kJump[] = {
+    0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL, 0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL
+  };
+  unsigned long long int s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+  for (int i = 0; i < 4; ++i) {
+    for (int b = 0; b < 64; ++b) {
+      if (kJump[i] & (1ULL << b)) {
+	s0 ^= s_[0];
+	s1 ^= s_[1];
+	s2 ^= s_[2];
+	s3 ^= s_[3];
+      }
+      Next();
+    }
+  }
+  s_[0] = s0;
+  s_[1] = s1;
+  s_[2] = s2;
+  s_[3] = s3;
+}
+
+unsigned long long int FullDeck(void) {
+  int num_cards = Game::MaxCard() + 1;
+  if (num_cards > 64) {
+    fprintf(stderr, "FullDeck: at most 64 cards supported\n");
+    exit(-1);
+  }
+  return num_cards == 64 ? ~0ULL : (1ULL << num_cards) - 1;
+}
+
+void DealCards(RNG *rng, int n, unsigned long long int *deck, Card *cards) {
+  for (int i = 0; i < n; ++i) cards[i] = DealCard(rng, deck);
+}
+
+void DealHands(RNG *rng, int num_hands, int cards_per_hand, unsigned long long int *deck,
+	       Card *cards) {
+  for (int h = 0; h < num_hands; ++h) {
+    Card *hand = cards + h * cards_per_hand;
+    for (int i = 0; i < cards_per_hand; ++i) {
+      // Insertion sort from high to low as we go
+      Card c = DealCard(rng, deck);
+      int j = i;
+      while (j > 0 && hand[j - 1] < c) {
+	hand[j] = hand[j - 1];
+	--j;
+      }
+      hand[j] = c;
+    }
+  }
+}
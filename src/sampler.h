@@ -0,0 +1,78 @@
+#ifndef _SAMPLER_H_
+#define _SAMPLER_H_
+
+// Fast random number generation and card dealing for the sampling algorithms (TCFR, ECFR,
+// play, sampled_br).  Each thread should own its own RNG; nothing here is thread-safe.
+
+#include <x86intrin.h>
+
+#include "cards.h"
+
+// xoshiro256** (Blackman and Vigna).  Much faster than drand48_r() and with far better
+// statistical properties.
+class RNG {
+ public:
+  RNG(void) {Seed(0);}
+  explicit RNG(unsigned long long int seed) {Seed(seed);}
+  void Seed(unsigned long long int seed);
+  // Advances the state by 2^128 steps.  Seeding two RNGs the same way and jumping one of them i
+  // times gives non-overlapping streams.
+  void Jump(void);
+  unsigned long long int Next(void) {
+    unsigned long long int result = Rotl(s_[1] * 5, 7) * 9;
+    unsigned long long int t = s_[1] << 17;
+    s_[2] ^= s_[0];
+    s_[3] ^= s_[1];
+    s_[1] ^= s_[2];
+    s_[0] ^= s_[3];
+    s_[2] ^= t;
+    s_[3] = Rotl(s_[3], 45);
+    return result;
+  }
+  // In [0, 1); never one, even after casting to a float.
+  double RandZeroToOne(void) {return (Next() >> 11) * 0x1.0p-53;}
+  // Uniform integer in [0, n) by multiply-shift.  The bias is at most n / 2^64.
+  unsigned int RandBelow(unsigned int n) {
+    return (unsigned int)(((unsigned __int128)Next() * n) >> 64);
+  }
+ private:
+  static unsigned long long int Rotl(unsigned long long int x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  unsigned long long int s_[4];
+};
+
+// A deck is a bitmask with bit c set if card c is available.  Dealing from a mask never
+// collides with cards already dealt, so there are no rejection loops.
+unsigned long long int FullDeck(void);
+static inline unsigned long long int RemoveCards(unsigned long long int deck, const Card *cards,
+						 int n) {
+  for (int i = 0; i < n; ++i) deck &= ~(1ULL << cards[i]);
+  return deck;
+}
+
+// Deals one card uniformly from the deck and removes it.  One step of a Fisher-Yates shuffle
+// over the cards remaining in the deck.
+static inline Card DealCard(RNG *rng, unsigned long long int *deck) {
+  unsigned long long int d = *deck;
+  unsigned int k = rng->RandBelow(__builtin_popcountll(d));
+#ifdef __BMI2__
+  // Deposit a single bit into the k-th set bit of the deck
+  Card c = __builtin_ctzll(_pdep_u64(1ULL << k, d));
+#else
+  while (k-- > 0) d &= d - 1;
+  Card c = __builtin_ctzll(d);
+#endif
+  *deck &= ~(1ULL << c);
+  return c;
+}
+
+// Deals n distinct cards from the deck, removing them from it.
+void DealCards(RNG *rng, int n, unsigned long long int *deck, Card *cards);
+// Deals num_hands disjoint hands of cards_per_hand cards each (e.g., the hole cards of every
+// player), removing them from the deck.  The cards of each hand are sorted from high to low.
+void DealHands(RNG *rng, int num_hands, int cards_per_hand, unsigned long long int *deck,
+	       Card *cards);
+
+#endif
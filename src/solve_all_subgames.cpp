@@ -6,8 +6,8 @@
 // should not assume we can load the trunk sumprobs in memory.  Can I assume a hand tree for the
 // trunk in memory?
 //
-// With base_mem false, solve_all_subgames is pretty slow because we repeatedly read the entire base
-// strategy in (inside ReadBaseSubgameStrategy()).
+// With base_mem false, we read the base strategy for each subgame as we need it (inside
+// ReadBaseSubgameStrategy()).  Only the part of the files under the subgame is read.
 //
 // Should allow trunk sumprobs to be quantized.
 
@@ -441,6 +441,19 @@ void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequen
   }
   // Don't support asymmetric yet
   unique_ptr<BettingTrees> subgame_subtrees(CreateSubtrees(node, 0, false));
+  unique_ptr<DynamicCBR> subgame_cbr;
+  if (! base_mem_) {
+    // Read just the part of the base strategy under this subgame.  We index it by the base tree's
+    // nonterminal IDs so that we can compute the CBRs on the base tree itself.
+    shared_ptr<CFRValues> base_subgame_strategy(
+		    ReadBaseSubgameStrategy(base_card_abstraction_, base_betting_abstraction_,
+					    base_cfr_config_, base_betting_trees_.get(),
+					    base_buckets_, subgame_buckets_, base_it_, node, gbd, "x",
+					    nullptr, nullptr, current_, 0));
+    subgame_cbr.reset(new DynamicCBR(base_card_abstraction_, base_cfr_config_, base_buckets_, 1));
+    if (current_) subgame_cbr->SetRegrets(base_subgame_strategy);
+    else          subgame_cbr->SetSumprobs(base_subgame_strategy);
+  }
   for (int solve_p = 0; solve_p < num_players; ++solve_p) {
     if (! card_level_) {
       fprintf(stderr, "DynamicCBR cannot compute bucket-level CVs\n");
@@ -457,13 +470,8 @@ void SubgameSolver::ResolveSafe(Node *node, int gbd, const string &action_sequen
       // fprintf(stderr, "solve_p %i t_vals[0] %f\n", solve_p, t_vals[0]);
       // exit(-1);
     } else {
-      fprintf(stderr, "base_mem_ false not supported yet\n");
-      exit(-1);
-#if 0
-      t_vals = dynamic_cbr_->Compute(base_subtree->Root(), reach_probs, gbd, &hand_tree,
-				     solve_p^1, cfrs_, zero_sum_, current_,
-				     pure_streets_[st]);
-#endif
+      t_vals = subgame_cbr->Compute(node, reach_probs, gbd, &hand_tree, solve_p^1, cfrs_,
+				    zero_sum_, current_, pure_streets_[st]);
     }
     // Pass in false for both_players.  I am doing separate solves for
     // each player.
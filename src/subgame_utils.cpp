@@ -249,6 +249,8 @@ BettingTrees *BuildHybridTreeBackup(const BettingAbstraction &betting_abstractio
 // CBR computation.
 // Actually: for normal subgame solving, I think I only need both players'
 // strategies if we are zero-summing.
+// Only reads the values below base_node for the boards descending from gbd (see
+// CFRValues::ReadSubtreeFromFull()).
 unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_abstraction,
 					      const BettingAbstraction &base_betting_abstraction,
 					      const CFRConfig &base_cfr_config,
@@ -265,9 +267,12 @@ unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_a
   for (int st = 0; st <= max_street; ++st) {
     subgame_streets[st] = st >= base_node->Street();
   }
+  // Without a subtree, the values are indexed by the nonterminal IDs of the base tree.
+  const BettingTree *betting_tree = subtree ? subtree : base_betting_trees->GetBettingTree();
+  Node *subtree_root = subtree ? subtree->Root() : base_node;
   unique_ptr<CFRValues> strategy(new CFRValues(nullptr, subgame_streets.get(),
 					       gbd, base_node->Street(), base_buckets,
-					       base_betting_trees->GetBettingTree()));
+					       betting_tree));
 
   char dir[500];
   sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::OldCFRBase(),
@@ -283,23 +288,21 @@ unique_ptr<CFRValues> ReadBaseSubgameStrategy(const CardAbstraction &base_card_a
     strcat(dir, buf);
   }
 
+  // The base strategy files hold the values for the full tree
   unique_ptr<int []> num_full_holdings(new int[max_street + 1]);
   for (int st = 0; st <= max_street; ++st) {
-    if (subgame_buckets.None(st)) {
+    if (base_buckets.None(st)) {
       num_full_holdings[st] =
 	BoardTree::NumBoards(st) * Game::NumHoleCardPairs(st);
     } else {
-      num_full_holdings[st] = subgame_buckets.NumBuckets(st);
+      num_full_holdings[st] = base_buckets.NumBuckets(st);
     }
   }
 
-  fprintf(stderr, "Need to implement ReadSubtreeFromFull()\n");
-  exit(-1);
-#if 0
-  strategy->ReadSubtreeFromFull(dir, base_it, base_betting_trees->Root(),
-				base_node, subtree->Root(), action_sequence,
-				num_full_holdings.get(), -1);
-#endif
+  Node *full_root = base_betting_abstraction.Asymmetric() ? base_betting_trees->Root(asym_p) :
+    base_betting_trees->Root();
+  strategy->ReadSubtreeFromFull(dir, base_it, full_root, base_node, subtree_root,
+				action_sequence, num_full_holdings.get(), -1, ! current);
   
   return strategy;
 }
@@ -3,9 +3,14 @@
 //
 // Targeted CFR.
 
+#include <linux/mempolicy.h> // MPOL_INTERLEAVE
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h> // clock_gettime()
 #include <unistd.h> // sleep()
 
 #include <algorithm>
@@ -23,10 +28,11 @@
 #include "game.h"
 #include "hand_tree.h"
 #include "hand_value_tree.h"
+#include "instrument.h"
 #include "io.h"
 #include "nonterminal_ids.h"
-#include "rand.h"
 #include "regret_compression.h"
+#include "sampler.h"
 #include "split.h"
 #include "tcfr.h"
 
@@ -35,24 +41,66 @@ using namespace std;
 // #define BC 1
 #define SWITCH 1
 
+TCFRThreadStats::TCFRThreadStats(void) {
+  its.store(0ULL, std::memory_order_relaxed);
+  process_count.store(0ULL, std::memory_order_relaxed);
+  full_process_count.store(0ULL, std::memory_order_relaxed);
+  int max_street = Game::MaxStreet();
+  street_visits.reset(new std::atomic<unsigned long long int>[max_street + 1]);
+  for (int st = 0; st <= max_street; ++st) {
+    street_visits[st].store(0ULL, std::memory_order_relaxed);
+  }
+}
+
+// Each counter has a single writer, so a relaxed load and store suffice; there is no need for an
+// atomic read-modify-write.
+static inline void Increment(std::atomic<unsigned long long int> *counter) {
+  counter->store(counter->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+static const unsigned long long int kCacheLineSize = 64;
+
+static inline unsigned long long int AlignUp(unsigned long long int n, unsigned long long int a) {
+  return (n + a - 1) & ~(a - 1);
+}
+
+// With PadBuckets, the bucket data of each node starts on a cache line and each bucket's record
+// is rounded up to a power of two (or to a multiple of the line size if larger) so that no record
+// straddles two cache lines.
+static inline unsigned int PaddedBucketSize(unsigned int sz) {
+  if (sz >= kCacheLineSize) return AlignUp(sz, kCacheLineSize);
+  unsigned int p = 1;
+  while (p < sz) p <<= 1;
+  return p;
+}
+
+// Start of the per-bucket data of the nonterminal node at ptr
+static inline unsigned char *BucketData(unsigned char *data, unsigned char *ptr, int num_succs,
+					bool pad) {
+  unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+  if (pad) ptr1 = data + AlignUp(ptr1 - data, kCacheLineSize);
+  return ptr1;
+}
+
 TCFRThread::TCFRThread(const BettingAbstraction &ba, const CFRConfig &cc, const Buckets &buckets,
 		       int batch_index, int thread_index, int num_threads, unsigned char *data,
-		       int target_player, float *rngs, unsigned int *uncompress,
+		       int target_player, unsigned int *uncompress,
 		       unsigned int *short_uncompress, unsigned int *pruning_thresholds,
 		       bool **sumprob_streets, const double *boost_thresholds, const bool *freeze,
 		       unsigned char *hvb_table, unsigned char ***cards_to_indices,
 		       int num_raw_boards, const int *board_table, int batch_size,
-		       unsigned long long int *total_its) :
+		       std::atomic<unsigned long long int> *total_its, TCFRThreadStats *stats,
+		       int cpu) :
   betting_abstraction_(ba), cfr_config_(cc), buckets_(buckets) {
   batch_index_ = batch_index;
   thread_index_ = thread_index;
   num_threads_ = num_threads;
   data_ = data;
+  pad_buckets_ = cfr_config_.PadBuckets();
+  cpu_ = cpu;
   asymmetric_ = betting_abstraction_.Asymmetric();
   num_players_ = Game::NumPlayers();
   target_player_ = target_player;
-  rngs_ = rngs;
-  rng_index_ = RandZeroToOne() * kNumPregenRNGs;
   uncompress_ = uncompress;
   short_uncompress_ = short_uncompress;
   pruning_thresholds_ = pruning_thresholds;
@@ -65,6 +113,7 @@ TCFRThread::TCFRThread(const BettingAbstraction &ba, const CFRConfig &cc, const
   board_table_ = board_table;
   batch_size_ = batch_size;
   total_its_ = total_its;
+  stats_ = stats;
   
   max_street_ = Game::MaxStreet();
   char_quantized_streets_.reset(new bool[max_street_ + 1]);
@@ -172,7 +221,8 @@ TCFRThread::TCFRThread(const BettingAbstraction &ba, const CFRConfig &cc, const
     active_rems_ = NULL;
   }
 
-  srand48_r(batch_index_ * num_threads_ + thread_index_, &rand_buf_);
+  rng_.Seed(batch_index_ * num_threads_ + thread_index_);
+  full_deck_ = FullDeck();
 }
 
 TCFRThread::~TCFRThread(void) {
@@ -205,14 +255,12 @@ TCFRThread::~TCFRThread(void) {
 }
 
 void TCFRThread::HVBDealHand(void) {
-  double r;
-  drand48_r(&rand_buf_, &r);
 #ifdef BC
   unsigned int num_boards = BoardTree::NumBoards(max_street_);
-  unsigned int msbd = r * num_boards;
+  unsigned int msbd = rng_.RandBelow(num_boards);
   board_count_ = BoardTree::BoardCount(max_street_, msbd);
 #else
-  unsigned int msbd = board_table_[(int)(r * num_raw_boards_)];
+  unsigned int msbd = board_table_[rng_.RandBelow(num_raw_boards_)];
 #endif
   canon_bds_[max_street_] = msbd;
   for (int st = 1; st < max_street_; ++st) {
@@ -220,28 +268,12 @@ void TCFRThread::HVBDealHand(void) {
   }
   const Card *board = BoardTree::Board(max_street_, msbd);
   unsigned int num_ms_board_cards = Game::NumBoardCards(max_street_);
-  unsigned int end_cards = Game::MaxCard() + 1;
 
+  unsigned long long int deck = RemoveCards(full_deck_, board, num_ms_board_cards);
+  DealHands(&rng_, num_players_, 2, &deck, hole_cards_);
   for (int p = 0; p < num_players_; ++p) {
-    int c1, c2;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c1 = end_cards * r;
-      if (InCards(c1, board, num_ms_board_cards)) continue;
-      if (InCards(c1, hole_cards_, 2 * p)) continue;
-      break;
-    }
-    hole_cards_[2 * p] = c1;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c2 = end_cards * r;
-      if (InCards(c2, board, num_ms_board_cards)) continue;
-      if (InCards(c2, hole_cards_, 2 * p + 1)) continue;
-      break;
-    }
-    hole_cards_[2 * p + 1] = c2;
-    if (c1 > c2) {hi_cards_[p] = c1; lo_cards_[p] = c2;}
-    else         {hi_cards_[p] = c2; lo_cards_[p] = c1;}
+    hi_cards_[p] = hole_cards_[2 * p];
+    lo_cards_[p] = hole_cards_[2 * p + 1];
   }
   
   for (int p = 0; p < num_players_; ++p) hvs_[p] = 0;
@@ -279,14 +311,12 @@ void TCFRThread::HVBDealHand(void) {
 
 // Our old implementation which is a bit slower.
 void TCFRThread::NoHVBDealHand(void) {
-  double r;
-  drand48_r(&rand_buf_, &r);
 #ifdef BC
   unsigned int num_boards = BoardTree::NumBoards(max_street_);
-  unsigned int msbd = r * num_boards;
+  unsigned int msbd = rng_.RandBelow(num_boards);
   board_count_ = BoardTree::BoardCount(max_street_, msbd);
 #else
-  unsigned int msbd = board_table_[(int)(r * num_raw_boards_)];
+  unsigned int msbd = board_table_[rng_.RandBelow(num_raw_boards_)];
 #endif
   canon_bds_[max_street_] = msbd;
   for (int st = 1; st < max_street_; ++st) {
@@ -298,31 +328,13 @@ void TCFRThread::NoHVBDealHand(void) {
   for (unsigned int i = 0; i < num_ms_board_cards; ++i) {
     cards[i+2] = board[i];
   }
-  int end_cards = Game::MaxCard() + 1;
-
+  unsigned long long int deck = RemoveCards(full_deck_, board, num_ms_board_cards);
+  DealHands(&rng_, num_players_, 2, &deck, hole_cards_);
   for (int p = 0; p < num_players_; ++p) {
-    int c1, c2;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c1 = end_cards * r;
-      if (InCards(c1, board, num_ms_board_cards)) continue;
-      if (InCards(c1, hole_cards_, 2 * p)) continue;
-      break;
-    }
-    hole_cards_[2 * p] = c1;
-    while (true) {
-      drand48_r(&rand_buf_, &r);
-      c2 = end_cards * r;
-      if (InCards(c2, board, num_ms_board_cards)) continue;
-      if (InCards(c2, hole_cards_, 2 * p + 1)) continue;
-      break;
-    }
-    hole_cards_[2 * p + 1] = c2;
-    if (c1 > c2) {hi_cards_[p] = c1; lo_cards_[p] = c2;}
-    else         {hi_cards_[p] = c2; lo_cards_[p] = c1;}
+    hi_cards_[p] = hole_cards_[2 * p];
+    lo_cards_[p] = hole_cards_[2 * p + 1];
   }
 
-
   for (int p = 0; p < num_players_; ++p) hvs_[p] = 0;
 
   for (int st = 0; st <= max_street_; ++st) {
@@ -350,8 +362,14 @@ static double **g_preflop_vals = nullptr;
 static unsigned long long int **g_preflop_nums = nullptr;
 
 void TCFRThread::Run(void) {
-  process_count_ = 0ULL;
-  full_process_count_ = 0ULL;
+  if (cpu_ >= 0) {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(cpu_, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+      fprintf(stderr, "Could not pin thread %i to CPU %i\n", thread_index_, cpu_);
+    }
+  }
   it_ = 1;
   unique_ptr<long long int []> sum_values(new long long int[num_players_]);
   unique_ptr<long long int []> denoms(new long long int[num_players_]);
@@ -361,7 +379,8 @@ void TCFRThread::Run(void) {
   }
   
   while (1) {
-    if (*total_its_ >= ((unsigned long long int)batch_size_) * num_threads_) {
+    if (total_its_->load(std::memory_order_relaxed) >=
+	((unsigned long long int)batch_size_) * num_threads_) {
       fprintf(stderr, "Thread %u performed %llu iterations\n", thread_index_, it_);
       break;
     }
@@ -438,7 +457,11 @@ void TCFRThread::Run(void) {
 	  contributions_[p] = 0;
 	}
       }
-      T_VALUE val = Process(data_, 1000, -1);
+      T_VALUE val;
+      {
+	SCOPED_TIMER(kTimerTCFRProcess, -1);
+	val = Process(data_, 1000, -1);
+      }
       sum_values[p_] += val;
 #ifdef BC
       denoms[p_] += board_count_;
@@ -455,18 +478,18 @@ void TCFRThread::Run(void) {
     }
 
     ++it_;
+    Increment(&stats_->its);
     if (it_ % 10000000 == 0 && thread_index_ == 0) {
       for (int p = 0; p < num_players_; ++p) {
 	fprintf(stderr, "It %llu avg P%u val %f\n", it_, p, sum_values[p] / (double)denoms[p]);
       }
     }
     if (num_threads_ == 1) {
-      ++*total_its_;
+      total_its_->fetch_add(1, std::memory_order_relaxed);
     } else {
       if (it_ % 1000 == 0) {
-	// To reduce the chance of multiple threads trying to update total_its_
-	// at the same time, only update every 1000 iterations.
-	*total_its_ += 1000;
+	// To reduce contention on total_its_, only update every 1000 iterations.
+	total_its_->fetch_add(1000, std::memory_order_relaxed);
       }
     }
   }
@@ -494,8 +517,7 @@ void TCFRThread::Join(void) {
 }
 
 int TCFRThread::Round(double d) {
-  double rnd = rngs_[rng_index_++];
-  if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+  double rnd = rng_.RandZeroToOne();
   if (d < 0) {
     int below = d;
     double rem = below - d;
@@ -516,9 +538,9 @@ int TCFRThread::Round(double d) {
 }
 
 T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last_st) {
-  ++process_count_;
+  Increment(&stats_->process_count);
   if (all_full_) {
-    ++full_process_count_;
+    Increment(&stats_->full_process_count);
   }
   unsigned char first_byte = ptr[0];
   if (first_byte == 1) {
@@ -539,6 +561,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
       }
     }
 
+    COUNT_NODE(last_st, num_remaining == 1 ? kNodeFold : kNodeShowdown);
     if (num_remaining == 1) {
       // A fold node.  Everyone has folded except one player.  We know the
       // one remaining player is the target player (p_) because when the
@@ -593,12 +616,14 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
   } else { // Nonterminal node
     int st = ptr[1];
     int num_succs = ptr[2];
+    Increment(&stats_->street_visits[st]);
     // Find the next player to act.  Start with the first candidate and move
     // forward until we find someone who has not folded.  The first candidate
     // is either the last player plus one, or, if we are starting a new
     // betting round, the first player to act on that street.
     int player_acting;
     if (st > last_st) {
+      if (last_st >= 0) COUNT_NODE(st, kNodeStreetInitial);
       player_acting = Game::FirstToAct(st);
     } else {
       player_acting = last_player_acting + 1;
@@ -619,6 +644,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
     // unsigned int player_acting = ptr[5];
     if (player_acting == p_) {
       // Our choice
+      COUNT_NODE(st, kNodeOurChoice);
       int our_bucket = hand_buckets_[p_ * (max_street_ + 1) + st];
 
       int size_bucket_data;
@@ -634,7 +660,8 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	  size_bucket_data += num_succs * sizeof(T_SUM_PROB);
 	}
       }
-      unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+      if (pad_buckets_) size_bucket_data = PaddedBucketSize(size_bucket_data);
+      unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
       ptr1 += our_bucket * size_bucket_data;
       // ptr1 has now skipped past prior buckets
 
@@ -705,8 +732,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	int s = min_s;
 	if (explore_ > 0) {
 	  double thresh = explore_ * num_succs;
-	  double rnd = rngs_[rng_index_++];
-	  if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	  double rnd = rng_.RandZeroToOne();
 	  if (rnd < thresh) {
 	    s = rnd / explore_;
 	  }
@@ -792,8 +818,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	    int incr = succ_values[s] - val;
 	    double scaled = incr * 0.005;
 	    int trunc = scaled;
-	    double rnd = rngs_[rng_index_++];
-	    if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	    double rnd = rng_.RandZeroToOne();
 	    if (scaled < 0) {
 	      double rem = trunc - scaled;
 	      if (rnd < rem) incr = trunc - 1;
@@ -823,13 +848,11 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	  unsigned int r = (unsigned int)(i_regret + offset);
 	  if (char_quantized_streets_[st]) {
 	    unsigned char *bucket_regrets = ptr1;
-	    double rnd = rngs_[rng_index_++];
-	    if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	    double rnd = rng_.RandZeroToOne();
 	    bucket_regrets[s] = CompressRegret(r, rnd, uncompress_);
 	  } else if (short_quantized_streets_[st]) {
 	    unsigned short *bucket_regrets = (unsigned short *)ptr1;
-	    double rnd = rngs_[rng_index_++];
-	    if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	    double rnd = rng_.RandZeroToOne();
 	    bucket_regrets[s] = CompressRegretShort(r, rnd, short_uncompress_);
 	  } else {
 	    T_REGRET *bucket_regrets = (T_REGRET *)ptr1;
@@ -843,9 +866,10 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
       return val;
     } else {
       // Opp choice
+      COUNT_NODE(st, kNodeOppChoice);
       unsigned int opp_bucket = hand_buckets_[player_acting * (max_street_ + 1) + st];
 
-      unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+      unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
       unsigned int size_bucket_data;
       if (char_quantized_streets_[st]) {
 	size_bucket_data = num_succs;
@@ -859,6 +883,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	  size_bucket_data += num_succs * sizeof(T_SUM_PROB);
 	}
       }
+      if (pad_buckets_) size_bucket_data = PaddedBucketSize(size_bucket_data);
 
       ptr1 += opp_bucket * size_bucket_data;
       // ptr1 has now skipped past prior buckets
@@ -887,8 +912,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	} else {
 	  double d_sum_sumprobs = sum_sumprobs;
 	  double cum = 0;
-	  double rnd = rngs_[rng_index_++];
-	  if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	  double rnd = rng_.RandZeroToOne();
 	  ss = 0;
 	  for (ss = 0; ss < num_succs - 1; ++ss) {
 	    double prob = bucket_sum_probs[ss] / d_sum_sumprobs;
@@ -927,8 +951,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	
 	if (explore_ > 0) {
 	  double thresh = explore_ * num_succs;
-	  double rnd = rngs_[rng_index_++];
-	  if (rng_index_ == kNumPregenRNGs) rng_index_ = 0;
+	  double rnd = rng_.RandZeroToOne();
 	  if (rnd < thresh) {
 	    ss = rnd / explore_;
 	  }
@@ -960,7 +983,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 	  if (boost_thresholds_[st] > 0) {
 	    int num_buckets = buckets_.NumBuckets(st);
 	    action_sumprobs = (T_SUM_PROB *)
-	      (SUCCPTR(ptr) + num_succs * 8 + num_buckets * size_bucket_data);
+	      (BucketData(data_, ptr, num_succs, pad_buckets_) + num_buckets * size_bucket_data);
 	    action_sumprobs[ss] += 1;
 	    if (action_sumprobs[ss] > 2000000000) {
 	      for (int s = 0; s < num_succs; ++s) {
@@ -990,7 +1013,7 @@ T_VALUE TCFRThread::Process(unsigned char *ptr, int last_player_acting, int last
 		int num_buckets = buckets_.NumBuckets(st);
 		for (int b = 0; b < num_buckets; ++b) {
 		  T_REGRET *bucket_regrets = (T_REGRET *)
-		    (SUCCPTR(ptr) + num_succs * 8 + b * size_bucket_data);
+		    (BucketData(data_, ptr, num_succs, pad_buckets_) + b * size_bucket_data);
 		  // In FTL systems, positive regret is bad.  Want to *subtract*
 		  // to make action more likely to be taken.
 		  static const unsigned int kAdjust = 1000;
@@ -1050,16 +1073,14 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers, bool *
     seen[st][pa][nt] = true;
     Reader *reader = readers[pa][st];
     int num_buckets = buckets_.NumBuckets(st);
-    unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+    unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
+    unsigned int stride = BucketSize(st, pa, num_succs);
     if (char_quantized_streets_[st]) {
       for (int b = 0; b < num_buckets; ++b) {
 	for (int s = 0; s < num_succs; ++s) {
 	  ptr1[s] = reader->ReadUnsignedCharOrDie();
 	}
-	ptr1 += num_succs;
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     } else if (short_quantized_streets_[st]) {
       for (int b = 0; b < num_buckets; ++b) {
@@ -1067,10 +1088,7 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers, bool *
 	for (int s = 0; s < num_succs; ++s) {
 	  regrets[s] = reader->ReadUnsignedShortOrDie();
 	}
-	ptr1 += num_succs * 2;
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     } else {
       for (int b = 0; b < num_buckets; ++b) {
@@ -1078,10 +1096,7 @@ void TCFR::ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers, bool *
 	for (int s = 0; s < num_succs; ++s) {
 	  regrets[s] = reader->ReadUnsignedIntOrDie();
 	}
-	ptr1 += num_succs * sizeof(T_REGRET);
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     }
   }
@@ -1105,16 +1120,14 @@ void TCFR::WriteRegrets(unsigned char *ptr, Node *node, Writer ***writers, bool
     seen[st][pa][nt] = true;
     Writer *writer = writers[pa][st];
     int num_buckets = buckets_.NumBuckets(st);
-    unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+    unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
+    unsigned int stride = BucketSize(st, pa, num_succs);
     if (char_quantized_streets_[st]) {
       for (int b = 0; b < num_buckets; ++b) {
 	for (int s = 0; s < num_succs; ++s) {
 	  writer->WriteUnsignedChar(ptr1[s]);
 	}
-	ptr1 += num_succs;
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     } else if (short_quantized_streets_[st]) {
       for (int b = 0; b < num_buckets; ++b) {
@@ -1122,10 +1135,7 @@ void TCFR::WriteRegrets(unsigned char *ptr, Node *node, Writer ***writers, bool
 	for (int s = 0; s < num_succs; ++s) {
 	  writer->WriteUnsignedShort(regrets[s]);
 	}
-	ptr1 += num_succs * 2;
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     } else {
       for (int b = 0; b < num_buckets; ++b) {
@@ -1133,10 +1143,7 @@ void TCFR::WriteRegrets(unsigned char *ptr, Node *node, Writer ***writers, bool
 	for (int s = 0; s < num_succs; ++s) {
 	  writer->WriteUnsignedInt(regrets[s]);
 	}
-	ptr1 += num_succs * sizeof(T_REGRET);
-	if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-	  ptr1 += num_succs * sizeof(T_SUM_PROB);
-	}
+	ptr1 += stride;
       }
     }
   }
@@ -1159,7 +1166,8 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
     if (seen[st][pa][nt]) return;
     seen[st][pa][nt] = true;
     int num_buckets = buckets_.NumBuckets(st);
-    unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+    unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
+    unsigned int stride = BucketSize(st, pa, num_succs);
     if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
       Reader *reader = readers[pa][st];
       if (char_quantized_streets_[st]) {
@@ -1174,7 +1182,7 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
 	      sum_probs[s] = reader->ReadUnsignedIntOrDie();
 	    }
 	  }
-	  ptr1 += num_succs * (1 + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
       } else if (short_quantized_streets_[st]) {
 	for (int b = 0; b < num_buckets; ++b) {
@@ -1188,7 +1196,7 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
 	      sum_probs[s] = reader->ReadUnsignedIntOrDie();
 	    }
 	  }
-	  ptr1 += num_succs * (2 + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
       } else {
 	for (int b = 0; b < num_buckets; ++b) {
@@ -1203,7 +1211,7 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
 	      sumprobs[s] = reader->ReadUnsignedIntOrDie();
 	    }
 	  }
-	  ptr1 += num_succs * (sizeof(T_REGRET) + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
 	if (boost_thresholds_[st] > 0) {
 	  unique_ptr<unsigned long long int []>
@@ -1211,14 +1219,14 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
 	  for (int s = 0; s < num_succs; ++s) {
 	    succ_total_sumprobs[s] = 0;
 	  }
-	  unsigned char *ptr2 = SUCCPTR(ptr) + num_succs * 8;
+	  unsigned char *ptr2 = BucketData(data_, ptr, num_succs, pad_buckets_);
 	  for (int b = 0; b < num_buckets; ++b) {
 	    T_SUM_PROB *sumprobs =
 	      (T_SUM_PROB *)(ptr2 + num_succs * sizeof(T_REGRET));
 	    for (int s = 0; s < num_succs; ++s) {
 	      succ_total_sumprobs[s] += sumprobs[s];
 	    }
-	    ptr2 += num_succs * (sizeof(T_REGRET) + sizeof(T_SUM_PROB));
+	    ptr2 += stride;
 	  }
 	  while (true) {
 	    bool too_high = false;
@@ -1234,8 +1242,7 @@ void TCFR::ReadSumprobs(unsigned char *ptr, Node *node, Reader ***readers, bool
 	    }
 	  }
 	  int *action_sumprobs = (int *)
-	    (SUCCPTR(ptr) + num_succs * 8 + num_buckets * num_succs *
-	     (sizeof(T_REGRET) + sizeof(T_SUM_PROB)));
+	    (BucketData(data_, ptr, num_succs, pad_buckets_) + num_buckets * stride);
 	  for (int s = 0; s < num_succs; ++s) {
 	    action_sumprobs[s] = succ_total_sumprobs[s];
 	  }
@@ -1264,14 +1271,15 @@ void TCFR::WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers, bool
     if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
       Writer *writer = writers[pa][st];
       int num_buckets = buckets_.NumBuckets(st);
-      unsigned char *ptr1 = SUCCPTR(ptr) + num_succs * 8;
+      unsigned char *ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
+      unsigned int stride = BucketSize(st, pa, num_succs);
       if (char_quantized_streets_[st]) {
 	for (int b = 0; b < num_buckets; ++b) {
 	  T_SUM_PROB *sum_probs = (T_SUM_PROB *)(ptr1 + num_succs);
 	  for (int s = 0; s < num_succs; ++s) {
 	    writer->WriteUnsignedInt(sum_probs[s]);
 	  }
-	  ptr1 += num_succs * (1 + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
       } else if (short_quantized_streets_[st]) {
 	for (int b = 0; b < num_buckets; ++b) {
@@ -1279,7 +1287,7 @@ void TCFR::WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers, bool
 	  for (int s = 0; s < num_succs; ++s) {
 	    writer->WriteUnsignedInt(sum_probs[s]);
 	  }
-	  ptr1 += num_succs * (2 + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
       } else {
 	for (int b = 0; b < num_buckets; ++b) {
@@ -1288,7 +1296,7 @@ void TCFR::WriteSumprobs(unsigned char *ptr, Node *node, Writer ***writers, bool
 	  for (int s = 0; s < num_succs; ++s) {
 	    writer->WriteUnsignedInt(sum_probs[s]);
 	  }
-	  ptr1 += num_succs * (sizeof(T_REGRET) + sizeof(T_SUM_PROB));
+	  ptr1 += stride;
 	}
       }
     }
@@ -1395,8 +1403,7 @@ void TCFR::Read(int batch_index) {
   delete [] sum_prob_readers;
 }
 
-void TCFR::Write(int batch_index) {
-  char dir[500], buf[500];
+void TCFR::CFRDir(char *dir) const {
   sprintf(dir, "%s/%s.%u.%s.%i.%i.%i.%s.%s", Files::NewCFRBase(), Game::GameName().c_str(),
 	  Game::NumPlayers(), card_abstraction_.CardAbstractionName().c_str(), Game::NumRanks(),
 	  Game::NumSuits(), Game::MaxStreet(),
@@ -1407,6 +1414,11 @@ void TCFR::Write(int batch_index) {
     sprintf(buf2, ".p%u", target_player_);
     strcat(dir, buf2);
   }
+}
+
+void TCFR::Write(int batch_index) {
+  char dir[500], buf[500];
+  CFRDir(dir);
   Mkdir(dir);
   int num_players = Game::NumPlayers();
   Writer ***regret_writers = new Writer **[num_players];
@@ -1497,7 +1509,7 @@ void TCFR::Run(void) {
       g_preflop_nums[p][b] = 0ULL;
     }
   }
-  total_its_ = 0ULL;
+  total_its_.store(0ULL, std::memory_order_relaxed);
 
   for (int i = 1; i < num_cfr_threads_; ++i) {
     cfr_threads_[i]->RunThread();
@@ -1506,6 +1518,10 @@ void TCFR::Run(void) {
   fprintf(stderr, "Starting thread 0 in main thread\n");
   cfr_threads_[0]->Run();
   fprintf(stderr, "Finished main thread\n");
+  // Thread 0 pinned the main thread; undo that
+  if (pin_cpus_.size() > 0) {
+    pthread_setaffinity_np(pthread_self(), sizeof(allowed_cpus_), &allowed_cpus_);
+  }
   for (int i = 1; i < num_cfr_threads_; ++i) {
     cfr_threads_[i]->Join();
     fprintf(stderr, "Joined thread %i\n", i);
@@ -1545,37 +1561,27 @@ void TCFR::Run(void) {
 }
 
 void TCFR::RunBatch(int batch_size) {
-  SeedRand(batch_index_);
   fprintf(stderr, "Seeding to %i\n", batch_index_);
-  for (int i = 0; i < kNumPregenRNGs; ++i) {
-    rngs_[i] = RandZeroToOne();
-    // A hack.  We can end up generating 1.0 as an RNG because we are casting
-    // doubles to floats.  Code elsewhere assumes RNGs are strictly less than
-    // 1.0.
-    if (rngs_[i] >= 1.0) rngs_[i] = 0.99999;
-  }
 
   cfr_threads_ = new TCFRThread *[num_cfr_threads_];
   for (int i = 0; i < num_cfr_threads_; ++i) {
     TCFRThread *cfr_thread =
       new TCFRThread(betting_abstraction_, cfr_config_, buckets_, batch_index_, i, 
-		     num_cfr_threads_, data_, target_player_, rngs_, uncompress_, short_uncompress_,
+		     num_cfr_threads_, data_, target_player_, uncompress_, short_uncompress_,
 		     pruning_thresholds_, sumprob_streets_, boost_thresholds_.get(),
 		     freeze_.get(), hvb_table_, cards_to_indices_, num_raw_boards_,
-		     board_table_.get(), batch_size, &total_its_);
+		     board_table_.get(), batch_size, &total_its_, &thread_stats_[i],
+		     pin_cpus_.size() > 0 ? pin_cpus_[i % pin_cpus_.size()] : -1);
     cfr_threads_[i] = cfr_thread;
   }
 
+  unsigned long long int start_process_count = SumProcessCounts(false);
+  unsigned long long int start_full_process_count = SumProcessCounts(true);
   fprintf(stderr, "Running batch %i\n", batch_index_);
   Run();
   fprintf(stderr, "Finished running batch %i\n", batch_index_);
-
-  for (int i = 0; i < num_cfr_threads_; ++i) {
-    total_process_count_ += cfr_threads_[i]->ProcessCount();
-  }
-  for (int i = 0; i < num_cfr_threads_; ++i) {
-    total_full_process_count_ += cfr_threads_[i]->FullProcessCount();
-  }
+  total_process_count_ += SumProcessCounts(false) - start_process_count;
+  total_full_process_count_ += SumProcessCounts(true) - start_full_process_count;
 
   for (int i = 0; i < num_cfr_threads_; ++i) {
     delete cfr_threads_[i];
@@ -1598,6 +1604,7 @@ void TCFR::Run(int start_batch_index, int end_batch_index, int batch_size, int s
   total_process_count_ = 0ULL;
   total_full_process_count_ = 0ULL;
 
+  if (telemetry_interval_ > 0) StartTelemetry(start_batch_index);
   for (batch_index_ = start_batch_index; batch_index_ < end_batch_index; ++batch_index_) {
     RunBatch(batch_size);
     // In general, save every save_interval batches.  The logic is a little messy.  If the save
@@ -1614,6 +1621,7 @@ void TCFR::Run(int start_batch_index, int end_batch_index, int batch_size, int s
       total_full_process_count_ = 0ULL;
     }
   }
+  if (telemetry_interval_ > 0) StopTelemetry();
 }
 
 // Returns a pointer to the allocation buffer after this node and all of its
@@ -1631,10 +1639,12 @@ void TCFR::Run(int start_batch_index, int end_batch_index, int batch_size, int s
 //   Bytes 6-7:   Last-bet-to
 //   Byte 8:      Beginning of succ ptrs
 // The next num-succs * 8 bytes are for the succ ptrs
+// With PadBuckets, padding up to the next cache line
 // For each bucket
 //   num-succs * sizeof(T_REGRET) for the regrets
 //   If saving sumprobs:
 //     num-succs * sizeof(T_SUM_PROB) for the sum-probs
+//   With PadBuckets, padding up to the size given by PaddedBucketSize()
 // If boosting: num_succs * sizeof(T_SUM_PROB) for the action-sum-probs
 unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node, unsigned short last_bet_to,
 			     unsigned long long int ***offsets) {
@@ -1660,8 +1670,11 @@ unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node, unsigned short last
 
   unsigned char *ptr1 = succ_ptr + num_succs * 8;
   if (num_succs > 1) {
+    ptr1 = BucketData(data_, ptr, num_succs, pad_buckets_);
     int num_buckets = buckets_.NumBuckets(st);
+    unsigned int stride = BucketSize(st, pa, num_succs);
     for (int b = 0; b < num_buckets; ++b) {
+      unsigned char *bucket_start = ptr1;
       // Regrets
       if (char_quantized_streets_[st]) {
 	for (int s = 0; s < num_succs; ++s) {
@@ -1686,6 +1699,8 @@ unsigned char *TCFR::Prepare(unsigned char *ptr, Node *node, unsigned short last
 	  ptr1 += sizeof(T_SUM_PROB);
 	}
       }
+      // Skip any padding
+      ptr1 = bucket_start + stride;
     }
     // Action sumprobs
     if (boost_thresholds_[st] > 0 && sumprob_streets_[pa][st] &&
@@ -1750,31 +1765,20 @@ void TCFR::MeasureTree(Node *node, bool ***seen, unsigned long long int *allocat
   if (seen[st][pa][nt]) return;
   seen[st][pa][nt] = true;
   
-  // This is the number of bytes needed for everything else (e.g.,
-  // num-succs).
-  int this_sz = 8;
-
+  // Eight bytes for everything else (e.g., num-succs), and eight bytes per succ.
   int num_succs = node->NumSuccs();
-  // Eight bytes per succ
-  this_sz += num_succs * 8;
+  *allocation_size += 8 + num_succs * 8;
   if (num_succs > 1) {
+    // Must be laid out exactly as Prepare() will, so track the alignment of the bucket data.
+    if (pad_buckets_) *allocation_size = AlignUp(*allocation_size, kCacheLineSize);
     // A regret and a sum-prob for each bucket and succ
-    int nb = buckets_.NumBuckets(st);
-    if (char_quantized_streets_[st]) {
-      this_sz += nb * num_succs;
-    } else if (short_quantized_streets_[st]) {
-      this_sz += nb * num_succs * 2;
-    } else {
-      this_sz += nb * num_succs * sizeof(T_REGRET);
-    }
+    unsigned long long int nb = buckets_.NumBuckets(st);
+    *allocation_size += nb * BucketSize(st, pa, num_succs);
     if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
-      this_sz += nb * num_succs * sizeof(T_SUM_PROB);
-      if (boost_thresholds_[st] > 0) this_sz += num_succs * sizeof(T_SUM_PROB);
+      if (boost_thresholds_[st] > 0) *allocation_size += num_succs * sizeof(T_SUM_PROB);
     }
   }
 
-  *allocation_size += this_sz;
-
   for (int s = 0; s < num_succs; ++s) {
     MeasureTree(node->IthSucc(s), seen, allocation_size);
   }
@@ -1814,11 +1818,7 @@ void TCFR::Prepare(void) {
     exit(-1);
   }
   fprintf(stderr, "Allocation size: %llu\n", allocation_size);
-  data_ = new unsigned char[allocation_size];
-  if (data_ == NULL) {
-    fprintf(stderr, "Could not allocate\n");
-    exit(-1);
-  }
+  AllocateData(allocation_size);
   fprintf(stderr, "Allocated: %llu\n", allocation_size);
 
   unsigned long long int ***offsets =
@@ -1849,6 +1849,81 @@ void TCFR::Prepare(void) {
   delete [] offsets;
 }
 
+// Bytes per bucket at a node: the regrets, plus the sum-probs if we maintain them.
+unsigned int TCFR::BucketSize(int st, int pa, int num_succs) const {
+  unsigned int sz;
+  if (char_quantized_streets_[st]) {
+    sz = num_succs;
+  } else if (short_quantized_streets_[st]) {
+    sz = num_succs * 2;
+  } else {
+    sz = num_succs * sizeof(T_REGRET);
+  }
+  if (sumprob_streets_[pa][st] && (! asymmetric_ || target_player_ == pa)) {
+    sz += num_succs * sizeof(T_SUM_PROB);
+  }
+  if (pad_buckets_) sz = PaddedBucketSize(sz);
+  return sz;
+}
+
+// Returns a bitmask of the online NUMA nodes, parsed from a list like "0-1,3".  Returns 1 (just
+// node 0) if the information is not available.
+static unsigned long long int OnlineNUMANodes(void) {
+  FILE *fp = fopen("/sys/devices/system/node/online", "r");
+  if (fp == NULL) return 1ULL;
+  unsigned long long int mask = 0ULL;
+  int lo, hi;
+  char sep;
+  while (fscanf(fp, "%i", &lo) == 1) {
+    hi = lo;
+    int ret = fscanf(fp, "%c", &sep);
+    if (ret == 1 && sep == '-') {
+      if (fscanf(fp, "%i", &hi) != 1) break;
+      ret = fscanf(fp, "%c", &sep);
+    }
+    for (int n = lo; n <= hi && n < 64; ++n) mask |= 1ULL << n;
+    if (ret != 1 || sep != ',') break;
+  }
+  fclose(fp);
+  return mask == 0ULL ? 1ULL : mask;
+}
+
+// By default the tree data is plain heap memory.  With HugePages, InterleaveData or PadBuckets we
+// mmap anonymous memory instead, which is page aligned (PadBuckets computes alignment relative to
+// the start of data_) and zero filled.  The NUMA policy must be set before Prepare() first touches
+// the pages.
+void TCFR::AllocateData(unsigned long long int size) {
+  bool huge_pages = cfr_config_.HugePages();
+  bool interleave = cfr_config_.InterleaveData();
+  mapped_data_ = huge_pages || interleave || pad_buckets_;
+  if (! mapped_data_) {
+    data_ = new unsigned char[size];
+    data_size_ = size;
+    return;
+  }
+  // Round up to a multiple of the 2MB huge page size
+  data_size_ = AlignUp(size, 1ULL << 21);
+  void *addr = mmap(NULL, data_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (addr == MAP_FAILED) {
+    fprintf(stderr, "Could not mmap %llu bytes\n", data_size_);
+    exit(-1);
+  }
+  data_ = (unsigned char *)addr;
+  if (huge_pages && madvise(addr, data_size_, MADV_HUGEPAGE) != 0) {
+    fprintf(stderr, "madvise(MADV_HUGEPAGE) failed; continuing with normal pages\n");
+  }
+  if (interleave) {
+    unsigned long long int nodes = OnlineNUMANodes();
+    if (__builtin_popcountll(nodes) > 1) {
+      if (syscall(SYS_mbind, addr, data_size_, MPOL_INTERLEAVE, &nodes, 64, 0) != 0) {
+	fprintf(stderr, "mbind(MPOL_INTERLEAVE) failed; continuing without interleaving\n");
+      } else {
+	fprintf(stderr, "Interleaving data across %i NUMA nodes\n", __builtin_popcountll(nodes));
+      }
+    }
+  }
+}
+
 static int Factorial(int n) {
   if (n == 0) return 1;
   if (n == 1) return 1;
@@ -1884,6 +1959,11 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba, const CFRCon
   target_player_ = target_player;
   num_cfr_threads_ = num_threads;
   fprintf(stderr, "Num threads: %i\n", num_cfr_threads_);
+  thread_stats_.reset(new TCFRThreadStats[num_cfr_threads_]);
+  telemetry_interval_ = cfr_config_.TelemetryInterval();
+  pthread_mutex_init(&telemetry_mutex_, NULL);
+  pthread_cond_init(&telemetry_cond_, NULL);
+  telemetry_quit_ = false;
   for (int st = 0; st <= max_street_; ++st) {
     if (buckets_.None(st)) {
       fprintf(stderr, "TCFR expects buckets on all streets\n");
@@ -1995,9 +2075,21 @@ TCFR::TCFR(const CardAbstraction &ca, const BettingAbstraction &ba, const CFRCon
   BoardTree::DeleteBoardCounts();
 #endif
 
+  pad_buckets_ = cfr_config_.PadBuckets();
   Prepare();
 
-  rngs_ = new float[kNumPregenRNGs];
+  // Pin thread i to the i'th CPU we are allowed to run on
+  CPU_ZERO(&allowed_cpus_);
+  if (cfr_config_.PinThreads()) {
+    if (sched_getaffinity(0, sizeof(allowed_cpus_), &allowed_cpus_) != 0) {
+      fprintf(stderr, "sched_getaffinity failed\n");
+      exit(-1);
+    }
+    for (int c = 0; c < CPU_SETSIZE; ++c) {
+      if (CPU_ISSET(c, &allowed_cpus_)) pin_cpus_.push_back(c);
+    }
+  }
+
   uncompress_ = new unsigned int[256];
   for (unsigned int c = 0; c <= 255; ++c) {
     uncompress_[c] = UncompressRegret(c);
@@ -2085,10 +2177,121 @@ TCFR::~TCFR(void) {
   delete [] pruning_thresholds_;
   delete [] uncompress_;
   delete [] short_uncompress_;
-  delete [] rngs_;
-  delete [] data_;
+  if (mapped_data_) munmap(data_, data_size_);
+  else              delete [] data_;
   for (int p = 0; p < num_players_; ++p) {
     delete [] sumprob_streets_[p];
   }
   delete [] sumprob_streets_;
+  pthread_cond_destroy(&telemetry_cond_);
+  pthread_mutex_destroy(&telemetry_mutex_);
+}
+
+unsigned long long int TCFR::SumProcessCounts(bool full) const {
+  unsigned long long int sum = 0ULL;
+  for (int i = 0; i < num_cfr_threads_; ++i) {
+    const TCFRThreadStats &stats = thread_stats_[i];
+    sum += (full ? stats.full_process_count : stats.process_count).load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+// Telemetry.  A separate thread wakes up every TelemetryInterval seconds, sums the counters of
+// the CFR threads and reports rates over the last interval.  One line goes to stderr; one
+// tab-separated line goes to the stats file in the CFR directory.  The columns of the stats file
+// are given by its header line.
+
+static void *telemetry_thread_run(void *v_t) {
+  TCFR *t = (TCFR *)v_t;
+  t->TelemetryLoop();
+  return NULL;
+}
+
+static double Seconds(const struct timespec &ts) {
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void TCFR::StartTelemetry(int start_batch_index) {
+  char dir[500], buf[500];
+  CFRDir(dir);
+  Mkdir(dir);
+  sprintf(buf, "%s/tcfr_stats.%i", dir, start_batch_index);
+  stats_writer_.reset(new Writer(buf));
+  string header = "secs\tits\tits_per_sec\tprocess_per_sec\tfull_process_per_sec\tfull_frac";
+  for (int st = 0; st <= max_street_; ++st) {
+    header += "\tst" + std::to_string(st) + "_visits_per_sec";
+  }
+  header += "\n";
+  stats_writer_->WriteText(header.c_str());
+  stats_writer_->Flush();
+  // its, process count, full process count, then visits by street
+  last_telemetry_counts_.reset(new unsigned long long int[max_street_ + 4]);
+  for (int i = 0; i < max_street_ + 4; ++i) last_telemetry_counts_[i] = 0ULL;
+  telemetry_quit_ = false;
+  pthread_create(&telemetry_pthread_id_, NULL, telemetry_thread_run, this);
+}
+
+void TCFR::StopTelemetry(void) {
+  pthread_mutex_lock(&telemetry_mutex_);
+  telemetry_quit_ = true;
+  pthread_cond_signal(&telemetry_cond_);
+  pthread_mutex_unlock(&telemetry_mutex_);
+  pthread_join(telemetry_pthread_id_, NULL);
+  stats_writer_.reset(nullptr);
+}
+
+void TCFR::TelemetryLoop(void) {
+  struct timespec start, last, now, deadline;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  last = start;
+  pthread_mutex_lock(&telemetry_mutex_);
+  while (! telemetry_quit_) {
+    // pthread_cond_timedwait() uses the realtime clock by default
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += telemetry_interval_;
+    while (! telemetry_quit_) {
+      if (pthread_cond_timedwait(&telemetry_cond_, &telemetry_mutex_, &deadline) != 0) break;
+    }
+    if (telemetry_quit_) break;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    ReportTelemetry(Seconds(now) - Seconds(start), Seconds(now) - Seconds(last));
+    last = now;
+  }
+  pthread_mutex_unlock(&telemetry_mutex_);
+}
+
+void TCFR::ReportTelemetry(double elapsed, double interval) {
+  int num_counts = max_street_ + 4;
+  unique_ptr<unsigned long long int []> counts(new unsigned long long int[num_counts]);
+  for (int i = 0; i < num_counts; ++i) counts[i] = 0ULL;
+  for (int t = 0; t < num_cfr_threads_; ++t) {
+    const TCFRThreadStats &stats = thread_stats_[t];
+    counts[0] += stats.its.load(std::memory_order_relaxed);
+    counts[1] += stats.process_count.load(std::memory_order_relaxed);
+    counts[2] += stats.full_process_count.load(std::memory_order_relaxed);
+    for (int st = 0; st <= max_street_; ++st) {
+      counts[3 + st] += stats.street_visits[st].load(std::memory_order_relaxed);
+    }
+  }
+  unique_ptr<double []> rates(new double[num_counts]);
+  for (int i = 0; i < num_counts; ++i) {
+    rates[i] = (counts[i] - last_telemetry_counts_[i]) / interval;
+    last_telemetry_counts_[i] = counts[i];
+  }
+  double full_frac = rates[1] > 0 ? rates[2] / rates[1] : 0;
+  fprintf(stderr, "Telemetry %.0fs: its %llu (%.0f/s) process %.0f/s full %.1f%% visits/s",
+	  elapsed, counts[0], rates[0], rates[1], 100.0 * full_frac);
+  for (int st = 0; st <= max_street_; ++st) fprintf(stderr, " %.0f", rates[3 + st]);
+  fprintf(stderr, "\n");
+  char buf[100];
+  sprintf(buf, "%.3f\t%llu\t%.1f\t%.1f\t%.1f\t%.4f", elapsed, counts[0], rates[0], rates[1],
+	  rates[2], full_frac);
+  string line = buf;
+  for (int st = 0; st <= max_street_; ++st) {
+    sprintf(buf, "\t%.1f", rates[3 + st]);
+    line += buf;
+  }
+  line += "\n";
+  stats_writer_->WriteText(line.c_str());
+  stats_writer_->Flush();
 }
@@ -1,9 +1,15 @@
 #ifndef _TCFR_H_
 #define _TCFR_H_
 
+#include <pthread.h>
+#include <sched.h>
+
+#include <atomic>
 #include <memory>
+#include <vector>
 
 // #include "cfr.h"
+#include "sampler.h"
 
 using namespace std;
 
@@ -22,26 +28,33 @@ class Writer;
 
 #define SUCCPTR(ptr) (ptr + 8)
 
-static const int kNumPregenRNGs = 10000000;
+// Running counts for one TCFR thread.  Only the thread itself writes them, but the telemetry
+// thread reads them while CFR is running, so they are atomics.  Aligned so that different threads'
+// counters don't share a cache line.
+struct alignas(64) TCFRThreadStats {
+  TCFRThreadStats(void);
+  std::atomic<unsigned long long int> its;
+  std::atomic<unsigned long long int> process_count;
+  std::atomic<unsigned long long int> full_process_count;
+  // Nonterminal nodes visited on each street
+  std::unique_ptr<std::atomic<unsigned long long int> []> street_visits;
+};
 
 class TCFRThread {
 public:
   TCFRThread(const BettingAbstraction &ba, const CFRConfig &cc, const Buckets &buckets,
 	     int batch_index, int thread_index, int num_threads, unsigned char *data,
-	     int target_player, float *rngs, unsigned int *uncompress,
+	     int target_player, unsigned int *uncompress,
 	     unsigned int *short_uncompress, unsigned int *pruning_thresholds,
 	     bool **sumprob_streets, const double *boost_thresholds, const bool *freeze,
 	     unsigned char *hvb_table, unsigned char ***cards_to_indices, int num_raw_boards,
-	     const int *board_table_, int batch_size, unsigned long long int *total_its);
+	     const int *board_table_, int batch_size,
+	     std::atomic<unsigned long long int> *total_its, TCFRThreadStats *stats, int cpu);
   virtual ~TCFRThread(void);
   void RunThread(void);
   void Join(void);
   void Run(void);
   int ThreadIndex(void) const {return thread_index_;}
-  unsigned long long int ProcessCount(void) const {return process_count_;}
-  unsigned long long int FullProcessCount(void) const {
-    return full_process_count_;
-  }
  protected:
   static const int kStackDepth = 500;
   static const int kMaxSuccs = 50;
@@ -58,6 +71,9 @@ public:
   int thread_index_;
   int num_threads_;
   unsigned char *data_;
+  bool pad_buckets_;
+  // CPU to pin this thread to, or -1
+  int cpu_;
   bool asymmetric_;
   int num_players_;
   int target_player_;
@@ -80,8 +96,6 @@ public:
   double explore_;
   unsigned int *sumprob_ceilings_;
   unsigned long long int it_;
-  float *rngs_;
-  int rng_index_;
   unique_ptr<bool []> char_quantized_streets_;
   unique_ptr<bool []> short_quantized_streets_;
   bool *scaled_streets_;
@@ -101,8 +115,7 @@ public:
   bool all_full_;
   bool *full_;
   unique_ptr<unsigned int []> close_thresholds_;
-  unsigned long long int process_count_;
-  unsigned long long int full_process_count_;
+  TCFRThreadStats *stats_;
   int active_mod_;
   int num_active_conditions_;
   int *num_active_streets_;
@@ -110,8 +123,10 @@ public:
   int **active_streets_;
   int **active_rems_;
   int batch_size_;
-  unsigned long long int *total_its_;
-  struct drand48_data rand_buf_;
+  std::atomic<unsigned long long int> *total_its_;
+  RNG rng_;
+  // Bit c set for every card in the deck
+  unsigned long long int full_deck_;
   // Keep this as a signed int so we can use it in winnings calculation
   // without casting.
   int board_count_;
@@ -125,6 +140,9 @@ public:
        const Buckets &buckets, int num_threads, int target_player);
   ~TCFR(void);
   void Run(int start_batch_index, int end_batch_index, int batch_size, int save_interval);
+  // Overrides the TelemetryInterval from the CFR config.  Zero turns telemetry off.
+  void SetTelemetryInterval(int secs) {telemetry_interval_ = secs;}
+  void TelemetryLoop(void);
 private:
   void ReadRegrets(unsigned char *ptr, Node *node, Reader ***readers, bool ***seen);
   void WriteRegrets(unsigned char *ptr, Node *node, Writer ***writers, bool ***seen);
@@ -138,6 +156,13 @@ private:
 			 unsigned long long int ***offsets);
   void MeasureTree(Node *node, bool ***seen, unsigned long long int *allocation_size);
   void Prepare(void);
+  unsigned int BucketSize(int st, int pa, int num_succs) const;
+  void AllocateData(unsigned long long int size);
+  void CFRDir(char *dir) const;
+  unsigned long long int SumProcessCounts(bool full) const;
+  void StartTelemetry(int start_batch_index);
+  void StopTelemetry(void);
+  void ReportTelemetry(double elapsed, double interval);
 
   const CardAbstraction &card_abstraction_;
   const BettingAbstraction &betting_abstraction_;
@@ -150,10 +175,16 @@ private:
   int num_players_;
   int target_player_;
   unsigned char *data_;
+  unsigned long long int data_size_;
+  // True if data_ was mmapped rather than allocated with new
+  bool mapped_data_;
+  bool pad_buckets_;
+  cpu_set_t allowed_cpus_;
+  // Empty unless pinning threads
+  vector<int> pin_cpus_;
   int batch_index_;
   int num_cfr_threads_;
   TCFRThread **cfr_threads_;
-  float *rngs_;
   unsigned int *uncompress_;
   unsigned int *short_uncompress_;
   int max_street_;
@@ -167,7 +198,18 @@ private:
   unique_ptr<int []> board_table_;
   unsigned long long int total_process_count_;
   unsigned long long int total_full_process_count_;
-  unsigned long long int total_its_;
+  std::atomic<unsigned long long int> total_its_;
+  // Indexed by thread.  Persist across batches.
+  unique_ptr<TCFRThreadStats []> thread_stats_;
+  // Seconds between telemetry reports; zero if telemetry is off
+  int telemetry_interval_;
+  pthread_t telemetry_pthread_id_;
+  pthread_mutex_t telemetry_mutex_;
+  pthread_cond_t telemetry_cond_;
+  bool telemetry_quit_;
+  unique_ptr<Writer> stats_writer_;
+  // Totals as of the last telemetry report
+  unique_ptr<unsigned long long int []> last_telemetry_counts_;
 };
 
 #endif
@@ -8,6 +8,7 @@
 #include "cfr_values.h"
 #include "game.h"
 #include "hand_tree.h"
+#include "instrument.h"
 #include "reach_probs.h"
 #include "unsafe_eg_cfr.h"
 #include "vcfr_state.h"
@@ -27,6 +28,7 @@ void UnsafeEGCFR::SolveSubgame(BettingTrees *subtrees, int solve_bd, const Reach
 			       const string &action_sequence, const HandTree *hand_tree,
 			       double *opp_cvs, int target_p, bool both_players, int num_its) {
   int subtree_st = subtrees->Root()->Street();
+  SCOPED_TIMER(kTimerSolveSubgame, subtree_st);
   int num_players = Game::NumPlayers();
   int max_street = Game::MaxStreet();
   
@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+#include "value_arena.h"
+
+// Allocations are rounded up to a whole number of cache lines so that every vector handed out
+// starts on a cache line boundary.
+static const size_t kDoublesPerLine = 8;
+
+ValueArena::ValueArena(void) : cur_block_(0), cur_offset_(0), depth_(0) {
+}
+
+double *ValueArena::Allocate(size_t num) {
+  size_t rounded = (num + kDoublesPerLine - 1) & ~(kDoublesPerLine - 1);
+  if (rounded == 0) rounded = kDoublesPerLine;
+  int num_blocks = blocks_.size();
+  // Skip over any blocks too small to hold this request.  The skipped space is wasted only until
+  // the enclosing frame closes.
+  while (cur_block_ < num_blocks && cur_offset_ + rounded > block_sizes_[cur_block_]) {
+    ++cur_block_;
+    cur_offset_ = 0;
+  }
+  if (cur_block_ == num_blocks) {
+    size_t block_size = kMinBlockSize;
+    if (num_blocks > 0 && 2 * block_sizes_[num_blocks - 1] > block_size) {
+      block_size = 2 * block_sizes_[num_blocks - 1];
+    }
+    if (rounded > block_size) block_size = rounded;
+    double *p = (double *)aligned_alloc(kDoublesPerLine * sizeof(double),
+					block_size * sizeof(double));
+    if (p == nullptr) {
+      fprintf(stderr, "ValueArena: failed to allocate %zu bytes\n", block_size * sizeof(double));
+      exit(-1);
+    }
+    blocks_.emplace_back(p);
+    block_sizes_.push_back(block_size);
+  }
+  double *ret = blocks_[cur_block_].get() + cur_offset_;
+  cur_offset_ += rounded;
+  if (depth_ > 0) {
+    size_t frame_bytes = (frame_sizes_[depth_ - 1] += rounded) * sizeof(double);
+    if (frame_bytes > max_bytes_by_depth_[depth_ - 1]) {
+      max_bytes_by_depth_[depth_ - 1] = frame_bytes;
+    }
+  }
+  return ret;
+}
+
+ValueArena::Mark ValueArena::OpenFrame(void) {
+  if ((int)frame_sizes_.size() == depth_) {
+    frame_sizes_.push_back(0);
+    max_bytes_by_depth_.push_back(0);
+  }
+  frame_sizes_[depth_] = 0;
+  ++depth_;
+  Mark mark;
+  mark.block = cur_block_;
+  mark.offset = cur_offset_;
+  return mark;
+}
+
+void ValueArena::CloseFrame(const Mark &mark) {
+  --depth_;
+  cur_block_ = mark.block;
+  cur_offset_ = mark.offset;
+}
+
+void ValueArena::Reset(void) {
+  if (depth_ != 0) {
+    fprintf(stderr, "ValueArena::Reset() called with %i frames open\n", depth_);
+    exit(-1);
+  }
+  cur_block_ = 0;
+  cur_offset_ = 0;
+}
+
+void ValueArena::Clear(void) {
+  Reset();
+  blocks_.clear();
+  block_sizes_.clear();
+}
+
+size_t ValueArena::BytesReserved(void) const {
+  size_t sum = 0;
+  for (size_t b : block_sizes_) sum += b * sizeof(double);
+  return sum;
+}
+
+size_t ValueArena::MaxBytesAtDepth(int d) const {
+  if (d < 0 || d >= (int)max_bytes_by_depth_.size()) return 0;
+  return max_bytes_by_depth_[d];
+}
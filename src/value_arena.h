@@ -0,0 +1,66 @@
+#ifndef _VALUE_ARENA_H_
+#define _VALUE_ARENA_H_
+
+#include <stdlib.h>
+
+#include <memory>
+#include <vector>
+
+// A ValueArena supplies the per-node vectors (values, successor values, successor opponent reach
+// probabilities, etc.) used by one thread during a VCFR traversal.  Allocation is stack-like: a
+// node opens an ArenaFrame on entry, allocates what it needs, and everything allocated in the
+// frame is released when the frame goes out of scope.  Blocks are never freed (until Clear() is
+// called) so after the first iteration a traversal does no heap allocation at all.
+//
+// Not thread-safe; each thread needs its own arena.
+class ValueArena {
+public:
+  ValueArena(void);
+  ~ValueArena(void) {}
+  // The returned memory is uninitialized and aligned on a cache line boundary.
+  double *Allocate(size_t num);
+  // Releases everything.  Should only be called when no frames are open; e.g., at the start of
+  // each iteration.
+  void Reset(void);
+  // Releases everything and frees the blocks.
+  void Clear(void);
+  int Depth(void) const {return depth_;}
+  size_t BytesReserved(void) const;
+  // The maximum number of bytes allocated by any one frame at the given depth.
+  size_t MaxBytesAtDepth(int d) const;
+  int MaxDepth(void) const {return max_bytes_by_depth_.size();}
+
+  struct Mark {
+    int block;
+    size_t offset;
+  };
+  Mark OpenFrame(void);
+  void CloseFrame(const Mark &mark);
+private:
+  struct FreeDeleter {
+    void operator()(double *p) const {free(p);}
+  };
+
+  static const size_t kMinBlockSize = 1 << 16;
+
+  std::vector<std::unique_ptr<double [], FreeDeleter>> blocks_;
+  std::vector<size_t> block_sizes_;
+  int cur_block_;
+  size_t cur_offset_;
+  int depth_;
+  // Number of doubles allocated so far by the open frame at each depth
+  std::vector<size_t> frame_sizes_;
+  std::vector<size_t> max_bytes_by_depth_;
+};
+
+// RAII helper for opening and closing a frame on a ValueArena.
+class ArenaFrame {
+public:
+  explicit ArenaFrame(ValueArena *arena) : arena_(arena), mark_(arena->OpenFrame()) {}
+  ~ArenaFrame(void) {arena_->CloseFrame(mark_);}
+private:
+  ValueArena *arena_;
+  ValueArena::Mark mark_;
+};
+
+#endif
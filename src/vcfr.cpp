@@ -1,7 +1,6 @@
 #include <math.h> // lrint()
 #include <stdio.h>
 #include <stdlib.h>
-#include <unistd.h> // usleep()
 
 #include <memory>
 #include <string>
@@ -18,6 +17,7 @@
 #include "cfr_utils.h"
 #include "cfr_values.h"
 #include "hand_tree.h"
+#include "instrument.h"
 #include "vcfr_state.h"
 #include "vcfr.h"
 
@@ -27,87 +27,23 @@ using std::unique_ptr;
 using std::vector;
 
 template <>
-void VCFR::UpdateRegrets<int>(Node *node, double *vals, shared_ptr<double []> *succ_vals,
-			      int *regrets) {
+void VCFR::UpdateRegrets<int>(Node *node, double *vals, double **succ_vals, int *regrets) {
   int st = node->Street();
-  int num_succs = node->NumSuccs();
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-
-  int floor = regret_floors_[st];
-  int ceiling = regret_ceilings_[st];
-  if (nn_regrets_) {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
-      int *my_regrets = regrets + i * num_succs;
-      for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
-	// Need different implementation for doubles
-	int di = lrint(d * regret_scaling_[st]);
-	int ri = my_regrets[s] + di;
-	if (ri < floor) {
-	  my_regrets[s] = floor;
-	} else if (ri > ceiling) {
-	  my_regrets[s] = ceiling;
-	} else {
-	  my_regrets[s] = ri;
-	}
-      }
-    }
-  } else {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
-      int *my_regrets = regrets + i * num_succs;
-      bool overflow = false;
-      for (int s = 0; s < num_succs; ++s) {
-	double d = succ_vals[s][i] - vals[i];
-	my_regrets[s] += lrint(d * regret_scaling_[st]);
-	if (my_regrets[s] < -2000000000 || my_regrets[s] > 2000000000) {
-	  overflow = true;
-	}
-      }
-      if (overflow) {
-	for (int s = 0; s < num_succs; ++s) {
-	  my_regrets[s] /= 2;
-	}
-      }
-    }
-  }
+  UpdateHandRegrets(regrets, Game::NumHoleCardPairs(st), node->NumSuccs(), vals, succ_vals,
+		    nn_regrets_, regret_scaling_[st], regret_floors_[st], regret_ceilings_[st]);
 }
 
 // This implementation does not round regrets to ints, nor do scaling.
 template <>
-void VCFR::UpdateRegrets<double>(Node *node, double *vals, shared_ptr<double []> *succ_vals,
+void VCFR::UpdateRegrets<double>(Node *node, double *vals, double **succ_vals,
 				 double *regrets) {
   int st = node->Street();
-  int num_succs = node->NumSuccs();
-  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  
-  double floor = regret_floors_[st];
-  double ceiling = regret_ceilings_[st];
-  if (nn_regrets_) {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
-      double *my_regrets = regrets + i * num_succs;
-      for (int s = 0; s < num_succs; ++s) {
-	double newr = my_regrets[s] + succ_vals[s][i] - vals[i];
-	if (newr < floor) {
-	  my_regrets[s] = floor;
-	} else if (newr > ceiling) {
-	  my_regrets[s] = ceiling;
-	} else {
-	  my_regrets[s] = newr;
-	}
-      }
-    }
-  } else {
-    for (int i = 0; i < num_hole_card_pairs; ++i) {
-      double *my_regrets = regrets + i * num_succs;
-      for (int s = 0; s < num_succs; ++s) {
-	my_regrets[s] += succ_vals[s][i] - vals[i];
-      }
-    }
-  }
+  UpdateHandRegrets(regrets, Game::NumHoleCardPairs(st), node->NumSuccs(), vals, succ_vals,
+		    nn_regrets_, regret_floors_[st], regret_ceilings_[st]);
 }
 
 // This is ugly, but I can't figure out a better way.
-void VCFR::UpdateRegrets(Node *node, int lbd, double *vals, shared_ptr<double []> *succ_vals) {
+void VCFR::UpdateRegrets(Node *node, int lbd, double *vals, double **succ_vals) {
   int pa = node->PlayerActing();
   int st = node->Street();
   int nt = node->NonterminalID();
@@ -115,6 +51,8 @@ void VCFR::UpdateRegrets(Node *node, int lbd, double *vals, shared_ptr<double []
   int num_succs = node->NumSuccs();
   CFRStreetValues<double> *d_street_values;
   CFRStreetValues<int> *i_street_values;
+  CFRStreetValues<unsigned char> *c_street_values;
+  CFRStreetValues<unsigned short> *s_street_values;
   AbstractCFRStreetValues *street_values = regrets_->StreetValues(st);
   if ((d_street_values =
        dynamic_cast<CFRStreetValues<double> *>(street_values))) {
@@ -126,11 +64,33 @@ void VCFR::UpdateRegrets(Node *node, int lbd, double *vals, shared_ptr<double []
     int *board_regrets = i_street_values->AllValues(pa, nt) +
       lbd * num_hole_card_pairs * num_succs;
     UpdateRegrets(node, vals, succ_vals, board_regrets);
+  } else if ((c_street_values =
+	      dynamic_cast<CFRStreetValues<unsigned char> *>(street_values))) {
+    unsigned char *board_regrets = c_street_values->AllValues(pa, nt) +
+      lbd * num_hole_card_pairs * num_succs;
+    UpdateHandRegrets(board_regrets, c_street_values->Scales(pa, nt) + lbd, num_hole_card_pairs,
+		      num_succs, vals, succ_vals, QuantizationSeed(pa, nt, lbd));
+  } else if ((s_street_values =
+	      dynamic_cast<CFRStreetValues<unsigned short> *>(street_values))) {
+    unsigned short *board_regrets = s_street_values->AllValues(pa, nt) +
+      lbd * num_hole_card_pairs * num_succs;
+    UpdateHandRegrets(board_regrets, s_street_values->Scales(pa, nt) + lbd, num_hole_card_pairs,
+		      num_succs, vals, succ_vals, QuantizationSeed(pa, nt, lbd));
   }
 }
 
+// Seeds the stochastic rounding of quantized regrets.  Depends only on the iteration and the
+// position of the regrets, so results don't depend on the number of threads.
+unsigned int VCFR::QuantizationSeed(int pa, int nt, int lbd) const {
+  unsigned int seed = it_;
+  seed = seed * 1000003u + pa;
+  seed = seed * 1000003u + nt;
+  seed = seed * 1000003u + lbd;
+  return seed * 2654435761u;
+}
+
 void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals, int *regrets) {
+				 double **succ_vals, int *regrets) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
@@ -178,7 +138,7 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
 
 // This implementation does not round regrets to ints, nor do scaling.
 void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals, double *regrets) {
+				 double **succ_vals, double *regrets) {
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
@@ -212,7 +172,7 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
 }
 
 void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				 shared_ptr<double []> *succ_vals) {
+				 double **succ_vals) {
   int pa = node->PlayerActing();
   int st = node->Street();
   int nt = node->NonterminalID();
@@ -230,99 +190,120 @@ void VCFR::UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
   }
 }
 
-shared_ptr<double []> VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state) {
+void VCFR::OurChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, double *vals) {
   int pa = p0_node->PlayerActing();
   Node *node = pa == 0 ? p0_node : p1_node;
   Node *responding_node = pa == 0 ? p1_node : p0_node;
   int st = node->Street();
   int num_succs = node->NumSuccs();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  int nt = node->NonterminalID();
   int lbd = state->LocalBoardIndex(st, gbd);
   unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
-  shared_ptr<double []> vals;
-  unique_ptr< shared_ptr<double []> []> succ_vals(new shared_ptr<double []> [num_succs]);
+  if (num_succs > kMaxSuccs) {
+    fprintf(stderr, "Too many succs: %i\n", num_succs);
+    exit(-1);
+  }
+  ValueArena *arena = state->Arena();
+  ArenaFrame frame(arena);
+  // Our actions don't change the opponent reach probabilities, so all of our terminal succs
+  // (typically a fold and a showdown) can share one pass of TerminalProbs().  We give the
+  // results only to the succ states; this state may be reused after we return.
+  bool any_terminal = false, any_showdown = false;
   for (int s = 0; s < num_succs; ++s) {
+    Node *p0_succ = p0_node->IthSucc(pa == 0 ? s : succ_mapping[s]);
+    if (p0_succ->Terminal()) {
+      any_terminal = true;
+      if (p0_succ->NumRemaining() > 1) any_showdown = true;
+    }
+  }
+  double *fold_probs = state->FoldProbs(), *showdown_probs = state->ShowdownProbs();
+  if (any_terminal && (fold_probs == nullptr || (any_showdown && showdown_probs == nullptr))) {
+    fold_probs = arena->Allocate(num_hole_card_pairs);
+    showdown_probs = any_showdown ? arena->Allocate(num_hole_card_pairs) : nullptr;
+    SCOPED_TIMER(kTimerTerminalEval, st);
+    TerminalProbs(state->Hands(st, gbd), state->OppProbs(), fold_probs, showdown_probs);
+  }
+  double *succ_vals[kMaxSuccs];
+  for (int s = 0; s < num_succs; ++s) {
+    // With only one succ its values are our values
+    succ_vals[s] = num_succs == 1 ? vals : arena->Allocate(num_hole_card_pairs);
     int p0_s = pa == 0 ? s : succ_mapping[s];
     int p1_s = pa == 0 ? succ_mapping[s] : s;
     VCFRState succ_state(*state, node, s);
-    succ_vals[s] = Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd, &succ_state, st);
+    succ_state.SetTerminalProbs(fold_probs, showdown_probs);
+    Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd, &succ_state, st, succ_vals[s]);
   }
-  if (num_succs == 1) {
-    vals = succ_vals[0];
+  if (num_succs > 1) {
+    OurVals(node, lbd, state->StreetBuckets(st), succ_vals, vals);
+  }
+}
+
+// Computes the values of our hands at an our-choice node from the values of the succs and, if we
+// are running CFR, updates the regrets.  Only called when there are at least two succs.
+void VCFR::OurVals(Node *node, int lbd, int *street_buckets, double **succ_vals, double *vals) {
+  int pa = node->PlayerActing();
+  int st = node->Street();
+  int num_succs = node->NumSuccs();
+  int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+  int nt = node->NonterminalID();
+  for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+  if (best_response_streets_[st]) {
+    for (int i = 0; i < num_hole_card_pairs; ++i) {
+      double max_val = succ_vals[0][i];
+      for (int s = 1; s < num_succs; ++s) {
+	double sv = succ_vals[s][i];
+	if (sv > max_val) {max_val = sv;}
+      }
+      vals[i] = max_val;
+    }
   } else {
-    int *street_buckets = state->StreetBuckets(st);
-    vals.reset(new double[num_hole_card_pairs]);
-    for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
-    if (best_response_streets_[st]) {
+    int dsi = node->DefaultSuccIndex();
+    bool bucketed = ! buckets_.None(st) &&
+      node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+    if (bucketed && ! value_calculation_) {
+      // This is true when we are running CFR+ on a bucketed system.  We don't want to get the
+      // current strategy from the regrets during the iteration, because the regrets for each
+      // bucket are in an intermediate state.  Instead we compute the current strategy once at the
+      // beginning of each iteration.  current_strategy_ always contains doubles.
+      CFRStreetValues<double> *street_values =
+	dynamic_cast< CFRStreetValues<double> *>(
+		      current_strategy_->StreetValues(st));
       for (int i = 0; i < num_hole_card_pairs; ++i) {
-	double max_val = succ_vals[0][i];
-	for (int s = 1; s < num_succs; ++s) {
-	  double sv = succ_vals[s][i];
-	  if (sv > max_val) {max_val = sv;}
+	int b = street_buckets[i];
+	double *current_probs =
+	  street_values->AllValues(pa, nt) + b * num_succs;
+	for (int s = 0; s < num_succs; ++s) {
+	  vals[i] += succ_vals[s][i] * current_probs[s];
 	}
-	vals[i] = max_val;
       }
     } else {
-      int dsi = node->DefaultSuccIndex();
-      bool bucketed = ! buckets_.None(st) &&
-	node->LastBetTo() < card_abstraction_.BucketThreshold(st);
-      if (bucketed && ! value_calculation_) {
-	// This is true when we are running CFR+ on a bucketed system.  We don't want to get the
-	// current strategy from the regrets during the iteration, because the regrets for each
-	// bucket are in an intermediate state.  Instead we compute the current strategy once at the
-	// beginning of each iteration.  current_strategy_ always contains doubles.
-	CFRStreetValues<double> *street_values =
-	  dynamic_cast< CFRStreetValues<double> *>(
-			current_strategy_->StreetValues(st));
-	for (int i = 0; i < num_hole_card_pairs; ++i) {
-	  int b = street_buckets[i];
-	  double *current_probs =
-	    street_values->AllValues(pa, nt) + b * num_succs;
-	  for (int s = 0; s < num_succs; ++s) {
-	    vals[i] += succ_vals[s][i] * current_probs[s];
-	  }
-	}
+      AbstractCFRStreetValues *street_values;
+      if (value_calculation_) {
+	street_values = sumprobs_->StreetValues(st);
       } else {
-	AbstractCFRStreetValues *street_values;
-	if (value_calculation_) {
-	  street_values = sumprobs_->StreetValues(st);
-	} else {
-	  street_values = regrets_->StreetValues(st);
-	}
-	unique_ptr<double []> current_probs(new double[num_succs]);
-	if (bucketed) {
-	  street_values->ComputeOurValsBucketed(pa, nt, num_hole_card_pairs, num_succs, dsi,
-						succ_vals.get(), street_buckets, vals);
-	} else {
-	  street_values->ComputeOurVals(pa, nt, num_hole_card_pairs, num_succs, dsi,
-					succ_vals.get(), lbd, vals);
-#if 0
-	  for (int i = 0; i < num_hole_card_pairs; ++i) {
-	    int offset = lbd * num_hole_card_pairs * num_succs + i * num_succs;
-	    street_values->RMProbs(pa, nt, offset, num_succs, dsi, current_probs.get());
-	    for (int s = 0; s < num_succs; ++s) {
-	      vals[i] += succ_vals[s][i] * current_probs[s];
-	    }
-	  }
-#endif
-	}
+	street_values = regrets_->StreetValues(st);
       }
-      if (! value_calculation_ && ! pre_phase_) {
-	if (bucketed) {
-	  UpdateRegretsBucketed(node, state->StreetBuckets(st), vals.get(), succ_vals.get());
-	} else {
-	  // Need values for current board if this is unabstracted system
-	  UpdateRegrets(node, lbd, vals.get(), succ_vals.get());
-	}
+      if (bucketed) {
+	street_values->ComputeOurValsBucketed(pa, nt, num_hole_card_pairs, num_succs, dsi,
+					      succ_vals, street_buckets, vals);
+      } else {
+	street_values->ComputeOurVals(pa, nt, num_hole_card_pairs, num_succs, dsi,
+				      succ_vals, lbd, vals);
+      }
+    }
+    if (! value_calculation_ && ! pre_phase_) {
+      SCOPED_TIMER(kTimerRegretUpdate, st);
+      if (bucketed) {
+	UpdateRegretsBucketed(node, street_buckets, vals, succ_vals);
+      } else {
+	// Need values for current board if this is unabstracted system
+	UpdateRegrets(node, lbd, vals, succ_vals);
       }
     }
   }
-
-  return vals;
 }
 
-shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state) {
+void VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, double *vals) {
   int pa = p0_node->PlayerActing();
   Node *node = pa == 0 ? p0_node : p1_node;
   Node *responding_node = pa == 0 ? p1_node : p0_node;
@@ -337,146 +318,28 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
   if (num_hole_cards == 1) num_enc = max_card1;
   else                     num_enc = max_card1 * max_card1;
 
-  const shared_ptr<double []> &opp_probs = state->OppProbs();
-  unique_ptr<shared_ptr<double []> []> succ_opp_probs(new shared_ptr<double []> [num_succs]);
+  double *opp_probs = state->OppProbs();
+  if (num_succs > kMaxSuccs) {
+    fprintf(stderr, "Too many succs: %i\n", num_succs);
+    exit(-1);
+  }
+  ValueArena *arena = state->Arena();
+  ArenaFrame frame(arena);
+  double *succ_opp_probs[kMaxSuccs];
   if (num_succs == 1) {
-    succ_opp_probs[0].reset(new double[num_enc]);
-    for (int i = 0; i < num_enc; ++i) {
-      succ_opp_probs[0][i] = opp_probs[i];
-    }
+    // Opponent reach probabilities are unchanged
+    succ_opp_probs[0] = opp_probs;
   } else {
     int *street_buckets = state->StreetBuckets(st);
     for (int s = 0; s < num_succs; ++s) {
-      succ_opp_probs[s].reset(new double[num_enc]);
+      succ_opp_probs[s] = arena->Allocate(num_enc);
       for (int i = 0; i < num_enc; ++i) succ_opp_probs[s][i] = 0;
     }
-
-    int dsi = node->DefaultSuccIndex();
-    bool bucketed = ! buckets_.None(st) &&
-      node->LastBetTo() < card_abstraction_.BucketThreshold(st);
-
-    // At most one of d_sumprob_values, i_sumprob_vals and c_sumprob_vals is non-null.
-    // All may be null.
-    CFRStreetValues<double> *d_sumprob_values = nullptr;
-    CFRStreetValues<int> *i_sumprob_values = nullptr;
-    CFRStreetValues<unsigned char> *c_sumprob_values = nullptr;
-    AbstractCFRStreetValues *sumprob_values = nullptr;
-    if (sumprobs_ && sumprob_streets_[st]) {
-      sumprob_values = sumprobs_->StreetValues(st);
-      if (sumprob_values == nullptr) {
-	fprintf(stderr, "No sumprobs values for street %u?!?\n", st);
-	exit(-1);
-      }
-      if ((d_sumprob_values =
-	   dynamic_cast<CFRStreetValues<double> *>(sumprob_values)) ==
-	  nullptr) {
-	if ((i_sumprob_values =
-	     dynamic_cast<CFRStreetValues<int> *>(sumprob_values)) ==
-	    nullptr) {
-	  if ((c_sumprob_values =
-	       dynamic_cast<CFRStreetValues<unsigned char> *>(sumprob_values)) ==
-	      nullptr) {
-	    fprintf(stderr, "sumprobs not doubles, ints or chars?!?\n");
-	    exit(-1);
-	  }
-	}
-      }
-    }
-
-    if (value_calculation_) {
-      // For example, RGBR calculation
-      if (br_current_) {
-	fprintf(stderr, "br_current_ not handled currently\n");
-	exit(-1);
-      } else {
-	if (d_sumprob_values) {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
-	} else if (i_sumprob_values) {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
-	} else if (c_sumprob_values) {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *c_sumprob_values, dsi, it_, soft_warmup_,
-			  hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
-	} else {
-	  fprintf(stderr, "value_calculation_ and ! br_current_ requires sumprobs\n");
-	  exit(-1);
-	}
-      }
-    } else if (bucketed) {
-      // This is true when we are running CFR+ on a bucketed system.  We
-      // don't want to get the current strategy from the regrets during the
-      // iteration, because the regrets for each bucket are in an intermediate
-      // state.  Instead we compute the current strategy once at the
-      // beginning of each iteration.
-      // current_strategy_ always contains doubles
-      CFRStreetValues<double> *street_values =
-	dynamic_cast< CFRStreetValues<double> *>(current_strategy_->StreetValues(st));
-      int nt = node->NonterminalID();
-      double *current_probs = street_values->AllValues(pa, nt);
-      if (d_sumprob_values) {
-	ProcessOppProbs(node, hands, street_buckets, opp_probs.get(), succ_opp_probs.get(),
-			current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
-			d_sumprob_values);
-      } else {
-	ProcessOppProbs(node, hands, street_buckets, opp_probs.get(), succ_opp_probs.get(),
-			current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
-			i_sumprob_values);
-      }
-    } else {
-      // Such a mess!
-      AbstractCFRStreetValues *cs_values;
-      if (value_calculation_ && ! br_current_) {
-	if (sumprobs_.get() == nullptr) {
-	  fprintf(stderr, "VCFR::OppChoice() null sumprobs?!?\n");
-	  exit(-1);
-	}
-	// value_calculation_ now handled above
-	cs_values = sumprobs_->StreetValues(st);
-      } else {
-	if (sumprobs_.get() == nullptr) {
-	  fprintf(stderr, "VCFR::OppChoice() null regrets?!?\n");
-	  exit(-1);
-	}
-	cs_values = regrets_->StreetValues(st);
-      }
-      CFRStreetValues<double> *d_cs_values;
-      CFRStreetValues<int> *i_cs_values;
-      if ((d_cs_values =
-	   dynamic_cast<CFRStreetValues<double> *>(cs_values))) {
-	if (d_sumprob_values) {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], d_sumprob_values);
-	} else {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], i_sumprob_values);
-	}
-      } else {
-	i_cs_values = dynamic_cast<CFRStreetValues<int> *>(cs_values);
-	if (i_cs_values == nullptr) {
-	  fprintf(stderr, "Neither int nor double cs values?!?\n");
-	  exit(-1);
-	}
-	if (d_sumprob_values) {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], d_sumprob_values);
-	} else {
-	  ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs.get(),
-			  succ_opp_probs.get(), *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
-			  sumprob_scaling_[st], i_sumprob_values);
-	}
-      }
-    }
+    OppSuccProbs(node, lbd, hands, street_buckets, opp_probs, succ_opp_probs);
   }
 
   unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
-  shared_ptr<double []> vals;
+  double *succ_vals = nullptr;
   for (int s = 0; s < num_succs; ++s) {
     // We can't prune now.  Is that a big problem?
 #if 0
@@ -490,98 +353,252 @@ shared_ptr<double []> VCFR::OppChoice(Node *p0_node, Node *p1_node, int gbd, VCF
     int p0_s = pa == 0 ? s : succ_mapping[s];
     int p1_s = pa == 0 ? succ_mapping[s] : s;
     VCFRState succ_state(*state, node, s, succ_opp_probs[s]);
-    shared_ptr<double []> succ_vals = Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd,
-					      &succ_state, st);
-    if (vals == nullptr) {
-      vals = succ_vals;
+    // The first succ writes directly into vals; the rest are summed in.
+    if (s == 0) {
+      Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd, &succ_state, st, vals);
     } else {
+      if (succ_vals == nullptr) succ_vals = arena->Allocate(num_hole_card_pairs);
+      Process(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), gbd, &succ_state, st, succ_vals);
       for (int i = 0; i < num_hole_card_pairs; ++i) {
 	vals[i] += succ_vals[i];
       }
     }
   }
-  if (vals == nullptr) {
-    // This can happen if there were non-zero opp probs on the prior street,
-    // but the board cards just dealt blocked all the opponent hands with
-    // non-zero probability.
-    vals.reset(new double[num_hole_card_pairs]);
-    for (int i = 0; i < num_hole_card_pairs; ++i) vals[i] = 0;
+}
+
+// Computes the opponent reach probabilities for each succ of an opp-choice node from the
+// reach probabilities at the node.  The succ reach probabilities must be zeroed by the caller.
+// Also updates the sumprobs if appropriate.  Only called when there are at least two succs.
+void VCFR::OppSuccProbs(Node *node, int lbd, const CanonicalCards *hands, int *street_buckets,
+			double *opp_probs, double **succ_opp_probs) {
+  int pa = node->PlayerActing();
+  int st = node->Street();
+  int dsi = node->DefaultSuccIndex();
+  bool bucketed = ! buckets_.None(st) &&
+    node->LastBetTo() < card_abstraction_.BucketThreshold(st);
+
+  // At most one of d_sumprob_values, i_sumprob_vals and c_sumprob_vals is non-null.
+  // All may be null.
+  CFRStreetValues<double> *d_sumprob_values = nullptr;
+  CFRStreetValues<int> *i_sumprob_values = nullptr;
+  CFRStreetValues<unsigned char> *c_sumprob_values = nullptr;
+  AbstractCFRStreetValues *sumprob_values = nullptr;
+  if (sumprobs_ && sumprob_streets_[st]) {
+    sumprob_values = sumprobs_->StreetValues(st);
+    if (sumprob_values == nullptr) {
+      fprintf(stderr, "No sumprobs values for street %u?!?\n", st);
+      exit(-1);
+    }
+    if ((d_sumprob_values =
+	 dynamic_cast<CFRStreetValues<double> *>(sumprob_values)) ==
+	nullptr) {
+      if ((i_sumprob_values =
+	   dynamic_cast<CFRStreetValues<int> *>(sumprob_values)) ==
+	  nullptr) {
+	if ((c_sumprob_values =
+	     dynamic_cast<CFRStreetValues<unsigned char> *>(sumprob_values)) ==
+	    nullptr) {
+	  fprintf(stderr, "sumprobs not doubles, ints or chars?!?\n");
+	  exit(-1);
+	}
+      }
+    }
   }
 
-  return vals;
+  if (value_calculation_) {
+    // For example, RGBR calculation
+    if (br_current_) {
+      fprintf(stderr, "br_current_ not handled currently\n");
+      exit(-1);
+    } else {
+      if (d_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *d_sumprob_values, dsi, it_, soft_warmup_,
+			hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+      } else if (i_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *i_sumprob_values, dsi, it_, soft_warmup_,
+			hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+      } else if (c_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *c_sumprob_values, dsi, it_, soft_warmup_,
+			hard_warmup_, sumprob_scaling_[st], (CFRStreetValues<int> *)nullptr);
+      } else {
+	fprintf(stderr, "value_calculation_ and ! br_current_ requires sumprobs\n");
+	exit(-1);
+      }
+    }
+  } else if (bucketed) {
+    // This is true when we are running CFR+ on a bucketed system.  We
+    // don't want to get the current strategy from the regrets during the
+    // iteration, because the regrets for each bucket are in an intermediate
+    // state.  Instead we compute the current strategy once at the
+    // beginning of each iteration.
+    // current_strategy_ always contains doubles
+    CFRStreetValues<double> *street_values =
+      dynamic_cast< CFRStreetValues<double> *>(current_strategy_->StreetValues(st));
+    int nt = node->NonterminalID();
+    double *current_probs = street_values->AllValues(pa, nt);
+    if (d_sumprob_values) {
+      ProcessOppProbs(node, hands, street_buckets, opp_probs, succ_opp_probs,
+		      current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+		      d_sumprob_values);
+    } else {
+      ProcessOppProbs(node, hands, street_buckets, opp_probs, succ_opp_probs,
+		      current_probs, it_, soft_warmup_, hard_warmup_, sumprob_scaling_[st],
+		      i_sumprob_values);
+    }
+  } else {
+    // Such a mess!
+    AbstractCFRStreetValues *cs_values;
+    if (value_calculation_ && ! br_current_) {
+      if (sumprobs_.get() == nullptr) {
+	fprintf(stderr, "VCFR::OppChoice() null sumprobs?!?\n");
+	exit(-1);
+      }
+      // value_calculation_ now handled above
+      cs_values = sumprobs_->StreetValues(st);
+    } else {
+      if (sumprobs_.get() == nullptr) {
+	fprintf(stderr, "VCFR::OppChoice() null regrets?!?\n");
+	exit(-1);
+      }
+      cs_values = regrets_->StreetValues(st);
+    }
+    CFRStreetValues<double> *d_cs_values;
+    CFRStreetValues<int> *i_cs_values;
+    CFRStreetValues<unsigned char> *c_cs_values;
+    CFRStreetValues<unsigned short> *s_cs_values;
+    if ((d_cs_values =
+	 dynamic_cast<CFRStreetValues<double> *>(cs_values))) {
+      if (d_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], d_sumprob_values);
+      } else {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *d_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], i_sumprob_values);
+      }
+    } else if ((i_cs_values =
+		dynamic_cast<CFRStreetValues<int> *>(cs_values))) {
+      if (d_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], d_sumprob_values);
+      } else {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *i_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], i_sumprob_values);
+      }
+    } else if ((c_cs_values =
+		dynamic_cast<CFRStreetValues<unsigned char> *>(cs_values))) {
+      // Quantized regrets.  The board's scale factor cancels out in regret matching.
+      if (d_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *c_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], d_sumprob_values);
+      } else {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *c_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], i_sumprob_values);
+      }
+    } else if ((s_cs_values =
+		dynamic_cast<CFRStreetValues<unsigned short> *>(cs_values))) {
+      if (d_sumprob_values) {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *s_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], d_sumprob_values);
+      } else {
+	ProcessOppProbs(node, lbd, hands, bucketed, street_buckets, opp_probs,
+			succ_opp_probs, *s_cs_values, dsi, it_, soft_warmup_, hard_warmup_,
+			sumprob_scaling_[st], i_sumprob_values);
+      }
+    } else {
+      fprintf(stderr, "Unexpected type of cs values\n");
+      exit(-1);
+    }
+  }
 }
 
-using std::queue;
-using std::shared_ptr;
-using std::unique_ptr;
+VCFRJob::VCFRJob(int ngbd_begin, int ngbd_end) : notify_finished_(false),
+						   ngbd_begin_(ngbd_begin) {
+  int num_boards = ngbd_end - ngbd_begin;
+  if (num_boards < 0) {
+    fprintf(stderr, "VCFRJob: bad board range %i-%i\n", ngbd_begin, ngbd_end);
+    exit(-1);
+  }
+  board_vals_.resize(num_boards);
+  num_remaining_.store(num_boards, std::memory_order_relaxed);
+}
 
-Request::Request(RequestType t, Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state,
-		 int *prev_canons) : request_type_(t), p0_node_(p0_node), p1_node_(p1_node),
-				     gbd_(gbd), pred_state_(pred_state), prev_canons_(prev_canons) {
+bool VCFRJob::SetBoardVals(int ngbd, const shared_ptr<double []> &vals) {
+  board_vals_[ngbd - ngbd_begin_] = vals;
+  return num_remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1;
 }
 
-VCFRWorker::VCFRWorker(VCFR *vcfr) : vcfr_(vcfr) {
+VCFRTask::VCFRTask(void) : p0_node_(nullptr), p1_node_(nullptr), gbd_(-1),
+			   pred_state_(nullptr), job_(nullptr) {
 }
 
-// Should be sure to call this while the worker is idle
-void VCFRWorker::Reset(int pst) {
-  int num_prev_hole_card_pairs = Game::NumHoleCardPairs(pst);
-  vals_.reset(new double[num_prev_hole_card_pairs]);
-  for (int i = 0; i < num_prev_hole_card_pairs; ++i) vals_[i] = 0;
+VCFRTask::VCFRTask(Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state,
+		   VCFRJob *job) : p0_node_(p0_node), p1_node_(p1_node), gbd_(gbd),
+				   pred_state_(pred_state), job_(job) {
 }
 
-void VCFRWorker::HandleRequest(const Request &request) {
-  Node *p0_node = request.P0Node();
-  Node *p1_node = request.P1Node();
-  int ngbd = request.GBD();
-  const VCFRState &pred_state = request.PredState();
-  int *prev_canons = request.PrevCanons();
-  int nst = p0_node->Street();
-  if (vals_.get() == nullptr) {
-    fprintf(stderr, "vals_ uninitialized\n");
-    exit(-1);
-  }
-  shared_ptr<double []> bd_vals = vcfr_->ProcessSubgame(p0_node, p1_node, ngbd, pred_state);
-  const CanonicalCards *hands = pred_state.Hands(nst, ngbd);
-  int board_variants = BoardTree::NumVariants(nst, ngbd);
-  int num_hands = hands->NumRaw();
-  int max_card1 = Game::MaxCard() + 1;
-  for (int nhcp = 0; nhcp < num_hands; ++nhcp) {
-    const Card *cards = hands->Cards(nhcp);
-    Card hi = cards[0];
-    Card lo = cards[1];
-    int enc = hi * max_card1 + lo;
-    int prev_canon = prev_canons[enc];
-    vals_[prev_canon] += board_variants * bd_vals[nhcp];
-  }
+// Identifies the worker (if any) that the current thread is running.  Threads that are not
+// workers (e.g., the main thread) use the task deque in workers_[0].
+static thread_local const VCFR *tl_vcfr = nullptr;
+static thread_local int tl_worker_index = 0;
+// The arena for threads that are neither workers nor the owner of the workers; e.g., the
+// threads of solve_all_subgames that share one DynamicCBR.
+static thread_local ValueArena tl_arena;
+
+VCFRWorker::VCFRWorker(VCFR *vcfr, int index) : vcfr_(vcfr), index_(index) {
+  pthread_mutex_init(&deque_mutex_, NULL);
 }
 
-void VCFRWorker::MainLoop(void) {
-  queue<Request> *request_queue = vcfr_->GetRequestQueue();
-  pthread_mutex_t *queue_mutex = vcfr_->GetQueueMutex();
-  pthread_cond_t *queue_not_empty = vcfr_->GetQueueNotEmpty();
-  pthread_cond_t *queue_not_full = vcfr_->GetQueueNotFull();
+VCFRWorker::~VCFRWorker(void) {
+  pthread_mutex_destroy(&deque_mutex_);
+}
 
-  while (true) {
-    pthread_mutex_lock(queue_mutex);
+void VCFRWorker::Push(const VCFRTask &task) {
+  pthread_mutex_lock(&deque_mutex_);
+  deque_.push_back(task);
+  pthread_mutex_unlock(&deque_mutex_);
+}
 
-    // Wait while the queue is empty.
-    while (request_queue->empty()) {
-      pthread_cond_wait(queue_not_empty, queue_mutex);
-    }
+bool VCFRWorker::Pop(VCFRTask *task) {
+  pthread_mutex_lock(&deque_mutex_);
+  if (deque_.empty()) {
+    pthread_mutex_unlock(&deque_mutex_);
+    return false;
+  }
+  *task = deque_.back();
+  deque_.pop_back();
+  pthread_mutex_unlock(&deque_mutex_);
+  return true;
+}
 
-    Request request = request_queue->front();
-    request_queue->pop();
+bool VCFRWorker::Steal(VCFRTask *task) {
+  pthread_mutex_lock(&deque_mutex_);
+  if (deque_.empty()) {
+    pthread_mutex_unlock(&deque_mutex_);
+    return false;
+  }
+  *task = deque_.front();
+  deque_.pop_front();
+  pthread_mutex_unlock(&deque_mutex_);
+  return true;
+}
 
-    pthread_cond_signal(queue_not_full);
-    pthread_mutex_unlock(queue_mutex);
-    if (request.GetRequestType() == RequestType::QUIT) {
-      vcfr_->IncrementNumDone();
-      break;
+void VCFRWorker::MainLoop(void) {
+  tl_vcfr = vcfr_;
+  tl_worker_index = index_;
+  while (! vcfr_->Quitting()) {
+    if (! vcfr_->RunOneTask(index_)) {
+      vcfr_->WaitForWork();
     }
-
-    HandleRequest(request);
-    vcfr_->IncrementNumDone();
   }
 }
 
@@ -600,76 +617,152 @@ void VCFRWorker::Join(void) {
 }
 
 void VCFR::SpawnWorkers(void) {
+  owner_ = pthread_self();
   workers_.reset(new unique_ptr<VCFRWorker>[num_threads_]);
-  for (int i = 0; i < num_threads_; ++i) {
-    workers_[i].reset(new VCFRWorker(this));
-    workers_[i]->Run();
+  for (int t = 0; t < num_threads_; ++t) {
+    workers_[t].reset(new VCFRWorker(this, t));
+  }
+  for (int t = 1; t < num_threads_; ++t) {
+    workers_[t]->Run();
+  }
+}
+
+int VCFR::WorkerIndex(void) const {
+  return tl_vcfr == this ? tl_worker_index : 0;
+}
+
+// Scratch vectors must never be shared between threads, so callers other than our workers and
+// their owner get an arena of their own.
+ValueArena *VCFR::CallerArena(void) {
+  if (tl_vcfr == this) return workers_[tl_worker_index]->Arena();
+  if (pthread_equal(pthread_self(), owner_)) return workers_[0]->Arena();
+  return &tl_arena;
+}
+
+void VCFR::HandleTask(const VCFRTask &task) {
+  shared_ptr<double []> bd_vals = ProcessSubgame(task.P0Node(), task.P1Node(), task.GBD(),
+						 task.PredState());
+  VCFRJob *job = task.Job();
+  // Check before setting the values; once the last board is in, the creator of the job may
+  // destroy it.
+  bool notify = job->NotifyFinished();
+  if (job->SetBoardVals(task.GBD(), bd_vals)) {
+    if (notify) JobFinished(job);
+    // Wake up the creator of the job if it is waiting in HelpUntilDone().
+    NotifyWorkers();
+  }
+}
+
+// Runs one task, taken from our own deque if possible and otherwise stolen from another worker.
+// Returns false if no task could be found.
+bool VCFR::RunOneTask(int t) {
+  VCFRTask task;
+  bool found = workers_[t]->Pop(&task);
+  for (int i = 1; ! found && i < num_threads_; ++i) {
+    found = workers_[(t + i) % num_threads_]->Steal(&task);
+  }
+  if (! found) return false;
+  num_pending_.fetch_sub(1, std::memory_order_relaxed);
+  HandleTask(task);
+  return true;
+}
+
+// Idle workers sleep here until some task is pushed or we are shutting down.
+void VCFR::WaitForWork(void) {
+  SCOPED_TIMER(kTimerQueueWait, -1);
+  pthread_mutex_lock(&idle_mutex_);
+  while (num_pending_.load(std::memory_order_relaxed) == 0 && ! Quitting()) {
+    pthread_cond_wait(&work_available_, &idle_mutex_);
+  }
+  pthread_mutex_unlock(&idle_mutex_);
+}
+
+// Waits until some task is pushed or the given job is done.
+void VCFR::WaitForWorkOrDone(const VCFRJob &job) {
+  SCOPED_TIMER(kTimerQueueWait, -1);
+  pthread_mutex_lock(&idle_mutex_);
+  while (num_pending_.load(std::memory_order_relaxed) == 0 && ! job.Done()) {
+    pthread_cond_wait(&work_available_, &idle_mutex_);
   }
+  pthread_mutex_unlock(&idle_mutex_);
 }
 
-void VCFR::IncrementNumDone(void) {
-  pthread_mutex_lock(&num_done_mutex_);
-  ++num_done_;
-  pthread_mutex_unlock(&num_done_mutex_);
+void VCFR::NotifyWorkers(void) {
+  pthread_mutex_lock(&idle_mutex_);
+  pthread_cond_broadcast(&work_available_);
+  pthread_mutex_unlock(&idle_mutex_);
 }
 
+// The thread that creates a job doesn't sit idle while the job is in progress.  It works on
+// tasks from its own deque (most likely boards from this job) and steals when that runs dry.
+// When there is nothing to steal it sleeps until more work shows up or the last of its boards
+// finishes.
+void VCFR::HelpUntilDone(int t, const VCFRJob &job) {
+  while (! job.Done()) {
+    if (! RunOneTask(t)) WaitForWorkOrDone(job);
+  }
+}
+
+// Adds the values for the next-street board ngbd into the values for the previous-street hands.
+void VCFR::AccumulateBoardVals(int nst, int ngbd, const CanonicalCards *hands,
+			       const int *prev_canons, const double *next_vals, double *vals) {
+  int max_card1 = Game::MaxCard() + 1;
+  int board_variants = BoardTree::NumVariants(nst, ngbd);
+  int num_next_hands = hands->NumRaw();
+  for (int nh = 0; nh < num_next_hands; ++nh) {
+    const Card *cards = hands->Cards(nh);
+    Card hi = cards[0];
+    Card lo = cards[1];
+    int enc = hi * max_card1 + lo;
+    int prev_canon = prev_canons[enc];
+    vals[prev_canon] += board_variants * next_vals[nh];
+  }
+}
+
+// Pushes one task per next-street board onto the deque of the current thread, and then helps
+// process tasks until all of them are finished.  Idle threads steal boards from us.  Because a
+// worker can itself call Split() on a later street, large subtrees get divided further while small
+// ones are processed serially by whoever holds them.
 void VCFR::Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state, int *prev_canons,
 		 double *vals) {
   int nst = p0_node->Street();
+  SCOPED_TIMER(kTimerSplit, nst);
   int pst = nst - 1;
-
-  // Reset the workers; i.e., initialize all values to zero
-  // Can only do this while workers are idle
-  for (int t = 0; t < num_threads_; ++t) {
-    workers_[t]->Reset(pst);
-  }
-  
-  num_done_ = 0;
   int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
   int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
-  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
-    // Push onto the queue under mutex protection
-    pthread_mutex_lock(&queue_mutex_);
-    // Wait until there’s room in the queue.
-    while (request_queue_.size() == kRequestQueueMaxSize) {
-      pthread_cond_wait(&queue_not_full_, &queue_mutex_);
-    }
-    Request request(RequestType::PROCESS, p0_node, p1_node, ngbd, state, prev_canons);
-    request_queue_.push(request);
-    // Inform waiting threads that queue has a request
-    pthread_cond_signal(&queue_not_empty_);
-    pthread_mutex_unlock(&queue_mutex_);
+  int t = WorkerIndex();
+  VCFRJob job(ngbd_begin, ngbd_end);
+  // Count the tasks before pushing them so that a thief's decrement can never make the count
+  // negative.
+  num_pending_.fetch_add(ngbd_end - ngbd_begin, std::memory_order_relaxed);
+  // Push in reverse order so that we pop boards in order while thieves take the last boards.
+  for (int ngbd = ngbd_end - 1; ngbd >= ngbd_begin; --ngbd) {
+    workers_[t]->Push(VCFRTask(p0_node, p1_node, ngbd, state, &job));
   }
+  NotifyWorkers();
 
-  // There should be a better way to do this without a busy loop
-  int num_requests = ngbd_end - ngbd_begin;
-  while (true) {
-    // No mutex needed, right?
-    if (num_done_ == num_requests) break;
-    usleep(1);
-  }
+  HelpUntilDone(t, job);
 
-  int num_prev_hole_card_pairs = Game::NumHoleCardPairs(pst);
-  for (int t = 0; t < num_threads_; ++t) {
-    double *t_vals = workers_[t]->Vals();
-    for (int i = 0; i < num_prev_hole_card_pairs; ++i) {
-      vals[i] += t_vals[i];
-    }
+  for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
+    AccumulateBoardVals(nst, ngbd, state->Hands(nst, ngbd), prev_canons,
+			job.BoardVals(ngbd).get(), vals);
   }
 }
 
 void VCFR::SetStreetBuckets(int st, int gbd, VCFRState *state) {
   if (buckets_.None(st)) return;
+  SetStreetBuckets(st, gbd, state->Hands(st, gbd), state->StreetBuckets(st));
+}
+
+void VCFR::SetStreetBuckets(int st, int gbd, const CanonicalCards *hands, int *street_buckets) {
   int num_board_cards = Game::NumBoardCards(st);
   const Card *board = BoardTree::Board(st, gbd);
   Card cards[7];
   for (int i = 0; i < num_board_cards; ++i) {
     cards[i + 2] = board[i];
   }
-  const CanonicalCards *hands = state->Hands(st, gbd);
   int max_street = Game::MaxStreet();
   int num_hole_card_pairs = Game::NumHoleCardPairs(st);
-  int *street_buckets = state->StreetBuckets(st);
   for (int i = 0; i < num_hole_card_pairs; ++i) {
     unsigned int h;
     if (st == max_street) {
@@ -687,9 +780,11 @@ void VCFR::SetStreetBuckets(int st, int gbd, VCFRState *state) {
   }
 }
 
-shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
-					  VCFRState *state) {
+void VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+			 double *vals) {
   int nst = p0_node->Street();
+  SCOPED_TIMER(kTimerStreetInitial, nst);
+  COUNT_NODE(nst, kNodeStreetInitial);
   int pst = nst - 1;
   int prev_num_hole_card_pairs = Game::NumHoleCardPairs(pst);
 #if 0
@@ -718,7 +813,6 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
   Card max_card = Game::MaxCard();
   int num_encodings = (max_card + 1) * (max_card + 1);
   unique_ptr<int []> prev_canons(new int[num_encodings]);
-  shared_ptr<double []> vals(new double[prev_num_hole_card_pairs]);
   for (int i = 0; i < prev_num_hole_card_pairs; ++i) vals[i] = 0;
   for (int ph = 0; ph < prev_num_hole_card_pairs; ++ph) {
     if (pred_hands->NumVariants(ph) > 0) {
@@ -738,30 +832,26 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
     }
   }
 
-  if (nst == split_street_ && subgame_street_ == -1 && num_threads_ > 1) {
-    // By default, split on the flop.
-    Split(p0_node, p1_node, pgbd, state, prev_canons.get(), vals.get());
+  if (num_threads_ > 1 && subgame_street_ == -1 &&
+      (nst == split_street_ || (nst > split_street_ && nst <= max_split_street_))) {
+    // By default, split on the flop, and again on the turn.
+    Split(p0_node, p1_node, pgbd, state, prev_canons.get(), vals);
+  } else if (nst == Game::MaxStreet() && board_batch_size_ > 1) {
+    StreetInitialBatched(p0_node, p1_node, pgbd, state, prev_canons.get(), vals);
   } else {
     int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
     int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+    ValueArena *arena = state->Arena();
+    ArenaFrame frame(arena);
+    double *next_vals = arena->Allocate(Game::NumHoleCardPairs(nst));
     for (int ngbd = ngbd_begin; ngbd < ngbd_end; ++ngbd) {
-      const CanonicalCards *hands = state->Hands(nst, ngbd);
       SetStreetBuckets(nst, ngbd, state);
       // I can pass unset values for sum_opp_probs and total_card_probs.  I
       // know I will come across an opp choice node before getting to a terminal
       // node.
-      shared_ptr<double []> next_vals = Process(p0_node, p1_node, ngbd, state, nst);
-
-      int board_variants = BoardTree::NumVariants(nst, ngbd);
-      int num_next_hands = hands->NumRaw();
-      for (int nh = 0; nh < num_next_hands; ++nh) {
-	const Card *cards = hands->Cards(nh);
-	Card hi = cards[0];
-	Card lo = cards[1];
-	int enc = hi * (max_card + 1) + lo;
-	int prev_canon = prev_canons[enc];
-	vals[prev_canon] += board_variants * next_vals[nh];
-      }
+      Process(p0_node, p1_node, ngbd, state, nst, next_vals);
+      AccumulateBoardVals(nst, ngbd, state->Hands(nst, ngbd), prev_canons.get(), next_vals,
+			  vals);
     }
   }
   
@@ -780,51 +870,251 @@ shared_ptr<double []> VCFR::StreetInitial(Node *p0_node, Node *p1_node, int pgbd
       vals[ph] = vals[prev_canons[pred_hands->Canon(ph)]];
     }
   }
+}
 
-  return vals;
+// Processes the final-street boards under a street-initial node in blocks of board_batch_size_
+// boards.  Each block is traversed once, which saves walking the final-street betting tree once
+// per board.  The values computed for each board are the same as those computed by Process(), and
+// they are accumulated in the same order, so results are unchanged.
+void VCFR::StreetInitialBatched(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+				int *prev_canons, double *vals) {
+  int nst = p0_node->Street();
+  int pst = nst - 1;
+  int ngbd_begin = BoardTree::SuccBoardBegin(pst, pgbd, nst);
+  int ngbd_end = BoardTree::SuccBoardEnd(pst, pgbd, nst);
+  int num_hole_card_pairs = Game::NumHoleCardPairs(nst);
+  bool bucketed = ! buckets_.None(nst);
+  ValueArena *arena = state->Arena();
+  ArenaFrame frame(arena);
+  double *next_vals = arena->Allocate(board_batch_size_ * num_hole_card_pairs);
+  for (int ngbd0 = ngbd_begin; ngbd0 < ngbd_end; ngbd0 += board_batch_size_) {
+    int num_boards = ngbd_end - ngbd0;
+    if (num_boards > board_batch_size_) num_boards = board_batch_size_;
+    VCFRBatchState batch_state(state->P(), nst, ngbd0, num_boards, state->OppProbs(),
+			       state->GetHandTree(), bucketed, arena);
+    if (bucketed) {
+      for (int b = 0; b < num_boards; ++b) {
+	SetStreetBuckets(nst, ngbd0 + b, batch_state.Hands(b), batch_state.StreetBuckets(b));
+      }
+    }
+    ProcessBatch(p0_node, p1_node, &batch_state, next_vals);
+    for (int b = 0; b < num_boards; ++b) {
+      AccumulateBoardVals(nst, ngbd0 + b, batch_state.Hands(b), prev_canons,
+			  next_vals + b * num_hole_card_pairs, vals);
+    }
+  }
+}
+
+// Batched counterpart of InitializeTerminalProbs().
+void VCFR::InitializeTerminalProbs(VCFRBatchState *state, bool showdown) {
+  if (state->FoldProbs() && (! showdown || state->ShowdownProbs())) return;
+  int num_boards = state->NumBoards();
+  int num_hole_card_pairs = state->NumHoleCardPairs();
+  ValueArena *arena = state->Arena();
+  double *fold_probs = arena->Allocate(num_boards * num_hole_card_pairs);
+  double *showdown_probs =
+    showdown ? arena->Allocate(num_boards * num_hole_card_pairs) : nullptr;
+  for (int b = 0; b < num_boards; ++b) {
+    TerminalProbs(state->Hands(b), state->OppProbs(b), fold_probs + b * num_hole_card_pairs,
+		  showdown ? showdown_probs + b * num_hole_card_pairs : nullptr);
+  }
+  state->SetTerminalProbs(fold_probs, showdown_probs);
+}
+
+void VCFR::OurChoiceBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals) {
+  int pa = p0_node->PlayerActing();
+  Node *node = pa == 0 ? p0_node : p1_node;
+  Node *responding_node = pa == 0 ? p1_node : p0_node;
+  int num_succs = node->NumSuccs();
+  int num_boards = state->NumBoards();
+  int num_hole_card_pairs = state->NumHoleCardPairs();
+  unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
+  if (num_succs > kMaxSuccs) {
+    fprintf(stderr, "Too many succs: %i\n", num_succs);
+    exit(-1);
+  }
+  ValueArena *arena = state->Arena();
+  ArenaFrame frame(arena);
+  // As in OurChoice(), our terminal succs share one pass of TerminalProbs().
+  bool any_terminal = false, any_showdown = false;
+  for (int s = 0; s < num_succs; ++s) {
+    Node *p0_succ = p0_node->IthSucc(pa == 0 ? s : succ_mapping[s]);
+    if (p0_succ->Terminal()) {
+      any_terminal = true;
+      if (p0_succ->NumRemaining() > 1) any_showdown = true;
+    }
+  }
+  VCFRBatchState terminal_state(*state);
+  if (any_terminal) {
+    SCOPED_TIMER(kTimerTerminalEval, state->St());
+    InitializeTerminalProbs(&terminal_state, any_showdown);
+  }
+  double *succ_vals[kMaxSuccs];
+  for (int s = 0; s < num_succs; ++s) {
+    succ_vals[s] = num_succs == 1 ? vals : arena->Allocate(num_boards * num_hole_card_pairs);
+    int p0_s = pa == 0 ? s : succ_mapping[s];
+    int p1_s = pa == 0 ? succ_mapping[s] : s;
+    VCFRBatchState succ_state(terminal_state);
+    ProcessBatch(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), &succ_state, succ_vals[s]);
+  }
+  if (num_succs > 1) {
+    double *board_succ_vals[kMaxSuccs];
+    for (int b = 0; b < num_boards; ++b) {
+      int offset = b * num_hole_card_pairs;
+      for (int s = 0; s < num_succs; ++s) board_succ_vals[s] = succ_vals[s] + offset;
+      OurVals(node, state->LocalBoardIndex(b), state->StreetBuckets(b), board_succ_vals,
+	      vals + offset);
+    }
+  }
 }
 
-void VCFR::InitializeOppData(VCFRState *state, int st, int gbd) {
-  if (state->SumOppProbs() != -1) return;
+void VCFR::OppChoiceBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals) {
+  int pa = p0_node->PlayerActing();
+  Node *node = pa == 0 ? p0_node : p1_node;
+  Node *responding_node = pa == 0 ? p1_node : p0_node;
+  int num_succs = node->NumSuccs();
+  int num_boards = state->NumBoards();
+  int num_hole_card_pairs = state->NumHoleCardPairs();
+  int num_vals = num_boards * num_hole_card_pairs;
+  int num_hole_cards = Game::NumCardsForStreet(0);
+  int max_card1 = Game::MaxCard() + 1;
+  int num_enc;
+  if (num_hole_cards == 1) num_enc = max_card1;
+  else                     num_enc = max_card1 * max_card1;
+
+  if (num_succs > kMaxSuccs) {
+    fprintf(stderr, "Too many succs: %i\n", num_succs);
+    exit(-1);
+  }
+  ValueArena *arena = state->Arena();
+  ArenaFrame frame(arena);
+  unique_ptr<int []> succ_mapping = GetSuccMapping(node, responding_node);
+  if (num_succs == 1) {
+    // Opponent reach probabilities are unchanged
+    VCFRBatchState succ_state(*state);
+    succ_state.SetTerminalProbs(nullptr, nullptr);
+    int p0_s = pa == 0 ? 0 : succ_mapping[0];
+    int p1_s = pa == 0 ? succ_mapping[0] : 0;
+    ProcessBatch(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), &succ_state, vals);
+    return;
+  }
+  double *succ_opp_probs[kMaxSuccs];
+  for (int s = 0; s < num_succs; ++s) {
+    succ_opp_probs[s] = arena->Allocate(num_boards * num_enc);
+    for (int i = 0; i < num_boards * num_enc; ++i) succ_opp_probs[s][i] = 0;
+  }
+  double *board_succ_opp_probs[kMaxSuccs];
+  for (int b = 0; b < num_boards; ++b) {
+    for (int s = 0; s < num_succs; ++s) board_succ_opp_probs[s] = succ_opp_probs[s] + b * num_enc;
+    OppSuccProbs(node, state->LocalBoardIndex(b), state->Hands(b), state->StreetBuckets(b),
+		 state->OppProbs(b), board_succ_opp_probs);
+  }
+  double *succ_vals = nullptr;
+  for (int s = 0; s < num_succs; ++s) {
+    int p0_s = pa == 0 ? s : succ_mapping[s];
+    int p1_s = pa == 0 ? succ_mapping[s] : s;
+    VCFRBatchState succ_state(*state, succ_opp_probs[s]);
+    // The first succ writes directly into vals; the rest are summed in.
+    if (s == 0) {
+      ProcessBatch(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), &succ_state, vals);
+    } else {
+      if (succ_vals == nullptr) succ_vals = arena->Allocate(num_vals);
+      ProcessBatch(p0_node->IthSucc(p0_s), p1_node->IthSucc(p1_s), &succ_state, succ_vals);
+      for (int i = 0; i < num_vals; ++i) {
+	vals[i] += succ_vals[i];
+      }
+    }
+  }
+}
+
+// Batched counterpart of Process() for a block of boards on the final street.  Writes the values
+// of our hands on each board of the block into vals, one board after another.
+void VCFR::ProcessBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals) {
+  SCOPED_TIMER(kTimerVCFRProcess, state->St());
+  if (p0_node->Terminal()) {
+    ArenaFrame frame(state->Arena());
+    bool showdown = p0_node->NumRemaining() > 1;
+    COUNT_NODE(state->St(), showdown ? kNodeShowdown : kNodeFold);
+    SCOPED_TIMER(kTimerTerminalEval, state->St());
+    InitializeTerminalProbs(state, showdown);
+    // The terminal values are elementwise in the terminal probs, so the whole block is done at
+    // once.
+    int num_vals = state->NumBoards() * state->NumHoleCardPairs();
+    if (showdown) {
+      ShowdownVals(p0_node, num_vals, state->ShowdownProbs(), vals);
+    } else {
+      FoldVals(p0_node, state->P(), num_vals, state->FoldProbs(), vals);
+    }
+    return;
+  }
+  if (p0_node->PlayerActing() == state->P()) {
+    COUNT_NODE(state->St(), kNodeOurChoice);
+    OurChoiceBatch(p0_node, p1_node, state, vals);
+  } else {
+    COUNT_NODE(state->St(), kNodeOppChoice);
+    OppChoiceBatch(p0_node, p1_node, state, vals);
+  }
+}
+
+// Computes the fold probs (and, if needed, the showdown probs) for the state's opponent reach
+// probabilities, unless they are already available.  They are allocated from the current arena
+// frame.
+void VCFR::InitializeTerminalProbs(VCFRState *state, int st, int gbd, bool showdown) {
+  if (state->FoldProbs() && (! showdown || state->ShowdownProbs())) return;
   const CanonicalCards *hands = state->Hands(st, gbd);
-  state->AllocateTotalCardProbs();
-  double sum_opp_probs;
-  CommonBetResponseCalcs(st, hands, state->OppProbs().get(), &sum_opp_probs,
-			 state->TotalCardProbs().get());
-  state->SetSumOppProbs(sum_opp_probs);
+  int num_hole_card_pairs = hands->NumRaw();
+  ValueArena *arena = state->Arena();
+  double *fold_probs = arena->Allocate(num_hole_card_pairs);
+  double *showdown_probs = showdown ? arena->Allocate(num_hole_card_pairs) : nullptr;
+  TerminalProbs(hands, state->OppProbs(), fold_probs, showdown_probs);
+  state->SetTerminalProbs(fold_probs, showdown_probs);
 }
 
-shared_ptr<double []> VCFR::Process(Node *p0_node, Node *p1_node, int gbd, VCFRState *state,
-				    int last_st) {
+void VCFR::Process(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, int last_st,
+		   double *vals) {
   int st = p0_node->Street();
+  SCOPED_TIMER(kTimerVCFRProcess, st);
   if (p0_node->Terminal()) {
-    InitializeOppData(state, st, gbd);
-    if (p0_node->NumRemaining() == 1) {
-      return Fold(p0_node, state->P(), state->Hands(st, gbd), state->OppProbs().get(),
-		  state->SumOppProbs(), state->TotalCardProbs().get());
+    // Normally OurChoice() has already computed the terminal probs for us.  If not, they only
+    // need to live as long as this terminal's state.
+    ArenaFrame frame(state->Arena());
+    bool showdown = p0_node->NumRemaining() > 1;
+    COUNT_NODE(st, showdown ? kNodeShowdown : kNodeFold);
+    SCOPED_TIMER(kTimerTerminalEval, st);
+    InitializeTerminalProbs(state, st, gbd, showdown);
+    int num_hole_card_pairs = Game::NumHoleCardPairs(st);
+    if (showdown) {
+      ShowdownVals(p0_node, num_hole_card_pairs, state->ShowdownProbs(), vals);
     } else {
-      return Showdown(p0_node, state->Hands(st, gbd), state->OppProbs().get(),
-		      state->SumOppProbs(), state->TotalCardProbs().get());
+      FoldVals(p0_node, state->P(), num_hole_card_pairs, state->FoldProbs(), vals);
     }
+    return;
   }
   if (st > last_st) {
-    return StreetInitial(p0_node, p1_node, gbd, state);
+    StreetInitial(p0_node, p1_node, gbd, state, vals);
+    return;
   }
-  shared_ptr<double []> vals;
   if (p0_node->PlayerActing() == state->P()) {
-    vals = OurChoice(p0_node, p1_node, gbd, state);
+    COUNT_NODE(st, kNodeOurChoice);
+    OurChoice(p0_node, p1_node, gbd, state, vals);
   } else {
-    vals = OppChoice(p0_node, p1_node, gbd, state);
+    COUNT_NODE(st, kNodeOppChoice);
+    OppChoice(p0_node, p1_node, gbd, state, vals);
   }
-  return vals;
 }
 
 // Must be called on the root of the entire tree
 shared_ptr<double []> VCFR::ProcessRoot(const BettingTrees *betting_trees, int p,
 					HandTree *hand_tree) {
-  VCFRState state(p, hand_tree);
+  // Nothing should be outstanding on the arena at the start of an iteration.
+  ValueArena *arena = CallerArena();
+  arena->Reset();
+  ArenaFrame frame(arena);
+  VCFRState state(p, hand_tree, arena);
   SetStreetBuckets(0, 0, &state);
-  return Process(betting_trees->Root(), betting_trees->Root(), 0, &state, 0);
+  shared_ptr<double []> vals(new double[Game::NumHoleCardPairs(0)]);
+  Process(betting_trees->Root(), betting_trees->Root(), 0, &state, 0, vals.get());
+  return vals;
 }
 
 // Two implementations of ProcessSubgame().  One if you have a VCFRState object to work from,
@@ -832,22 +1122,40 @@ shared_ptr<double []> VCFR::ProcessRoot(const BettingTrees *betting_trees, int p
 shared_ptr<double []> VCFR::ProcessSubgame(Node *p0_node, Node *p1_node, int gbd, 
 					   const VCFRState &pred_state) {
   // It's important to create a new state object, I think.  In the case of multithreading, we don't
-  // want multiple threads modifying the same state object.
+  // want multiple threads modifying the same state object.  The new state must also use the arena
+  // of the thread we are running on.
   VCFRState state(pred_state.P(), pred_state.OppProbs(), pred_state.GetHandTree(),
-		  pred_state.ActionSequence());
+		  pred_state.ActionSequence(), CallerArena());
   int st = p0_node->Street();
   SetStreetBuckets(st, gbd, &state);
-  return Process(p0_node, p1_node, gbd, &state, st);
+  shared_ptr<double []> vals(new double[Game::NumHoleCardPairs(st)]);
+  Process(p0_node, p1_node, gbd, &state, st, vals.get());
+  return vals;
 }
 
 shared_ptr<double []> VCFR::ProcessSubgame(Node *p0_node, Node *p1_node, int gbd, int p,
 					   shared_ptr<double []> opp_probs,
 					   const HandTree *hand_tree,
 					   const string &action_sequence) {
-  VCFRState state(p, opp_probs, hand_tree, action_sequence);
+  VCFRState state(p, opp_probs.get(), hand_tree, action_sequence, CallerArena());
   int st = p0_node->Street();
   SetStreetBuckets(st, gbd, &state);
-  return Process(p0_node, p1_node, gbd, &state, st);
+  shared_ptr<double []> vals(new double[Game::NumHoleCardPairs(st)]);
+  Process(p0_node, p1_node, gbd, &state, st, vals.get());
+  return vals;
+}
+
+// Reports, for each thread's arena, the total bytes reserved and the most bytes used by a single
+// frame at each depth of the recursion.
+void VCFR::ReportArenaStats(void) const {
+  for (int t = 0; t < num_threads_; ++t) {
+    const ValueArena *arena = workers_[t]->Arena();
+    fprintf(stderr, "Thread %i arena: %zu bytes reserved\n", t, arena->BytesReserved());
+    int max_depth = arena->MaxDepth();
+    for (int d = 0; d < max_depth; ++d) {
+      fprintf(stderr, "  Depth %i: %zu bytes\n", d, arena->MaxBytesAtDepth(d));
+    }
+  }
 }
 
 void VCFR::SetCurrentStrategy(Node *node) {
@@ -905,6 +1213,9 @@ VCFR::VCFR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
   num_threads_ = num_threads;
   subgame_street_ = cfr_config_.SubgameStreet();
   split_street_ = 1; // Default
+  max_split_street_ = Game::MaxStreet() - 1;
+  board_batch_size_ = cfr_config_.BoardBatchSize();
+  if (board_batch_size_ == 0) board_batch_size_ = kDefaultBoardBatchSize;
   soft_warmup_ = cfr_config_.SoftWarmup();
   hard_warmup_ = cfr_config_.HardWarmup();
   nn_regrets_ = cfr_config_.NNR();
@@ -1004,40 +1315,19 @@ VCFR::VCFR(const CardAbstraction &ca, const CFRConfig &cc, const Buckets &bucket
     }
   }
 
-  pthread_mutex_init(&queue_mutex_, NULL);
-  pthread_mutex_init(&num_done_mutex_, NULL);
-  pthread_cond_init(&queue_not_empty_, NULL);
-  pthread_cond_init(&queue_not_full_, NULL);
+  num_pending_.store(0);
+  quit_.store(false);
+  pthread_mutex_init(&idle_mutex_, NULL);
+  pthread_cond_init(&work_available_, NULL);
   SpawnWorkers();
 }
 
 VCFR::~VCFR(void) {
-  num_done_ = 0;
-  // Add num_threads_ quit requests to the queue
-  for (int t = 0; t < num_threads_; ++t) {
-    pthread_mutex_lock(&queue_mutex_);
-    // Wait until there’s room in the queue.
-    while (request_queue_.size() == kRequestQueueMaxSize) {
-      pthread_cond_wait(&queue_not_full_, &queue_mutex_);
-    }
-    Request request(RequestType::QUIT, nullptr, nullptr, -1, nullptr, nullptr);
-    request_queue_.push(request);
-    // Inform waiting threads that queue has a request
-    pthread_cond_signal(&queue_not_empty_);
-    pthread_mutex_unlock(&queue_mutex_);
-  }
-  // There should be a better way to do this without a busy loop
-  while (true) {
-    // No mutex needed, right?
-    if (num_done_ == num_threads_) break;
-    usleep(1);
-  }
-  for (int t = 0; t < num_threads_; ++t) {
+  quit_.store(true, std::memory_order_release);
+  NotifyWorkers();
+  for (int t = 1; t < num_threads_; ++t) {
     workers_[t]->Join();
   }
-  pthread_mutex_destroy(&queue_mutex_);
-  pthread_mutex_destroy(&num_done_mutex_);
-  pthread_cond_destroy(&queue_not_empty_);
-  pthread_cond_destroy(&queue_not_full_);
+  pthread_mutex_destroy(&idle_mutex_);
+  pthread_cond_destroy(&work_available_);
 }
-
@@ -1,45 +1,73 @@
 #ifndef _VCFR_H_
 #define _VCFR_H_
 
+#include <pthread.h>
+
+#include <atomic>
+#include <deque>
 #include <memory>
 #include <string>
-#include <queue>
+#include <vector>
 
 #include "cfr_values.h"
 #include "prob_method.h"
+#include "value_arena.h"
 
 class BettingAbstraction;
 class BettingTrees;
 class Buckets;
+class CanonicalCards;
 class CardAbstraction;
 class CFRConfig;
 class HandTree;
+class VCFRBatchState;
 class VCFRState;
 class VCFRWorker;
 
-enum class RequestType {
-  PROCESS,
-  QUIT
+// A VCFRJob is the set of next-street boards under one street-initial node that is being
+// processed in parallel.  The values for each board are kept separately so that the thread that
+// created the job can combine them in board order.  That way results don't depend on which thread
+// happened to process which board.
+class VCFRJob {
+public:
+  VCFRJob(int ngbd_begin, int ngbd_end);
+  virtual ~VCFRJob(void) {}
+  // Returns true if this was the last board of the job to finish.
+  bool SetBoardVals(int ngbd, const std::shared_ptr<double []> &vals);
+  const std::shared_ptr<double []> &BoardVals(int ngbd) const {
+    return board_vals_[ngbd - ngbd_begin_];
+  }
+  // What HelpUntilDone() waits for.  By default, that every board has finished.
+  virtual bool Done(void) const {return num_remaining_.load(std::memory_order_acquire) == 0;}
+  void ClearBoardVals(void) {std::vector< std::shared_ptr<double []> >().swap(board_vals_);}
+  // Whether VCFR::JobFinished() should be called when the last board finishes.  Must not be set
+  // for jobs whose creator may destroy them as soon as Done() returns true.
+  bool NotifyFinished(void) const {return notify_finished_;}
+protected:
+  bool notify_finished_;
+private:
+  int ngbd_begin_;
+  std::vector< std::shared_ptr<double []> > board_vals_;
+  std::atomic<int> num_remaining_;
 };
 
-class Request {
+// A VCFRTask is the processing of a single next-street board belonging to some VCFRJob.
+class VCFRTask {
 public:
-  Request(RequestType t, Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state,
-	  int *prev_canons);
-  ~Request(void) {}
-  RequestType GetRequestType(void) const {return request_type_;}
+  VCFRTask(void);
+  VCFRTask(Node *p0_node, Node *p1_node, int gbd, const VCFRState *pred_state, VCFRJob *job);
+  ~VCFRTask(void) {}
   Node *P0Node(void) const {return p0_node_;}
   Node *P1Node(void) const {return p1_node_;}
   int GBD(void) const {return gbd_;}
   const VCFRState &PredState(void) const {return *pred_state_;}
-  int *PrevCanons(void) const {return prev_canons_;}
+  VCFRJob *Job(void) const {return job_;}
 private:
-  RequestType request_type_;
   Node *p0_node_;
   Node *p1_node_;
   int gbd_;
   const VCFRState *pred_state_;
-  int *prev_canons_;
+  VCFRJob *job_;
 };
 
 class VCFR {
@@ -59,41 +87,63 @@ class VCFR {
   void SetRegrets(std::shared_ptr<CFRValues> &src) {regrets_ = src;}
   void ClearSumprobs(void) {sumprobs_.reset();}
   virtual void SetStreetBuckets(int st, int gbd, VCFRState *state);
+  void SetStreetBuckets(int st, int gbd, const CanonicalCards *hands, int *street_buckets);
   virtual void SetValueCalculation(bool b) {value_calculation_ = b;}
   virtual void SetBestResponseStreet(int st, bool b) {best_response_streets_[st] = b;}
   virtual void SetSplitStreet(int st) {split_street_ = st;}
+  virtual void SetMaxSplitStreet(int st) {max_split_street_ = st;}
+  void SetBoardBatchSize(int n) {board_batch_size_ = n;}
   int It(void) const {return it_;}
   void SpawnWorkers(void);
-  void IncrementNumDone(void);
-  std::queue<Request> *GetRequestQueue(void) {return &request_queue_;}
-  pthread_mutex_t *GetQueueMutex(void) {return &queue_mutex_;}
-  pthread_mutex_t *GetNumDoneMutex(void) {return &num_done_mutex_;}
-  pthread_cond_t *GetQueueNotEmpty(void) {return &queue_not_empty_;}
-  pthread_cond_t *GetQueueNotFull(void) {return &queue_not_full_;}
+  bool RunOneTask(int t);
+  void WaitForWork(void);
+  bool Quitting(void) const {return quit_.load(std::memory_order_acquire);}
+  void ReportArenaStats(void) const;
  protected:
-  static const int kRequestQueueMaxSize = 100;
-  
+  static const int kMaxSuccs = 50;
+  static const int kDefaultBoardBatchSize = 16;
+
   template <typename T>
-    void UpdateRegrets(Node *node, double *vals, std::shared_ptr<double []> *succ_vals, T *regrets);
-  virtual void UpdateRegrets(Node *node, int lbd, double *vals,
-			     std::shared_ptr<double []> *succ_vals);
+    void UpdateRegrets(Node *node, double *vals, double **succ_vals, T *regrets);
+  virtual void UpdateRegrets(Node *node, int lbd, double *vals, double **succ_vals);
+  unsigned int QuantizationSeed(int pa, int nt, int lbd) const;
   virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals, int *regrets);
+				     double **succ_vals, int *regrets);
   virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals, double *regrets);
+				     double **succ_vals, double *regrets);
   virtual void UpdateRegretsBucketed(Node *node, int *street_buckets, double *vals,
-				     std::shared_ptr<double []> *succ_vals);
-  virtual std::shared_ptr<double []> OurChoice(Node *p0_node, Node *p1_node, int gbd,
-					       VCFRState *state);
-  virtual std::shared_ptr<double []> OppChoice(Node *p0_node, Node *p1_node, int gbd,
-					       VCFRState *state);
+				     double **succ_vals);
+  virtual void OurChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, double *vals);
+  void OurVals(Node *node, int lbd, int *street_buckets, double **succ_vals, double *vals);
+  virtual void OppChoice(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, double *vals);
+  void OppSuccProbs(Node *node, int lbd, const CanonicalCards *hands, int *street_buckets,
+		    double *opp_probs, double **succ_opp_probs);
   virtual void Split(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
 		     int *prev_canons, double *vals);
-  virtual std::shared_ptr<double []> StreetInitial(Node *p0_node, Node *p1_node, int pgbd,
-						   VCFRState *state);
-  virtual void InitializeOppData(VCFRState *state, int st, int gbd);
-  virtual std::shared_ptr<double []> Process(Node *p0_node, Node *p1_node, int gbd,
-					     VCFRState *state, int last_st);
+  void HandleTask(const VCFRTask &task);
+  // Called by whichever thread finishes the last board of a job, if the job asks for it (see
+  // VCFRJob::NotifyFinished()).
+  virtual void JobFinished(VCFRJob *job) {}
+  static void AccumulateBoardVals(int nst, int ngbd, const CanonicalCards *hands,
+				  const int *prev_canons, const double *next_vals, double *vals);
+  void HelpUntilDone(int t, const VCFRJob &job);
+  void WaitForWorkOrDone(const VCFRJob &job);
+  void NotifyWorkers(void);
+  int WorkerIndex(void) const;
+  ValueArena *CallerArena(void);
+  virtual void StreetInitial(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+			     double *vals);
+  virtual void InitializeTerminalProbs(VCFRState *state, int st, int gbd, bool showdown);
+  // Writes the values of our hands for the street last_st into vals.  Scratch vectors come from
+  // the arena of the calling thread (state->Arena()).
+  virtual void Process(Node *p0_node, Node *p1_node, int gbd, VCFRState *state, int last_st,
+		       double *vals);
+  void StreetInitialBatched(Node *p0_node, Node *p1_node, int pgbd, VCFRState *state,
+			    int *prev_canons, double *vals);
+  void InitializeTerminalProbs(VCFRBatchState *state, bool showdown);
+  void OurChoiceBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals);
+  void OppChoiceBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals);
+  void ProcessBatch(Node *p0_node, Node *p1_node, VCFRBatchState *state, double *vals);
   virtual void SetCurrentStrategy(Node *node);
   
   const CardAbstraction &card_abstraction_;
@@ -112,6 +162,12 @@ class VCFR {
   bool value_calculation_;
   bool prune_;
   int split_street_;
+  // Boards on streets after split_street_ and up to max_split_street_ may be split again by
+  // whichever thread is processing the enclosing board.
+  int max_split_street_;
+  // Number of final-street boards traversed together (see StreetInitialBatched()).  One means
+  // boards are traversed one at a time.
+  int board_batch_size_;
   int subgame_street_;
   bool nn_regrets_;
   int soft_warmup_;
@@ -123,28 +179,37 @@ class VCFR {
   std::unique_ptr<double []> sumprob_scaling_;
   int it_;
   bool pre_phase_;
+  // workers_[0] holds the task deque of the thread that calls into this object; it has no
+  // pthread of its own.  workers_[1]...workers_[num_threads_-1] are spawned threads.
   std::unique_ptr<std::unique_ptr<VCFRWorker> []> workers_;
-  std::queue<Request> request_queue_;
-  pthread_mutex_t queue_mutex_;
-  pthread_mutex_t num_done_mutex_;
-  pthread_cond_t queue_not_empty_;
-  pthread_cond_t queue_not_full_;
-  int num_done_;
+  // The thread that created the workers.  Only it uses the arena of workers_[0].
+  pthread_t owner_;
+  // Number of tasks not yet taken by any thread.  Incremented before the tasks are pushed.
+  std::atomic<int> num_pending_;
+  std::atomic<bool> quit_;
+  pthread_mutex_t idle_mutex_;
+  pthread_cond_t work_available_;
 };
 
+// Each worker owns a deque of tasks.  The owner pushes and pops at the back; idle threads steal
+// from the front.  Stealing from the front tends to take the tasks that were pushed earliest.
 class VCFRWorker {
 public:
-  VCFRWorker(VCFR *vcfr);
-  ~VCFRWorker(void) {}
-  void Reset(int pst);
-  void HandleRequest(const Request &request);
+  VCFRWorker(VCFR *vcfr, int index);
+  ~VCFRWorker(void);
+  void Push(const VCFRTask &task);
+  bool Pop(VCFRTask *task);
+  bool Steal(VCFRTask *task);
   void MainLoop(void);
   void Run(void);
   void Join(void);
-  double *Vals(void) const {return vals_.get();}
+  ValueArena *Arena(void) {return &arena_;}
 private:
   VCFR *vcfr_;
-  std::unique_ptr<double []> vals_;
+  int index_;
+  ValueArena arena_;
+  std::deque<VCFRTask> deque_;
+  pthread_mutex_t deque_mutex_;
   pthread_t pthread_id_;
 };
 
@@ -2,8 +2,9 @@
 // the probabilities of each opponent hand reaching the current state.  Some data is shared
 // between different VCFRState objects.  For example, if we are at an "our choice" node then
 // the current state and all the successor states will share the same opponent reach
-// probabilities.  We use shared_ptrs to allow such data to be shared between states, and yet
-// be cleaned up when no longer needed.
+// probabilities.  Arrays are allocated from the thread's ValueArena (or are owned by the
+// street-initial state), so states hold plain pointers.  A state never outlives the
+// predecessor state it was created from.
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -12,95 +13,139 @@
 #include <string>
 
 #include "betting_tree.h"
-#include "cfr_utils.h" // CommonBetResponseCalcs()
 #include "game.h"
 #include "hand_tree.h"
+#include "value_arena.h"
 #include "vcfr_state.h"
 
-using std::shared_ptr;
 using std::string;
+using std::unique_ptr;
 
-static shared_ptr<int []> AllocateStreetBuckets(void) {
+static unique_ptr<int []> AllocateStreetBuckets(void) {
   int max_num_hole_card_pairs = Game::NumHoleCardPairs(0);
   int max_street = Game::MaxStreet();
   int num = (max_street + 1) * max_num_hole_card_pairs;
-  shared_ptr<int []> street_buckets(new int[num]);
+  unique_ptr<int []> street_buckets(new int[num]);
   return street_buckets;
 }
 
-static shared_ptr<double []> AllocateOppProbs(void) {
+static double *AllocateOppProbs(ValueArena *arena) {
   int num_hole_cards = Game::NumCardsForStreet(0);
   int max_card1 = Game::MaxCard() + 1;
   int num_enc;
   if (num_hole_cards == 1) num_enc = max_card1;
   else                     num_enc = max_card1 * max_card1;
-  shared_ptr<double []> opp_probs(new double[num_enc]);
+  double *opp_probs = arena->Allocate(num_enc);
   for (int i = 0; i < num_enc; ++i) opp_probs[i] = 1.0;
   return opp_probs;
 }
 
-void VCFRState::AllocateTotalCardProbs(void) {
-  int max_card1 = Game::MaxCard() + 1;
-  total_card_probs_.reset(new double[max_card1]);
-}
-
 // Called at the root of the tree.
-VCFRState::VCFRState(int p, const HandTree *hand_tree) {
+VCFRState::VCFRState(int p, const HandTree *hand_tree, ValueArena *arena) {
   p_ = p;
-  opp_probs_ = AllocateOppProbs();
-  street_buckets_ = AllocateStreetBuckets();
+  arena_ = arena;
+  opp_probs_ = AllocateOppProbs(arena_);
+  owned_street_buckets_ = AllocateStreetBuckets();
+  street_buckets_ = owned_street_buckets_.get();
   action_sequence_ = "x";
   hand_tree_ = hand_tree;
-  total_card_probs_ = nullptr;
-  // Signifies opp data is uninitialized
-  sum_opp_probs_ = -1;
-#if 0
-  const CanonicalCards *hands = hand_tree_->Hands(0, 0);
-  // We need to initialize total_card_probs_ and sum_opp_probs_ because an open fold is allowed.
-  CommonBetResponseCalcs(0, hands, opp_probs_.get(), &sum_opp_probs_, total_card_probs_.get());
-#endif
+  fold_probs_ = nullptr;
+  showdown_probs_ = nullptr;
 }
   
-// Called at an internal street-initial node.  We do not initialize total_card_probs_ (and set
-// sum_opp_probs_ to zero) because we know we will come across an opp-choice node before we need
-// those members.
-VCFRState::VCFRState(int p, const shared_ptr<double []> &opp_probs, const HandTree *hand_tree,
-		     const string &action_sequence) {
+// Called at an internal street-initial node.  We do not compute the terminal probs because we
+// know we will come across an opp-choice node before we need them.  The caller must keep opp_probs alive for the lifetime of this state.
+VCFRState::VCFRState(int p, double *opp_probs, const HandTree *hand_tree,
+		     const string &action_sequence, ValueArena *arena) {
   p_ = p;
+  arena_ = arena;
   opp_probs_ = opp_probs;
-  total_card_probs_ = nullptr;
-  // Signifies opp data is uninitialized
-  sum_opp_probs_ = -1;
+  fold_probs_ = nullptr;
+  showdown_probs_ = nullptr;
   hand_tree_ = hand_tree;
   action_sequence_ = action_sequence;
-  street_buckets_ = AllocateStreetBuckets();
+  owned_street_buckets_ = AllocateStreetBuckets();
+  street_buckets_ = owned_street_buckets_.get();
 }
 
 // Create a new VCFRState corresponding to taking an action of ours.
 VCFRState::VCFRState(const VCFRState &pred, Node *node, int s) {
   p_ = pred.P();
+  arena_ = pred.Arena();
   opp_probs_ = pred.OppProbs();
   hand_tree_ = pred.GetHandTree();
   action_sequence_ = pred.ActionSequence() + node->ActionName(s);
   street_buckets_ = pred.AllStreetBuckets();
-  total_card_probs_ = pred.TotalCardProbs();
-  sum_opp_probs_ = pred.SumOppProbs();
+  fold_probs_ = pred.FoldProbs();
+  showdown_probs_ = pred.ShowdownProbs();
 }
 
 // Create a new VCFRState corresponding to taking an opponent action.
-VCFRState::VCFRState(const VCFRState &pred, Node *node, int s,
-		     const shared_ptr<double []> &opp_probs) {
+VCFRState::VCFRState(const VCFRState &pred, Node *node, int s, double *opp_probs) {
   p_ = pred.P();
+  arena_ = pred.Arena();
   opp_probs_ = opp_probs;
   hand_tree_ = pred.GetHandTree();
   action_sequence_ = pred.ActionSequence() + node->ActionName(s);
   street_buckets_ = pred.AllStreetBuckets();
-  // Signifies opp data is uninitialized
-  sum_opp_probs_ = -1;
-  total_card_probs_ = nullptr;
+  fold_probs_ = nullptr;
+  showdown_probs_ = nullptr;
+}
+
+// Called at a street-initial node.  All boards share opp_probs, which the caller must keep alive
+// for the lifetime of this state.  The caller is responsible for filling in the street buckets.
+VCFRBatchState::VCFRBatchState(int p, int st, int gbd_begin, int num_boards, double *opp_probs,
+			       const HandTree *hand_tree, bool bucketed, ValueArena *arena) {
+  p_ = p;
+  st_ = st;
+  gbd_begin_ = gbd_begin;
+  num_boards_ = num_boards;
+  num_hole_card_pairs_ = Game::NumHoleCardPairs(st);
+  opp_probs_ = opp_probs;
+  opp_probs_stride_ = 0;
+  fold_probs_ = nullptr;
+  showdown_probs_ = nullptr;
+  if (bucketed) {
+    owned_street_buckets_.reset(new int[num_boards * num_hole_card_pairs_]);
+  }
+  street_buckets_ = owned_street_buckets_.get();
+  hand_tree_ = hand_tree;
+  arena_ = arena;
+}
+
+VCFRBatchState::VCFRBatchState(const VCFRBatchState &pred) {
+  p_ = pred.p_;
+  st_ = pred.st_;
+  gbd_begin_ = pred.gbd_begin_;
+  num_boards_ = pred.num_boards_;
+  num_hole_card_pairs_ = pred.num_hole_card_pairs_;
+  opp_probs_ = pred.opp_probs_;
+  opp_probs_stride_ = pred.opp_probs_stride_;
+  fold_probs_ = pred.fold_probs_;
+  showdown_probs_ = pred.showdown_probs_;
+  street_buckets_ = pred.street_buckets_;
+  hand_tree_ = pred.hand_tree_;
+  arena_ = pred.arena_;
+}
+
+VCFRBatchState::VCFRBatchState(const VCFRBatchState &pred, double *opp_probs) {
+  int num_hole_cards = Game::NumCardsForStreet(0);
+  int max_card1 = Game::MaxCard() + 1;
+  p_ = pred.p_;
+  st_ = pred.st_;
+  gbd_begin_ = pred.gbd_begin_;
+  num_boards_ = pred.num_boards_;
+  num_hole_card_pairs_ = pred.num_hole_card_pairs_;
+  opp_probs_ = opp_probs;
+  opp_probs_stride_ = num_hole_cards == 1 ? max_card1 : max_card1 * max_card1;
+  fold_probs_ = nullptr;
+  showdown_probs_ = nullptr;
+  street_buckets_ = pred.street_buckets_;
+  hand_tree_ = pred.hand_tree_;
+  arena_ = pred.arena_;
 }
 
 int *VCFRState::StreetBuckets(int st) const {
   int max_num_hole_card_pairs = Game::NumHoleCardPairs(0);
-  return street_buckets_.get() + st * max_num_hole_card_pairs;
+  return street_buckets_ + st * max_num_hole_card_pairs;
 }
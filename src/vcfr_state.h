@@ -7,23 +7,28 @@
 #include "hand_tree.h"
 
 class CanonicalCards;
+class ValueArena;
 
 class VCFRState {
  public:
-  VCFRState(int p, const HandTree *hand_tree);
-  VCFRState(int p, const std::shared_ptr<double []> &opp_probs, const HandTree *hand_tree, 
-	    const std::string &action_sequence);
+  VCFRState(int p, const HandTree *hand_tree, ValueArena *arena);
+  VCFRState(int p, double *opp_probs, const HandTree *hand_tree, 
+	    const std::string &action_sequence, ValueArena *arena);
   VCFRState(const VCFRState &pred, Node *node, int s);
-  VCFRState(const VCFRState &pred, Node *node, int s, const std::shared_ptr<double []> &opp_probs);
+  VCFRState(const VCFRState &pred, Node *node, int s, double *opp_probs);
   virtual ~VCFRState(void) {}
   int P(void) const {return p_;}
-  std::shared_ptr<double []> OppProbs(void) const {return opp_probs_;}
-  double SumOppProbs(void) const {return sum_opp_probs_;}
-  void SetSumOppProbs(double s) {sum_opp_probs_ = s;}
-  void AllocateTotalCardProbs(void);
-  std::shared_ptr<double []> TotalCardProbs(void) const {return total_card_probs_;}
+  double *OppProbs(void) const {return opp_probs_;}
+  // Outputs of TerminalProbs() for opp_probs_; null if not yet computed.
+  double *FoldProbs(void) const {return fold_probs_;}
+  double *ShowdownProbs(void) const {return showdown_probs_;}
+  void SetTerminalProbs(double *fold_probs, double *showdown_probs) {
+    fold_probs_ = fold_probs;
+    showdown_probs_ = showdown_probs;
+  }
   int *StreetBuckets(int st) const;
-  const std::shared_ptr<int []> AllStreetBuckets(void) const {return street_buckets_;}
+  int *AllStreetBuckets(void) const {return street_buckets_;}
+  ValueArena *Arena(void) const {return arena_;}
   const std::string &ActionSequence(void) const {return action_sequence_;}
   const HandTree *GetHandTree(void) const {return hand_tree_;}
   int RootSt(void) const {return hand_tree_->RootSt();}
@@ -32,15 +37,71 @@ class VCFRState {
   const CanonicalCards *Hands(int st, int gbd) const {
     return hand_tree_->Hands(st, gbd);
   }
-  void SetOppProbs(const std::shared_ptr<double []> &opp_probs) {opp_probs_ = opp_probs;}
+  void SetOppProbs(double *opp_probs) {opp_probs_ = opp_probs;}
  protected:
   int p_;
-  std::shared_ptr<double []> opp_probs_;
-  double sum_opp_probs_;
-  std::shared_ptr<double []> total_card_probs_;
-  std::shared_ptr<int []> street_buckets_;
+  double *opp_probs_;
+  double *fold_probs_;
+  double *showdown_probs_;
+  // Only street-initial states own the street buckets; all other states point to their
+  // predecessor's.
+  std::unique_ptr<int []> owned_street_buckets_;
+  int *street_buckets_;
   std::string action_sequence_;
   const HandTree *hand_tree_;
+  ValueArena *arena_;
+};
+
+// The state for a block of consecutive boards on the final street that are traversed together
+// (see VCFR::ProcessBatch()).  Per-board vectors are stored contiguously, one board after another,
+// so that the vectors for the whole block can be processed in one pass where that is possible.
+// At the street-initial node all boards share the predecessor's opponent reach probabilities;
+// the stride between boards is then zero.  Batch states do not track the action sequence.
+class VCFRBatchState {
+ public:
+  VCFRBatchState(int p, int st, int gbd_begin, int num_boards, double *opp_probs,
+		 const HandTree *hand_tree, bool bucketed, ValueArena *arena);
+  // Create a new state corresponding to taking an action of ours
+  explicit VCFRBatchState(const VCFRBatchState &pred);
+  // Create a new state corresponding to taking an opponent action.  opp_probs holds the reach
+  // probabilities of every board in the block.
+  VCFRBatchState(const VCFRBatchState &pred, double *opp_probs);
+  ~VCFRBatchState(void) {}
+  int P(void) const {return p_;}
+  int St(void) const {return st_;}
+  int NumBoards(void) const {return num_boards_;}
+  int NumHoleCardPairs(void) const {return num_hole_card_pairs_;}
+  int GBD(int b) const {return gbd_begin_ + b;}
+  int LocalBoardIndex(int b) const {return hand_tree_->LocalBoardIndex(st_, gbd_begin_ + b);}
+  const CanonicalCards *Hands(int b) const {return hand_tree_->Hands(st_, gbd_begin_ + b);}
+  double *OppProbs(int b) const {return opp_probs_ + b * opp_probs_stride_;}
+  // Outputs of TerminalProbs() for the whole block; null if not yet computed.
+  double *FoldProbs(void) const {return fold_probs_;}
+  double *ShowdownProbs(void) const {return showdown_probs_;}
+  void SetTerminalProbs(double *fold_probs, double *showdown_probs) {
+    fold_probs_ = fold_probs;
+    showdown_probs_ = showdown_probs;
+  }
+  // Null if the street is not bucketed
+  int *StreetBuckets(int b) const {
+    return street_buckets_ ? street_buckets_ + b * num_hole_card_pairs_ : nullptr;
+  }
+  ValueArena *Arena(void) const {return arena_;}
+ protected:
+  int p_;
+  int st_;
+  int gbd_begin_;
+  int num_boards_;
+  int num_hole_card_pairs_;
+  double *opp_probs_;
+  int opp_probs_stride_;
+  double *fold_probs_;
+  double *showdown_probs_;
+  // Only the street-initial state owns the street buckets
+  std::unique_ptr<int []> owned_street_buckets_;
+  int *street_buckets_;
+  const HandTree *hand_tree_;
+  ValueArena *arena_;
 };
 
 #endif